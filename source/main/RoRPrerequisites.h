@@ -113,6 +113,7 @@ class Autopilot;
 class Axle;
 class Beam;
 class BeamEngine;
+class BeamRenderer;
 class BeamThreadStats;
 class Buoyance;
 class Cache_Entry;
@@ -164,6 +165,7 @@ class SoundManager;
 class SoundScriptInstance;
 class SoundScriptManager;
 class TerrainManager;
+class ThreadPool;
 class TorqueCurve;
 class TruckEditor;
 class TruckHUD;
@@ -0,0 +1,592 @@
+/*
+This source file is part of Rigs of Rods
+Copyright 2005-2012 Pierre-Michel Ricordel
+Copyright 2007-2012 Thomas Fischer
+
+For more information, see http://www.rigsofrods.com/
+
+Rigs of Rods is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 3, as
+published by the Free Software Foundation.
+
+Rigs of Rods is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "CacheIndex.h"
+
+#include "BeamData.h" // for authorinfo_t
+#include "CacheSystem.h"
+
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // OGRE_PLATFORM_WIN32
+
+using namespace Ogre;
+
+#define CACHE_INDEX_BYTEORDER 0x01020304
+
+// deduplicating string table used while writing, offset 0 is always the empty string
+struct cache_index_strings_t
+{
+	std::map<String, unsigned int> offsets;
+	std::vector<char> data;
+
+	cache_index_strings_t() : data(1, 0) {}
+
+	unsigned int add(const String &str)
+	{
+		if (str.empty()) return 0;
+		std::map<String, unsigned int>::iterator it = offsets.find(str);
+		if (it != offsets.end()) return it->second;
+		unsigned int offset = (unsigned int)data.size();
+		data.insert(data.end(), str.begin(), str.end());
+		data.push_back(0);
+		offsets[str] = offset;
+		return offset;
+	}
+};
+
+// orders index keys by the string they point to, then by record
+struct cache_index_string_less_t
+{
+	const char *strings;
+	cache_index_string_less_t(const char *strings) : strings(strings) {}
+	bool operator()(const cache_index_key_t &a, const cache_index_key_t &b) const
+	{
+		int res = strcmp(strings + a.key, strings + b.key);
+		if (res) return res < 0;
+		return a.record < b.record;
+	}
+};
+
+// orders the category index by category id, then by record
+static bool cacheIndexCategoryLess(const cache_index_key_t &a, const cache_index_key_t &b)
+{
+	if (a.key != b.key) return (int)a.key < (int)b.key;
+	return a.record < b.record;
+}
+
+static void appendBlock(std::vector<char> &out, const void *ptr, size_t len)
+{
+	const char *p = (const char *)ptr;
+	out.insert(out.end(), p, p + len);
+	// keep all sections 4 byte aligned
+	while (out.size() % 4) out.push_back(0);
+}
+
+CacheIndex::CacheIndex() :
+	  authors(0)
+	, data(0)
+	, header(0)
+	, lists(0)
+	, records(0)
+	, size(0)
+	, strings(0)
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+	, fileHandle(INVALID_HANDLE_VALUE)
+	, mappingHandle(0)
+#endif // OGRE_PLATFORM_WIN32
+{
+}
+
+CacheIndex::~CacheIndex()
+{
+	close();
+}
+
+bool CacheIndex::open(String filename)
+{
+	close();
+
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+	fileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+		return false;
+	size = GetFileSize(fileHandle, NULL);
+	if (size == INVALID_FILE_SIZE || size < sizeof(cache_index_header_t))
+	{
+		close();
+		return false;
+	}
+	mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mappingHandle)
+	{
+		close();
+		return false;
+	}
+	data = (char *)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	if (!data)
+	{
+		close();
+		return false;
+	}
+#else
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st) || st.st_size < (off_t)sizeof(cache_index_header_t))
+	{
+		::close(fd);
+		return false;
+	}
+	size = (size_t)st.st_size;
+	void *ptr = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+	// the mapping stays valid after the descriptor is closed
+	::close(fd);
+	if (ptr == MAP_FAILED)
+		return false;
+	data = (char *)ptr;
+#endif // OGRE_PLATFORM_WIN32
+
+	if (!validate())
+	{
+		LOG("mod cache index '" + filename + "' is invalid or has an old format");
+		close();
+		return false;
+	}
+	return true;
+}
+
+void CacheIndex::close()
+{
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+	if (data) UnmapViewOfFile(data);
+	if (mappingHandle) CloseHandle(mappingHandle);
+	if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+	mappingHandle = 0;
+	fileHandle    = INVALID_HANDLE_VALUE;
+#else
+	if (data) munmap(data, size);
+#endif // OGRE_PLATFORM_WIN32
+	authors = 0;
+	data    = 0;
+	header  = 0;
+	lists   = 0;
+	records = 0;
+	size    = 0;
+	strings = 0;
+}
+
+bool CacheIndex::validate()
+{
+	cache_index_header_t *h = (cache_index_header_t *)data;
+	if (memcmp(h->magic, CACHE_INDEX_MAGIC, 8) || h->version != CACHE_INDEX_VERSION || h->byteorder != CACHE_INDEX_BYTEORDER)
+		return false;
+
+	// every section has to be inside of the file
+	unsigned long long fsize = size;
+	if ((unsigned long long)h->records_offset + (unsigned long long)h->count * sizeof(cache_index_record_t) > fsize) return false;
+	if ((unsigned long long)h->strings_offset + h->strings_size > fsize || h->strings_size == 0) return false;
+	if ((unsigned long long)h->authors_offset + (unsigned long long)h->authors_count * sizeof(cache_index_author_t) > fsize) return false;
+	if ((unsigned long long)h->lists_offset + (unsigned long long)h->lists_count * sizeof(unsigned int) > fsize) return false;
+	if ((unsigned long long)h->idx_filename_offset + (unsigned long long)h->idx_filename_count * sizeof(cache_index_key_t) > fsize) return false;
+	if ((unsigned long long)h->idx_uniqueid_offset + (unsigned long long)h->idx_uniqueid_count * sizeof(cache_index_key_t) > fsize) return false;
+	if ((unsigned long long)h->idx_guid_offset + (unsigned long long)h->idx_guid_count * sizeof(cache_index_key_t) > fsize) return false;
+	if ((unsigned long long)h->idx_category_offset + (unsigned long long)h->idx_category_count * sizeof(cache_index_key_t) > fsize) return false;
+
+	// the string table must be terminated, so a corrupt offset can never read past it
+	if (data[h->strings_offset + h->strings_size - 1] != 0)
+		return false;
+
+	header  = h;
+	records = (cache_index_record_t *)(data + h->records_offset);
+	strings = data + h->strings_offset;
+	authors = (cache_index_author_t *)(data + h->authors_offset);
+	lists   = (unsigned int *)(data + h->lists_offset);
+	return true;
+}
+
+const char *CacheIndex::getString(unsigned int offset)
+{
+	if (!strings || offset >= header->strings_size) return "";
+	return strings + offset;
+}
+
+String CacheIndex::getSHA1()
+{
+	if (!header) return "";
+	size_t len = 0;
+	while (len < sizeof(header->shaone) && header->shaone[len]) len++;
+	return String(header->shaone, len);
+}
+
+int CacheIndex::getCategoryID(unsigned int record)
+{
+	if (!header || record >= header->count)
+		return -1;
+	return records[record].categoryid;
+}
+
+bool CacheIndex::getEntry(unsigned int record, Cache_Entry &t)
+{
+	if (!header || record >= header->count)
+		return false;
+
+	cache_index_record_t &r = records[record];
+
+	t = Cache_Entry();
+	t.minitype          = getString(r.minitype);
+	t.fname             = getString(r.fname);
+	t.fname_without_uid = getString(r.fname_without_uid);
+	t.dname             = getString(r.dname);
+	t.uniqueid          = getString(r.uniqueid);
+	t.guid              = getString(r.guid);
+	t.fext              = getString(r.fext);
+	t.type              = getString(r.type);
+	t.dirname           = getString(r.dirname);
+	t.hash              = getString(r.hash);
+	t.filetime          = getString(r.filetime);
+	t.filecachename     = getString(r.filecachename);
+	t.description       = getString(r.description);
+	t.tags              = getString(r.tags);
+
+	t.addtimestamp      = r.addtimestamp;
+	t.categoryid        = r.categoryid;
+	t.fileformatversion = r.fileformatversion;
+	t.number            = r.number;
+	t.usagecounter      = r.usagecounter;
+	t.version           = r.version;
+
+	t.nodecount                  = r.nodecount;
+	t.beamcount                  = r.beamcount;
+	t.shockcount                 = r.shockcount;
+	t.fixescount                 = r.fixescount;
+	t.hydroscount                = r.hydroscount;
+	t.wheelcount                 = r.wheelcount;
+	t.propwheelcount             = r.propwheelcount;
+	t.commandscount              = r.commandscount;
+	t.flarescount                = r.flarescount;
+	t.propscount                 = r.propscount;
+	t.wingscount                 = r.wingscount;
+	t.turbopropscount            = r.turbopropscount;
+	t.turbojetcount              = r.turbojetcount;
+	t.rotatorscount              = r.rotatorscount;
+	t.exhaustscount              = r.exhaustscount;
+	t.flexbodiescount            = r.flexbodiescount;
+	t.materialflarebindingscount = r.materialflarebindingscount;
+	t.soundsourcescount          = r.soundsourcescount;
+	t.managedmaterialscount      = r.managedmaterialscount;
+	t.driveable                  = r.driveable;
+	t.numgears                   = r.numgears;
+
+	t.truckmass = r.truckmass;
+	t.loadmass  = r.loadmass;
+	t.minrpm    = r.minrpm;
+	t.maxrpm    = r.maxrpm;
+	t.torque    = r.torque;
+
+	t.hasSubmeshs      = (r.flags & CACHE_INDEX_FLAG_SUBMESHS) != 0;
+	t.customtach       = (r.flags & CACHE_INDEX_FLAG_CUSTOMTACH) != 0;
+	t.custom_particles = (r.flags & CACHE_INDEX_FLAG_PARTICLES) != 0;
+	t.forwardcommands  = (r.flags & CACHE_INDEX_FLAG_FORWARDCOMMANDS) != 0;
+	t.importcommands   = (r.flags & CACHE_INDEX_FLAG_IMPORTCOMMANDS) != 0;
+	t.rollon           = (r.flags & CACHE_INDEX_FLAG_ROLLON) != 0;
+	t.rescuer          = (r.flags & CACHE_INDEX_FLAG_RESCUER) != 0;
+	t.enginetype       = r.enginetype;
+
+	if ((unsigned long long)r.authors_start + r.authors_count <= header->authors_count)
+	{
+		for (unsigned int i = 0; i < r.authors_count; i++)
+		{
+			cache_index_author_t &a = authors[r.authors_start + i];
+			authorinfo_t ai;
+			ai.id    = a.id;
+			ai.type  = getString(a.type);
+			ai.name  = getString(a.name);
+			ai.email = getString(a.email);
+			t.authors.push_back(ai);
+		}
+	}
+	if ((unsigned long long)r.sectionconfigs_start + r.sectionconfigs_count <= header->lists_count)
+	{
+		for (unsigned int i = 0; i < r.sectionconfigs_count; i++)
+			t.sectionconfigs.push_back(getString(lists[r.sectionconfigs_start + i]));
+	}
+	if ((unsigned long long)r.materials_start + r.materials_count <= header->lists_count)
+	{
+		for (unsigned int i = 0; i < r.materials_count; i++)
+			t.materials.insert(getString(lists[r.materials_start + i]));
+	}
+
+	t.resourceLoaded = false;
+	t.changedornew   = false;
+	t.deleted        = false;
+	return true;
+}
+
+int CacheIndex::findString(unsigned int offset, unsigned int count, const String &key)
+{
+	if (!header || !count) return -1;
+
+	// lower bound, so duplicate keys resolve to the first record like the linear search did
+	cache_index_key_t *idx = (cache_index_key_t *)(data + offset);
+	unsigned int lo = 0, hi = count;
+	while (lo < hi)
+	{
+		unsigned int mid = lo + (hi - lo) / 2;
+		if (strcmp(getString(idx[mid].key), key.c_str()) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo >= count || key != getString(idx[lo].key) || idx[lo].record >= header->count)
+		return -1;
+	return (int)idx[lo].record;
+}
+
+int CacheIndex::findByFilename(String filename)
+{
+	if (!header) return -1;
+	StringUtil::toLowerCase(filename);
+	return findString(header->idx_filename_offset, header->idx_filename_count, filename);
+}
+
+int CacheIndex::findByUniqueID(String uniqueid)
+{
+	if (!header || uniqueid.empty()) return -1;
+	return findString(header->idx_uniqueid_offset, header->idx_uniqueid_count, uniqueid);
+}
+
+int CacheIndex::findByGUID(String guid)
+{
+	if (!header || guid.empty()) return -1;
+	return findString(header->idx_guid_offset, header->idx_guid_count, guid);
+}
+
+void CacheIndex::findByCategory(int categoryid, std::vector<unsigned int> &result)
+{
+	if (!header || !header->idx_category_count) return;
+
+	cache_index_key_t *idx = (cache_index_key_t *)(data + header->idx_category_offset);
+	unsigned int lo = 0, hi = header->idx_category_count;
+	while (lo < hi)
+	{
+		unsigned int mid = lo + (hi - lo) / 2;
+		if ((int)idx[mid].key < categoryid)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	for (; lo < header->idx_category_count && (int)idx[lo].key == categoryid; lo++)
+		if (idx[lo].record < header->count)
+			result.push_back(idx[lo].record);
+}
+
+bool CacheIndex::write(String filename, String shaone, unsigned int generation, std::vector<Cache_Entry> &entries)
+{
+	cache_index_strings_t st;
+	std::vector<cache_index_record_t> recs;
+	std::vector<cache_index_author_t> auths;
+	std::vector<unsigned int> lst;
+	std::vector<cache_index_key_t> idxFilename, idxUniqueID, idxGUID, idxCategory;
+
+	recs.reserve(entries.size());
+	for (std::vector<Cache_Entry>::iterator it = entries.begin(); it != entries.end(); it++)
+	{
+		if (it->deleted) continue;
+		Cache_Entry &t = *it;
+		unsigned int number = (unsigned int)recs.size();
+
+		cache_index_record_t r;
+		memset(&r, 0, sizeof(cache_index_record_t));
+		r.minitype          = st.add(t.minitype);
+		r.fname             = st.add(t.fname);
+		r.fname_without_uid = st.add(t.fname_without_uid);
+		r.dname             = st.add(t.dname);
+		r.uniqueid          = st.add(t.uniqueid);
+		r.guid              = st.add(t.guid);
+		r.fext              = st.add(t.fext);
+		r.type              = st.add(t.type);
+		r.dirname           = st.add(t.dirname);
+		r.hash              = st.add(t.hash);
+		r.filetime          = st.add(t.filetime);
+		r.filecachename     = st.add(t.filecachename);
+		r.description       = st.add(t.description);
+		r.tags              = st.add(t.tags);
+
+		r.addtimestamp      = t.addtimestamp;
+		r.categoryid        = t.categoryid;
+		r.fileformatversion = t.fileformatversion;
+		r.number            = (int)number; // always count linear!
+		r.usagecounter      = t.usagecounter;
+		r.version           = t.version;
+
+		r.nodecount                  = t.nodecount;
+		r.beamcount                  = t.beamcount;
+		r.shockcount                 = t.shockcount;
+		r.fixescount                 = t.fixescount;
+		r.hydroscount                = t.hydroscount;
+		r.wheelcount                 = t.wheelcount;
+		r.propwheelcount             = t.propwheelcount;
+		r.commandscount              = t.commandscount;
+		r.flarescount                = t.flarescount;
+		r.propscount                 = t.propscount;
+		r.wingscount                 = t.wingscount;
+		r.turbopropscount            = t.turbopropscount;
+		r.turbojetcount              = t.turbojetcount;
+		r.rotatorscount              = t.rotatorscount;
+		r.exhaustscount              = t.exhaustscount;
+		r.flexbodiescount            = t.flexbodiescount;
+		r.materialflarebindingscount = t.materialflarebindingscount;
+		r.soundsourcescount          = t.soundsourcescount;
+		r.managedmaterialscount      = t.managedmaterialscount;
+		r.driveable                  = t.driveable;
+		r.numgears                   = t.numgears;
+
+		r.truckmass = t.truckmass;
+		r.loadmass  = t.loadmass;
+		r.minrpm    = t.minrpm;
+		r.maxrpm    = t.maxrpm;
+		r.torque    = t.torque;
+
+		if (t.hasSubmeshs)      r.flags |= CACHE_INDEX_FLAG_SUBMESHS;
+		if (t.customtach)       r.flags |= CACHE_INDEX_FLAG_CUSTOMTACH;
+		if (t.custom_particles) r.flags |= CACHE_INDEX_FLAG_PARTICLES;
+		if (t.forwardcommands)  r.flags |= CACHE_INDEX_FLAG_FORWARDCOMMANDS;
+		if (t.importcommands)   r.flags |= CACHE_INDEX_FLAG_IMPORTCOMMANDS;
+		if (t.rollon)           r.flags |= CACHE_INDEX_FLAG_ROLLON;
+		if (t.rescuer)          r.flags |= CACHE_INDEX_FLAG_RESCUER;
+		r.enginetype = t.enginetype;
+
+		r.authors_start = (unsigned int)auths.size();
+		r.authors_count = (unsigned int)t.authors.size();
+		for (size_t i = 0; i < t.authors.size(); i++)
+		{
+			cache_index_author_t a;
+			a.id    = t.authors[i].id;
+			a.type  = st.add(t.authors[i].type);
+			a.name  = st.add(t.authors[i].name);
+			a.email = st.add(t.authors[i].email);
+			auths.push_back(a);
+		}
+
+		r.sectionconfigs_start = (unsigned int)lst.size();
+		r.sectionconfigs_count = (unsigned int)t.sectionconfigs.size();
+		for (size_t i = 0; i < t.sectionconfigs.size(); i++)
+			lst.push_back(st.add(t.sectionconfigs[i]));
+
+		r.materials_start = (unsigned int)lst.size();
+		r.materials_count = (unsigned int)t.materials.size();
+		for (std::set<String>::iterator mit = t.materials.begin(); mit != t.materials.end(); mit++)
+			lst.push_back(st.add(*mit));
+
+		// index keys
+		String fname = t.fname, fname_without_uid = t.fname_without_uid;
+		StringUtil::toLowerCase(fname);
+		StringUtil::toLowerCase(fname_without_uid);
+		cache_index_key_t k;
+		k.record = number;
+		if (!fname.empty())
+		{
+			k.key = st.add(fname);
+			idxFilename.push_back(k);
+		}
+		if (!fname_without_uid.empty() && fname_without_uid != fname)
+		{
+			k.key = st.add(fname_without_uid);
+			idxFilename.push_back(k);
+		}
+		if (!t.uniqueid.empty())
+		{
+			k.key = r.uniqueid;
+			idxUniqueID.push_back(k);
+		}
+		if (!t.guid.empty())
+		{
+			k.key = r.guid;
+			idxGUID.push_back(k);
+		}
+		k.key = (unsigned int)t.categoryid;
+		idxCategory.push_back(k);
+
+		recs.push_back(r);
+	}
+
+	const char *strdata = &st.data[0];
+	std::sort(idxFilename.begin(), idxFilename.end(), cache_index_string_less_t(strdata));
+	std::sort(idxUniqueID.begin(), idxUniqueID.end(), cache_index_string_less_t(strdata));
+	std::sort(idxGUID.begin(), idxGUID.end(), cache_index_string_less_t(strdata));
+	std::sort(idxCategory.begin(), idxCategory.end(), cacheIndexCategoryLess);
+
+	// assemble the file in memory
+	cache_index_header_t h;
+	memset(&h, 0, sizeof(cache_index_header_t));
+	memcpy(h.magic, CACHE_INDEX_MAGIC, 8);
+	h.version   = CACHE_INDEX_VERSION;
+	h.byteorder = CACHE_INDEX_BYTEORDER;
+	strncpy(h.shaone, shaone.c_str(), sizeof(h.shaone) - 1);
+	h.count      = (unsigned int)recs.size();
+	h.generation = generation;
+
+	std::vector<char> out;
+	appendBlock(out, &h, sizeof(cache_index_header_t));
+
+	h.records_offset = (unsigned int)out.size();
+	if (!recs.empty()) appendBlock(out, &recs[0], recs.size() * sizeof(cache_index_record_t));
+
+	h.strings_offset = (unsigned int)out.size();
+	h.strings_size   = (unsigned int)st.data.size();
+	appendBlock(out, &st.data[0], st.data.size());
+
+	h.authors_offset = (unsigned int)out.size();
+	h.authors_count  = (unsigned int)auths.size();
+	if (!auths.empty()) appendBlock(out, &auths[0], auths.size() * sizeof(cache_index_author_t));
+
+	h.lists_offset = (unsigned int)out.size();
+	h.lists_count  = (unsigned int)lst.size();
+	if (!lst.empty()) appendBlock(out, &lst[0], lst.size() * sizeof(unsigned int));
+
+	h.idx_filename_offset = (unsigned int)out.size();
+	h.idx_filename_count  = (unsigned int)idxFilename.size();
+	if (!idxFilename.empty()) appendBlock(out, &idxFilename[0], idxFilename.size() * sizeof(cache_index_key_t));
+
+	h.idx_uniqueid_offset = (unsigned int)out.size();
+	h.idx_uniqueid_count  = (unsigned int)idxUniqueID.size();
+	if (!idxUniqueID.empty()) appendBlock(out, &idxUniqueID[0], idxUniqueID.size() * sizeof(cache_index_key_t));
+
+	h.idx_guid_offset = (unsigned int)out.size();
+	h.idx_guid_count  = (unsigned int)idxGUID.size();
+	if (!idxGUID.empty()) appendBlock(out, &idxGUID[0], idxGUID.size() * sizeof(cache_index_key_t));
+
+	h.idx_category_offset = (unsigned int)out.size();
+	h.idx_category_count  = (unsigned int)idxCategory.size();
+	if (!idxCategory.empty()) appendBlock(out, &idxCategory[0], idxCategory.size() * sizeof(cache_index_key_t));
+
+	// now that all offsets are known, write the final header
+	memcpy(&out[0], &h, sizeof(cache_index_header_t));
+
+	// write to a temporary file first, so a crash never leaves a half written index behind
+	String tmpfilename = filename + ".tmp";
+	FILE *f = fopen(tmpfilename.c_str(), "wb");
+	if (!f)
+	{
+		LOG("unable to write mod cache index: " + tmpfilename);
+		return false;
+	}
+	size_t written = fwrite(&out[0], 1, out.size(), f);
+	fclose(f);
+	if (written != out.size())
+	{
+		LOG("unable to write mod cache index: " + tmpfilename);
+		remove(tmpfilename.c_str());
+		return false;
+	}
+	remove(filename.c_str());
+	if (rename(tmpfilename.c_str(), filename.c_str()))
+	{
+		LOG("unable to rename mod cache index: " + tmpfilename);
+		return false;
+	}
+	return true;
+}
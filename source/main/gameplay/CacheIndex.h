@@ -0,0 +1,157 @@
+/*
+This source file is part of Rigs of Rods
+Copyright 2005-2012 Pierre-Michel Ricordel
+Copyright 2007-2012 Thomas Fischer
+
+For more information, see http://www.rigsofrods.com/
+
+Rigs of Rods is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 3, as
+published by the Free Software Foundation.
+
+Rigs of Rods is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __CacheIndex_H_
+#define __CacheIndex_H_
+
+#include "RoRPrerequisites.h"
+
+#include <Ogre.h>
+
+class Cache_Entry;
+
+#define CACHE_INDEX_MAGIC   "RORCIDX\0"
+#define CACHE_INDEX_VERSION 2
+
+// binary mod cache layout, all offsets are relative to the start of the file:
+// header | records | string table | author table | string lists | index tables
+// strings are NUL terminated and referenced by their offset into the string table,
+// every index table is a sorted array of cache_index_key_t
+typedef struct cache_index_header_t
+{
+	char magic[8];                 //!< CACHE_INDEX_MAGIC
+	unsigned int version;          //!< CACHE_INDEX_VERSION
+	unsigned int byteorder;        //!< 0x01020304, the file is only valid on machines with the same byte order
+	char shaone[64];               //!< sha1 over the content that was used to generate the file
+	unsigned int generation;       //!< CacheSystem entries generation the file was written from
+	unsigned int count;            //!< number of records
+	unsigned int records_offset;
+	unsigned int strings_offset;
+	unsigned int strings_size;
+	unsigned int authors_offset;
+	unsigned int authors_count;
+	unsigned int lists_offset;     //!< string offsets used by sectionconfigs and materials
+	unsigned int lists_count;
+	unsigned int idx_filename_offset;
+	unsigned int idx_filename_count;
+	unsigned int idx_uniqueid_offset;
+	unsigned int idx_uniqueid_count;
+	unsigned int idx_guid_offset;
+	unsigned int idx_guid_count;
+	unsigned int idx_category_offset;
+	unsigned int idx_category_count;
+} cache_index_header_t;
+
+typedef struct cache_index_record_t
+{
+	// string table offsets
+	unsigned int minitype, fname, fname_without_uid, dname, uniqueid, guid, fext, type, dirname, hash, filetime, filecachename, description, tags;
+
+	int addtimestamp, categoryid, fileformatversion, number, usagecounter, version;
+	int nodecount, beamcount, shockcount, fixescount, hydroscount, wheelcount, propwheelcount, commandscount, flarescount, propscount, wingscount;
+	int turbopropscount, turbojetcount, rotatorscount, exhaustscount, flexbodiescount, materialflarebindingscount, soundsourcescount, managedmaterialscount;
+	int driveable, numgears;
+	float truckmass, loadmass, minrpm, maxrpm, torque;
+
+	// CACHE_INDEX_FLAG_*
+	unsigned int flags;
+	char enginetype;
+	char pad[3];
+
+	// ranges into the author table and the string lists
+	unsigned int authors_start, authors_count;
+	unsigned int sectionconfigs_start, sectionconfigs_count;
+	unsigned int materials_start, materials_count;
+} cache_index_record_t;
+
+enum {
+	CACHE_INDEX_FLAG_SUBMESHS        = 1 << 0,
+	CACHE_INDEX_FLAG_CUSTOMTACH      = 1 << 1,
+	CACHE_INDEX_FLAG_PARTICLES       = 1 << 2,
+	CACHE_INDEX_FLAG_FORWARDCOMMANDS = 1 << 3,
+	CACHE_INDEX_FLAG_IMPORTCOMMANDS  = 1 << 4,
+	CACHE_INDEX_FLAG_ROLLON          = 1 << 5,
+	CACHE_INDEX_FLAG_RESCUER         = 1 << 6,
+};
+
+typedef struct cache_index_author_t
+{
+	unsigned int type, name, email; //!< string table offsets
+	int id;
+} cache_index_author_t;
+
+typedef struct cache_index_key_t
+{
+	unsigned int key;    //!< string table offset, or the category id for the category index
+	unsigned int record;
+} cache_index_key_t;
+
+/**
+ * Read only view of the binary mod cache.
+ * The file is memory mapped, records are only decoded into Cache_Entry objects when asked for.
+ */
+class CacheIndex
+{
+public:
+	CacheIndex();
+	~CacheIndex();
+
+	bool open(Ogre::String filename);
+	void close();
+	bool isOpen() { return data != 0; };
+
+	unsigned int getCount() { return header ? header->count : 0; };
+	unsigned int getGeneration() { return header ? header->generation : 0; };
+	Ogre::String getSHA1();
+
+	// decodes one record, returns false if the record number is out of range
+	bool getEntry(unsigned int record, Cache_Entry &entry);
+	// category of a record without decoding it, -1 if the record number is out of range
+	int getCategoryID(unsigned int record);
+
+	// lookups return the record number or -1. The filename lookup is case insensitive and
+	// matches both the filename and the filename without uid.
+	int findByFilename(Ogre::String filename);
+	int findByUniqueID(Ogre::String uniqueid);
+	int findByGUID(Ogre::String guid);
+	void findByCategory(int categoryid, std::vector<unsigned int> &records);
+
+	// writes all non deleted entries, the records are numbered linear in the order of the vector
+	static bool write(Ogre::String filename, Ogre::String shaone, unsigned int generation, std::vector<Cache_Entry> &entries);
+
+protected:
+	char *data;
+	size_t size;
+	cache_index_header_t *header;
+	cache_index_record_t *records;
+	const char *strings;
+	cache_index_author_t *authors;
+	unsigned int *lists;
+
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+	void *fileHandle;
+	void *mappingHandle;
+#endif // OGRE_PLATFORM_WIN32
+
+	const char *getString(unsigned int offset);
+	int findString(unsigned int offset, unsigned int count, const Ogre::String &key);
+	bool validate();
+};
+
+#endif // __CacheIndex_H_
@@ -30,6 +30,8 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 #include "Settings.h"
 #include "sha1.h"
 #include "SoundScriptManager.h"
+#include "ThreadPool.h"
+#include "Timer.h"
 #include "utils.h"
 
 #ifdef USE_MYGUI
@@ -39,12 +41,32 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 //using namespace RoR; // CSHA1
 using namespace Ogre;
 
+// the data of one CacheSystem::hashFiles() batch
+struct cache_hash_job_t
+{
+	ContentFingerprints *fingerprints;
+	std::vector<String> *filenames;
+	std::vector<String> *hashes;
+};
+
+// runs on a worker thread: only file io and hashing in here
+static void cacheHashJob(void *data, int i)
+{
+	cache_hash_job_t *job = (cache_hash_job_t *)data;
+	(*job->hashes)[i] = job->fingerprints->getSHA1((*job->filenames)[i]);
+}
+
 CacheSystem::CacheSystem() :
 	  changedFiles(0)
 	, deletedFiles(0)
+	, generation(0)
 	, newFiles(0)
+	, resourceGroupClock(0)
 	, rgcounter(0)
+	, rgcounterReloaded(0)
+	, searchIndexGeneration(0)
 	, smgr(0)
+	, undecodedCount(0)
 {
 	// register the extensions
 	known_extensions.push_back("machine");
@@ -88,6 +110,9 @@ void CacheSystem::startup(SceneManager *smgr, bool forcecheck)
 	// read valid categories from file
 	readCategoryTitles();
 
+	// fingerprints of the last run, so unchanged archives do not need to be read again
+	fingerprints.load(location + FINGERPRINTS_FILE);
+
 	// calculate sha1 over all the content
 	currentSHA1 = filenamesSHA1();
 
@@ -111,6 +136,12 @@ void CacheSystem::startup(SceneManager *smgr, bool forcecheck)
 	// load the cache finally!
 	loadCache();
 
+	if(!index.isOpen() && !entries.empty())
+	{
+		// this was a text cache of an older version, store it in the binary format
+		writeGeneratedCache();
+	}
+
 	// show error on zero content
 	if(entries.empty())
 	{
@@ -128,9 +159,21 @@ std::map<int, Category_Entry> *CacheSystem::getCategories()
 
 std::vector<Cache_Entry> *CacheSystem::getEntries()
 {
+	decodeEntries();
 	return &entries;
 }
 
+SearchIndex *CacheSystem::getSearchIndex()
+{
+	if(!searchIndex.isBuilt() || searchIndexGeneration != generation)
+	{
+		decodeEntries();
+		searchIndex.build(entries, getTimeStamp());
+		searchIndexGeneration = generation;
+	}
+	return &searchIndex;
+}
+
 
 void CacheSystem::unloadUselessResourceGroups()
 {
@@ -183,7 +226,76 @@ bool CacheSystem::resourceExistsInAllGroups(Ogre::String filename)
 	return exists;
 }
 
+String CacheSystem::getCacheIndexFilename()
+{
+	return location+String(CACHE_INDEX_FILE);
+}
+
+bool CacheSystem::isIndexInSync()
+{
+	return index.isOpen() && index.getGeneration() == generation && entries.size() == index.getCount();
+}
+
+void CacheSystem::entriesChanged()
+{
+	// lookups only use the index again once it was written from the same generation,
+	// the search index is built again the next time it is used
+	generation++;
+	// the lookups scan the entries until then, so all of them have to be decoded
+	decodeEntries();
+}
+
+Cache_Entry *CacheSystem::decodeEntry(unsigned int record)
+{
+	if(record >= entries.size())
+		return 0;
+	if(record < decoded.size() && !decoded[record])
+	{
+		Cache_Entry &t = entries[record];
+		if(!index.getEntry(record, t))
+			t.deleted = true;
+		t.categoryname = categories[t.categoryid].title;
+		decoded[record] = true;
+		undecodedCount--;
+	}
+	return &entries[record];
+}
+
+void CacheSystem::decodeEntries()
+{
+	if(!undecodedCount)
+	{
+		decoded.clear();
+		return;
+	}
+	for(unsigned int i = 0; i < decoded.size(); i++)
+		decodeEntry(i);
+	decoded.clear();
+	undecodedCount = 0;
+}
+
 int CacheSystem::isCacheValid()
+{
+	if(!index.open(getCacheIndexFilename()))
+	{
+		LOG("unable to load cache index: "+getCacheIndexFilename());
+		// maybe there is a text cache of an older version that we can convert
+		return isTextCacheValid();
+	}
+
+	String shaone = index.getSHA1();
+	if(shaone == "" || shaone != currentSHA1)
+	{
+		LOG("* mod cache is invalid (not up to date), regenerating new one ...");
+		// never use the outdated records for lookups, the index is written again after the update
+		index.close();
+		return -1;
+	}
+	LOG("* mod cache is valid, using it.");
+	return 0;
+}
+
+int CacheSystem::isTextCacheValid()
 {
 	String cfgfilename = getCacheConfigFilename(false);
 	ImprovedConfigFile cfg;
@@ -208,6 +320,7 @@ int CacheSystem::isCacheValid()
 	if(cacheformat != String(CACHE_FILE_FORMAT))
 	{
 		entries.clear();
+		entriesChanged();
 		LOG("* mod cache has invalid format, trying to regenerate");
 		return -1;
 	}
@@ -546,6 +659,36 @@ bool CacheSystem::loadCache()
 {
 	// Clear existing entries
 	entries.clear();
+	decoded.clear();
+	undecodedCount = 0;
+	searchIndex.clear();
+
+	if(!index.isOpen() && !index.open(getCacheIndexFilename()))
+		// no binary index yet, fall back to the text cache of older versions
+		return loadTextCache();
+
+	LOG("CacheSystem::loadCache");
+
+	// the records are only decoded when they are used, the lookups go through the index
+	unsigned int count = index.getCount();
+	entries.resize(count);
+	decoded.assign(count, false);
+	undecodedCount = count;
+	for(unsigned int i = 0; i < count; i++)
+	{
+		int categoryid = index.getCategoryID(i);
+		category_usage[categoryid] = category_usage[categoryid] + 1;
+	}
+	// the entries are the records of the index again
+	generation = index.getGeneration();
+	return true;
+}
+
+bool CacheSystem::loadTextCache()
+{
+	// Clear existing entries
+	entries.clear();
+	entriesChanged();
 
 	String cfgfilename = getCacheConfigFilename(false);
 
@@ -558,7 +701,7 @@ bool CacheSystem::loadCache()
 	String group = ResourceGroupManager::getSingleton().findGroupContainingResource(String(cfgfilename));
 	DataStreamPtr stream=ResourceGroupManager::getSingleton().openResource(cfgfilename, group);
 
-	LOG("CacheSystem::loadCache");
+	LOG("CacheSystem::loadTextCache");
 
 	Cache_Entry t;
 	String line = "";
@@ -661,10 +804,13 @@ String CacheSystem::getVirtualPath(String path)
 int CacheSystem::incrementalCacheUpdate()
 {
 	entries.clear();
+	entriesChanged();
 
 	if(!loadCache())
 		//error loading cache!
 		return -1;
+	// every entry is checked
+	decodeEntries();
 
 	LOG("* incremental check starting ...");
 	LOG("* incremental check (1/5): deleted and changed files ...");
@@ -672,6 +818,8 @@ int CacheSystem::incrementalCacheUpdate()
 	LoadingWindow::getSingleton().setProgress(20, _L("incremental check: deleted and changed files"));
 #endif //USE_MYGUI
 	std::vector<Cache_Entry> changed_entries;
+	std::vector<int> slowcheck_entries;
+	std::vector<String> slowcheck_files;
 	UTFString tmp = "";
 	String fn = "";
 	int counter = 0;
@@ -697,6 +845,7 @@ int CacheSystem::incrementalCacheUpdate()
 #endif //USE_MYGUI
 			removeFileFromFileCache(it);
 			it->deleted = true;
+			entriesChanged();
 			// do not try: entries.erase(it)
 			deletedFiles++;
 			continue;
@@ -704,32 +853,39 @@ int CacheSystem::incrementalCacheUpdate()
 		// check whether it changed
 		if(it->type == "Zip")
 		{
-			// check file time, if that fails, fall back to sha1 (needed for platforms where filetime is not yet implemented!
-			bool check = false;
-			String ft = fileTime(fn);
-			if(ft.empty() || it->filetime.empty() || it->filetime == "unknown")
-			{
-				// slow sha1 check
-				char hash[256] = {};
-
-				RoR::CSHA1 sha1;
-				sha1.HashFile(const_cast<char*>(fn.c_str()));
-				sha1.Final();
-				sha1.ReportHash(hash, RoR::CSHA1::REPORT_HEX_SHORT);
-				check = (it->hash != String(hash));
-			} else
+			// only zips whose size or modification time changed need to be read, those are hashed all at once below
+			if(!fingerprints.isUnchanged(fn))
 			{
-				// faster file time check
-				check = (it->filetime != ft);
+				slowcheck_entries.push_back(counter);
+				slowcheck_files.push_back(fn);
 			}
+		}
+	}
 
-			if (check)
+	if(!slowcheck_files.empty())
+	{
+		// several entries can share one zip, so only hash every zip once
+		std::vector<String> files, hashes;
+		std::map<String, int> fileindex;
+		for(size_t i = 0; i < slowcheck_files.size(); i++)
+		{
+			if(fileindex.find(slowcheck_files[i]) != fileindex.end()) continue;
+			fileindex[slowcheck_files[i]] = (int)files.size();
+			files.push_back(slowcheck_files[i]);
+		}
+		hashFiles(files, hashes, _L("incremental check: deleted and changed files"));
+
+		for(size_t i = 0; i < slowcheck_entries.size(); i++)
+		{
+			Cache_Entry &e = entries[slowcheck_entries[i]];
+			if(e.hash != hashes[fileindex[slowcheck_files[i]]])
 			{
 				changedFiles++;
-				LOG("- "+fn+" changed");
-				it->changedornew = true;
-				it->deleted = true; // see below
-				changed_entries.push_back(*it);
+				LOG("- "+slowcheck_files[i]+" changed");
+				e.changedornew = true;
+				e.deleted = true; // see below
+				entriesChanged();
+				changed_entries.push_back(e);
 			}
 		}
 	}
@@ -821,6 +977,7 @@ int CacheSystem::incrementalCacheUpdate()
 				if(it->number == it2->number) continue; // do not delete self
 				LOG("- "+ it2->dirname+"/" + it->fname + " hard duplicate");
 				it2->deleted=true;
+				entriesChanged();
 				continue;
 			}
 			// soft duplicates
@@ -829,12 +986,7 @@ int CacheSystem::incrementalCacheUpdate()
 				if(it->number == it2->number) continue; // do not delete self
 				LOG("- "+ it2->dirname+"/" + it->fname + " soft duplicate, resolving ...");
 				// create sha1 and see whats the correct entry :)
-				RoR::CSHA1 sha1;
-				sha1.HashFile(const_cast<char*>(it2->dirname.c_str()));
-				sha1.Final();
-				char hashres[256]="";
-				sha1.ReportHash(hashres, RoR::CSHA1::REPORT_HEX_SHORT);
-				String hashstr = String(hashres);
+				String hashstr = fingerprints.getSHA1(getRealPath(it2->dirname));
 				if(hashstr == it->hash)
 				{
 					LOG("  - entry 2 removed");
@@ -849,6 +1001,7 @@ int CacheSystem::incrementalCacheUpdate()
 					it->deleted=true;
 					it2->deleted=true;
 				}
+				entriesChanged();
 			}
 		}
 	}
@@ -870,6 +1023,12 @@ int CacheSystem::incrementalCacheUpdate()
 
 Cache_Entry *CacheSystem::getEntry(int modid)
 {
+	// mods are numbered linear, so this is a direct hit unless entries were added or removed
+	if (modid >= 0 && modid < (int)entries.size() && decodeEntry(modid)->number == modid)
+		return &entries[modid];
+
+	decodeEntries();
+
 	for(std::vector<Cache_Entry>::iterator it = entries.begin(); it != entries.end(); it++)
 	{
 		if (modid == it->number)
@@ -1043,6 +1202,50 @@ Ogre::String CacheSystem::formatEntry(int counter, Cache_Entry t)
 }
 
 void CacheSystem::writeGeneratedCache()
+{
+	// entries might have changed in place
+	searchIndex.clear();
+
+	// the index must not be mapped while it gets replaced
+	decodeEntries();
+	index.close();
+
+	String indexpath = getCacheIndexFilename();
+	LOG("writing cache index to file ("+indexpath+")...");
+	bool written = CacheIndex::write(indexpath, currentSHA1, generation, entries);
+	if(!written)
+		LOG("error writing the cache index");
+	fingerprints.save(location + FINGERPRINTS_FILE);
+
+	// the text format is only written for debugging purposes
+	if(BSETTING("Cache Text Export", false))
+		writeTextCache();
+
+	if(!written)
+	{
+		LOG("...done!");
+		return;
+	}
+
+	// the index only holds the entries that were not deleted and numbers them linear, do the
+	// same here so the records map 1:1 to the entries again
+	std::vector<Cache_Entry>::iterator last = entries.begin();
+	for(std::vector<Cache_Entry>::iterator it = entries.begin(); it != entries.end(); it++)
+	{
+		if(it->deleted) continue;
+		if(last != it) *last = *it;
+		last->number = (int)(last - entries.begin());
+		last++;
+	}
+	entries.erase(last, entries.end());
+
+	// lookups use the new index right away
+	if(!index.open(indexpath))
+		LOG("unable to reopen the cache index: " + indexpath);
+	LOG("...done!");
+}
+
+void CacheSystem::writeTextCache()
 {
 	String path = getCacheConfigFilename(true);
 	LOG("writing cache to file ("+path+")...");
@@ -1066,7 +1269,6 @@ void CacheSystem::writeGeneratedCache()
 
 	// close
 	fclose(f);
-	LOG("...done!");
 }
 
 
@@ -1212,6 +1414,7 @@ void CacheSystem::addFile(String filename, String archiveType, String archiveDir
 				entry.hash="none";
 			// read in author and category
 			entries.push_back(entry);
+			entriesChanged();
 		} catch(Ogre::Exception& e)
 		{
 			if(e.getNumber() == Ogre::Exception::ERR_DUPLICATE_ITEM)
@@ -1514,6 +1717,7 @@ void CacheSystem::parseFilesOneRG(Ogre::String ext, Ogre::String rg)
 
 bool CacheSystem::isFileInEntries(Ogre::String filename)
 {
+	decodeEntries();
 	for(std::vector<Cache_Entry>::iterator it = entries.begin(); it!=entries.end(); it++)
 	{
 		if(it->fname == filename)
@@ -1524,6 +1728,7 @@ bool CacheSystem::isFileInEntries(Ogre::String filename)
 void CacheSystem::generateZipList()
 {
 	zipCacheList.clear();
+	decodeEntries();
 	for(std::vector<Cache_Entry>::iterator it = entries.begin(); it!=entries.end(); it++)
 	{
 		zipCacheList.insert(getVirtualPath(it->dirname));
@@ -1545,6 +1750,7 @@ bool CacheSystem::isDirectoryUsedInEntries(Ogre::String directory)
 	String dira = directory;
 	dira = getVirtualPath(dira);
 
+	decodeEntries();
 	std::vector<Cache_Entry>::iterator it;
 	for(it = entries.begin(); it!=entries.end(); it++)
 	{
@@ -1645,6 +1851,9 @@ String CacheSystem::filenamesSHA1()
 					if(!vipfile) continue;
 				}
 				name += iterFiles->filename;
+				// size and modification time of archives, so changed archives invalidate the cache without reading them
+				if(iterFiles->archive && StringUtil::endsWith(iterFiles->filename, ".zip"))
+					name += "|" + ContentFingerprints::getMetadataString(iterFiles->archive->getName() + "/" + iterFiles->filename);
 				filenames += name + "\n";
 			}
 		}
@@ -1793,9 +2002,88 @@ bool CacheSystem::checkResourceLoaded(Ogre::String &filename)
 	return checkResourceLoaded(filename, group);
 }
 
+Cache_Entry *CacheSystem::findEntryByFilename(Ogre::String filename)
+{
+	if(isIndexInSync())
+	{
+		int record = index.findByFilename(filename);
+		if(record < 0)
+			return 0;
+		if(!decodeEntry(record)->deleted)
+			return &entries[record];
+		// the index only knows the first record of a filename, another one might still match
+	}
+	decodeEntries();
+
+	StringUtil::toLowerCase(filename);
+	std::vector<Cache_Entry>::iterator it;
+	for(it = entries.begin(); it != entries.end(); it++)
+	{
+		if(it->deleted) continue;
+		// case insensitive comparison
+		String fname = it->fname;
+		String fname_without_uid_lower = it->fname_without_uid;
+		StringUtil::toLowerCase(fname);
+		StringUtil::toLowerCase(fname_without_uid_lower);
+		if (fname == filename || fname_without_uid_lower == filename)
+			return &*it;
+	}
+	return 0;
+}
+
+Cache_Entry *CacheSystem::getEntryByUniqueID(Ogre::String uniqueid)
+{
+	if(isIndexInSync())
+	{
+		int record = index.findByUniqueID(uniqueid);
+		return (record >= 0 && !decodeEntry(record)->deleted) ? &entries[record] : 0;
+	}
+	decodeEntries();
+	for(std::vector<Cache_Entry>::iterator it = entries.begin(); it != entries.end(); it++)
+		if(!it->deleted && it->uniqueid == uniqueid)
+			return &*it;
+	return 0;
+}
+
+Cache_Entry *CacheSystem::getEntryByGUID(Ogre::String guid)
+{
+	if(isIndexInSync())
+	{
+		int record = index.findByGUID(guid);
+		return (record >= 0 && !decodeEntry(record)->deleted) ? &entries[record] : 0;
+	}
+	decodeEntries();
+	for(std::vector<Cache_Entry>::iterator it = entries.begin(); it != entries.end(); it++)
+		if(!it->deleted && it->guid == guid)
+			return &*it;
+	return 0;
+}
+
+void CacheSystem::getEntriesByCategory(int categoryid, std::vector<Cache_Entry *> &result)
+{
+	if(isIndexInSync())
+	{
+		std::vector<unsigned int> records;
+		index.findByCategory(categoryid, records);
+		for(std::vector<unsigned int>::iterator it = records.begin(); it != records.end(); it++)
+			if(!decodeEntry(*it)->deleted)
+				result.push_back(&entries[*it]);
+		return;
+	}
+	decodeEntries();
+	for(std::vector<Cache_Entry>::iterator it = entries.begin(); it != entries.end(); it++)
+		if(!it->deleted && it->categoryid == categoryid)
+			result.push_back(&*it);
+}
+
 Cache_Entry CacheSystem::getResourceInfo(Ogre::String &filename)
 {
 	Cache_Entry def;
+	Cache_Entry *entry = findEntryByFilename(filename);
+	if(entry && (entry->fname == filename || entry->fname_without_uid == filename))
+		return *entry;
+
+	decodeEntries();
 	std::vector<Cache_Entry>::iterator it;
 	for(it = entries.begin(); it != entries.end(); it++)
 		if(it->fname == filename || it->fname_without_uid == filename)
@@ -1803,57 +2091,71 @@ Cache_Entry CacheSystem::getResourceInfo(Ogre::String &filename)
 	return def;
 }
 
+Cache_Entry *CacheSystem::getEntryInArchive(Ogre::String filename, Ogre::String archive)
+{
+	// the index knows the first entry of a filename, usually there is no other one
+	Cache_Entry *entry = findEntryByFilename(filename);
+	if(entry && entry->dirname == archive && (entry->fname == filename || entry->fname_without_uid == filename))
+		return entry;
+
+	decodeEntries();
+	for(std::vector<Cache_Entry>::iterator it = entries.begin(); it != entries.end(); it++)
+		if(!it->deleted && it->dirname == archive && (it->fname == filename || it->fname_without_uid == filename))
+			return &*it;
+	return 0;
+}
+
 bool CacheSystem::checkResourceLoaded(Ogre::String &filename, Ogre::String &group)
 {
 	// check if we already loaded it via ogre ...
 	if (ResourceGroupManager::getSingleton().resourceExistsInAnyGroup(filename))
 	{
 		group = ResourceGroupManager::getSingleton().findGroupContainingResource(filename);
+		touchResourceGroup(group);
 		return true;
 	}
 
-	std::vector<Cache_Entry>::iterator it;
+	Cache_Entry *entry = findEntryByFilename(filename);
+	if (!entry)
+		return false;
 
-	for(it = entries.begin(); it != entries.end(); it++)
-	{
-		// case insensitive comparison
-		String fname = it->fname;
-		String filename_lower = filename;
-		String fname_without_uid_lower = it->fname_without_uid;
-		StringUtil::toLowerCase(fname);
-		StringUtil::toLowerCase(filename_lower);
-		StringUtil::toLowerCase(fname_without_uid_lower);
-		if (fname == filename_lower || fname_without_uid_lower == filename_lower)
-		{
-			// we found the file, load it
-			filename = it->fname;
-			bool res = checkResourceLoaded(*it);
-			bool exists = ResourceGroupManager::getSingleton().resourceExistsInAnyGroup(filename);
-			if (!exists)
-				return false;
-			group = ResourceGroupManager::getSingleton().findGroupContainingResource(filename);
-			return res;
-		}
-	}
-	return false;
+	// we found the file, load it
+	filename = entry->fname;
+	bool res = checkResourceLoaded(*entry);
+	bool exists = ResourceGroupManager::getSingleton().resourceExistsInAnyGroup(filename);
+	if (!exists)
+		return false;
+	group = ResourceGroupManager::getSingleton().findGroupContainingResource(filename);
+	return res;
 }
 
 bool CacheSystem::checkResourceLoaded(Cache_Entry t)
 {
-	static int rgcountera = 0;
-	static std::map<String, bool> loaded;
-	if(t.resourceLoaded || loaded[t.dirname])
-		// only load once
+	if(t.resourceLoaded)
+		return true;
+	std::map<String, String>::iterator it = archiveGroups.find(t.dirname);
+	if(it != archiveGroups.end())
+	{
+		// only load once, unloaded resources are loaded again by ogre on their next use
+		touchResourceGroup(it->second);
 		return true;
+	}
 	if(t.type == "Zip")
 	{
 		//ScopeLog log("cache_"+t.fname);
 		try
 		{
-			rgcountera++;
-			String name = "General-Reloaded-"+TOSTRING(rgcountera);
+			rgcounterReloaded++;
+			String name = "General-Reloaded-"+TOSTRING(rgcounterReloaded);
 			ResourceGroupManager::getSingleton().addResourceLocation(t.dirname, t.type, name);
-			loaded[t.dirname]=true;
+			archiveGroups[t.dirname] = name;
+
+			resource_group_t &rg = resourceGroups[name];
+			rg.archive  = t.dirname;
+			rg.pinned   = (t.fext == "terrn");
+			rg.unloaded = false;
+			touchResourceGroup(name);
+
 			ResourceGroupManager::getSingleton().initialiseResourceGroup(name);
 			return true;
 		} catch(Ogre::Exception& e)
@@ -1875,6 +2177,67 @@ bool CacheSystem::checkResourceLoaded(Cache_Entry t)
 	return false;
 }
 
+void CacheSystem::touchResourceGroup(const String &group)
+{
+	std::map<String, resource_group_t>::iterator it = resourceGroups.find(group);
+	if(it == resourceGroups.end())
+		return;
+	it->second.lastUsed = ++resourceGroupClock;
+	it->second.unloaded = false;
+}
+
+bool CacheSystem::isResourceBudgetExceeded()
+{
+	// in MB, 0 disables unloading
+	size_t budget = (size_t)ISETTING("Resource Memory Budget", 768) * 1024 * 1024;
+	if(!budget)
+		return false;
+	return TextureManager::getSingleton().getMemoryUsage() + MeshManager::getSingleton().getMemoryUsage() > budget;
+}
+
+void CacheSystem::trimResourceGroups(const std::set<String> &usedGroups)
+{
+	if(!isResourceBudgetExceeded())
+		return;
+
+	size_t budget = (size_t)ISETTING("Resource Memory Budget", 768) * 1024 * 1024;
+	size_t used = TextureManager::getSingleton().getMemoryUsage() + MeshManager::getSingleton().getMemoryUsage();
+
+	// least recently used first
+	std::vector< std::pair<unsigned long, String> > candidates;
+	for(std::map<String, resource_group_t>::iterator it = resourceGroups.begin(); it != resourceGroups.end(); it++)
+	{
+		if(it->second.pinned || it->second.unloaded || usedGroups.count(it->first))
+			continue;
+		candidates.push_back(std::make_pair(it->second.lastUsed, it->first));
+	}
+	if(candidates.empty())
+		return;
+	std::sort(candidates.begin(), candidates.end());
+
+	size_t before = used;
+	int count = 0;
+	for(size_t i = 0; i < candidates.size() && used > budget; i++)
+	{
+		resource_group_t &rg = resourceGroups[candidates[i].second];
+		try
+		{
+			// the group stays declared, so the resources are loaded again when they are needed.
+			// Only reloadable ones: manually created resources (i.e. generated textures) could not be restored
+			ResourceGroupManager::getSingleton().unloadUnreferencedResourcesInGroup(candidates[i].second, true);
+		} catch(Ogre::Exception& e)
+		{
+			LOG("error while unloading resource group " + candidates[i].second + ": " + e.getFullDescription());
+		}
+		rg.unloaded = true;
+		count++;
+		used = TextureManager::getSingleton().getMemoryUsage() + MeshManager::getSingleton().getMemoryUsage();
+	}
+
+	LOG("unloaded " + TOSTRING(count) + " resource groups: " + TOSTRING((before - std::min(before, used)) / 1024) + " kB freed, "
+		+ TOSTRING(used / (1024 * 1024)) + " MB of " + TOSTRING(budget / (1024 * 1024)) + " MB in use");
+}
+
 void CacheSystem::loadSingleZip(Cache_Entry e, bool unload, bool ownGroup)
 {
 	loadSingleZip(e.dirname, -1, unload, ownGroup);
@@ -1952,14 +2315,18 @@ void CacheSystem::loadSingleZip(String zippath, int cfactor, bool unload, bool o
 	*/
 
 	String realzipPath = getRealPath(zippath);
-	char hash[256];
-	memset(hash, 0, 255);
 
-	RoR::CSHA1 sha1;
-	sha1.HashFile(const_cast<char*>(realzipPath.c_str()));
-	sha1.Final();
-	sha1.ReportHash(hash, RoR::CSHA1::REPORT_HEX_SHORT);
-	zipHashes[getVirtualPath(zippath)] = String(hash);
+	// the zip was usually hashed already together with all other zips, see hashZips(),
+	// hash it again if it was replaced since then
+	std::map<String, String>::iterator hit = zipHashes.find(getVirtualPath(zippath));
+	if(hit == zipHashes.end() || !fingerprints.isUnchanged(realzipPath))
+	{
+		std::vector<String> zippaths;
+		zippaths.push_back(zippath);
+		hashZips(zippaths);
+		hit = zipHashes.find(getVirtualPath(zippath));
+	}
+	String hash = hit->second;
 
 
 	String compr = "";
@@ -1967,7 +2334,7 @@ void CacheSystem::loadSingleZip(String zippath, int cfactor, bool unload, bool o
 		compr = "(No Compression)";
 	else if (cfactor > 0)
 		compr = "(Compression: " + TOSTRING(cfactor) + ")";
-	LOG("Adding archive " + realzipPath + " (hash: "+String(hash)+") " + compr);
+	LOG("Adding archive " + realzipPath + " (hash: "+hash+") " + compr);
 
 	rgcounter++;
 	String rgname = "General-"+TOSTRING(rgcounter);
@@ -2018,6 +2385,56 @@ void CacheSystem::loadSingleZip(String zippath, int cfactor, bool unload, bool o
 }
 
 
+void CacheSystem::hashFiles(std::vector<String> &filenames, std::vector<String> &hashes, UTFString title)
+{
+	hashes.clear();
+	hashes.resize(filenames.size());
+	if(filenames.empty()) return;
+
+	PrecisionTimer timer;
+	cache_hash_job_t job;
+	job.fingerprints = &fingerprints;
+	job.filenames    = &filenames;
+	job.hashes       = &hashes;
+
+	int threads = ISETTING("Cache Threads", 0);
+	if(threads <= 0)
+		threads = ThreadPool::getCPUCount();
+	ThreadPool pool(std::min(threads, (int)filenames.size()));
+	pool.start((int)filenames.size(), cacheHashJob, &job);
+	// the workers only do file io and hashing, the loading window is updated from this thread
+	while(!pool.waitFor(100))
+	{
+#ifdef USE_MYGUI
+		int done = pool.getCompleted();
+		int progress = ((float)done/(float)filenames.size())*100;
+		LoadingWindow::getSingleton().setProgress(progress, title + L"\n" + _L("hashing archives") + L" " + ANSI_TO_UTF(TOSTRING(done)) + L"/" + ANSI_TO_UTF(TOSTRING(filenames.size())));
+#endif //USE_MYGUI
+	}
+	LOG("hashed " + TOSTRING(filenames.size()) + " files in " + TOSTRING((int)(timer.elapsed() * 1000)) + " ms using " + TOSTRING(pool.getThreadCount()) + " threads");
+}
+
+void CacheSystem::hashZips(std::vector<String> &zippaths)
+{
+	std::vector<String> realpaths, virtualpaths, hashes;
+	std::set<String> listed;
+	for(std::vector<String>::iterator it = zippaths.begin(); it != zippaths.end(); it++)
+	{
+		String vpath = getVirtualPath(*it);
+		String rpath = getRealPath(*it);
+		// known hashes are only kept while size and modification time of the zip did not change
+		if(zipHashes.find(vpath) != zipHashes.end() && fingerprints.isUnchanged(rpath)) continue;
+		if(!listed.insert(vpath).second) continue;
+		virtualpaths.push_back(vpath);
+		realpaths.push_back(rpath);
+	}
+
+	hashFiles(realpaths, hashes, _L("Loading zips"));
+
+	for(size_t i = 0; i < virtualpaths.size(); i++)
+		zipHashes[virtualpaths[i]] = hashes[i];
+}
+
 void CacheSystem::loadAllZipsInResourceGroup(String group)
 {
 	std::map<String, bool> loadedZips;
@@ -2025,7 +2442,15 @@ void CacheSystem::loadAllZipsInResourceGroup(String group)
 	FileInfoListPtr files = rgm.findResourceFileInfo(group, "*.zip");
 	FileInfoList::iterator iterFiles = files->begin();
 	size_t i=0, filecount=files->size();
-	for (; iterFiles!= files->end(); ++iterFiles, i++)
+
+	// hash all zips upfront in parallel, the parsing below needs Ogre and stays on this thread
+	std::vector<String> zippaths;
+	for (; iterFiles!= files->end(); ++iterFiles)
+		zippaths.push_back(iterFiles->archive->getName() + "/" + iterFiles->filename);
+	hashZips(zippaths);
+
+	PrecisionTimer timer;
+	for (iterFiles = files->begin(); iterFiles!= files->end(); ++iterFiles, i++)
 	{
 		if(loadedZips[iterFiles->filename])
 		{
@@ -2043,6 +2468,7 @@ void CacheSystem::loadAllZipsInResourceGroup(String group)
 		loadSingleZip((Ogre::FileInfo)*iterFiles);
 		loadedZips[iterFiles->filename] = true;
 	}
+	LOG("parsed " + TOSTRING(filecount) + " zips in group " + group + " in " + TOSTRING((int)(timer.elapsed() * 1000)) + " ms");
 	// hide loader again
 #ifdef USE_MYGUI
 	LoadingWindow::getSingleton().hide();
@@ -2092,7 +2518,21 @@ void CacheSystem::checkForNewZipsInResourceGroup(String group)
 	FileInfoListPtr files = ResourceGroupManager::getSingleton().findResourceFileInfo(group, "*.zip");
 	FileInfoList::iterator iterFiles = files->begin();
 	size_t i=0, filecount=files->size();
-	for (; iterFiles!= files->end(); ++iterFiles, i++)
+
+	// hash the new zips upfront in parallel
+	std::vector<String> zippaths;
+	for (; iterFiles!= files->end(); ++iterFiles)
+	{
+		String archivename = iterFiles->archive->getName();
+		String zippath2 = archivename + iterFiles->filename;
+		if(archivename[archivename.size()-1] != '/')
+			zippath2 = archivename + "/" + iterFiles->filename;
+		if(!isZipUsedInEntries(zippath2))
+			zippaths.push_back(archivename + "/" + iterFiles->filename);
+	}
+	hashZips(zippaths);
+
+	for (iterFiles = files->begin(); iterFiles!= files->end(); ++iterFiles, i++)
 	{
 		String zippath = iterFiles->archive->getName() + "\\" + iterFiles->filename;
 		String zippath2="";
@@ -25,6 +25,9 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 #include "RoRPrerequisites.h"
 
 #include "BeamData.h"
+#include "CacheIndex.h"
+#include "ContentFingerprints.h"
+#include "SearchIndex.h"
 #include "sha1.h"
 #include "Singleton.h"
 
@@ -32,6 +35,7 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 
 #define CACHE_FILE "mods.cache"
 #define CACHE_FILE_FORMAT "6"
+#define CACHE_INDEX_FILE "mods.cache.bin"
 
 // 60*60*24 = one day
 #define CACHE_FILE_FRESHNESS 86400
@@ -201,6 +205,8 @@ public:
 	bool checkResourceLoaded(Ogre::String &filename);
 	bool checkResourceLoaded(Ogre::String &filename, Ogre::String &group);
 	Cache_Entry getResourceInfo(Ogre::String &filename);
+	// the entry of filename in this archive (the dirname of the entry), 0 if there is none
+	Cache_Entry *getEntryInArchive(Ogre::String filename, Ogre::String archive);
 	Ogre::String addMeshMaterials(Cache_Entry &entry, Ogre::Entity *e);
 	std::map<int, Category_Entry> *getCategories();
 	std::vector<Cache_Entry> *getEntries();
@@ -208,6 +214,19 @@ public:
 	int getCategoryUsage(int category);
 	Cache_Entry *getEntry(int modid);
 
+	// indexed lookups, return 0 if nothing was found
+	Cache_Entry *getEntryByUniqueID(Ogre::String uniqueid);
+	Cache_Entry *getEntryByGUID(Ogre::String guid);
+	void getEntriesByCategory(int categoryid, std::vector<Cache_Entry *> &result);
+
+	// search index over getEntries(), rebuilt when the entries changed
+	SearchIndex *getSearchIndex();
+
+	// unloads the resources of the least recently used archives while the memory budget is exceeded,
+	// usedGroups hold the resources that are in use right now, they are never touched
+	void trimResourceGroups(const std::set<Ogre::String> &usedGroups);
+	bool isResourceBudgetExceeded();
+
 	int getTimeStamp();
 
 	// this location MUST include a path separator at the end!
@@ -236,6 +255,7 @@ protected:
 
 	Ogre::String currentSHA1;	// stores sha1 over the content
 	int rgcounter;				// resource group counter, used to track the resource groups created
+	int rgcounterReloaded;		// same for the groups created on demand by checkResourceLoaded
 	int modcounter;				// counter the number of mods
 
 
@@ -266,13 +286,22 @@ protected:
 	int isCacheValid();                       // validate cache
 	void unloadUselessResourceGroups();       // unload unused resources after cache generation
 	Ogre::String filenamesSHA1();             // generates the hash over the whole content
-	bool loadCache();			              // loads cache config file, new format
-	Ogre::String getCacheConfigFilename(bool full); // returns filename of the cache file
+	bool loadCache();			              // loads the binary cache index, converts an old text cache
+	bool loadTextCache();                     // loads the text cache file, only used to convert it
+	int isTextCacheValid();                   // validates the text cache file of older versions
+	Ogre::String getCacheConfigFilename(bool full); // returns filename of the text cache file
+	Ogre::String getCacheIndexFilename();     // returns the full filename of the binary cache index
+	bool isIndexInSync();                     // true if entries still map 1:1 to the index records
+	void entriesChanged();                    // call whenever entries are added, removed or marked deleted
+	Cache_Entry *decodeEntry(unsigned int record); // decodes the record into entries[record] on first access
+	void decodeEntries();                     // decodes all records, call before iterating or changing entries
+	Cache_Entry *findEntryByFilename(Ogre::String filename); // case insensitive, also matches the filename without uid
 	int incrementalCacheUpdate();             // tries to update parts of the Cache only
 
 	void generateFileCache(Cache_Entry &entry, Ogre::String directory=Ogre::String());	// generates a new cache
 	void deleteFileCache(char *filename); // removed files from cache
-	void writeGeneratedCache();
+	void writeGeneratedCache();               // writes the binary index and maps it again
+	void writeTextCache();                    // text format of older versions, only for debugging
 	void writeStreamCache();
 	
 	// adds a zip to the cache
@@ -290,12 +319,33 @@ protected:
 
 	// this holds all files
 	std::vector<Cache_Entry> entries;
+	unsigned int generation;       //!< bumped by entriesChanged(), stored in the index it was written to
+	// memory mapped binary cache, entries[i] is record i as long as isIndexInSync()
+	CacheIndex index;
+	std::vector<bool> decoded;     //!< records that were decoded into entries, empty once all of them were
+	unsigned int undecodedCount;
 
 	std::map<Ogre::String, Ogre::String> zipHashes;
+	ContentFingerprints fingerprints;
+	SearchIndex searchIndex;
+	unsigned int searchIndexGeneration; //!< generation of the entries the search index was built from
 
 	// categories
 	std::map<int, Category_Entry> categories;
 	std::map<int, int> category_usage;
+
+	// archives that were loaded on demand by checkResourceLoaded
+	typedef struct resource_group_t
+	{
+		Ogre::String archive;
+		unsigned long lastUsed;   //!< value of resourceGroupClock at the last use
+		bool pinned;              //!< terrains are never unloaded
+		bool unloaded;            //!< resources were unloaded since the last use
+	} resource_group_t;
+	std::map<Ogre::String, resource_group_t> resourceGroups; //!< group name -> group
+	std::map<Ogre::String, Ogre::String> archiveGroups;      //!< archive -> group name
+	unsigned long resourceGroupClock;
+	void touchResourceGroup(const Ogre::String &group);
 	std::set<Ogre::String> zipCacheList;
 	void readCategoryTitles();
 
@@ -316,6 +366,10 @@ protected:
 
 	void checkForNewContent();
 
+	// hashes all given zips that are not yet in zipHashes or changed since, the work is spread over several threads
+	void hashZips(std::vector<Ogre::String> &zippaths);
+	void hashFiles(std::vector<Ogre::String> &filenames, std::vector<Ogre::String> &hashes, Ogre::UTFString title);
+
 	void checkForNewZipsInResourceGroup(Ogre::String group);
 	void checkForNewDirectoriesInResourceGroup(Ogre::String group);
 
@@ -25,6 +25,7 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 #include "heightfinder.h"
 #include "InputEngine.h"
 #include "IWater.h"
+#include "LabelRenderer.h"
 #include "MapControl.h"
 #include "MapEntity.h"
 #include "network.h"
@@ -46,15 +47,18 @@ Character::Character(Camera *cam, Collisions *c, Network *net, HeightFinder *h,
 	, collisions(c)
 	, colourNumber(colourNumber)
 	, hFinder(h)
+	, last_net_send_time(0)
 	, last_net_time(0)
 	, mAnimState(0)
 	, mCamera(cam)
 	, mCharacterNode(0)
 	, mLastPosition(Vector3::ZERO)
-	, mMoveableText(0)
+	, mNetLabel(-1)
 	, mSceneMgr(scm)
 	, mapControl(m)
 	, net(net)
+	, netLastSentOrientation(Quaternion::IDENTITY)
+	, netLastSentPosition(Vector3::ZERO)
 	, networkAuthLevel(0)
 	, networkUsername("")
 	, physicsEnabled(true)
@@ -112,9 +116,9 @@ Character::Character(Camera *cam, Collisions *c, Network *net, HeightFinder *h,
 Character::~Character()
 {
 	setVisible(false);
-	if (mMoveableText)
+	if (mNetLabel >= 0 && LabelRenderer::singletonExists())
 	{
-		delete mMoveableText;
+		LabelRenderer::getSingleton().removeLabel(mNetLabel);
 	}
 	if (mCharacterNode)
 	{
@@ -173,36 +177,13 @@ void Character::updateNetLabel()
 	}
 
 	//LOG(" * updateNetLabel : " + TOSTRING(this->source));
-	if (!mMoveableText)
+	if (LabelRenderer::singletonExists())
 	{
-		mMoveableText = new MovableText("netlabel-"+myName, networkUsername);
-		mCharacterNode->attachObject(mMoveableText);
-		mMoveableText->setFontName("CyberbitEnglish");
-		mMoveableText->setTextAlignment(MovableText::H_CENTER, MovableText::V_ABOVE);
-		mMoveableText->setAdditionalHeight(2);
-		mMoveableText->showOnTop(false);
-		mMoveableText->setCharacterHeight(8);
-		mMoveableText->setColor(ColourValue::Black);
+		if (mNetLabel < 0)
+			mNetLabel = LabelRenderer::getSingleton().addLabel(ColourValue::Black);
+		LabelRenderer::getSingleton().setCaption(mNetLabel, networkUsername);
 	}
 
-	//LOG(" *label caption: " + String(networkUsername));
-	try
-	{
-		mMoveableText->setCaption(networkUsername);
-	} catch (...) {}
-	/*
-	if (networkAuthLevel & AUTH_ADMIN)
-	{
-		mMoveableText->setFontName("highcontrast_red");
-	} else if (networkAuthLevel & AUTH_RANKED)
-	{
-		mMoveableText->setFontName("highcontrast_green");
-	} else
-	{
-		mMoveableText->setFontName("highcontrast_black");
-	}
-	*/
-
 	// update character colour
 	updateCharacterColour();
 #endif //SOCKETW
@@ -291,6 +272,14 @@ void Character::setAnimationMode(String mode, float time)
 	}
 }
 
+void Character::setAnimationTime(String mode, float timePosition)
+{
+	if (!mAnimState || !mAnimState->hasAnimationState(mode))
+		return;
+	setAnimationMode(mode);
+	mAnimState->getAnimationState(mode)->setTimePosition(timePosition);
+}
+
 void Character::update(float dt)
 {
 	if (physicsEnabled && !remote)
@@ -530,6 +519,9 @@ void Character::update(float dt)
 			mAnimState->getAnimationState("driving")->setTimePosition(timePos);
 		}
 
+	} else if (remote)
+	{
+		updateNetInterpolation(dt);
 	}
 
 #ifdef USE_SOCKETW
@@ -573,7 +565,7 @@ void Character::sendStreamSetup()
 void Character::sendStreamData()
 {
 	int t = netTimer.getMilliseconds();
-	if (t-last_net_time < 100)
+	if (t-last_net_time < netSendInterval)
 		return;
 
 	// do not send position data if coupled to a truck already
@@ -581,6 +573,19 @@ void Character::sendStreamData()
 
 	last_net_time = t;
 
+	// only send if something visible changed, and once in a while so late joiners and lost packets are covered
+	// the animation time itself is not checked: the remote side keeps the animation running on its own
+	bool changed = mCharacterNode->getPosition().squaredDistance(netLastSentPosition) > 0.0004f
+		|| !mCharacterNode->getOrientation().equals(netLastSentOrientation, Degree(1.0f))
+		|| mLastAnimMode != netLastSentAnimationMode;
+	if (!changed && t - last_net_send_time < netHeartbeatInterval)
+		return;
+
+	last_net_send_time        = t;
+	netLastSentPosition       = mCharacterNode->getPosition();
+	netLastSentOrientation    = mCharacterNode->getOrientation();
+	netLastSentAnimationMode  = mLastAnimMode;
+
 	pos_netdata_t data;
 	data.command = CHARCMD_POSITION;
 	data.posx = mCharacterNode->getPosition().x;
@@ -604,13 +609,15 @@ void Character::receiveStreamData(unsigned int &type, int &source, unsigned int
 		header_netdata_t *header = (header_netdata_t *)buffer;
 		if (header->command == CHARCMD_POSITION)
 		{
-			// position
+			// position, applied smoothly in updateNetInterpolation
 			pos_netdata_t *data = (pos_netdata_t *)buffer;
-			Vector3 pos(data->posx, data->posy, data->posz);
-			this->setPosition(pos);
-			Quaternion rot(data->rotw, data->rotx, data->roty, data->rotz);
-			mCharacterNode->setOrientation(rot);
-			setAnimationMode(getASCIIFromCharString(data->animationMode, 255), data->animationTime);
+			net_snapshot_t snapshot;
+			snapshot.time          = netTimer.getMilliseconds();
+			snapshot.position      = Vector3(data->posx, data->posy, data->posz);
+			snapshot.orientation   = Quaternion(data->rotw, data->rotx, data->roty, data->rotz);
+			snapshot.animationMode = getASCIIFromCharString(data->animationMode, 255);
+			snapshot.animationTime = data->animationTime;
+			addNetSnapshot(snapshot);
 		} else if (header->command == CHARCMD_ATTACH)
 		{
 			// attach
@@ -627,37 +634,106 @@ void Character::receiveStreamData(unsigned int &type, int &source, unsigned int
 	}
 }
 
+void Character::addNetSnapshot(const net_snapshot_t &snapshot)
+{
+	if (!netSnapshots.empty())
+	{
+		// the sender skips packets while standing still: hold the old state until shortly
+		// before the new one, otherwise the movement would be stretched over the whole pause
+		net_snapshot_t last = netSnapshots.back();
+		if (snapshot.time - last.time > (unsigned long)netSendInterval * 2)
+		{
+			last.time = snapshot.time - netSendInterval;
+			netSnapshots.push_back(last);
+		}
+	} else
+	{
+		// first snapshot, jump there
+		setPosition(snapshot.position);
+		mCharacterNode->setOrientation(snapshot.orientation);
+		setAnimationTime(snapshot.animationMode, snapshot.animationTime);
+	}
+
+	netSnapshots.push_back(snapshot);
+	while (netSnapshots.size() > netSnapshotCount)
+		netSnapshots.pop_front();
+}
+
+void Character::updateNetInterpolation(float dt)
+{
+	if (netSnapshots.empty())
+		return;
+
+	unsigned long now = netTimer.getMilliseconds();
+	unsigned long renderTime = (now > netInterpolationDelay) ? now - netInterpolationDelay : 0;
+
+	// drop the snapshots we passed already, keep the one right before renderTime
+	while (netSnapshots.size() > 1 && netSnapshots[1].time <= renderTime)
+		netSnapshots.pop_front();
+
+	net_snapshot_t &s1 = netSnapshots.front();
+	if (netSnapshots.size() == 1 || renderTime <= s1.time)
+	{
+		// nothing newer: stay where we are and keep the animation going
+		setPosition(s1.position);
+		mCharacterNode->setOrientation(s1.orientation);
+		if (mLastAnimMode != s1.animationMode)
+			setAnimationTime(s1.animationMode, s1.animationTime);
+		else if (mAnimState && mAnimState->hasAnimationState(s1.animationMode))
+			setAnimationMode(s1.animationMode, dt);
+		return;
+	}
+
+	net_snapshot_t &s2 = netSnapshots[1];
+	float ratio = (float)(renderTime - s1.time) / (float)std::max(1UL, s2.time - s1.time);
+
+	setPosition(s1.position + (s2.position - s1.position) * ratio);
+	mCharacterNode->setOrientation(Quaternion::Slerp(ratio, s1.orientation, s2.orientation, true));
+
+	if (s1.animationMode == s2.animationMode && s2.animationTime >= s1.animationTime)
+		setAnimationTime(s1.animationMode, s1.animationTime + (s2.animationTime - s1.animationTime) * ratio);
+	else if (ratio < 0.5f)
+		setAnimationTime(s1.animationMode, s1.animationTime);
+	else
+		setAnimationTime(s2.animationMode, s2.animationTime);
+}
+
 void Character::updateNetLabelSize()
 {
-	if (!this || !net || !mMoveableText) return;
+	if (!this || !net || mNetLabel < 0) return;
 
-	mMoveableText->setVisible(getVisible());
+	LabelRenderer &labels = LabelRenderer::getSingleton();
+	labels.setVisible(mNetLabel, getVisible());
 
-	if (!mMoveableText->isVisible()) return; // why not getVisible()?
+	if (!labels.getVisible(mNetLabel)) return;
 
+	// the label keeps the size it had when it was scaled with the character node
 	float camDist = (mCharacterNode->getPosition() - mCamera->getPosition()).length();
-	float h = std::max(9.0f, camDist * 1.2f);
+	float h = std::max(9.0f, camDist * 1.2f) * 0.02f;
 
-	mMoveableText->setCharacterHeight(h);
+	labels.setPosition(mNetLabel, mCharacterNode->getPosition() + Vector3(0, 2, 0), h);
 
 	if (camDist > 1000.0f)
-		mMoveableText->setCaption(networkUsername + "  (" + TOSTRING((float)(ceil(camDist / 100) / 10.0f))+ " km)");
+		labels.setCaption(mNetLabel, networkUsername + "  (" + TOSTRING((float)(ceil(camDist / 100) / 10.0f))+ " km)");
 	else if (camDist > 20.0f && camDist <= 1000.0f)
-		mMoveableText->setCaption(networkUsername + "  (" + TOSTRING((int)camDist)+ " m)");
+		labels.setCaption(mNetLabel, networkUsername + "  (" + TOSTRING((int)camDist)+ " m)");
 	else
-		mMoveableText->setCaption(networkUsername);
+		labels.setCaption(mNetLabel, networkUsername);
 }
 
 void Character::setBeamCoupling(bool enabled, Beam *truck /* = 0 */)
 {
+	// the snapshots from before do not belong to the new situation
+	netSnapshots.clear();
+
 	if (enabled)
 	{
 		if (!truck) return;
 		beamCoupling = truck;
 		setPhysicsEnabled(false);
-		if (mMoveableText && mMoveableText->isVisible())
+		if (mNetLabel >= 0)
 		{
-			mMoveableText->setVisible(false);
+			LabelRenderer::getSingleton().setVisible(mNetLabel, false);
 		}
 		if (net && !remote)
 		{
@@ -682,9 +758,9 @@ void Character::setBeamCoupling(bool enabled, Beam *truck /* = 0 */)
 	{
 		setPhysicsEnabled(true);
 		beamCoupling = 0;
-		if (mMoveableText && !mMoveableText->isVisible())
+		if (mNetLabel >= 0)
 		{
-			mMoveableText->setVisible(true);
+			LabelRenderer::getSingleton().setVisible(mNetLabel, true);
 		}
 		if (net && !remote)
 		{
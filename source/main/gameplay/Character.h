@@ -22,7 +22,6 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "RoRPrerequisites.h"
 
-#include "MovableText.h"
 #include "Streamable.h"
 
 class Character : public Streamable
@@ -82,12 +81,12 @@ protected:
 	Ogre::Real characterVSpeed;
 	
 	int colourNumber;
+	int mNetLabel;                 //!< handle in the LabelRenderer, -1 without a label
 	int networkAuthLevel;
 	int source;
 
 	Ogre::AnimationStateSet *mAnimState;
 	Ogre::Camera *mCamera;
-	Ogre::MovableText *mMoveableText;
 	Ogre::SceneManager *mSceneMgr;
 	Ogre::SceneNode *mCharacterNode;
 	Ogre::String mLastAnimMode;
@@ -99,6 +98,31 @@ protected:
 	unsigned int streamid;
 	
 	void setAnimationMode(Ogre::String mode, float time=0);
+	void setAnimationTime(Ogre::String mode, float timePosition);
+
+	// remote characters are displayed slightly in the past, interpolated between the received snapshots
+	typedef struct net_snapshot_t
+	{
+		unsigned long time; //!< local receive time in ms
+		Ogre::Vector3 position;
+		Ogre::Quaternion orientation;
+		Ogre::String animationMode;
+		float animationTime;
+	} net_snapshot_t;
+
+	static const unsigned int netSnapshotCount = 8;
+	static const unsigned long netInterpolationDelay = 150; //!< ms the remote characters are displayed behind the newest snapshot
+	static const int netSendInterval = 100;                 //!< ms between two position packets at most
+	static const int netHeartbeatInterval = 1000;           //!< ms after which the position is sent even if nothing changed
+
+	std::deque < net_snapshot_t > netSnapshots;
+	Ogre::String netLastSentAnimationMode;
+	Ogre::Quaternion netLastSentOrientation;
+	Ogre::Vector3 netLastSentPosition;
+	int last_net_send_time;
+
+	void addNetSnapshot(const net_snapshot_t &snapshot);
+	void updateNetInterpolation(float dt);
 
 	// network stuff
 	typedef struct header_netdata_t
@@ -134,6 +158,7 @@ protected:
 	void sendStreamData();
 	void sendStreamSetup();
 	void setUID(int uid);
+	Ogre::String getStreamName() { return "character"; };
 
 	void updateNetLabelSize();
 };
@@ -0,0 +1,321 @@
+/*
+This source file is part of Rigs of Rods
+Copyright 2005-2012 Pierre-Michel Ricordel
+Copyright 2007-2012 Thomas Fischer
+
+For more information, see http://www.rigsofrods.com/
+
+Rigs of Rods is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 3, as
+published by the Free Software Foundation.
+
+Rigs of Rods is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "ContentFingerprints.h"
+
+#include "sha1.h"
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif // OGRE_PLATFORM_WIN32
+
+using namespace Ogre;
+
+// files are mapped in windows of this size, a multiple of the page size and the windows allocation granularity
+#define FINGERPRINT_CHUNK_SIZE (16 * 1024 * 1024)
+
+#define FASTHASH_K1 0x87c37b91114253d5ULL
+#define FASTHASH_K2 0x4cf5ad432745937fULL
+
+static inline unsigned long long fastHashRotl(unsigned long long x, int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+// mixes a block of memory into the hash state, the block size must be a multiple of 8 unless it is the last one
+static unsigned long long fastHashUpdate(unsigned long long h, const unsigned char *data, size_t len)
+{
+	size_t words = len / 8;
+	for (size_t i = 0; i < words; i++)
+	{
+		unsigned long long k;
+		memcpy(&k, data + i * 8, 8);
+		k *= FASTHASH_K1;
+		k  = fastHashRotl(k, 31);
+		k *= FASTHASH_K2;
+		h ^= k;
+		h  = fastHashRotl(h, 27) * 5 + 0x52dce729;
+	}
+
+	size_t rest = len & 7;
+	if (rest)
+	{
+		unsigned long long k = 0;
+		memcpy(&k, data + words * 8, rest);
+		k *= FASTHASH_K1;
+		k  = fastHashRotl(k, 31);
+		k *= FASTHASH_K2;
+		h ^= k;
+	}
+	return h;
+}
+
+static unsigned long long fastHashFinal(unsigned long long h, unsigned long long len)
+{
+	h ^= len;
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+ContentFingerprints::ContentFingerprints()
+{
+	pthread_mutex_init(&lock, NULL);
+}
+
+ContentFingerprints::~ContentFingerprints()
+{
+	pthread_mutex_destroy(&lock);
+}
+
+bool ContentFingerprints::load(String filename)
+{
+	FILE *f = fopen(filename.c_str(), "r");
+	if (!f)
+		return false;
+
+	MUTEX_LOCK(&lock);
+	fingerprints.clear();
+	char line[2048];
+	bool valid = false;
+	while (fgets(line, 2048, f))
+	{
+		String str = line;
+		StringUtil::trim(str, false, true);
+		if (str.empty()) continue;
+		if (!valid)
+		{
+			// first line has to be the format
+			valid = (str == "fingerprints=" + String(FINGERPRINTS_FILE_FORMAT));
+			if (!valid) break;
+			continue;
+		}
+
+		// path, size, mtime, inode, fast hash, sha1
+		StringVector args = StringUtil::split(str, "\t", 6);
+		if (args.size() != 6) continue;
+
+		content_fingerprint_t fp;
+		fp.size = fp.mtime = fp.inode = fp.fasthash = 0;
+		sscanf(args[1].c_str(), "%llu", &fp.size);
+		sscanf(args[2].c_str(), "%llu", &fp.mtime);
+		sscanf(args[3].c_str(), "%llu", &fp.inode);
+		sscanf(args[4].c_str(), "%llx", &fp.fasthash);
+		fp.sha1     = args[5];
+		fp.used     = false;
+		fingerprints[args[0]] = fp;
+	}
+	MUTEX_UNLOCK(&lock);
+	fclose(f);
+	return valid;
+}
+
+bool ContentFingerprints::save(String filename)
+{
+	FILE *f = fopen(filename.c_str(), "w");
+	if (!f)
+		return false;
+
+	fprintf(f, "fingerprints=%s\n", FINGERPRINTS_FILE_FORMAT);
+	MUTEX_LOCK(&lock);
+	for (std::map<String, content_fingerprint_t>::iterator it = fingerprints.begin(); it != fingerprints.end(); it++)
+	{
+		// drop files that we did not see this time, they were most likely deleted
+		if (!it->second.used) continue;
+		fprintf(f, "%s\t%llu\t%llu\t%llu\t%016llx\t%s\n", it->first.c_str(), it->second.size, it->second.mtime, it->second.inode, it->second.fasthash, it->second.sha1.c_str());
+	}
+	MUTEX_UNLOCK(&lock);
+	fclose(f);
+	return true;
+}
+
+bool ContentFingerprints::getMetadata(String path, unsigned long long &size, unsigned long long &mtime, unsigned long long &inode)
+{
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+	struct _stati64 st;
+	if (_stati64(path.c_str(), &st))
+		return false;
+#else
+	struct stat st;
+	if (stat(path.c_str(), &st))
+		return false;
+#endif // OGRE_PLATFORM_WIN32
+	size  = (unsigned long long)st.st_size;
+	mtime = (unsigned long long)st.st_mtime;
+	inode = (unsigned long long)st.st_ino;
+	return true;
+}
+
+String ContentFingerprints::getMetadataString(String path)
+{
+	unsigned long long size = 0, mtime = 0, inode = 0;
+	if (!getMetadata(path, size, mtime, inode))
+		return "";
+	char tmp[64] = "";
+	sprintf(tmp, "%llu/%llu", size, mtime);
+	return String(tmp);
+}
+
+bool ContentFingerprints::isUnchanged(String path)
+{
+	unsigned long long size = 0, mtime = 0, inode = 0;
+	if (!getMetadata(path, size, mtime, inode))
+		return false;
+
+	bool res = false;
+	MUTEX_LOCK(&lock);
+	std::map<String, content_fingerprint_t>::iterator it = fingerprints.find(path);
+	if (it != fingerprints.end() && it->second.size == size && it->second.mtime == mtime && it->second.inode == inode)
+	{
+		it->second.used = true;
+		res = true;
+	}
+	MUTEX_UNLOCK(&lock);
+	return res;
+}
+
+String ContentFingerprints::getSHA1(String path)
+{
+	unsigned long long size = 0, mtime = 0, inode = 0;
+	if (!getMetadata(path, size, mtime, inode))
+		return "";
+
+	content_fingerprint_t fp;
+	bool known = false;
+	MUTEX_LOCK(&lock);
+	std::map<String, content_fingerprint_t>::iterator it = fingerprints.find(path);
+	if (it != fingerprints.end())
+	{
+		fp = it->second;
+		known = true;
+		if (fp.size == size && fp.mtime == mtime && fp.inode == inode && !fp.sha1.empty())
+		{
+			// nothing changed, no need to read the file
+			it->second.used = true;
+			MUTEX_UNLOCK(&lock);
+			return fp.sha1;
+		}
+	}
+	MUTEX_UNLOCK(&lock);
+
+	// the metadata changed: check the content with the fast hash, and only do the expensive SHA1 if it really changed
+	unsigned long long fasthash = 0;
+	if (!calcFastHash(path, size, fasthash))
+		return "";
+
+	String sha1;
+	if (known && fp.size == size && fp.fasthash == fasthash && !fp.sha1.empty())
+		sha1 = fp.sha1;
+	else
+		sha1 = calcSHA1(path);
+
+	fp.size     = size;
+	fp.mtime    = mtime;
+	fp.inode    = inode;
+	fp.fasthash = fasthash;
+	fp.sha1     = sha1;
+	fp.used     = true;
+
+	MUTEX_LOCK(&lock);
+	fingerprints[path] = fp;
+	MUTEX_UNLOCK(&lock);
+	return sha1;
+}
+
+String ContentFingerprints::calcSHA1(String path)
+{
+	char hash[256] = {};
+	RoR::CSHA1 sha1;
+	if (!sha1.HashFile(const_cast<char*>(path.c_str())))
+		return "";
+	sha1.Final();
+	sha1.ReportHash(hash, RoR::CSHA1::REPORT_HEX_SHORT);
+	return String(hash);
+}
+
+bool ContentFingerprints::calcFastHash(String path, unsigned long long size, unsigned long long &hash)
+{
+	unsigned long long h = 0x9e3779b97f4a7c15ULL;
+	if (size == 0)
+	{
+		hash = fastHashFinal(h, 0);
+		return true;
+	}
+
+	// the file is mapped window by window, so huge archives do not need huge amounts of address space
+#if OGRE_PLATFORM == OGRE_PLATFORM_WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mapping)
+	{
+		CloseHandle(file);
+		return false;
+	}
+	bool ok = true;
+	for (unsigned long long offset = 0; offset < size; offset += FINGERPRINT_CHUNK_SIZE)
+	{
+		size_t len = (size_t)std::min<unsigned long long>(FINGERPRINT_CHUNK_SIZE, size - offset);
+		void *ptr = MapViewOfFile(mapping, FILE_MAP_READ, (DWORD)(offset >> 32), (DWORD)(offset & 0xffffffff), len);
+		if (!ptr)
+		{
+			ok = false;
+			break;
+		}
+		h = fastHashUpdate(h, (const unsigned char *)ptr, len);
+		UnmapViewOfFile(ptr);
+	}
+	CloseHandle(mapping);
+	CloseHandle(file);
+	if (!ok)
+		return false;
+#else
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	for (unsigned long long offset = 0; offset < size; offset += FINGERPRINT_CHUNK_SIZE)
+	{
+		size_t len = (size_t)std::min<unsigned long long>(FINGERPRINT_CHUNK_SIZE, size - offset);
+		void *ptr = mmap(0, len, PROT_READ, MAP_PRIVATE, fd, (off_t)offset);
+		if (ptr == MAP_FAILED)
+		{
+			close(fd);
+			return false;
+		}
+		madvise(ptr, len, MADV_SEQUENTIAL);
+		h = fastHashUpdate(h, (const unsigned char *)ptr, len);
+		munmap(ptr, len);
+	}
+	close(fd);
+#endif // OGRE_PLATFORM_WIN32
+
+	hash = fastHashFinal(h, size);
+	return true;
+}
@@ -0,0 +1,74 @@
+/*
+This source file is part of Rigs of Rods
+Copyright 2005-2012 Pierre-Michel Ricordel
+Copyright 2007-2012 Thomas Fischer
+
+For more information, see http://www.rigsofrods.com/
+
+Rigs of Rods is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 3, as
+published by the Free Software Foundation.
+
+Rigs of Rods is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __ContentFingerprints_H_
+#define __ContentFingerprints_H_
+
+#include "RoRPrerequisites.h"
+
+#include <Ogre.h>
+#include <pthread.h>
+
+#define FINGERPRINTS_FILE "fingerprints.cache"
+#define FINGERPRINTS_FILE_FORMAT "1"
+
+typedef struct content_fingerprint_t
+{
+	unsigned long long size;
+	unsigned long long mtime;
+	unsigned long long inode;     //!< 0 on platforms without inodes
+	unsigned long long fasthash;  //!< non cryptographic hash over the content
+	Ogre::String sha1;            //!< the hash that is shown to the user, see Cache_Entry::hash
+	bool used;                    //!< queried during this run, unused fingerprints are not saved
+} content_fingerprint_t;
+
+/**
+ * Persistent store of file fingerprints, used to avoid reading unchanged archives.
+ * A file is only read again if its size, modification time or inode changed. In that case the fast
+ * content hash decides if the content really changed, the SHA1 is only recalculated if it did.
+ * All methods are thread safe, so the hashing can run on a ThreadPool.
+ */
+class ContentFingerprints
+{
+public:
+	ContentFingerprints();
+	~ContentFingerprints();
+
+	bool load(Ogre::String filename);
+	bool save(Ogre::String filename);
+
+	// reads the file metadata only, true if it matches the stored fingerprint
+	bool isUnchanged(Ogre::String path);
+
+	// returns the SHA1 of the file, the file is only read if its metadata changed since the last time
+	Ogre::String getSHA1(Ogre::String path);
+
+	// returns size and modification time of the file as string, used for content list hashes
+	static Ogre::String getMetadataString(Ogre::String path);
+
+	static bool getMetadata(Ogre::String path, unsigned long long &size, unsigned long long &mtime, unsigned long long &inode);
+	static bool calcFastHash(Ogre::String path, unsigned long long size, unsigned long long &hash);
+	static Ogre::String calcSHA1(Ogre::String path);
+
+protected:
+	pthread_mutex_t lock;
+	std::map<Ogre::String, content_fingerprint_t> fingerprints;
+};
+
+#endif // __ContentFingerprints_H_
@@ -53,6 +53,7 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 #include "Heathaze.h"
 #include "InputEngine.h"
 #include "IWater.h"
+#include "LabelRenderer.h"
 #include "language.h"
 #include "MeshObject.h"
 #include "MumbleIntegration.h"
@@ -736,6 +737,8 @@ void RoRFrameListener::setGravity(float value)
 
 // Constructor takes a RenderWindow because it uses that to determine input context
 RoRFrameListener::RoRFrameListener(AppState *parentState, RenderWindow* win, Camera* cam, SceneManager* scm, Root* root, bool isEmbedded, Ogre::String inputhwnd) :
+	asyncSpawnPosition(Vector3::ZERO),
+	asyncSpawnTruck(-1),
 	clutch(0),
 	collisions(0),
 	dashboard(0),
@@ -896,6 +899,9 @@ RoRFrameListener::RoRFrameListener(AppState *parentState, RenderWindow* win, Cam
 	// setup particle manager
 	new DustManager(mSceneMgr);
 
+	// the name labels of all trucks and characters
+	new LabelRenderer(mSceneMgr, mCamera);
+
 	if (BSETTING("regen-cache-only", false))
 	{
 		CACHE.startup(scm, true);
@@ -1212,6 +1218,10 @@ RoRFrameListener::RoRFrameListener(AppState *parentState, RenderWindow* win, Cam
 
 RoRFrameListener::~RoRFrameListener()
 {
+	for (std::map<String, odef_t *>::iterator it = odefCache.begin(); it != odefCache.end(); it++)
+		delete it->second;
+	odefCache.clear();
+
 #ifdef USE_MYGUI
 	LoadingWindow::freeSingleton();
 	SelectorWindow::freeSingleton();
@@ -1320,42 +1330,25 @@ void RoRFrameListener::unloadObject(const char* instancename)
 	obj.enabled = false;
 }
 
-void RoRFrameListener::loadObject(const char* name, float px, float py, float pz, float rx, float ry, float rz, SceneNode * bakeNode, const char* instancename, bool enable_collisions, int scripthandler, const char *type, bool uniquifyMaterial)
+RoRFrameListener::odef_t *RoRFrameListener::getObjectDefinition(const char *name)
 {
-	ScopeLog log("object_"+String(name));
-	if (type && !strcmp(type, "grid"))
-	{
-		// some fast grid object hacks :)
-		for(int x=0;x<500;x+=50)
-			for(int z=0;z<500;z+=50)
-				loadObject(name, px+x, py, pz+z, rx, ry, rz, bakeNode, 0, enable_collisions, scripthandler, 0);
-		return;
-	}
-
-	// nice idea, but too many random hits
-	//if (abs(rx+1) < 0.001) rx = Math::RangeRandom(0, 360);
-	//if (abs(ry+1) < 0.001) ry = Math::RangeRandom(0, 360);
-	//if (abs(rz+1) < 0.001) rz = Math::RangeRandom(0, 360);
-
-	if (strnlen(name, 250)==0)
-		return;
+	// the same objects are placed many times, so every file is only searched and parsed once
+	String key = terrainUID + "/" + String(name);
+	std::map<String, odef_t *>::iterator itc = odefCache.find(key);
+	if (itc != odefCache.end())
+		return itc->second;
 
-	//FILE *fd;
 	char fname[1024] = {};
-	char oname[1024] = {};
 	char mesh[1024] = {};
 	char line[1024] = {};
 	char collmesh[1024] = {};
-	float scx = 0, scy = 0, scz = 0;
 	float lx = 0, hx = 0, ly = 0, hy = 0, lz = 0, hz = 0;
 	float srx = 0, sry = 0, srz = 0;
 	float drx = 0, dry = 0, drz = 0;
 	float fcx = 0, fcy = 0, fcz = 0;
 	bool forcecam=false;
-	bool ismovable=false;
 
 	int event_filter = EVENT_ALL;
-	Quaternion rotation = Quaternion(Degree(rx), Vector3::UNIT_X)*Quaternion(Degree(ry), Vector3::UNIT_Y)*Quaternion(Degree(rz), Vector3::UNIT_Z);
 
 	// try to load with UID first!
 	String odefgroup = "";
@@ -1390,71 +1383,34 @@ void RoRFrameListener::loadObject(const char* name, float px, float py, float pz
 	if (!odefFound)
 	{
 		LOG("Error while loading Terrain: could not find required .odef file: " + odefname + ". Ignoring entry.");
-		return;
+		return 0;
 	}
 
 	DataStreamPtr ds=ResourceGroupManager::getSingleton().openResource(odefname, odefgroup);
 
+	odef_t *odef = new odef_t();
+	odef->filename  = String(fname);
+	odef->truckShop = false;
+
 	ds->readLine(mesh, 1023);
 	if (String(mesh) == "LOD")
 	{
 		// LOD line is obsolete
 		ds->readLine(mesh, 1023);
 	}
+	odef->mesh = String(mesh);
 
 	//scale
+	float scx = 0, scy = 0, scz = 0;
 	ds->readLine(line, 1023);
 	sscanf(line, "%f, %f, %f",&scx,&scy,&scz);
-	sprintf(oname,"object%i(%s)", objcounter,name);
-	objcounter++;
-
-
-	SceneNode *tenode = mSceneMgr->getRootSceneNode()->createChildSceneNode();
-	bool background_loading = BSETTING("Background Loading", false);
-
-	MeshObject *mo = NULL;
-	if (String(mesh) != "none")
-		mo = new MeshObject(mSceneMgr, mesh, oname, tenode, NULL, background_loading);
-	
-	//mo->setQueryFlags(OBJECTS_MASK);
-	//tenode->attachObject(te);
-	tenode->setScale(scx,scy,scz);
-	tenode->setPosition(px,py,pz);
-	tenode->rotate(rotation);
-	tenode->pitch(Degree(-90));
-	tenode->setVisible(true);
-
-	// register in map
-	loaded_object_t *obj = &loadedObjects[std::string(instancename)];
-	obj->instanceName = std::string(instancename);
-	obj->loadType     = 0;
-	obj->enabled      = true;
-	obj->sceneNode    = tenode;
-	obj->collTris.clear();
-
-
-	if (mo && uniquifyMaterial && instancename)
-	{
-		for(unsigned int i = 0; i < mo->getEntity()->getNumSubEntities(); i++)
-		{
-			SubEntity *se = mo->getEntity()->getSubEntity(i);
-			String matname = se->getMaterialName();
-			String newmatname = matname + "/" + String(instancename);
-			//LOG("subentity " + TOSTRING(i) + ": "+ matname + " -> " + newmatname);
-			se->getMaterial()->clone(newmatname);
-			se->setMaterialName(newmatname);
-		}
-	}
-
-	//String meshGroup = ResourceGroupManager::getSingleton().findGroupContainingResource(mesh);
-	//MeshPtr mainMesh = mo->getMesh();
+	odef->scale = Vector3(scx, scy, scz);
 
 	//collision box(es)
 	bool virt=false;
 	bool rotating=false;
-	bool classic_ref=true;
 	// everything is of concrete by default
-	ground_model_t *gm = collisions->getGroundModelByString("concrete");
+	String groundmodel = "concrete";
 	char eventname[256];
 	eventname[0]=0;
 	while (!ds->eof())
@@ -1466,55 +1422,36 @@ void RoRFrameListener::loadObject(const char* name, float px, float py, float pz
 		Ogre::StringUtil::trim(lineStr);
 
 		const char* ptline = lineStr.c_str();
-		if (ll==0 || line[0]=='/' || line[0]==';') continue;
+		if (ll==0 || line[0]=='/' || line[0]==';' || lineStr.empty()) continue;
+
+		odef_command_t c;
+		c.type     = -1;
+		c.param    = 0;
+		c.rotating = false;
+		c.virt     = false;
+		c.forcecam = false;
+		c.line     = lineStr;
+		memset(c.values, 0, sizeof(c.values));
 
 		if (!strcmp("end",ptline)) break;
-		if (!strcmp("movable", ptline)) {ismovable=true;continue;};
-		if (!strcmp("localizer-h", ptline))
-		{
-			localizers[free_localizer].position=Vector3(px,py,pz);
-			localizers[free_localizer].rotation=rotation;
-			localizers[free_localizer].type=Autopilot::LOCALIZER_HORIZONTAL;
-			free_localizer++;
-			continue;
-		}
-		if (!strcmp("localizer-v", ptline))
-		{
-			localizers[free_localizer].position=Vector3(px,py,pz);
-			localizers[free_localizer].rotation=rotation;
-			localizers[free_localizer].type=Autopilot::LOCALIZER_VERTICAL;
-			free_localizer++;
-			continue;
-		}
-		if (!strcmp("localizer-ndb", ptline))
-		{
-			localizers[free_localizer].position=Vector3(px,py,pz);
-			localizers[free_localizer].rotation=rotation;
-			localizers[free_localizer].type=Autopilot::LOCALIZER_NDB;
-			free_localizer++;
+		if (!strcmp("movable", ptline)) continue;
+		if (!strcmp("localizer-h", ptline))   { c.type = ODEF_LOCALIZER; c.param = Autopilot::LOCALIZER_HORIZONTAL; }
+		if (!strcmp("localizer-v", ptline))   { c.type = ODEF_LOCALIZER; c.param = Autopilot::LOCALIZER_VERTICAL; }
+		if (!strcmp("localizer-ndb", ptline)) { c.type = ODEF_LOCALIZER; c.param = Autopilot::LOCALIZER_NDB; }
+		if (!strcmp("localizer-vor", ptline)) { c.type = ODEF_LOCALIZER; c.param = Autopilot::LOCALIZER_VOR; }
+		if (!strcmp("standard", ptline)) c.type = ODEF_STANDARD;
+		if (c.type != -1)
+		{
+			odef->commands.push_back(c);
 			continue;
 		}
-		if (!strcmp("localizer-vor", ptline))
-		{
-			localizers[free_localizer].position=Vector3(px,py,pz);
-			localizers[free_localizer].rotation=rotation;
-			localizers[free_localizer].type=Autopilot::LOCALIZER_VOR;
-			free_localizer++;
-			continue;
-		}
-		if (!strcmp("standard", ptline)) {classic_ref=false;tenode->pitch(Degree(90));continue;};
 		if (!strncmp("sound", ptline, 5))
 		{
-#ifdef USE_OPENAL
-			if (!SoundScriptManager::getSingleton().isDisabled())
-			{
-				char tmp[255]="";
-				sscanf(ptline, "sound %s", tmp);
-				SoundScriptInstance *sound = SoundScriptManager::getSingleton().createInstance(tmp, MAX_TRUCKS+1, tenode);
-				sound->setPosition(tenode->getPosition(), Vector3::ZERO);
-				sound->start();
-			}
-#endif //USE_OPENAL
+			char tmp[255]="";
+			sscanf(ptline, "sound %s", tmp);
+			c.type = ODEF_SOUND;
+			c.name = String(tmp);
+			odef->commands.push_back(c);
 			continue;
 		}
 		if (!strcmp("beginbox", ptline) || !strcmp("beginmesh", ptline))
@@ -1526,7 +1463,7 @@ void RoRFrameListener::loadObject(const char* name, float px, float py, float pz
 			event_filter=EVENT_NONE;
 			eventname[0]=0;
 			collmesh[0]=0;
-			gm = collisions->getGroundModelByString("concrete");
+			groundmodel = "concrete";
 			continue;
 		};
 		if (!strncmp("boxcoords", ptline, 9))
@@ -1558,14 +1495,14 @@ void RoRFrameListener::loadObject(const char* name, float px, float py, float pz
 		}
 		if (!strncmp("frictionconfig", ptline, 14) && strlen(ptline) > 15)
 		{
-			// load a custom friction config
-			collisions->loadGroundModelsConfigFile(String(ptline + 15));
+			c.type = ODEF_FRICTIONCONFIG;
+			c.name = String(ptline + 15);
+			odef->commands.push_back(c);
 			continue;
 		}
 		if ((!strncmp("stdfriction", ptline, 11) || !strncmp("usefriction", ptline, 11)) && strlen(ptline) > 12)
 		{
-			String modelName = String(ptline + 12);
-			gm = collisions->getGroundModelByString(modelName);
+			groundmodel = String(ptline + 12);
 			continue;
 		}
 		if (!strcmp("virtual", ptline)) {virt=true;continue;};
@@ -1584,7 +1521,7 @@ void RoRFrameListener::loadObject(const char* name, float px, float py, float pz
 				event_filter=EVENT_DELETE;
 			
 			if (!strncmp(ts, "shoptruck", 9))
-				terrainHasTruckShop=true;
+				odef->truckShop=true;
 
 			// fallback
 			if (strlen(ts) == 0)
@@ -1592,54 +1529,42 @@ void RoRFrameListener::loadObject(const char* name, float px, float py, float pz
 
 			continue;
 		}
-		//resp=sscanf(ptline, "%f, %f, %f, %f, %f, %f, %f, %f, %f, %c",&lx,&hx,&ly, &hy,&lz, &hz, &srx, &sry, &srz,&type);
 		if (!strcmp("endbox", ptline))
 		{
-			if (enable_collisions)
-			{
-				int boxnum = collisions->addCollisionBox(tenode, rotating, virt,px,py,pz,rx,ry,rz,lx,hx,ly,hy,lz,hz,srx,sry,srz,eventname, instancename, forcecam, Vector3(fcx, fcy, fcz), scx, scy, scz, drx, dry, drz, event_filter, scripthandler);
-				obj->collBoxes.push_back((boxnum));
-			}
+			c.type      = ODEF_BOX;
+			c.param     = event_filter;
+			c.rotating  = rotating;
+			c.virt      = virt;
+			c.forcecam  = forcecam;
+			c.name2     = String(eventname);
+			c.boxLow    = Vector3(lx, ly, lz);
+			c.boxHigh   = Vector3(hx, hy, hz);
+			c.rotation  = Vector3(srx, sry, srz);
+			c.direction = Vector3(drx, dry, drz);
+			c.camera    = Vector3(fcx, fcy, fcz);
+			odef->commands.push_back(c);
 			continue;
 		}
 		if (!strcmp("endmesh", ptline))
 		{
-			collisions->addCollisionMesh(collmesh, Vector3(px,py,pz), tenode->getOrientation(), Vector3(scx, scy, scz), gm, &(obj->collTris));
+			c.type  = ODEF_MESH;
+			c.name  = String(collmesh);
+			c.name2 = groundmodel;
+			odef->commands.push_back(c);
 			continue;
 		}
 
-		if (!strncmp("particleSystem", ptline, 14) && tenode)
+		if (!strncmp("particleSystem", ptline, 14))
 		{
 			float x=0, y=0, z=0, scale=0;
 			char pname[255]="", sname[255]="";
 			int res = sscanf(ptline, "particleSystem %f, %f, %f, %f, %s %s", &scale, &x, &y, &z, pname, sname);
 			if (res != 6) continue;
 
-			// hacky: prevent duplicates
-			String paname = String(pname);
-			while(mSceneMgr->hasParticleSystem(paname))
-				paname += "_";
-
-			// create particle system
-			ParticleSystem* pParticleSys = mSceneMgr->createParticleSystem(paname, String(sname));
-			pParticleSys->setCastShadows(false);
-			pParticleSys->setVisibilityFlags(DEPTHMAP_DISABLED); // disable particles in depthmap
-
-			// Some affectors may need its instance name (e.g. for script feedback purposes)
-#ifdef USE_ANGELSCRIPT
-			unsigned short affCount = pParticleSys->getNumAffectors();
-			ParticleAffector* pAff;
-			for(unsigned short i = 0; i<affCount; ++i)
-			{
-				pAff = pParticleSys->getAffector(i);
-				if (pAff->getType()=="ExtinguishableFire")
-					((ExtinguishableFireAffector*)pAff)->setInstanceName(obj->instanceName);
-			}
-#endif // USE_ANGELSCRIPT
-
-			SceneNode *sn = tenode->createChildSceneNode();
-			sn->attachObject(pParticleSys);
-			sn->pitch(Degree(90));
+			c.type  = ODEF_PARTICLESYSTEM;
+			c.name  = String(pname);
+			c.name2 = String(sname);
+			odef->commands.push_back(c);
 			continue;
 		}
 
@@ -1647,11 +1572,11 @@ void RoRFrameListener::loadObject(const char* name, float px, float py, float pz
 		{
 			char mat[256]="";
 			sscanf(ptline, "setMeshMaterial %s", mat);
-			if (mo->getEntity() && strnlen(mat,250)>0)
+			if (strnlen(mat,250)>0)
 			{
-				mo->getEntity()->setMaterialName(String(mat));
-				// load it
-				//MaterialManager::getSingleton().load(String(mat), ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+				c.type = ODEF_SETMESHMATERIAL;
+				c.name = String(mat);
+				odef->commands.push_back(c);
 			}
 			continue;
 		}
@@ -1659,133 +1584,311 @@ void RoRFrameListener::loadObject(const char* name, float px, float py, float pz
 		{
 			char mat[256]="";
 			sscanf(ptline, "generateMaterialShaders %s", mat);
-			if (BSETTING("Use RTShader System", false))
+			c.type = ODEF_GENERATESHADERS;
+			c.name = String(mat);
+			odef->commands.push_back(c);
+			continue;
+		}
+		if (!strncmp("playanimation", ptline, 13))
+		{
+			char animname[256]="";
+			sscanf(ptline, "playanimation %f, %f, %s", &c.values[0], &c.values[1], animname);
+			if (strnlen(animname,250)>0)
 			{
-				Ogre::RTShader::ShaderGenerator::getSingleton().createShaderBasedTechnique(String(mat), Ogre::MaterialManager::DEFAULT_SCHEME_NAME, Ogre::RTShader::ShaderGenerator::DEFAULT_SCHEME_NAME);
-				Ogre::RTShader::ShaderGenerator::getSingleton().invalidateMaterial(RTShader::ShaderGenerator::DEFAULT_SCHEME_NAME, String(mat));
+				c.type = ODEF_PLAYANIMATION;
+				c.name = String(animname);
+				odef->commands.push_back(c);
 			}
-
 			continue;
 		}
-		if (!strncmp("playanimation", ptline, 13) && mo)
+		if (!strncmp("drawTextOnMeshTexture", ptline, 21))
 		{
-			char animname[256]="";
-			float speedfactorMin = 0, speedfactorMax = 0;
-			sscanf(ptline, "playanimation %f, %f, %s", &speedfactorMin, &speedfactorMax, animname);
-			if (tenode && mo->getEntity() && strnlen(animname,250)>0)
+			char fontname[256]="";
+			char text[256]="";
+			char option='l';
+			int res = sscanf(ptline, "drawTextOnMeshTexture %f, %f, %f, %f, %f, %f, %f, %f, %c, %s %s", &c.values[0], &c.values[1], &c.values[2], &c.values[3], &c.values[4], &c.values[5], &c.values[6], &c.values[7], &option, fontname, text);
+			if (res < 11)
+			{
+				LOG("ODEF: problem with drawTextOnMeshTexture command: "+String(fname)+" : "+String(ptline));
+				continue;
+			}
+			c.type  = ODEF_DRAWTEXT;
+			c.param = option;
+			c.name  = String(fontname);
+			c.name2 = String(text);
+			odef->commands.push_back(c);
+			continue;
+		}
+
+		LOG("ODEF: unknown command in "+String(fname)+" : "+String(ptline));
+	}
+
+	odefCache[key] = odef;
+	return odef;
+}
+
+void RoRFrameListener::loadObject(const char* name, float px, float py, float pz, float rx, float ry, float rz, SceneNode * bakeNode, const char* instancename, bool enable_collisions, int scripthandler, const char *type, bool uniquifyMaterial)
+{
+	ScopeLog log("object_"+String(name));
+	if (type && !strcmp(type, "grid"))
+	{
+		// some fast grid object hacks :)
+		for(int x=0;x<500;x+=50)
+			for(int z=0;z<500;z+=50)
+				loadObject(name, px+x, py, pz+z, rx, ry, rz, bakeNode, 0, enable_collisions, scripthandler, 0);
+		return;
+	}
+
+	// nice idea, but too many random hits
+	//if (abs(rx+1) < 0.001) rx = Math::RangeRandom(0, 360);
+	//if (abs(ry+1) < 0.001) ry = Math::RangeRandom(0, 360);
+	//if (abs(rz+1) < 0.001) rz = Math::RangeRandom(0, 360);
+
+	if (strnlen(name, 250)==0)
+		return;
+
+	odef_t *odef = getObjectDefinition(name);
+	if (!odef)
+		return;
+
+	char oname[1024] = {};
+	Quaternion rotation = Quaternion(Degree(rx), Vector3::UNIT_X)*Quaternion(Degree(ry), Vector3::UNIT_Y)*Quaternion(Degree(rz), Vector3::UNIT_Z);
+	float scx = odef->scale.x, scy = odef->scale.y, scz = odef->scale.z;
+
+	sprintf(oname,"object%i(%s)", objcounter,name);
+	objcounter++;
+
+
+	SceneNode *tenode = mSceneMgr->getRootSceneNode()->createChildSceneNode();
+	bool background_loading = BSETTING("Background Loading", false);
+
+	MeshObject *mo = NULL;
+	if (odef->mesh != "none")
+		mo = new MeshObject(mSceneMgr, odef->mesh, oname, tenode, NULL, background_loading);
+	
+	//mo->setQueryFlags(OBJECTS_MASK);
+	//tenode->attachObject(te);
+	tenode->setScale(scx,scy,scz);
+	tenode->setPosition(px,py,pz);
+	tenode->rotate(rotation);
+	tenode->pitch(Degree(-90));
+	tenode->setVisible(true);
+
+	// register in map
+	loaded_object_t *obj = &loadedObjects[std::string(instancename)];
+	obj->instanceName = std::string(instancename);
+	obj->loadType     = 0;
+	obj->enabled      = true;
+	obj->sceneNode    = tenode;
+	obj->collTris.clear();
+
+
+	if (mo && uniquifyMaterial && instancename)
+	{
+		for(unsigned int i = 0; i < mo->getEntity()->getNumSubEntities(); i++)
+		{
+			SubEntity *se = mo->getEntity()->getSubEntity(i);
+			String matname = se->getMaterialName();
+			String newmatname = matname + "/" + String(instancename);
+			//LOG("subentity " + TOSTRING(i) + ": "+ matname + " -> " + newmatname);
+			se->getMaterial()->clone(newmatname);
+			se->setMaterialName(newmatname);
+		}
+	}
+
+	if (odef->truckShop)
+		terrainHasTruckShop=true;
+
+	for (std::vector<odef_command_t>::iterator it = odef->commands.begin(); it != odef->commands.end(); it++)
+	{
+		const odef_command_t &c = *it;
+		const char *ptline = c.line.c_str();
+		switch (c.type)
+		{
+		case ODEF_LOCALIZER:
+			localizers[free_localizer].position=Vector3(px,py,pz);
+			localizers[free_localizer].rotation=rotation;
+			localizers[free_localizer].type=c.param;
+			free_localizer++;
+			break;
+
+		case ODEF_STANDARD:
+			tenode->pitch(Degree(90));
+			break;
+
+		case ODEF_SOUND:
+#ifdef USE_OPENAL
+			if (!SoundScriptManager::getSingleton().isDisabled())
+			{
+				SoundScriptInstance *sound = SoundScriptManager::getSingleton().createInstance(c.name, MAX_TRUCKS+1, tenode);
+				sound->setPosition(tenode->getPosition(), Vector3::ZERO);
+				sound->start();
+			}
+#endif //USE_OPENAL
+			break;
+
+		case ODEF_BOX:
+			if (enable_collisions)
+			{
+				int boxnum = collisions->addCollisionBox(tenode, c.rotating, c.virt, px, py, pz, rx, ry, rz, c.boxLow.x, c.boxHigh.x, c.boxLow.y, c.boxHigh.y, c.boxLow.z, c.boxHigh.z, c.rotation.x, c.rotation.y, c.rotation.z, c.name2.c_str(), instancename, c.forcecam, c.camera, scx, scy, scz, c.direction.x, c.direction.y, c.direction.z, c.param, scripthandler);
+				obj->collBoxes.push_back((boxnum));
+			}
+			break;
+
+		case ODEF_MESH:
+			collisions->addCollisionMesh(c.name, Vector3(px,py,pz), tenode->getOrientation(), Vector3(scx, scy, scz), collisions->getGroundModelByString(c.name2), &(obj->collTris));
+			break;
+
+		case ODEF_FRICTIONCONFIG:
+			// load a custom friction config
+			collisions->loadGroundModelsConfigFile(c.name);
+			break;
+
+		case ODEF_PARTICLESYSTEM:
+			{
+				// hacky: prevent duplicates
+				String paname = c.name;
+				while(mSceneMgr->hasParticleSystem(paname))
+					paname += "_";
+
+				// create particle system
+				ParticleSystem* pParticleSys = mSceneMgr->createParticleSystem(paname, c.name2);
+				pParticleSys->setCastShadows(false);
+				pParticleSys->setVisibilityFlags(DEPTHMAP_DISABLED); // disable particles in depthmap
+
+				// Some affectors may need its instance name (e.g. for script feedback purposes)
+#ifdef USE_ANGELSCRIPT
+				unsigned short affCount = pParticleSys->getNumAffectors();
+				ParticleAffector* pAff;
+				for(unsigned short i = 0; i<affCount; ++i)
+				{
+					pAff = pParticleSys->getAffector(i);
+					if (pAff->getType()=="ExtinguishableFire")
+						((ExtinguishableFireAffector*)pAff)->setInstanceName(obj->instanceName);
+				}
+#endif // USE_ANGELSCRIPT
+
+				SceneNode *sn = tenode->createChildSceneNode();
+				sn->attachObject(pParticleSys);
+				sn->pitch(Degree(90));
+			}
+			break;
+
+		case ODEF_SETMESHMATERIAL:
+			if (mo && mo->getEntity())
+				mo->getEntity()->setMaterialName(c.name);
+			break;
+
+		case ODEF_GENERATESHADERS:
+			if (BSETTING("Use RTShader System", false))
+			{
+				Ogre::RTShader::ShaderGenerator::getSingleton().createShaderBasedTechnique(c.name, Ogre::MaterialManager::DEFAULT_SCHEME_NAME, Ogre::RTShader::ShaderGenerator::DEFAULT_SCHEME_NAME);
+				Ogre::RTShader::ShaderGenerator::getSingleton().invalidateMaterial(RTShader::ShaderGenerator::DEFAULT_SCHEME_NAME, c.name);
+			}
+			break;
+
+		case ODEF_PLAYANIMATION:
+			if (mo && mo->getEntity())
 			{
 				AnimationStateSet *s = mo->getEntity()->getAllAnimationStates();
-				if (!s->hasAnimationState(String(animname)))
+				if (!s->hasAnimationState(c.name))
 				{
-					LOG("ODEF: animation '" + String(animname) + "' for mesh: '" + String(mesh) + "' in odef file '" + String(name) + ".odef' not found!");
-					continue;
+					LOG("ODEF: animation '" + c.name + "' for mesh: '" + odef->mesh + "' in odef file '" + String(name) + ".odef' not found!");
+					break;
 				}
 				animated_object_t ao;
 				ao.node = tenode;
 				ao.ent = mo->getEntity();
-				ao.speedfactor = speedfactorMin;
-				if (speedfactorMin != speedfactorMax)
-					ao.speedfactor = Math::RangeRandom(speedfactorMin, speedfactorMax);
+				ao.speedfactor = c.values[0];
+				if (c.values[0] != c.values[1])
+					ao.speedfactor = Math::RangeRandom(c.values[0], c.values[1]);
 				ao.anim = 0;
 				try
 				{
-					ao.anim = mo->getEntity()->getAnimationState(String(animname));
+					ao.anim = mo->getEntity()->getAnimationState(c.name);
 				} catch (...)
 				{
 					ao.anim = 0;
 				}
 				if (!ao.anim)
 				{
-					LOG("ODEF: animation '" + String(animname) + "' for mesh: '" + String(mesh) + "' in odef file '" + String(name) + ".odef' not found!");
-					continue;
+					LOG("ODEF: animation '" + c.name + "' for mesh: '" + odef->mesh + "' in odef file '" + String(name) + ".odef' not found!");
+					break;
 				}
 				ao.anim->setEnabled(true);
 				animatedObjects.push_back(ao);
 			}
-			continue;
-		}
-		if (!strncmp("drawTextOnMeshTexture", ptline, 21) && mo)
-		{
-			if (!mo->getEntity())
-				continue;
-			String matName = mo->getEntity()->getSubEntity(0)->getMaterialName();
-			MaterialPtr m = MaterialManager::getSingleton().getByName(matName);
-			if (m.getPointer() == 0)
-			{
-				LOG("ODEF: problem with drawTextOnMeshTexture command: mesh material not found: "+String(fname)+" : "+String(ptline));
-				continue;
-			}
-			String texName = m->getTechnique(0)->getPass(0)->getTextureUnitState(0)->getTextureName();
-			Texture* background = (Texture *)TextureManager::getSingleton().getByName(texName).getPointer();
-			if (!background)
-			{
-				LOG("ODEF: problem with drawTextOnMeshTexture command: mesh texture not found: "+String(fname)+" : "+String(ptline));
-				continue;
-			}
+			break;
 
-			static int textureNumber = 0;
-			textureNumber++;
-			char tmpTextName[256]="", tmpMatName[256]="";
-			sprintf(tmpTextName, "TextOnTexture_%d_Texture", textureNumber);
-			sprintf(tmpMatName, "TextOnTexture_%d_Material", textureNumber);			// Make sure the texture is not WRITE_ONLY, we need to read the buffer to do the blending with the font (get the alpha for example)
-			TexturePtr texture = TextureManager::getSingleton().createManual(tmpTextName, ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME, TEX_TYPE_2D, (Ogre::uint)background->getWidth(), (Ogre::uint)background->getHeight(), MIP_UNLIMITED , PF_X8R8G8B8, Ogre::TU_STATIC|Ogre::TU_AUTOMIPMAP, new ResourceBuffer());
-			if (texture.getPointer() == 0)
+		case ODEF_DRAWTEXT:
 			{
-				LOG("ODEF: problem with drawTextOnMeshTexture command: could not create texture: "+String(fname)+" : "+String(ptline));
-				continue;
-			}
+				if (!mo || !mo->getEntity())
+					break;
+				String matName = mo->getEntity()->getSubEntity(0)->getMaterialName();
+				MaterialPtr m = MaterialManager::getSingleton().getByName(matName);
+				if (m.getPointer() == 0)
+				{
+					LOG("ODEF: problem with drawTextOnMeshTexture command: mesh material not found: "+odef->filename+" : "+String(ptline));
+					break;
+				}
+				String texName = m->getTechnique(0)->getPass(0)->getTextureUnitState(0)->getTextureName();
+				Texture* background = (Texture *)TextureManager::getSingleton().getByName(texName).getPointer();
+				if (!background)
+				{
+					LOG("ODEF: problem with drawTextOnMeshTexture command: mesh texture not found: "+odef->filename+" : "+String(ptline));
+					break;
+				}
 
-			float x=0, y=0, w=0, h=0;
-			float a=0, r=0, g=0, b=0;
-			char fontname[256]="";
-			char text[256]="";
-			char option='l';
-			int res = sscanf(ptline, "drawTextOnMeshTexture %f, %f, %f, %f, %f, %f, %f, %f, %c, %s %s", &x, &y, &w, &h, &r, &g, &b, &a, &option, fontname, text);
-			if (res < 11)
-			{
-				LOG("ODEF: problem with drawTextOnMeshTexture command: "+String(fname)+" : "+String(ptline));
-				continue;
-			}
+				static int textureNumber = 0;
+				textureNumber++;
+				char tmpTextName[256]="", tmpMatName[256]="";
+				sprintf(tmpTextName, "TextOnTexture_%d_Texture", textureNumber);
+				sprintf(tmpMatName, "TextOnTexture_%d_Material", textureNumber);			// Make sure the texture is not WRITE_ONLY, we need to read the buffer to do the blending with the font (get the alpha for example)
+				TexturePtr texture = TextureManager::getSingleton().createManual(tmpTextName, ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME, TEX_TYPE_2D, (Ogre::uint)background->getWidth(), (Ogre::uint)background->getHeight(), MIP_UNLIMITED , PF_X8R8G8B8, Ogre::TU_STATIC|Ogre::TU_AUTOMIPMAP, new ResourceBuffer());
+				if (texture.getPointer() == 0)
+				{
+					LOG("ODEF: problem with drawTextOnMeshTexture command: could not create texture: "+odef->filename+" : "+String(ptline));
+					break;
+				}
 
-			// cehck if we got a template argument
-			if (!strncmp(text, "{{argument1}}", 13))
-				strncpy(text, instancename, 250);
+				// cehck if we got a template argument
+				String text = c.name2;
+				if (!strncmp(text.c_str(), "{{argument1}}", 13))
+					text = String(instancename).substr(0, 250);
 
-			// replace '_' with ' '
-			char *text_pointer = text;
-			while (*text_pointer!=0) {if (*text_pointer=='_') *text_pointer=' ';text_pointer++;};
+				// replace '_' with ' '
+				std::replace(text.begin(), text.end(), '_', ' ');
 
-			Font* font = (Font *)FontManager::getSingleton().getByName(String(fontname)).getPointer();
-			if (!font)
-			{
-				LOG("ODEF: problem with drawTextOnMeshTexture command: font not found: "+String(fname)+" : "+String(ptline));
-				continue;
-			}
+				Font* font = (Font *)FontManager::getSingleton().getByName(c.name).getPointer();
+				if (!font)
+				{
+					LOG("ODEF: problem with drawTextOnMeshTexture command: font not found: "+odef->filename+" : "+String(ptline));
+					break;
+				}
 
 
-			//Draw the background to the new texture
-			texture->getBuffer()->blit(background->getBuffer());
+				//Draw the background to the new texture
+				texture->getBuffer()->blit(background->getBuffer());
 
-			x = background->getWidth() * x;
-			y = background->getHeight() * y;
-			w = background->getWidth() * w;
-			h = background->getHeight() * h;
+				float x = background->getWidth() * c.values[0];
+				float y = background->getHeight() * c.values[1];
+				float w = background->getWidth() * c.values[2];
+				float h = background->getHeight() * c.values[3];
 
-			Image::Box box = Image::Box((size_t)x, (size_t)y, (size_t)(x+w), (size_t)(y+h));
-			WriteToTexture(String(text), texture, box, font, ColourValue(r, g, b, a), option);
+				Image::Box box = Image::Box((size_t)x, (size_t)y, (size_t)(x+w), (size_t)(y+h));
+				WriteToTexture(text, texture, box, font, ColourValue(c.values[4], c.values[5], c.values[6], c.values[7]), (char)c.param);
 
-			// we can save it to disc for debug purposes:
-			//SaveImage(texture, "test.png");
+				// we can save it to disc for debug purposes:
+				//SaveImage(texture, "test.png");
 
-			m->clone(tmpMatName);
-			MaterialPtr mNew = MaterialManager::getSingleton().getByName(tmpMatName);
-			mNew->getTechnique(0)->getPass(0)->getTextureUnitState(0)->setTextureName(tmpTextName);
+				m->clone(tmpMatName);
+				MaterialPtr mNew = MaterialManager::getSingleton().getByName(tmpMatName);
+				mNew->getTechnique(0)->getPass(0)->getTextureUnitState(0)->setTextureName(tmpTextName);
 
-			mo->getEntity()->setMaterialName(String(tmpMatName));
-			continue;
+				mo->getEntity()->setMaterialName(String(tmpMatName));
+			}
+			break;
 		}
-
-		LOG("ODEF: unknown command in "+String(fname)+" : "+String(ptline));
 	}
 
 	//add icons if type is set
@@ -3061,6 +3164,7 @@ bool RoRFrameListener::updateEvents(float dt)
 					else
 						curr_truck->showSkeleton(true, true);
 
+					BeamFactory::getSingleton().finishVisualPrep();
 					curr_truck->updateVisual();
 				}
 
@@ -3378,7 +3482,7 @@ bool RoRFrameListener::updateEvents(float dt)
 			{
 				Cache_Entry *selection = SelectorWindow::getSingleton().getSelection();
 				Skin *skin = SelectorWindow::getSingleton().getSelectedSkin();
-				Beam *localTruck = 0;
+				bool spawning = false;
 				if (selection)
 				{
 					//we load an extra truck
@@ -3387,22 +3491,22 @@ bool RoRFrameListener::updateEvents(float dt)
 					std::vector<Ogre::String> *configptr = &config;
 					if (config.size() == 0) configptr = 0;
 
-					localTruck = BeamFactory::getSingleton().createLocal(reload_pos, reload_dir, selected, reload_box, false, flaresMode, configptr, skin, freeTruckPosition);
-					freeTruckPosition=false; // reset this, only to be used once
-				}
-
-				if (surveyMap && localTruck)
-				{
-					MapEntity *e = surveyMap->createNamedMapEntity("Truck"+TOSTRING(localTruck->trucknum), MapControl::getTypeByDriveable(localTruck->driveable));
-					if (e)
+					if (BeamFactory::getSingleton().isLocalSpawnAsync())
 					{
-						e->setState(DESACTIVATED);
-						e->setVisibility(true);
-						e->setPosition(reload_pos);
-						e->setRotation(-Radian(localTruck->getHeadingDirectionAngle()));
-						// create a map icon
-						//createNamedMapEntity();
+						// the truck is prepared in the background, localTruckSpawned is called once it exists
+						asyncSpawnTruck    = BeamFactory::getSingleton().getCurrentTruckNumber();
+						asyncSpawnPosition = person ? person->getPosition() : Vector3::ZERO;
+						spawning = BeamFactory::getSingleton().createLocalAsync(reload_pos, reload_dir, selected, reload_box, false, flaresMode, configptr, skin, freeTruckPosition);
+					} else
+					{
+						Beam *localTruck = BeamFactory::getSingleton().createLocal(reload_pos, reload_dir, selected, reload_box, false, flaresMode, configptr, skin, freeTruckPosition);
+						if (localTruck)
+						{
+							localTruckSpawned(localTruck);
+							spawning = true;
+						}
 					}
+					freeTruckPosition=false; // reset this, only to be used once
 				}
 
 				SelectorWindow::getSingleton().hide();
@@ -3410,19 +3514,10 @@ bool RoRFrameListener::updateEvents(float dt)
 
 				GUIManager::getSingleton().unfocus();
 
-				if (localTruck && localTruck->driveable)
+				if (!spawning)
 				{
-					//we are supposed to be in this truck, if it is a truck
-					if (localTruck->engine)
-						localTruck->engine->start();
-					BeamFactory::getSingleton().setCurrentTruck(localTruck->trucknum);
-				} else
-				{
-					// if it is a load or trailer, than stay in person mode
-					// but relocate to the new position, so we dont spawn the dialog again
-					//personode->setPosition(reload_pos);
+					// stay in person mode, but relocate to the new position, so we dont spawn the dialog again
 					person->move(Vector3(3.0, 0.2, 0.0)); //bad, but better
-					//BeamFactory::getSingleton().setCurrentTruck(-1);
 				}
 			}
 
@@ -4246,6 +4341,10 @@ void RoRFrameListener::loadClassicTerrain(String terrainfile)
 	int lastprogress = -1;
 	bool proroad = false;
 
+	// placing the objects is most of the terrain loading time on object heavy maps
+	unsigned long objectsStarted = Root::getSingleton().getTimer()->getMilliseconds();
+	int objectsBefore = objcounter;
+
 	while (!ds->eof())
 	{
 		int progress = ((float)(ds->tell()) / (float)(ds->size())) * 100.0f;
@@ -4774,6 +4873,8 @@ void RoRFrameListener::loadClassicTerrain(String terrainfile)
 			proceduralManager->addObject(po);
 	}
 
+	LOG("placed " + TOSTRING(objcounter - objectsBefore) + " objects from " + TOSTRING(odefCache.size()) + " object definitions in "
+		+ TOSTRING(Root::getSingleton().getTimer()->getMilliseconds() - objectsStarted) + " ms");
 
 	// okay, now bake everything
 	bakesg = mSceneMgr->createStaticGeometry("bakeSG");
@@ -4852,6 +4953,44 @@ void RoRFrameListener::loadClassicTerrain(String terrainfile)
 	collisions->finishLoadingTerrain();
 }
 
+void RoRFrameListener::localTruckSpawned(Beam *localTruck, bool enter)
+{
+	if (surveyMap)
+	{
+		MapEntity *e = surveyMap->createNamedMapEntity("Truck"+TOSTRING(localTruck->trucknum), MapControl::getTypeByDriveable(localTruck->driveable));
+		if (e)
+		{
+			e->setState(DESACTIVATED);
+			e->setVisibility(true);
+			e->setPosition(localTruck->getPosition());
+			e->setRotation(-Radian(localTruck->getHeadingDirectionAngle()));
+			// create a map icon
+			//createNamedMapEntity();
+		}
+	}
+
+	if (!enter)
+	{
+		LOG("truck " + localTruck->realtruckfilename + " was spawned in the background, the player is left where they are");
+		return;
+	}
+
+	if (localTruck->driveable)
+	{
+		//we are supposed to be in this truck, if it is a truck
+		if (localTruck->engine)
+			localTruck->engine->start();
+		BeamFactory::getSingleton().setCurrentTruck(localTruck->trucknum);
+	} else
+	{
+		// if it is a load or trailer, than stay in person mode
+		// but relocate to the new position, so we dont spawn the dialog again
+		//personode->setPosition(reload_pos);
+		person->move(Vector3(3.0, 0.2, 0.0)); //bad, but better
+		//BeamFactory::getSingleton().setCurrentTruck(-1);
+	}
+}
+
 void RoRFrameListener::initTrucks(bool loadmanual, Ogre::String selected, Ogre::String selectedExtension /* = "" */, std::vector<Ogre::String> *truckconfig/* =0 */, bool enterTruck /* = false */, Skin *skin /* = NULL */)
 {
 	//we load truck
@@ -5298,6 +5437,18 @@ bool RoRFrameListener::frameStarted(const FrameEvent& evt)
 	//update visual - antishaking
 	if (loading_state==ALL_LOADED)
 	{
+		// trucks that were prepared in the background
+		Beam *localTruck = BeamFactory::getSingleton().updateLocalSpawns();
+		if (localTruck)
+		{
+			// this can be seconds after the request, only take the player into the truck
+			// if they did not walk away or enter another truck meanwhile
+			bool enter = (BeamFactory::getSingleton().getCurrentTruckNumber() == asyncSpawnTruck);
+			if (person && person->getPosition().squaredDistance(asyncSpawnPosition) > 1.0f)
+				enter = false;
+			localTruckSpawned(localTruck, enter);
+		}
+
 		BeamFactory::getSingleton().updateVisual(dt);
 
 		// add some example AI
@@ -5364,6 +5515,7 @@ bool RoRFrameListener::frameStarted(const FrameEvent& evt)
 	{
 		CharacterFactory::getSingleton().updateLabels();
 	}
+	LabelRenderer::getSingleton().update();
 
 	return true;
 }
@@ -5389,6 +5541,9 @@ bool RoRFrameListener::frameEnded(const FrameEvent& evt)
 	{
 		// process all packets and streams received
 		NetworkStreamManager::getSingleton().update();
+#ifdef USE_MYGUI
+		GUI_Multiplayer::getSingleton().updateNetStats();
+#endif // USE_MYGUI
 	}
 #endif //SOCKETW
 
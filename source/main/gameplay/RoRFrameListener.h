@@ -70,6 +70,10 @@ public:
 	Ogre::String terrainName;
 	Ogre::Vector3 reload_pos;
 
+	// state of the player when the last truck was requested in the background, see localTruckSpawned
+	Ogre::Vector3 asyncSpawnPosition;
+	int asyncSpawnTruck;
+
 	Water *w;
 
 	bool freeTruckPosition;
@@ -120,6 +124,37 @@ protected:
 		float speedfactor;
 	} animated_object_t;
 
+	enum ODefCommands { ODEF_LOCALIZER, ODEF_STANDARD, ODEF_SOUND, ODEF_BOX, ODEF_MESH, ODEF_FRICTIONCONFIG, ODEF_PARTICLESYSTEM, ODEF_SETMESHMATERIAL, ODEF_GENERATESHADERS, ODEF_PLAYANIMATION, ODEF_DRAWTEXT };
+
+	// one command of an .odef file with its arguments already parsed
+	typedef struct
+	{
+		int type;                  //!< ODEF_*
+		int param;                 //!< localizer type, event filter of boxes or text alignment
+		bool rotating;
+		bool virt;
+		bool forcecam;
+		Ogre::String line;         //!< source line, for error messages
+		Ogre::String name;         //!< sound, collision mesh, config file, particle system, material, animation or font
+		Ogre::String name2;        //!< event name, particle template, ground model or text
+		Ogre::Vector3 boxLow;
+		Ogre::Vector3 boxHigh;
+		Ogre::Vector3 rotation;
+		Ogre::Vector3 direction;
+		Ogre::Vector3 camera;
+		float values[8];           //!< animation speed range, text box and colour
+	} odef_command_t;
+
+	// parsed .odef file, all placements of the same object are created from it
+	typedef struct
+	{
+		Ogre::String filename;
+		Ogre::String mesh;
+		Ogre::Vector3 scale;
+		bool truckShop;            //!< has a shoptruck event
+		std::vector<odef_command_t> commands;
+	} odef_t;
+
 #ifdef USE_PAGED
 	typedef struct
 	{
@@ -232,6 +267,7 @@ protected:
 	static float gravity;
 
 	std::map< std::string, loaded_object_t >  loadedObjects;
+	std::map< std::string, odef_t * >         odefCache;
 	std::map< std::string, spawn_location_t > netSpawnPos;
 	std::vector< animated_object_t >          animatedObjects;
 
@@ -253,6 +289,10 @@ protected:
 	void initHDR();
 	void initSoftShadows();
 	void initializeCompontents();
+	void localTruckSpawned(Beam *localTruck, bool enter=true);
+
+	// returns the parsed .odef file of the object, 0 if it does not exist
+	odef_t *getObjectDefinition(const char *name);
 
 	void updateGUI(float dt); // update engine panel
 	void updateIO(float dt);
@@ -33,7 +33,7 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 
 using namespace Ogre;
 
-const char *Savegame::current_version = "ROR_SAVEGAME_v2";
+const char *Savegame::current_version = "ROR_SAVEGAME_v3";
 
 #define WRITEVAR(x)    fwrite(&x, sizeof(x), 1, f)
 #define WRITEARR(x, y) for(int n = 0; n < y; n++) { WRITEVAR(x); }
@@ -360,8 +360,8 @@ int Savegame::load(Ogre::String &filename)
 			tmp.p2         = t->beams[n].p2;
 			tmp.p2truck    = t->beams[n].p2truck;
 			tmp.shock      = t->beams[n].shock;
-			tmp.mSceneNode = t->beams[n].mSceneNode;
-			tmp.mEntity    = t->beams[n].mEntity;
+			tmp.mBatch     = t->beams[n].mBatch;
+			tmp.mVisible   = t->beams[n].mVisible;
 
 			// load from file into memory
 			fread(&t->beams[n], sizeof(beam_t), 1, f);
@@ -371,8 +371,11 @@ int Savegame::load(Ogre::String &filename)
 			t->beams[n].p2         = tmp.p2;
 			t->beams[n].p2truck    = tmp.p2truck;
 			t->beams[n].shock      = tmp.shock;
-			t->beams[n].mSceneNode = tmp.mSceneNode;
-			t->beams[n].mEntity    = tmp.mEntity;
+			t->beams[n].mBatch     = tmp.mBatch;
+			t->beams[n].mVisible   = tmp.mVisible;
+			// beams that were already hidden when they broke
+			if (t->beams[n].broken == 2)
+				t->beams[n].mVisible = false;
 		}
 
 		if(t->free_shock != dh.free_shock)
@@ -0,0 +1,317 @@
+/*
+This source file is part of Rigs of Rods
+Copyright 2005-2012 Pierre-Michel Ricordel
+Copyright 2007-2012 Thomas Fischer
+
+For more information, see http://www.rigsofrods.com/
+
+Rigs of Rods is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 3, as
+published by the Free Software Foundation.
+
+Rigs of Rods is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "SearchIndex.h"
+
+#include "CacheSystem.h"
+
+using namespace Ogre;
+
+// words shorter than this are not matched fuzzy, too many false positives
+#define SEARCH_FUZZY_MIN_LENGTH 4
+// tokens and the words looked up in them are at least this long
+#define SEARCH_TOKEN_MIN_LENGTH 2
+
+// orders suffixes by their text
+struct search_suffix_less_t
+{
+	bool operator()(const search_suffix_t &a, const search_suffix_t &b) const
+	{
+		return strcmp(a.token->first.c_str() + a.offset, b.token->first.c_str() + b.offset) < 0;
+	}
+	bool operator()(const search_suffix_t &a, const String &word) const
+	{
+		return strcmp(a.token->first.c_str() + a.offset, word.c_str()) < 0;
+	}
+};
+
+static String toLower(String str)
+{
+	StringUtil::toLowerCase(str);
+	return str;
+}
+
+SearchIndex::SearchIndex() : built(false)
+{
+}
+
+void SearchIndex::clear()
+{
+	docs.clear();
+	tokens.clear();
+	suffixes.clear();
+	categoryUsage.clear();
+	built = false;
+}
+
+void SearchIndex::build(std::vector<Cache_Entry> &entries, int timestamp)
+{
+	clear();
+	std::map<int, Category_Entry> *categories = CACHE.getCategories();
+
+	docs.resize(entries.size());
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		Cache_Entry &e = entries[i];
+		search_entry_t &doc = docs[i];
+
+		// same rules the selector used: unsorted entries are hidden, invalid ones become unsorted
+		doc.hidden     = (e.categoryid == CacheSystem::CID_Unsorted);
+		doc.categoryid = e.categoryid;
+		if (doc.categoryid >= CacheSystem::CID_Max || doc.categoryid == -1)
+			doc.categoryid = CacheSystem::CID_Unsorted;
+		doc.fresh      = (timestamp - e.addtimestamp < CACHE_FILE_FRESHNESS);
+
+		doc.fname  = toLower(e.fname);
+		doc.hash   = toLower(e.hash);
+		doc.guid   = toLower(e.guid);
+		doc.fext   = e.fext;
+		doc.wheels = TOSTRING(e.wheelcount) + "x" + TOSTRING(e.propwheelcount);
+
+		doc.authors = "";
+		for (std::vector<authorinfo_t>::iterator it = e.authors.begin(); it != e.authors.end(); it++)
+			doc.authors += toLower(it->name) + "\n" + toLower(it->email) + "\n";
+
+		String category = "";
+		std::map<int, Category_Entry>::iterator itc = categories->find(doc.categoryid);
+		if (itc != categories->end())
+			category = toLower(itc->second.title);
+
+		doc.text = toLower(e.dname) + "\n" + doc.fname + "\n" + toLower(e.description) + "\n" + doc.authors + doc.guid + "\n" + category;
+		addTokens((int)i, doc.text);
+
+		if (doc.hidden)
+			continue;
+		std::map<int, int> &usage = categoryUsage[doc.fext];
+		usage[doc.categoryid]++;
+		usage[CacheSystem::CID_All]++;
+		if (doc.fresh)
+			usage[CacheSystem::CID_Fresh]++;
+	}
+	buildSuffixes();
+	built = true;
+	LOG("search index built: " + TOSTRING(docs.size()) + " entries, " + TOSTRING(tokens.size()) + " tokens, " + TOSTRING(suffixes.size()) + " suffixes");
+}
+
+void SearchIndex::buildSuffixes()
+{
+	suffixes.clear();
+	for (std::map<String, std::vector<int> >::iterator it = tokens.begin(); it != tokens.end(); it++)
+	{
+		for (size_t offset = 0; offset + SEARCH_TOKEN_MIN_LENGTH <= it->first.size(); offset++)
+		{
+			search_suffix_t s;
+			s.token  = &*it;
+			s.offset = (unsigned int)offset;
+			suffixes.push_back(s);
+		}
+	}
+	std::sort(suffixes.begin(), suffixes.end(), search_suffix_less_t());
+}
+
+bool SearchIndex::lookupWord(const String &word, std::vector<char> &hits)
+{
+	// a word with other characters can span several tokens, those are searched in the texts
+	if (word.size() < SEARCH_TOKEN_MIN_LENGTH)
+		return false;
+	for (size_t i = 0; i < word.size(); i++)
+	{
+		if (!isalnum((unsigned char)word[i]))
+			return false;
+	}
+
+	hits.assign(docs.size(), 0);
+	std::vector<search_suffix_t>::iterator it = std::lower_bound(suffixes.begin(), suffixes.end(), word, search_suffix_less_t());
+	for (; it != suffixes.end(); it++)
+	{
+		// all suffixes that start with the word follow each other
+		if (strncmp(it->token->first.c_str() + it->offset, word.c_str(), word.size()))
+			break;
+		const std::vector<int> &ids = it->token->second;
+		for (size_t i = 0; i < ids.size(); i++)
+			hits[ids[i]] = 1;
+	}
+	return true;
+}
+
+void SearchIndex::addTokens(int id, const String &text)
+{
+	size_t start = 0;
+	for (size_t i = 0; i <= text.size(); i++)
+	{
+		if (i < text.size() && isalnum((unsigned char)text[i]))
+			continue;
+		if (i - start >= SEARCH_TOKEN_MIN_LENGTH)
+		{
+			std::vector<int> &ids = tokens[text.substr(start, i - start)];
+			if (ids.empty() || ids.back() != id)
+				ids.push_back(id);
+		}
+		start = i + 1;
+	}
+}
+
+void SearchIndex::getEntries(const std::vector<String> &fexts, std::vector<int> &result)
+{
+	result.clear();
+	for (size_t i = 0; i < docs.size(); i++)
+	{
+		if (docs[i].hidden)
+			continue;
+		if (std::find(fexts.begin(), fexts.end(), docs[i].fext) != fexts.end())
+			result.push_back((int)i);
+	}
+}
+
+void SearchIndex::getCategoryUsage(const std::vector<String> &fexts, std::map<int, int> &usage)
+{
+	usage.clear();
+	for (size_t i = 0; i < fexts.size(); i++)
+	{
+		std::map<String, std::map<int, int> >::iterator it = categoryUsage.find(fexts[i]);
+		if (it == categoryUsage.end())
+			continue;
+		for (std::map<int, int>::iterator itu = it->second.begin(); itu != it->second.end(); itu++)
+			usage[itu->first] += itu->second;
+	}
+}
+
+bool SearchIndex::matches(const search_entry_t &doc, const String &field, const String &value)
+{
+	if (field == "hash")
+		return doc.hash.find(value) != String::npos;
+	else if (field == "guid")
+		return doc.guid.find(value) != String::npos;
+	else if (field == "author")
+		return doc.authors.find(value) != String::npos;
+	else if (field == "wheels")
+		return doc.wheels == value;
+	else if (field == "file")
+		return doc.fname.find(value) != String::npos;
+	return false;
+}
+
+bool SearchIndex::search(String query, const std::vector<int> &candidates, std::vector<int> &result)
+{
+	result.clear();
+	StringUtil::trim(query);
+
+	size_t colon = query.find(":");
+	if (colon != String::npos)
+	{
+		// field search
+		String field = query.substr(0, colon);
+		String value = query.substr(colon + 1);
+		if (value.empty())
+			return false; // invalid syntax
+		for (size_t i = 0; i < candidates.size(); i++)
+		{
+			if (matches(docs[candidates[i]], field, value))
+				result.push_back(candidates[i]);
+		}
+		return false;
+	}
+
+	StringVector words = StringUtil::split(query, " \t");
+	if (words.empty())
+		return false;
+
+	// the words are looked up in the tokens, only those that can not be are searched in the texts
+	std::vector< std::vector<char> > hits(words.size());
+	std::vector<bool> indexed(words.size());
+	for (size_t w = 0; w < words.size(); w++)
+		indexed[w] = lookupWord(words[w], hits[w]);
+
+	for (size_t i = 0; i < candidates.size(); i++)
+	{
+		int id = candidates[i];
+		bool found = true;
+		for (size_t w = 0; w < words.size() && found; w++)
+			found = indexed[w] ? (hits[w][id] != 0) : (docs[id].text.find(words[w]) != String::npos);
+		if (found)
+			result.push_back(id);
+	}
+	if (!result.empty())
+		return true;
+
+	// nothing found, maybe there is a typo: accept tokens that are one edit away
+	std::vector< std::set<int> > fuzzy(words.size());
+	for (size_t w = 0; w < words.size(); w++)
+		fuzzyTokens(words[w], fuzzy[w]);
+
+	for (size_t i = 0; i < candidates.size(); i++)
+	{
+		int id = candidates[i];
+		bool found = true;
+		for (size_t w = 0; w < words.size() && found; w++)
+			found = fuzzy[w].count(id) || (indexed[w] ? (hits[w][id] != 0) : (docs[id].text.find(words[w]) != String::npos));
+		if (found)
+			result.push_back(id);
+	}
+	return false;
+}
+
+void SearchIndex::fuzzyTokens(const String &word, std::set<int> &ids)
+{
+	if (word.size() < SEARCH_FUZZY_MIN_LENGTH)
+		return;
+
+	for (std::map<String, std::vector<int> >::iterator it = tokens.begin(); it != tokens.end(); it++)
+	{
+		// the word might also be the beginning of a token, so compare with the prefix of the same length as well
+		bool match = isWithinOneEdit(word, it->first);
+		if (!match && it->first.size() > word.size())
+			match = isWithinOneEdit(word, it->first.substr(0, word.size()));
+		if (match)
+			ids.insert(it->second.begin(), it->second.end());
+	}
+}
+
+bool SearchIndex::isWithinOneEdit(const String &a, const String &b)
+{
+	size_t la = a.size(), lb = b.size();
+	if (la > lb + 1 || lb > la + 1)
+		return false;
+
+	size_t i = 0, j = 0;
+	bool edited = false;
+	while (i < la && j < lb)
+	{
+		if (a[i] == b[j])
+		{
+			i++;
+			j++;
+			continue;
+		}
+		if (edited)
+			return false;
+		edited = true;
+		if (la > lb)
+			i++;          // deletion
+		else if (lb > la)
+			j++;          // insertion
+		else
+		{
+			i++;          // substitution
+			j++;
+		}
+	}
+	// one remaining character at the end is an edit as well
+	return !(edited && (i < la || j < lb));
+}
@@ -0,0 +1,99 @@
+/*
+This source file is part of Rigs of Rods
+Copyright 2005-2012 Pierre-Michel Ricordel
+Copyright 2007-2012 Thomas Fischer
+
+For more information, see http://www.rigsofrods.com/
+
+Rigs of Rods is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 3, as
+published by the Free Software Foundation.
+
+Rigs of Rods is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __SearchIndex_H_
+#define __SearchIndex_H_
+
+#include "RoRPrerequisites.h"
+
+#include <Ogre.h>
+
+class Cache_Entry;
+
+// searchable data of one cache entry, everything in lower case
+typedef struct search_entry_t
+{
+	Ogre::String text;        //!< name, file name, description, authors, guid and category, separated by newlines
+	Ogre::String authors;     //!< author names and emails
+	Ogre::String fname;
+	Ogre::String hash;
+	Ogre::String guid;
+	Ogre::String wheels;      //!< wheel count like "4x2"
+	Ogre::String fext;
+	int categoryid;           //!< CacheSystem::CID_Unsorted for entries without valid category
+	bool hidden;              //!< not shown in the selector at all
+	bool fresh;               //!< added within CACHE_FILE_FRESHNESS when the index was built
+} search_entry_t;
+
+// one suffix of a token, the suffixes of all tokens are sorted so every substring of a token can be looked up
+typedef struct search_suffix_t
+{
+	const std::pair<const Ogre::String, std::vector<int> > *token;
+	unsigned int offset;
+} search_suffix_t;
+
+/**
+ * In memory search index over the cache entries, ids are the positions in CacheSystem::getEntries().
+ * Keeps the lower case search texts, the tokens (alphanumeric words) of all texts with the entries they
+ * appear in and the category usage per file extension, so the selector does not need to scan and
+ * convert all entries on every key stroke. Query words are looked up in a sorted array of all token
+ * suffixes, which finds them anywhere inside of a token, just like a substring search over the texts.
+ */
+class SearchIndex
+{
+public:
+	SearchIndex();
+
+	void clear();
+	void build(std::vector<Cache_Entry> &entries, int timestamp);
+	bool isBuilt() { return built; };
+	size_t getCount() { return docs.size(); };
+
+	const search_entry_t &getEntry(int id) { return docs[id]; };
+
+	// all visible entries with one of the given file extensions
+	void getEntries(const std::vector<Ogre::String> &fexts, std::vector<int> &result);
+
+	// number of visible entries per category, including CID_All and CID_Fresh
+	void getCategoryUsage(const std::vector<Ogre::String> &fexts, std::map<int, int> &usage);
+
+	// filters candidates by the (lower case) query. All words of the query have to be found,
+	// "hash:", "guid:", "author:", "wheels:" and "file:" search in one field only.
+	// If nothing matches, words that are one typo away from a known token are accepted as well.
+	// Returns true if the result holds exact matches only, so a longer query can be searched in it
+	bool search(Ogre::String query, const std::vector<int> &candidates, std::vector<int> &result);
+
+protected:
+	bool built;
+	std::vector<search_entry_t> docs;
+	std::map<Ogre::String, std::vector<int> > tokens;                //!< token -> ids
+	std::vector<search_suffix_t> suffixes;                           //!< of all tokens, sorted
+	std::map<Ogre::String, std::map<int, int> > categoryUsage;       //!< file extension -> category -> count
+
+	void addTokens(int id, const Ogre::String &text);
+	void buildSuffixes();
+	// marks all ids whose text contains the word, returns false if the word can not be looked up
+	bool lookupWord(const Ogre::String &word, std::vector<char> &hits);
+	bool matches(const search_entry_t &doc, const Ogre::String &field, const Ogre::String &value);
+	void fuzzyTokens(const Ogre::String &word, std::set<int> &ids);
+
+	static bool isWithinOneEdit(const Ogre::String &a, const Ogre::String &b);
+};
+
+#endif // __SearchIndex_H_
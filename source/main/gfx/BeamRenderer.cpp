@@ -0,0 +1,282 @@
+/*
+This source file is part of Rigs of Rods
+Copyright 2005-2012 Pierre-Michel Ricordel
+Copyright 2007-2012 Thomas Fischer
+
+For more information, see http://www.rigsofrods.com/
+
+Rigs of Rods is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 3, as
+published by the Free Software Foundation.
+
+Rigs of Rods is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "BeamRenderer.h"
+
+#include "approxmath.h"
+#include "Settings.h"
+
+using namespace Ogre;
+
+#define BEAM_SKELETON_MATERIAL "mat-beam-vertexcolour"
+
+typedef struct beam_vertex_t
+{
+	float pos[3];
+	float normal[3];
+	RGBA colour;
+	float texcoord[2];
+} beam_vertex_t;
+
+BeamBatch::BeamBatch(String material, ColourValue colour) :
+	  indexedBeams(0)
+	, indexedCapacity(0)
+	, material(material)
+{
+	Root::getSingleton().convertColourValue(colour, &this->colour);
+	// the indices are only written for new beams or buffers, the shadow buffer keeps them over a device loss
+	initialize(RenderOperation::OT_TRIANGLE_LIST, true, true);
+	setMaterial(material);
+}
+
+void BeamBatch::createVertexDeclaration()
+{
+	VertexDeclaration *decl = mRenderOp.vertexData->vertexDeclaration;
+	decl->addElement(0, 0, VET_FLOAT3, VES_POSITION);
+	decl->addElement(0, 12, VET_FLOAT3, VES_NORMAL);
+	decl->addElement(0, 24, VET_COLOUR, VES_DIFFUSE);
+	decl->addElement(0, 28, VET_FLOAT2, VES_TEXTURE_COORDINATES);
+}
+
+void BeamBatch::fillHardwareBuffers()
+{
+	// the side faces of every beam, vertices 0-4 are around p1 and 5-9 around p2
+	HardwareIndexBufferSharedPtr ibuf = mRenderOp.indexData->indexBuffer;
+	unsigned short *ipt = static_cast<unsigned short*>(ibuf->lock(HardwareBuffer::HBL_DISCARD));
+	for (size_t i = 0; i < beams.size(); i++)
+	{
+		unsigned short base = (unsigned short)(i * BEAM_BATCH_VERTICES);
+		for (unsigned short k = 0; k < 4; k++)
+		{
+			*ipt++ = base + k;
+			*ipt++ = base + k + 1;
+			*ipt++ = base + 5 + k + 1;
+			*ipt++ = base + k;
+			*ipt++ = base + 5 + k + 1;
+			*ipt++ = base + 5 + k;
+		}
+	}
+	ibuf->unlock();
+	indexedBeams    = beams.size();
+	indexedCapacity = mIndexBufferCapacity;
+}
+
+int BeamBatch::update(beam_t *allbeams, float diameter, bool skeleton)
+{
+	prepareHardwareBuffers(beams.size() * BEAM_BATCH_VERTICES, beams.size() * BEAM_BATCH_INDICES);
+	if (indexedBeams != beams.size() || indexedCapacity != mIndexBufferCapacity)
+		fillHardwareBuffers();
+
+	HardwareVertexBufferSharedPtr vbuf = mRenderOp.vertexData->vertexBufferBinding->getBuffer(0);
+	beam_vertex_t *vpt = static_cast<beam_vertex_t*>(vbuf->lock(HardwareBuffer::HBL_DISCARD));
+
+	Vector3 aabMin(Math::POS_INFINITY), aabMax(Math::NEG_INFINITY);
+	float maxRadius = 0.0f;
+	int drawn = 0;
+	for (size_t i = 0; i < beams.size(); i++)
+	{
+		beam_t &b = allbeams[beams[i]];
+		if (!b.mVisible || b.disabled) continue;
+
+		const Vector3 &p1 = b.p1->smoothpos;
+		const Vector3 &p2 = b.p2->smoothpos;
+		Vector3 axis = p2 - p1;
+		float len2 = axis.squaredLength();
+		if (len2 < 1e-8f) continue;
+
+		// two unit vectors perpendicular to the beam and to each other
+		Vector3 u = (fabs(axis.x) < fabs(axis.y)) ? Vector3(0, axis.z, -axis.y) : Vector3(-axis.z, 0, axis.x);
+		u *= fast_invSqrt(u.squaredLength());
+		Vector3 v = axis.crossProduct(u) * fast_invSqrt(len2);
+
+		float radius = (diameter > 0 ? diameter : b.diameter) * 0.5f;
+		RGBA c = colour;
+		if (skeleton)
+			Root::getSingleton().convertColourValue(BeamRenderer::getStressColour(b.scale), &c);
+
+		// texture u goes around the beam, v along it from p1 to p2
+		Vector3 dirs[4] = { u, v, -u, -v };
+		for (int k = 0; k < 5; k++)
+		{
+			const Vector3 &dir = dirs[k % 4];
+			Vector3 offset = dir * radius;
+			beam_vertex_t &v1 = vpt[k];
+			beam_vertex_t &v2 = vpt[5 + k];
+			v1.pos[0] = p1.x + offset.x; v1.pos[1] = p1.y + offset.y; v1.pos[2] = p1.z + offset.z;
+			v2.pos[0] = p2.x + offset.x; v2.pos[1] = p2.y + offset.y; v2.pos[2] = p2.z + offset.z;
+			v1.normal[0] = v2.normal[0] = dir.x;
+			v1.normal[1] = v2.normal[1] = dir.y;
+			v1.normal[2] = v2.normal[2] = dir.z;
+			v1.colour = v2.colour = c;
+			v1.texcoord[0] = v2.texcoord[0] = k * 0.25f;
+			v1.texcoord[1] = 0.0f;
+			v2.texcoord[1] = 1.0f;
+		}
+		vpt += BEAM_BATCH_VERTICES;
+
+		aabMin.makeFloor(p1); aabMin.makeFloor(p2);
+		aabMax.makeCeil(p1);  aabMax.makeCeil(p2);
+		maxRadius = std::max(maxRadius, radius);
+		drawn++;
+	}
+	vbuf->unlock();
+
+	// only the written beams are drawn
+	mRenderOp.vertexData->vertexCount = drawn * BEAM_BATCH_VERTICES;
+	mRenderOp.indexData->indexCount   = drawn * BEAM_BATCH_INDICES;
+
+	if (drawn)
+	{
+		mBox.setExtents(aabMin - Vector3(maxRadius), aabMax + Vector3(maxRadius));
+		if (getParentSceneNode())
+			getParentSceneNode()->needUpdate();
+	}
+	return drawn;
+}
+
+BeamRenderer::BeamRenderer(SceneNode *parent) :
+	  drawnBeams(0)
+	, parent(parent)
+	, skeleton(false)
+	, visible(true)
+{
+}
+
+BeamRenderer::~BeamRenderer()
+{
+	for (size_t i = 0; i < batches.size(); i++)
+	{
+		if (batches[i]->getParentSceneNode())
+			batches[i]->getParentSceneNode()->detachObject(batches[i]);
+		delete batches[i];
+	}
+	batches.clear();
+}
+
+int BeamRenderer::addBeam(int index, String material, ColourValue colour)
+{
+	// colourize beams in simple c.mode
+	if (BSETTING("SimpleMaterials", false) && !MaterialManager::getSingleton().getByName("tracks/simple").isNull())
+		material = getVertexColourMaterial("tracks/simple");
+	else
+		colour = ColourValue::White;
+
+	int batch = -1;
+	for (int i = 0; i < (int)batches.size(); i++)
+	{
+		if (batches[i]->material == material && batches[i]->beams.size() < BEAM_BATCH_SIZE)
+		{
+			RGBA c;
+			Root::getSingleton().convertColourValue(colour, &c);
+			if (c == batches[i]->colour)
+			{
+				batch = i;
+				break;
+			}
+		}
+	}
+	if (batch < 0)
+	{
+		BeamBatch *b = new BeamBatch(material, colour);
+		if (skeleton)
+			b->setMaterial(BEAM_SKELETON_MATERIAL);
+		b->setVisible(false);
+		parent->attachObject(b);
+		batches.push_back(b);
+		batch = (int)batches.size() - 1;
+	}
+	batches[batch]->beams.push_back(index);
+	return batch;
+}
+
+void BeamRenderer::update(beam_t *beams, float diameter)
+{
+	drawnBeams = 0;
+	if (!visible) return;
+	for (size_t i = 0; i < batches.size(); i++)
+	{
+		int drawn = batches[i]->update(beams, diameter, skeleton);
+		batches[i]->setVisible(visible && drawn > 0);
+		drawnBeams += drawn;
+	}
+}
+
+void BeamRenderer::setSkeleton(bool skeleton)
+{
+	if (skeleton && MaterialManager::getSingleton().getByName(BEAM_SKELETON_MATERIAL).isNull())
+	{
+		// shows the vertex colours as they are
+		MaterialPtr mat = MaterialManager::getSingleton().create(BEAM_SKELETON_MATERIAL, ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+		mat->setLightingEnabled(false);
+		mat->setReceiveShadows(false);
+	}
+
+	this->skeleton = skeleton;
+	for (size_t i = 0; i < batches.size(); i++)
+		batches[i]->setMaterial(skeleton ? String(BEAM_SKELETON_MATERIAL) : batches[i]->material);
+	if (skeleton)
+		setCastShadows(false);
+}
+
+void BeamRenderer::setCastShadows(bool cast)
+{
+	for (size_t i = 0; i < batches.size(); i++)
+		batches[i]->setCastShadows(cast);
+}
+
+void BeamRenderer::setVisible(bool visible)
+{
+	this->visible = visible;
+	if (!visible)
+	{
+		for (size_t i = 0; i < batches.size(); i++)
+			batches[i]->setVisible(false);
+	}
+	// otherwise shown again with the next update
+}
+
+ColourValue BeamRenderer::getStressColour(float scale)
+{
+	// same colours as the mat-beam-* materials: green without stress, blue and red at the limits
+	float f = std::min(fabs(scale), 1.0f);
+	ColourValue c;
+	if (scale <= 0)
+		c = ColourValue(0.2f, 2.0f*(1.0f-f), f*2.0f, 0.8f);
+	else
+		c = ColourValue(f*2.0f, 2.0f*(1.0f-f), 0.2f, 0.8f);
+	c.saturate();
+	return c;
+}
+
+String BeamRenderer::getVertexColourMaterial(String material)
+{
+	String name = material + "/vertexcolour";
+	if (!MaterialManager::getSingleton().getByName(name).isNull())
+		return name;
+
+	MaterialPtr mat = MaterialManager::getSingleton().getByName(material)->clone(name);
+	Material::TechniqueIterator it = mat->getTechniqueIterator();
+	while (it.hasMoreElements())
+	{
+		Technique::PassIterator pit = it.getNext()->getPassIterator();
+		while (pit.hasMoreElements())
+			pit.getNext()->setVertexColourTracking(TVC_AMBIENT | TVC_DIFFUSE);
+	}
+	return name;
+}
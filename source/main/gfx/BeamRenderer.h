@@ -0,0 +1,93 @@
+/*
+This source file is part of Rigs of Rods
+Copyright 2005-2012 Pierre-Michel Ricordel
+Copyright 2007-2012 Thomas Fischer
+
+For more information, see http://www.rigsofrods.com/
+
+Rigs of Rods is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 3, as
+published by the Free Software Foundation.
+
+Rigs of Rods is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __BeamRenderer_H_
+#define __BeamRenderer_H_
+
+#include "RoRPrerequisites.h"
+
+#include "BeamData.h"
+#include "DynamicRenderable.h"
+
+// a beam is a four sided prism: 10 vertices (the seam of the texture is doubled) and 24 indices,
+// a batch has to fit into 16 bit indices
+#define BEAM_BATCH_SIZE     2048
+#define BEAM_BATCH_VERTICES 10
+#define BEAM_BATCH_INDICES  24
+
+/**
+ * Beams of one truck that use the same material, drawn from one dynamic vertex buffer.
+ */
+class BeamBatch : public DynamicRenderable
+{
+	friend class BeamRenderer;
+public:
+	BeamBatch(Ogre::String material, Ogre::ColourValue colour);
+
+	// writes all visible beams to the vertex buffer, returns the number of beams drawn
+	int update(beam_t *beams, float diameter, bool skeleton);
+
+protected:
+	Ogre::String material;
+	Ogre::RGBA colour;             //!< vertex colour outside of the skeleton view
+	std::vector<int> beams;        //!< indices into the beam array of the truck
+	size_t indexedBeams;           //!< the indices never change, they are only written for new beams or buffers
+	size_t indexedCapacity;
+
+	virtual void createVertexDeclaration();
+	virtual void fillHardwareBuffers();
+};
+
+/**
+ * Draws all beams of a truck. Instead of one scene node and entity per beam, the beams are put into
+ * a few batches (one per material) that are filled from the smoothed node positions in one loop.
+ * In the skeleton view all batches switch to a vertex coloured material that shows the stress.
+ */
+class BeamRenderer
+{
+public:
+	BeamRenderer(Ogre::SceneNode *parent);
+	~BeamRenderer();
+
+	// adds the beam with this index, returns the batch it is drawn with
+	int addBeam(int index, Ogre::String material, Ogre::ColourValue colour);
+
+	// diameter is used for all beams if it is greater than 0, otherwise every beam uses its own
+	void update(beam_t *beams, float diameter);
+
+	void setSkeleton(bool skeleton);
+	void setCastShadows(bool cast);
+	void setVisible(bool visible);
+
+	int getDrawnBeams() { return drawnBeams; };
+
+	// colour of a beam in the skeleton view, scale is the beam stress in -1 .. 1
+	static Ogre::ColourValue getStressColour(float scale);
+
+protected:
+	Ogre::SceneNode *parent;
+	std::vector<BeamBatch *> batches;
+	bool skeleton;
+	bool visible;
+	int drawnBeams;
+
+	static Ogre::String getVertexColourMaterial(Ogre::String material);
+};
+
+#endif // __BeamRenderer_H_
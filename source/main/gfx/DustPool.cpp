@@ -20,12 +20,18 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 #include "DustPool.h"
 #include "IWater.h"
 #include "RoRPrerequisites.h"
+#include "utils.h"
 
-DustPool::DustPool(char* dname, int dsize, SceneNode *parent, SceneManager *smgr, Water *mw)
+DustPool::DustPool(char* dname, int dsize, SceneNode *parent, SceneManager *smgr, Water *mw) :
+	  drains(0)
+	, queueHead(0)
+	, queueTail(0)
+	, sourceDrain(0)
 {
 	w=mw;
 	size=dsize;
 	allocated=0;
+	memset(sources, 0, sizeof(sources));
 	int i;
 	for (i=0; i<size; i++)
 	{
@@ -60,100 +66,120 @@ void DustPool::setVisible(bool s)
 	}
 }
 
+void DustPool::push(const void *source, int type, Vector3 pos, Vector3 vel, ColourValue col, float rate)
+{
+	if (source)
+	{
+		// the table starts over after every drain
+		unsigned int drain = drains;
+		if (drain != sourceDrain)
+		{
+			memset(sources, 0, sizeof(sources));
+			sourceDrain = drain;
+		}
+		unsigned int slot = (unsigned int)(((size_t)source >> 4) % DUST_SOURCE_SLOTS);
+		for (int probe=0; probe<DUST_SOURCE_SLOTS; probe++, slot=(slot+1)%DUST_SOURCE_SLOTS)
+		{
+			if (sources[slot] == source) return;
+			if (!sources[slot])
+			{
+				sources[slot] = source;
+				break;
+			}
+		}
+	}
+
+	unsigned int head = queueHead;
+	// full, the render thread did not keep up
+	if (head - queueTail >= DUST_QUEUE_SIZE) return;
+
+	dust_request_t &req = queue[head % DUST_QUEUE_SIZE];
+	req.pos  = pos;
+	req.vel  = vel;
+	req.col  = col;
+	req.rate = rate;
+	req.type = type;
+
+	MEMORY_BARRIER();
+	queueHead = head + 1;
+}
+
+void DustPool::drain()
+{
+	unsigned int head = queueHead;
+	MEMORY_BARRIER();
+
+	// more requests than emitters are dropped
+	allocated=0;
+	unsigned int tail = queueTail;
+	for (; tail != head; tail++)
+	{
+		if (allocated==size) continue;
+		dust_request_t &req = queue[tail % DUST_QUEUE_SIZE];
+		positions[allocated]=req.pos;
+		velocities[allocated]=req.vel;
+		colours[allocated]=req.col;
+		rates[allocated]=req.rate;
+		types[allocated]=req.type;
+		allocated++;
+	}
+
+	MEMORY_BARRIER();
+	queueTail = tail;
+	drains = drains + 1;
+}
+
 //Dust
-void DustPool::malloc(Vector3 pos, Vector3 vel, ColourValue col)
+void DustPool::malloc(Vector3 pos, Vector3 vel, ColourValue col, const void *source)
 {
-	if (allocated==size) return;
-	positions[allocated]=pos;
-	velocities[allocated]=vel;
-	colours[allocated]=col;
-	types[allocated]=DUST_NORMAL;
-	//visible[allocated]=true;
-	allocated++;
+	push(source, DUST_NORMAL, pos, vel, col);
 }
 
 //Clumps
-void DustPool::allocClump(Vector3 pos, Vector3 vel, ColourValue col)
+void DustPool::allocClump(Vector3 pos, Vector3 vel, ColourValue col, const void *source)
 {
-	if (allocated==size) return;
-	positions[allocated]=pos;
-	velocities[allocated]=vel;
-	colours[allocated]=col;
-	types[allocated]=DUST_CLUMP;
-	//visible[allocated]=true;
-	allocated++;
+	push(source, DUST_CLUMP, pos, vel, col);
 }
 
 //Rubber smoke
-void DustPool::allocSmoke(Vector3 pos, Vector3 vel)
+void DustPool::allocSmoke(Vector3 pos, Vector3 vel, const void *source)
 {
-	if (allocated==size) return;
-	positions[allocated]=pos;
-	velocities[allocated]=vel;
-	types[allocated]=DUST_RUBBER;
-	//visible[allocated]=true;
-	allocated++;
+	push(source, DUST_RUBBER, pos, vel);
 }
 
 //
-void DustPool::allocSparks(Vector3 pos, Vector3 vel)
+void DustPool::allocSparks(Vector3 pos, Vector3 vel, const void *source)
 {
 	if(vel.length() < 0.1) return; // try to prevent emitting sparks while standing
-	if (allocated==size) return;
-	positions[allocated]=pos;
-	velocities[allocated]=vel;
-	types[allocated]=DUST_SPARKS;
-	//visible[allocated]=true;
-	allocated++;
+	push(source, DUST_SPARKS, pos, vel);
 }
 
 //Water vapour
-void DustPool::allocVapour(Vector3 pos, Vector3 vel, float time)
+void DustPool::allocVapour(Vector3 pos, Vector3 vel, float time, const void *source)
 {
-	if (allocated==size) return;
-	positions[allocated]=pos;
-	velocities[allocated]=vel;
-	types[allocated]=DUST_VAPOUR;
-	rates[allocated]=5.0-time;
-	//visible[allocated]=true;
-	allocated++;
+	push(source, DUST_VAPOUR, pos, vel, ColourValue::White, 5.0-time);
 }
 
-void DustPool::allocDrip(Vector3 pos, Vector3 vel, float time)
+void DustPool::allocDrip(Vector3 pos, Vector3 vel, float time, const void *source)
 {
-	if (allocated==size) return;
-	positions[allocated]=pos;
-	velocities[allocated]=vel;
-	types[allocated]=DUST_DRIP;
-	rates[allocated]=5.0-time;
-	//visible[allocated]=true;
-	allocated++;
+	push(source, DUST_DRIP, pos, vel, ColourValue::White, 5.0-time);
 }
 
-void DustPool::allocSplash(Vector3 pos, Vector3 vel)
+void DustPool::allocSplash(Vector3 pos, Vector3 vel, const void *source)
 {
-	if (allocated==size) return;
-	positions[allocated]=pos;
-	velocities[allocated]=vel;
-	types[allocated]=DUST_SPLASH;
-	//visible[allocated]=true;
-	allocated++;
+	push(source, DUST_SPLASH, pos, vel);
 }
 
-void DustPool::allocRipple(Vector3 pos, Vector3 vel)
+void DustPool::allocRipple(Vector3 pos, Vector3 vel, const void *source)
 {
-	if (allocated==size) return;
-	positions[allocated]=pos;
-	velocities[allocated]=vel;
-	types[allocated]=DUST_RIPPLE;
-	//visible[allocated]=true;
-	allocated++;
+	push(source, DUST_RIPPLE, pos, vel);
 }
 
 void DustPool::update(float gspeed)
 {
 	int i;
 	gspeed=fabs(gspeed);
+	drain();
 	for (i=0; i<allocated; i++)
 	{
 		/*
@@ -42,9 +42,40 @@ using namespace Ogre;
 #define DUST_SPARKS 6
 #define DUST_CLUMP 7
 
+#define DUST_QUEUE_SIZE   256 //!< power of two
+#define DUST_SOURCE_SLOTS 64  //!< sources the producer remembers between two drains
+
+/**
+ * The alloc functions are called by the physics, update() runs on the render thread. The requests go through
+ * a lock-free single producer, single consumer ring: the physics of all trucks runs on one thread at a time,
+ * handed over through the frame sync, so there is only one writer. Every source (i.e. a node) gets only one
+ * request in until the next update(), it would only move the same emitter again.
+ */
 class DustPool
 {
 protected:
+	typedef struct dust_request_t
+	{
+		Vector3 pos;
+		Vector3 vel;
+		ColourValue col;
+		float rate;
+		int type;
+	} dust_request_t;
+
+	dust_request_t queue[DUST_QUEUE_SIZE];
+	volatile unsigned int queueHead;   //!< only written by the producer
+	volatile unsigned int queueTail;   //!< only written by update()
+	volatile unsigned int drains;      //!< update() count
+
+	// producer side only
+	const void *sources[DUST_SOURCE_SLOTS];
+	unsigned int sourceDrain;          //!< drain count the sources belong to
+
+	void push(const void *source, int type, Vector3 pos, Vector3 vel, ColourValue col=ColourValue::White, float rate=0);
+	void drain();
+
+
 	ParticleSystem* pss[MAX_DUSTS];
     SceneNode *sns[MAX_DUSTS];
 	int size;
@@ -61,22 +92,23 @@ public:
 	DustPool(char* dname, int dsize, SceneNode *parent, SceneManager *smgr, Water *mw);
 
 	void setVisible(bool s);
+	// source identifies the emitter of the request (i.e. the node), 0 is never coalesced
 	//Dust
-	void malloc(Vector3 pos, Vector3 vel, ColourValue col=ColourValue(0.83, 0.71, 0.64, 1.0));
+	void malloc(Vector3 pos, Vector3 vel, ColourValue col=ColourValue(0.83, 0.71, 0.64, 1.0), const void *source=0);
 	//clumps
-	void allocClump(Vector3 pos, Vector3 vel, ColourValue col=ColourValue(0.83, 0.71, 0.64, 1.0));
+	void allocClump(Vector3 pos, Vector3 vel, ColourValue col=ColourValue(0.83, 0.71, 0.64, 1.0), const void *source=0);
 	//Rubber smoke
-	void allocSmoke(Vector3 pos, Vector3 vel);
+	void allocSmoke(Vector3 pos, Vector3 vel, const void *source=0);
 	//
-	void allocSparks(Vector3 pos, Vector3 vel);
+	void allocSparks(Vector3 pos, Vector3 vel, const void *source=0);
 	//Water vapour
-	void allocVapour(Vector3 pos, Vector3 vel, float time);
+	void allocVapour(Vector3 pos, Vector3 vel, float time, const void *source=0);
 
-	void allocDrip(Vector3 pos, Vector3 vel, float time);
+	void allocDrip(Vector3 pos, Vector3 vel, float time, const void *source=0);
 
-	void allocSplash(Vector3 pos, Vector3 vel);
+	void allocSplash(Vector3 pos, Vector3 vel, const void *source=0);
 
-	void allocRipple(Vector3 pos, Vector3 vel);
+	void allocRipple(Vector3 pos, Vector3 vel, const void *source=0);
 
 	void update(float gspeed);
 	void setWater(Water *_w) { w = _w; };
@@ -16,11 +16,12 @@ DynamicRenderable::~DynamicRenderable()
 }
 
 void DynamicRenderable::initialize(RenderOperation::OperationType operationType,
-	bool useIndices)
+	bool useIndices, bool staticIndices)
 {
 	// Initialize render operation
 	mRenderOp.operationType = operationType;
 	mRenderOp.useIndexes = useIndices;
+	mStaticIndices = staticIndices;
 	mRenderOp.vertexData = new VertexData;
 	if (mRenderOp.useIndexes)
 		mRenderOp.indexData = new IndexData;
@@ -109,7 +110,8 @@ void DynamicRenderable::prepareHardwareBuffers(size_t vertexCount,
 				HardwareBufferManager::getSingleton().createIndexBuffer(
 				HardwareIndexBuffer::IT_16BIT,
 				mIndexBufferCapacity,
-				HardwareBuffer::HBU_DYNAMIC_WRITE_ONLY); // TODO: Custom HBU_?
+				mStaticIndices ? HardwareBuffer::HBU_STATIC_WRITE_ONLY : HardwareBuffer::HBU_DYNAMIC_WRITE_ONLY,
+				mStaticIndices);
 		}
 
 		// Update index count in the render operation
@@ -21,9 +21,13 @@ public:
 		createVertexDeclaration().
 	@param operationType The type of render operation to perform.
 	@param useIndices Specifies whether to use indices to determine the
-			vertices to use as input. */
+			vertices to use as input.
+	@param staticIndices Creates the index buffer static with a shadow
+			buffer, for indices that are only written when the buffer is
+			reallocated. Ogre restores them from the shadow buffer when the
+			device is lost. */
 	void initialize(Ogre::RenderOperation::OperationType operationType,
-					bool useIndices);
+					bool useIndices, bool staticIndices = false);
 
 	/// Implementation of Ogre::SimpleRenderable
 	virtual Ogre::Real getBoundingRadius(void) const;
@@ -35,6 +39,8 @@ protected:
 	size_t mVertexBufferCapacity;
 	/// Maximum capacity of the currently allocated index buffer.
 	size_t mIndexBufferCapacity;
+	/// Whether the index buffer is static and shadowed.
+	bool mStaticIndices;
 
 	/** Creates the vertex declaration.
 	@remarks
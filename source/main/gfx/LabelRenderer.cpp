@@ -0,0 +1,334 @@
+/*
+This source file is part of Rigs of Rods
+Copyright 2005-2012 Pierre-Michel Ricordel
+Copyright 2007-2012 Thomas Fischer
+
+For more information, see http://www.rigsofrods.com/
+
+Rigs of Rods is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 3, as
+published by the Free Software Foundation.
+
+Rigs of Rods is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "LabelRenderer.h"
+
+#include "Ogre.h"
+#include "Settings.h"
+
+#include <OgreFontManager.h>
+
+using namespace Ogre;
+
+#define LABEL_MATERIAL "mat-labels"
+
+typedef struct label_vertex_t
+{
+	float pos[3];
+	RGBA colour;
+	float texcoord[2];
+} label_vertex_t;
+
+LabelBatch::LabelBatch(String material) :
+	  indexedCapacity(0)
+{
+	// the indices never change, their shadow copy survives a lost device
+	initialize(RenderOperation::OT_TRIANGLE_LIST, true, true);
+	setMaterial(material);
+	setCastShadows(false);
+}
+
+void LabelBatch::createVertexDeclaration()
+{
+	VertexDeclaration *decl = mRenderOp.vertexData->vertexDeclaration;
+	decl->addElement(0, 0, VET_FLOAT3, VES_POSITION);
+	decl->addElement(0, 12, VET_COLOUR, VES_DIFFUSE);
+	decl->addElement(0, 16, VET_FLOAT2, VES_TEXTURE_COORDINATES, 0);
+}
+
+void LabelBatch::fillHardwareBuffers()
+{
+	// every glyph is a quad of two triangles, written for the whole buffer
+	HardwareIndexBufferSharedPtr ibuf = mRenderOp.indexData->indexBuffer;
+	unsigned short *ipt = static_cast<unsigned short*>(ibuf->lock(HardwareBuffer::HBL_DISCARD));
+	for (size_t i = 0; i < mIndexBufferCapacity / 6; i++)
+	{
+		unsigned short base = (unsigned short)(i * 4);
+		*ipt++ = base;
+		*ipt++ = base + 1;
+		*ipt++ = base + 2;
+		*ipt++ = base + 2;
+		*ipt++ = base + 1;
+		*ipt++ = base + 3;
+	}
+	ibuf->unlock();
+	indexedCapacity = mIndexBufferCapacity;
+}
+
+void LabelBatch::prepare(size_t glyphs)
+{
+	prepareHardwareBuffers(glyphs * 4, glyphs * 6);
+	if (indexedCapacity != mIndexBufferCapacity)
+		fillHardwareBuffers();
+}
+
+LabelRenderer::LabelRenderer(SceneManager *scm, Camera *cam) :
+	  batch(0)
+	, cam(cam)
+	, changed(false)
+	, drawnGlyphs(0)
+	, font(0)
+	, lastCamOrientation(Quaternion::ZERO)
+	, lastCamPosition(Vector3::ZERO)
+	, maxDistance(FSETTING("Label Distance", 5000))
+	, snode(0)
+	, visible(true)
+{
+	setSingleton(this);
+
+	font = (Font *)FontManager::getSingleton().getByName(LABEL_FONT).getPointer();
+	if (!font)
+	{
+		LOG("LabelRenderer: font " + String(LABEL_FONT) + " not found, labels are disabled");
+		return;
+	}
+	font->load();
+
+	// the font texture is the glyph atlas, the text colour comes from the vertices
+	if (MaterialManager::getSingleton().getByName(LABEL_MATERIAL).isNull())
+	{
+		MaterialPtr mat = font->getMaterial()->clone(LABEL_MATERIAL);
+		mat->setDepthBias(1.0, 1.0);
+		mat->setDepthWriteEnabled(false);
+		mat->setFog(true);
+		mat->setLightingEnabled(false);
+		mat->load();
+	}
+
+	batch = new LabelBatch(LABEL_MATERIAL);
+	batch->setVisible(false);
+	snode = scm->getRootSceneNode()->createChildSceneNode();
+	snode->attachObject(batch);
+	Root::getSingleton().getRenderSystem()->addListener(this);
+}
+
+LabelRenderer::~LabelRenderer()
+{
+	if (batch && Root::getSingletonPtr() && Root::getSingleton().getRenderSystem())
+		Root::getSingleton().getRenderSystem()->removeListener(this);
+	if (snode)
+	{
+		snode->detachAllObjects();
+		snode->getParentSceneNode()->removeAndDestroyChild(snode->getName());
+	}
+	delete batch;
+}
+
+void LabelRenderer::eventOccurred(const String &eventName, const NameValuePairList *parameters)
+{
+	// the vertex buffer has no shadow copy, it is written again with the next update
+	if (eventName == "DeviceRestored")
+		changed = true;
+}
+
+int LabelRenderer::addLabel(ColourValue colour)
+{
+	int id;
+	if (!freeLabels.empty())
+	{
+		id = freeLabels.back();
+		freeLabels.pop_back();
+	} else
+	{
+		id = (int)labels.size();
+		labels.push_back(label_t());
+	}
+
+	label_t &label = labels[id];
+	label.used    = true;
+	label.visible = false;
+	label.caption = UTFString();
+	label.anchor  = Vector3::ZERO;
+	label.height  = 1.0f;
+	label.width   = 0.0f;
+	label.glyphs.clear();
+	Root::getSingleton().convertColourValue(colour, &label.colour);
+	return id;
+}
+
+void LabelRenderer::removeLabel(int id)
+{
+	label_t *label = getLabel(id);
+	if (!label) return;
+	if (label->visible)
+		changed = true;
+	label->used    = false;
+	label->visible = false;
+	label->glyphs.clear();
+	freeLabels.push_back(id);
+}
+
+LabelRenderer::label_t *LabelRenderer::getLabel(int id)
+{
+	if (id < 0 || id >= (int)labels.size() || !labels[id].used)
+		return 0;
+	return &labels[id];
+}
+
+void LabelRenderer::setCaption(int id, const UTFString &caption)
+{
+	label_t *label = getLabel(id);
+	if (!label || label->caption == caption) return;
+	label->caption = caption;
+	layout(*label);
+	if (label->visible)
+		changed = true;
+}
+
+void LabelRenderer::setPosition(int id, const Vector3 &anchor, float height)
+{
+	label_t *label = getLabel(id);
+	if (!label || (label->anchor == anchor && label->height == height)) return;
+	label->anchor = anchor;
+	label->height = height;
+	if (label->visible)
+		changed = true;
+}
+
+void LabelRenderer::setVisible(int id, bool visible)
+{
+	label_t *label = getLabel(id);
+	if (!label || label->visible == visible) return;
+	label->visible = visible;
+	changed = true;
+}
+
+bool LabelRenderer::getVisible(int id)
+{
+	label_t *label = getLabel(id);
+	return label && label->visible;
+}
+
+void LabelRenderer::setAllVisible(bool visible)
+{
+	this->visible = visible;
+	if (batch)
+		batch->setVisible(visible && drawnGlyphs > 0);
+}
+
+void LabelRenderer::layout(label_t &label)
+{
+	// same metrics as MovableText: a glyph is as wide as its aspect ratio times the character height
+	label.glyphs.clear();
+	label.width = 0.0f;
+	if (!font) return;
+
+	float spaceWidth = font->getGlyphAspectRatio('A');
+	for (UTFString::const_iterator it = label.caption.begin(); it != label.caption.end(); it++)
+	{
+		if (*it == ' ' || *it == '\n')
+		{
+			label.width += spaceWidth;
+			continue;
+		}
+		label_glyph_t g;
+		g.left  = label.width;
+		g.right = label.width + font->getGlyphAspectRatio(*it);
+		g.uv    = font->getGlyphTexCoords(*it);
+		label.glyphs.push_back(g);
+		label.width = g.right;
+	}
+}
+
+void LabelRenderer::update()
+{
+	if (!batch || !visible) return;
+
+	// the quads face the camera, so they have to be written again when it moved
+	Vector3 camPosition = cam->getDerivedPosition();
+	Quaternion camOrientation = cam->getDerivedOrientation();
+	if (!changed && camPosition == lastCamPosition && camOrientation == lastCamOrientation)
+		return;
+	changed            = false;
+	lastCamPosition    = camPosition;
+	lastCamOrientation = camOrientation;
+
+	size_t glyphs = 0;
+	for (size_t i = 0; i < labels.size(); i++)
+	{
+		if (labels[i].visible)
+			glyphs += labels[i].glyphs.size();
+	}
+	glyphs = std::min(glyphs, (size_t)LABEL_MAX_GLYPHS);
+
+	drawnGlyphs = 0;
+	if (glyphs)
+	{
+		batch->prepare(glyphs);
+
+		Vector3 right = camOrientation * Vector3::UNIT_X;
+		Vector3 up    = camOrientation * Vector3::UNIT_Y;
+		float maxDist2 = maxDistance * maxDistance;
+		Vector3 aabMin(Math::POS_INFINITY), aabMax(Math::NEG_INFINITY);
+
+		HardwareVertexBufferSharedPtr vbuf = batch->mRenderOp.vertexData->vertexBufferBinding->getBuffer(0);
+		label_vertex_t *vpt = static_cast<label_vertex_t*>(vbuf->lock(HardwareBuffer::HBL_DISCARD));
+		for (size_t i = 0; i < labels.size(); i++)
+		{
+			label_t &label = labels[i];
+			if (!label.visible || label.glyphs.empty()) continue;
+			if (maxDistance > 0 && label.anchor.squaredDistance(camPosition) > maxDist2) continue;
+			if (drawnGlyphs + label.glyphs.size() > glyphs) break;
+
+			// centred on the anchor, the glyph positions are in character heights
+			Vector3 origin = label.anchor - (right * label.width + up) * (label.height * 0.5f);
+			Vector3 r = right * label.height;
+			Vector3 u = up * label.height;
+			for (size_t k = 0; k < label.glyphs.size(); k++)
+			{
+				label_glyph_t &g = label.glyphs[k];
+				Vector3 corners[4] = {
+					origin + r * g.left + u,
+					origin + r * g.left,
+					origin + r * g.right + u,
+					origin + r * g.right
+				};
+				float uvs[4][2] = {
+					{ g.uv.left,  g.uv.top },
+					{ g.uv.left,  g.uv.bottom },
+					{ g.uv.right, g.uv.top },
+					{ g.uv.right, g.uv.bottom }
+				};
+				for (int c = 0; c < 4; c++, vpt++)
+				{
+					vpt->pos[0] = corners[c].x;
+					vpt->pos[1] = corners[c].y;
+					vpt->pos[2] = corners[c].z;
+					vpt->colour = label.colour;
+					vpt->texcoord[0] = uvs[c][0];
+					vpt->texcoord[1] = uvs[c][1];
+					aabMin.makeFloor(corners[c]);
+					aabMax.makeCeil(corners[c]);
+				}
+			}
+			drawnGlyphs += (int)label.glyphs.size();
+		}
+		vbuf->unlock();
+
+		// only the written glyphs are drawn
+		batch->mRenderOp.vertexData->vertexCount = drawnGlyphs * 4;
+		batch->mRenderOp.indexData->indexCount   = drawnGlyphs * 6;
+		if (drawnGlyphs)
+		{
+			batch->mBox.setExtents(aabMin, aabMax);
+			snode->needUpdate();
+		}
+	}
+	batch->setVisible(drawnGlyphs > 0);
+}
@@ -0,0 +1,123 @@
+/*
+This source file is part of Rigs of Rods
+Copyright 2005-2012 Pierre-Michel Ricordel
+Copyright 2007-2012 Thomas Fischer
+
+For more information, see http://www.rigsofrods.com/
+
+Rigs of Rods is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 3, as
+published by the Free Software Foundation.
+
+Rigs of Rods is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __LabelRenderer_H_
+#define __LabelRenderer_H_
+
+#include "RoRPrerequisites.h"
+
+#include "DynamicRenderable.h"
+#include "Singleton.h"
+
+#include <OgreFont.h>
+#include <OgreRenderSystem.h>
+
+#define LABEL_FONT        "CyberbitEnglish"
+#define LABEL_MAX_GLYPHS  10000    //!< a glyph is a quad of 4 vertices and 6 indices, all of them have to fit into 16 bit indices
+
+/**
+ * The glyphs of all labels, drawn from one dynamic vertex buffer with the texture of the label font.
+ */
+class LabelBatch : public DynamicRenderable
+{
+	friend class LabelRenderer;
+public:
+	LabelBatch(Ogre::String material);
+
+protected:
+	size_t indexedCapacity;        //!< the indices never change, they are only written for new buffers
+
+	virtual void createVertexDeclaration();
+	virtual void fillHardwareBuffers();
+
+	// makes room for this many glyphs
+	void prepare(size_t glyphs);
+};
+
+/**
+ * Draws the name labels of trucks and characters. Instead of one MovableText with its own buffers and
+ * material per label, all captions are laid out with one font and written into a single batch that faces
+ * the camera. A caption is only laid out again when its text changes, and the batch is only rewritten
+ * when a label or the camera moved. Labels beyond the "Label Distance" setting are not drawn.
+ */
+class LabelRenderer : public RoRSingletonNoCreation<LabelRenderer>, public Ogre::RenderSystem::Listener
+{
+public:
+	LabelRenderer(Ogre::SceneManager *scm, Ogre::Camera *cam);
+	~LabelRenderer();
+
+	// returns the handle of a new hidden label
+	int addLabel(Ogre::ColourValue colour = Ogre::ColourValue::Black);
+	void removeLabel(int id);
+
+	void setCaption(int id, const Ogre::UTFString &caption);
+	// the caption is centred on anchor, height is the world height of its characters
+	void setPosition(int id, const Ogre::Vector3 &anchor, float height);
+	void setVisible(int id, bool visible);
+	bool getVisible(int id);
+
+	// hides all labels without touching their own visibility, used while the map is rendered
+	void setAllVisible(bool visible);
+
+	// call once per frame after the labels were moved
+	void update();
+
+	int getDrawnGlyphs() { return drawnGlyphs; };
+
+	// Ogre::RenderSystem::Listener
+	void eventOccurred(const Ogre::String &eventName, const Ogre::NameValuePairList *parameters);
+
+protected:
+	typedef struct label_glyph_t
+	{
+		float left;                //!< in character heights from the start of the caption
+		float right;
+		Ogre::Font::UVRect uv;
+	} label_glyph_t;
+
+	typedef struct label_t
+	{
+		bool used;
+		bool visible;
+		Ogre::UTFString caption;
+		Ogre::RGBA colour;
+		Ogre::Vector3 anchor;
+		float height;
+		float width;               //!< of the caption in character heights
+		std::vector<label_glyph_t> glyphs;
+	} label_t;
+
+	Ogre::Camera *cam;
+	Ogre::Font *font;
+	Ogre::SceneNode *snode;
+	LabelBatch *batch;
+	std::vector<label_t> labels;
+	std::vector<int> freeLabels;
+	bool changed;                  //!< a label changed or the device lost the vertices since the batch was written
+	bool visible;
+	float maxDistance;             //!< m, 0 draws all labels
+	int drawnGlyphs;
+	Ogre::Vector3 lastCamPosition;
+	Ogre::Quaternion lastCamOrientation;
+
+	label_t *getLabel(int id);
+	void layout(label_t &label);
+};
+
+#endif // __LabelRenderer_H_
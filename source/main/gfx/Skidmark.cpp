@@ -20,24 +20,170 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 #include "Skidmark.h"
 
 #include "BeamData.h"
-#include "heightfinder.h"
 #include "Ogre.h"
+#include "Settings.h"
 
 using namespace Ogre;
 
-int Skidmark::instanceCounter = 0;
+typedef struct skidmark_vertex_t
+{
+	float pos[3];
+	RGBA colour;
+	float texcoord[2];
+} skidmark_vertex_t;
+
+SkidmarkBatch::SkidmarkBatch(String material) :
+	  dirtyFrom(0)
+	, dirtyTo(0)
+	, newest(0)
+	, next(0)
+	, used(0)
+{
+	quads.resize(SKIDMARK_BATCH_QUADS);
+	// the indices never change, the shadow buffer keeps them over a device loss
+	initialize(RenderOperation::OT_TRIANGLE_LIST, true, true);
+	prepareHardwareBuffers(SKIDMARK_BATCH_QUADS * 4, SKIDMARK_BATCH_QUADS * 6);
+	fillHardwareBuffers();
+	setRenderingDistance(2000); //2km sight range
+	reset(material);
+}
+
+void SkidmarkBatch::createVertexDeclaration()
+{
+	VertexDeclaration *decl = mRenderOp.vertexData->vertexDeclaration;
+	decl->addElement(0, 0, VET_FLOAT3, VES_POSITION);
+	decl->addElement(0, 12, VET_COLOUR, VES_DIFFUSE);
+	decl->addElement(0, 16, VET_FLOAT2, VES_TEXTURE_COORDINATES, 0);
+}
+
+void SkidmarkBatch::fillHardwareBuffers()
+{
+	// the indices never change, every slot is a quad of two triangles
+	HardwareIndexBufferSharedPtr ibuf = mRenderOp.indexData->indexBuffer;
+	unsigned short *ipt = static_cast<unsigned short*>(ibuf->lock(HardwareBuffer::HBL_DISCARD));
+	for (int i = 0; i < SKIDMARK_BATCH_QUADS; i++)
+	{
+		unsigned short base = (unsigned short)(i * 4);
+		*ipt++ = base;
+		*ipt++ = base + 1;
+		*ipt++ = base + 2;
+		*ipt++ = base + 2;
+		*ipt++ = base + 1;
+		*ipt++ = base + 3;
+	}
+	ibuf->unlock();
+}
+
+void SkidmarkBatch::reset(String material)
+{
+	next      = 0;
+	used      = 0;
+	dirtyFrom = 0;
+	dirtyTo   = 0;
+	setMaterial(material);
+	mBox.setNull();
+	mRenderOp.vertexData->vertexCount = 0;
+	mRenderOp.indexData->indexCount   = 0;
+}
+
+void SkidmarkBatch::addQuad(const skidmark_quad_t &quad)
+{
+	if (dirtyFrom == dirtyTo)
+		dirtyFrom = dirtyTo = next;
+	quads[next] = quad;
+	dirtyFrom = std::min(dirtyFrom, next);
+	dirtyTo   = std::max(dirtyTo, next + 1);
+	newest    = quad.born;
+	for (int k = 0; k < 4; k++)
+		mBox.merge(quad.corners[k]);
+
+	next = (next + 1) % SKIDMARK_BATCH_QUADS;
+	used = std::max(used, next ? next : SKIDMARK_BATCH_QUADS);
+}
+
+float SkidmarkBatch::getOldest()
+{
+	if (!used) return newest;
+	// the slot that is written next holds the oldest quad once the ring wrapped
+	return quads[(used < SKIDMARK_BATCH_QUADS) ? 0 : next].born;
+}
+
+void SkidmarkBatch::upload(int from, int to, float now, float lifetime, float fadeTime)
+{
+	if (from >= to) return;
+
+	HardwareVertexBufferSharedPtr vbuf = mRenderOp.vertexData->vertexBufferBinding->getBuffer(0);
+	skidmark_vertex_t *vpt = static_cast<skidmark_vertex_t*>(vbuf->lock(from * 4 * sizeof(skidmark_vertex_t), (to - from) * 4 * sizeof(skidmark_vertex_t), HardwareBuffer::HBL_NORMAL));
+	for (int i = from; i < to; i++)
+	{
+		skidmark_quad_t &q = quads[i];
+		float alpha = std::max(0.0f, std::min(1.0f, (lifetime - (now - q.born)) / fadeTime));
+		RGBA colour;
+		Root::getSingleton().convertColourValue(ColourValue(1.0f, 1.0f, 1.0f, alpha * 0.8f), &colour);
+		for (int k = 0; k < 4; k++, vpt++)
+		{
+			vpt->pos[0] = q.corners[k].x;
+			vpt->pos[1] = q.corners[k].y;
+			vpt->pos[2] = q.corners[k].z;
+			vpt->colour = colour;
+			vpt->texcoord[0] = (float)(k % 2);
+			vpt->texcoord[1] = q.texcoords[k / 2];
+		}
+	}
+	vbuf->unlock();
+
+	mRenderOp.vertexData->vertexCount = used * 4;
+	mRenderOp.indexData->indexCount   = used * 6;
+	if (getParentSceneNode())
+		getParentSceneNode()->needUpdate();
+}
+
+/////////////// SkidmarkManager below
 
-SkidmarkManager::SkidmarkManager()
+SkidmarkManager::SkidmarkManager() :
+	  deviceRestored(false)
+	, fadeTimer(0)
+	, scm(0)
+	, snode(0)
+	, time(0)
 {
 	LOG("SkidmarkManager created");
+	lifetime = std::max(1.0f, FSETTING("Skidmark Lifetime", 120.0f));
+	fadeTime = lifetime * 0.25f;
 	loadDefaultModels();
 }
 
 SkidmarkManager::~SkidmarkManager()
 {
+	if (scm && Root::getSingletonPtr() && Root::getSingleton().getRenderSystem())
+		Root::getSingleton().getRenderSystem()->removeListener(this);
+
+	for (std::map<batch_key_t, SkidmarkBatch *>::iterator it = batches.begin(); it != batches.end(); it++)
+		freeBatches.push_back(it->second);
+	batches.clear();
+	for (size_t i = 0; i < freeBatches.size(); i++)
+	{
+		if (freeBatches[i]->getParentSceneNode())
+			freeBatches[i]->getParentSceneNode()->detachObject(freeBatches[i]);
+		delete freeBatches[i];
+	}
+	freeBatches.clear();
 	LOG("SkidmarkManager destroyed");
 }
 
+void SkidmarkManager::init(SceneManager *scm)
+{
+	this->scm = scm;
+	snode = scm->getRootSceneNode()->createChildSceneNode();
+	Root::getSingleton().getRenderSystem()->addListener(this);
+}
+
+void SkidmarkManager::eventOccurred(const String &eventName, const NameValuePairList *parameters)
+{
+	if (eventName == "DeviceRestored")
+		deviceRestored = true;
+}
+
 int SkidmarkManager::loadDefaultModels()
 {
 	LOG("SkidmarkManager loading default models");
@@ -121,97 +267,128 @@ int SkidmarkManager::getTexture(String model, String ground, float slip, String
 	return 2;
 }
 
-/////////////// Skidmark below
-
-// this is a hardcoded array which we use to map ground types to a certain texture with UV/ coords
-Vector2 Skidmark::tex_coords[4] = {Vector2(0,0), Vector2(0,1), Vector2(1,0), Vector2(1,1)};
-
-Skidmark::Skidmark(SceneManager *scm, wheel_t *wheel, HeightFinder *hfinder, SceneNode *snode, int _lenght, int bucketCount) :
-	  scm(scm)
-	, mNode(snode)
-	, hfinder(hfinder)
-	, mDirty(true)
-	, lenght((_lenght%2) ? (_lenght-(_lenght%2)) : _lenght)
-	, bucketCount(bucketCount)
-	, wheel(wheel)
-	, minDistance(0.1f)
-	, maxDistance(std::max(0.5f, wheel->width*1.1f))
-	, minDistanceSquared(minDistance * minDistance)
-	, maxDistanceSquared(maxDistance * maxDistance)
+void SkidmarkManager::addQuad(String texture, const Vector3 *from, const Vector3 *to, float texFrom, float texTo)
 {
+	if (!snode) return;
+
+	SkidmarkBatch::skidmark_quad_t quad;
+	quad.corners[0]   = from[0];
+	quad.corners[1]   = from[1];
+	quad.corners[2]   = to[0];
+	quad.corners[3]   = to[1];
+	quad.texcoords[0] = texFrom;
+	quad.texcoords[1] = texTo;
+	quad.born         = time;
+	getBatch(texture, to[0])->addQuad(quad);
 }
 
-Skidmark::~Skidmark()
+SkidmarkBatch *SkidmarkManager::getBatch(String texture, const Vector3 &pos)
 {
+	batch_key_t key(texture, std::make_pair((int)floor(pos.x / SKIDMARK_REGION_SIZE), (int)floor(pos.z / SKIDMARK_REGION_SIZE)));
+	std::map<batch_key_t, SkidmarkBatch *>::iterator it = batches.find(key);
+	if (it != batches.end())
+		return it->second;
+
+	// the number of batches is limited, so the skidmarks cost the same no matter how many wheels leave them
+	if ((int)batches.size() >= SKIDMARK_MAX_BATCHES)
+	{
+		std::map<batch_key_t, SkidmarkBatch *>::iterator oldest = batches.begin();
+		for (it = batches.begin(); it != batches.end(); it++)
+		{
+			if (it->second->newest < oldest->second->newest)
+				oldest = it;
+		}
+		recycle(oldest);
+	}
+
+	SkidmarkBatch *batch = 0;
+	if (!freeBatches.empty())
+	{
+		batch = freeBatches.back();
+		freeBatches.pop_back();
+		batch->reset(getMaterial(texture));
+	} else
+	{
+		batch = new SkidmarkBatch(getMaterial(texture));
+		snode->attachObject(batch);
+	}
+	batch->setVisible(true);
+	batches[key] = batch;
+	return batch;
 }
 
-void Skidmark::addObject(Vector3 start, String texture)
+String SkidmarkManager::getMaterial(String texture)
 {
-	//LOG("new skidmark section");
-	skidmark_t skid;
-	skid.pos=0;
-	skid.lastPointAv=start;
-	skid.facecounter=0;
-	skid.face[0] = Vector3::ZERO;
-	skid.face[1] = Vector3::ZERO;
-	skid.colour = ColourValue(Math::RangeRandom(0, 100)/100.0f, Math::RangeRandom(0, 100)/100.0f, Math::RangeRandom(0, 100)/100.0f, 0.8f);
-
-
-	// new material
-	char bname[256]="";
-	sprintf(bname, "mat-skidmark-%d", instanceCounter);
-	MaterialPtr mat=(MaterialPtr)(MaterialManager::getSingleton().create(bname, ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME));
+	String name = "mat-skidmark-" + texture;
+	if (!MaterialManager::getSingleton().getByName(name).isNull())
+		return name;
+
+	MaterialPtr mat = (MaterialPtr)(MaterialManager::getSingleton().create(name, ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME));
 	Pass *p = mat->getTechnique(0)->getPass(0);
-	
+
 	p->setSceneBlending(SBT_TRANSPARENT_ALPHA);
 	p->setLightingEnabled(false);
 	p->setDepthWriteEnabled(false);
 	p->setDepthBias(3, 3);
 	p->setCullingMode(CULL_NONE);
+	if (ResourceGroupManager::getSingleton().resourceExistsInAnyGroup(texture))
+		p->createTextureUnitState(texture);
+	else
+		// without lighting the diffuse of the pass is ignored, the vertex colour has to be tinted instead
+		p->createTextureUnitState()->setColourOperationEx(LBX_MODULATE, LBS_MANUAL, LBS_DIFFUSE, ColourValue(0.1f, 0.1f, 0.1f));
+	return name;
+}
 
-	skid.points.resize(lenght);
-	skid.faceSizes.resize(lenght);
-	skid.groundTexture.resize(lenght);
-	skid.obj = scm->createManualObject("skidmark" + TOSTRING(instanceCounter++));
-	skid.obj->setDynamic(true);
-	skid.obj->setRenderingDistance(2000); //2km sight range
-	skid.obj->begin(bname, RenderOperation::OT_TRIANGLE_STRIP);
-	for(int i = 0; i < lenght; i++)
-	{
-		skid.points[i] = start;
-		skid.faceSizes[i] = 0;
-		skid.groundTexture[i] = "0.png";
-		skid.obj->position(start);
-		skid.obj->textureCoord(0,0);
-	}
-    skid.obj->end();
-	mNode->attachObject(skid.obj);
-
-
-	objects.push(skid);
-
-	limitObjects();
+void SkidmarkManager::recycle(std::map<batch_key_t, SkidmarkBatch *>::iterator it)
+{
+	it->second->setVisible(false);
+	freeBatches.push_back(it->second);
+	batches.erase(it);
 }
 
-void Skidmark::limitObjects()
+void SkidmarkManager::update(float dt)
 {
-	if((int)objects.size() > bucketCount)
+	time += dt;
+	fadeTimer += dt;
+	bool fade = (fadeTimer > SKIDMARK_FADE_INTERVAL);
+	if (fade)
+		fadeTimer = 0;
+
+	std::map<batch_key_t, SkidmarkBatch *>::iterator it = batches.begin();
+	while (it != batches.end())
 	{
-		//LOG("deleting first skidmarks section to keep the limits");
-		objects.front().points.clear();
-		objects.front().faceSizes.clear();
-		scm->destroyManualObject(objects.front().obj);
-		objects.pop();
+		SkidmarkBatch *batch = it->second;
+		if (time - batch->newest > lifetime)
+		{
+			// faded out completely
+			recycle(it++);
+			continue;
+		}
+
+		if (deviceRestored || (fade && time - batch->getOldest() > lifetime - fadeTime))
+		{
+			// some quads are fading or the buffer lost its contents, write all of them with their alpha
+			batch->upload(0, batch->used, time, lifetime, fadeTime);
+		} else
+		{
+			batch->upload(batch->dirtyFrom, batch->dirtyTo, time, lifetime, fadeTime);
+		}
+		batch->dirtyFrom = batch->dirtyTo = 0;
+		it++;
 	}
+	deviceRestored = false;
 }
 
-void Skidmark::setPointInt(unsigned short index, const Vector3 &value, Real fsize, String texture)
-{
-	objects.back().points[index] = value;
-	objects.back().faceSizes[index] = fsize;
-	objects.back().groundTexture[index] = texture;
+/////////////// Skidmark below
 
-	mDirty = true;
+Skidmark::Skidmark(wheel_t *wheel) :
+	  hasLast(false)
+	, lastPointAv(Vector3::ZERO)
+	, lastTexcoord(0)
+	, maxDistance(std::max(0.5f, wheel->width*1.1f))
+	, minDistance(0.1f)
+	, wheel(wheel)
+{
 }
 
 void Skidmark::updatePoint()
@@ -219,188 +396,51 @@ void Skidmark::updatePoint()
 	Vector3 thisPoint = wheel->lastContactType?wheel->lastContactOuter:wheel->lastContactInner;
 	Vector3 axis = wheel->lastContactType?(wheel->refnode1->RelPosition - wheel->refnode0->RelPosition):(wheel->refnode0->RelPosition - wheel->refnode1->RelPosition);
 	Vector3 thisPointAV = thisPoint + axis * 0.5f;
-	Real distance = 0;
-	Real maxDist = maxDistance;
 	String texture = "none";
 	SkidmarkManager::getSingleton().getTexture("default", wheel->lastGroundModel->name, wheel->lastSlip, texture);
 	
-	// dont add points with no texture
-	if(texture == "none") return;
-
-	if(wheel->speed > 1) maxDist *= wheel->speed;
-
-	if(!objects.size())
+	// no marks on this ground or at this slip, the trail is interrupted
+	if(texture == "none")
 	{
-		// add first bucket
-		addObject(thisPoint, texture);
-	} else
-	{
-		// check existing buckets
-		skidmark_t skid = objects.back();
-
-		distance = skid.lastPointAv.distance(thisPointAV);
-		// too near to update?
-		if(distance < minDistance)
-		{
-			//LOG("E: too near for update");
-			return;
-		}
-		
-		// change ground texture if required
-		if(skid.pos > 0 && skid.groundTexture[0] != texture)
-		{
-			// new object with new texture
-			if(distance > maxDist)
-			{
-				// to far away for connection
-				addObject(thisPoint, texture);
-			} else
-			{
-				// add new bucket with connection to last bucket
-				Vector3 lp1 = objects.back().points[objects.back().pos-1];
-				Vector3 lp2 = objects.back().points[objects.back().pos-2];
-				addObject(lp1, texture);
-				addPoint(lp2, distance, texture);
-				addPoint(lp1, distance, texture);
-			}
-		} else
-		{
-			// no texture change required :D
-
-			// far enough for new bucket?
-			if(skid.pos >= (int)skid.points.size())
-			{
-				if(distance > maxDist)
-				{
-					// to far away for connection
-					addObject(thisPoint, texture);
-				} else
-				{
-					// add new bucket with connection to last bucket
-					Vector3 lp1 = objects.back().points[objects.back().pos-1];
-					Vector3 lp2 = objects.back().points[objects.back().pos-2];
-					addObject(lp1, texture);
-					addPoint(lp2, distance, texture);
-					addPoint(lp1, distance, texture);
-				}
-			}
-			else if(distance > maxDistance)
-			{
-				// just new bucket, no connection to last bucket
-				addObject(thisPoint, texture);
-			}
-		}
+		hasLast = false;
+		return;
 	}
 
-	skidmark_t skid = objects.back();
-
-	float overaxis = 0.2f;
-	// tactics: we always choose the latest oint and then create two points
-	
-	// XXX: TO BE IMPROVED
-	//Vector3 groundNormal = Vector3::ZERO;
-	//hfinder->getNormalAt(thisPoint.x, thisPoint.y, thisPoint.z, &groundNormal);
+	Real distance = lastPointAv.distance(thisPointAV);
+	// too near to update?
+	if(hasLast && distance < minDistance)
+		return;
 
-	//LOG("ground normal: "+TOSTRING(wheel->refnode1->RelPosition.dotProduct(groundNormal)));
+	Real maxDist = maxDistance;
+	if(wheel->speed > 1) maxDist *= wheel->speed;
 
-	// choose node wheel by the latest added point
+	// two points across the contact patch, a bit wider than the wheel
+	float overaxis = 0.2f;
+	Vector3 edge[2];
 	if(!wheel->lastContactType)
 	{
-		// choose inner
-		//LOG("inner");
-		addPoint(wheel->lastContactInner - (axis * overaxis), distance, texture);
-		addPoint(wheel->lastContactInner + axis + (axis * overaxis), distance, texture);
+		edge[0] = wheel->lastContactInner - (axis * overaxis);
+		edge[1] = wheel->lastContactInner + axis + (axis * overaxis);
 	} else
 	{
-		// choose outer
-		//LOG("outer");
-		addPoint(wheel->lastContactOuter + axis + (axis * overaxis), distance, texture);
-		addPoint(wheel->lastContactOuter - (axis * overaxis), distance, texture);
+		edge[0] = wheel->lastContactOuter + axis + (axis * overaxis);
+		edge[1] = wheel->lastContactOuter - (axis * overaxis);
 	}
 
-	// save as last point (in the middle of the wheel)
-	objects.back().lastPointAv = thisPointAV;
-
-	/*
-	// debug code: adds boxes to the average point
-	SceneNode *sn = mNode->getParentSceneNode()->createChildSceneNode();
-	sn->attachObject(scm->createEntity("addPointTRACK"+TOSTRING(objects.back().lastPointAv) +TOSTRING(axis), "beam.mesh"));
-	sn->setPosition(thisPointAV);
-	sn->setScale(0.1f, 0.01f, 0.1f);
-	*/
-
-}
-
-void Skidmark::addPoint(const Vector3 &value, Real fsize, String texture)
-{
-	if(objects.back().pos >= lenght)
+	if(hasLast && distance <= maxDist)
 	{
-		//LOG("E: boundary protection hit");
-		return;
-	}
-	setPointInt(objects.back().pos, value, fsize, texture);
-	objects.back().pos++;
-}
-
-void Skidmark::update()
-{
-	if(!objects.size()) return;
-	skidmark_t skid = objects.back();
-	Vector3 vaabMin = skid.points[0];
-	Vector3 vaabMax = skid.points[0];
-	skid.obj->beginUpdate(0);
-	bool behindEnd = false;
-	Vector3 lastValid = Vector3::ZERO;
-	int to_counter=0;
-	float tcox_counter=0;
-
-	for(int i = 0; i < lenght; i++, to_counter++)
+		// the texture repeats along the trail, square at the width of the wheel
+		float texcoord = lastTexcoord + distance / std::max(minDistance, wheel->width);
+		SkidmarkManager::getSingleton().addQuad(texture, lastEdge, edge, lastTexcoord, texcoord);
+		lastTexcoord = texcoord - floor(texcoord);
+	} else
 	{
-		if(i>=skid.pos) behindEnd=true;
-
-		if(to_counter>3)
-			to_counter=0;
-
-		if(!behindEnd)
-			tcox_counter += skid.faceSizes[i] / minDistance;
-
-		while(tcox_counter>1)
-			tcox_counter--;
-
-		if(behindEnd)
-		{
-			skid.obj->position(lastValid);
-			skid.obj->textureCoord(0,0);
-		} else
-		{
-			skid.obj->position(skid.points[i]);
-
-			Vector2 tco = tex_coords[to_counter];
-			tco.x *= skid.faceSizes[i] / minDistance; // scale texture according face size
-			skid.obj->textureCoord(tco);
-
-			lastValid = skid.points[i];
-		}
-		
-		if(skid.points[i].x < vaabMin.x) vaabMin.x = skid.points[i].x;
-		if(skid.points[i].y < vaabMin.y) vaabMin.y = skid.points[i].y;
-		if(skid.points[i].z < vaabMin.z) vaabMin.z = skid.points[i].z;
-		if(skid.points[i].x > vaabMax.x) vaabMax.x = skid.points[i].x;
-		if(skid.points[i].y > vaabMax.y) vaabMax.y = skid.points[i].y;
-		if(skid.points[i].z > vaabMax.z) vaabMax.z = skid.points[i].z;
+		// to far away for a connection, start a new trail
+		lastTexcoord = 0;
 	}
-    skid.obj->end();
 
-	skid.obj->setBoundingBox(AxisAlignedBox(vaabMin, vaabMax));
-	
-	// Use infinite AAB to always stay visible
-	/*
-	// for debugging only
-	AxisAlignedBox aabInf;
-	aabInf.setInfinite();
-	skid.obj->setBoundingBox(aabInf);
-	*/
-
-	mDirty = false;
+	lastEdge[0] = edge[0];
+	lastEdge[1] = edge[1];
+	lastPointAv = thisPointAV;
+	hasLast = true;
 }
-
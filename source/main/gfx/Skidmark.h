@@ -22,17 +22,76 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "RoRPrerequisites.h"
 
+#include "DynamicRenderable.h"
 #include "Singleton.h"
 
-class SkidmarkManager : public RoRSingleton<SkidmarkManager>
+#include <OgreRenderSystem.h>
+
+// a batch is a ring of quads, the oldest quad is overwritten once it is full
+#define SKIDMARK_BATCH_QUADS    2048
+#define SKIDMARK_MAX_BATCHES    32       //!< the batch that was not used for the longest time is recycled beyond this
+#define SKIDMARK_REGION_SIZE    128.0f   //!< m, size of the terrain cells the quads are grouped in
+#define SKIDMARK_FADE_INTERVAL  0.5f     //!< s between two alpha updates of the fading batches
+
+/**
+ * Skidmark quads with the same texture in one terrain region, drawn from one dynamic vertex buffer.
+ */
+class SkidmarkBatch : public DynamicRenderable
+{
+	friend class SkidmarkManager;
+public:
+	SkidmarkBatch(Ogre::String material);
+
+protected:
+	typedef struct skidmark_quad_t
+	{
+		Ogre::Vector3 corners[4];  //!< two across the trail at its last point, two at the new point
+		float texcoords[2];        //!< along the trail at the last and at the new point
+		float born;                //!< SkidmarkManager time when the quad was added
+	} skidmark_quad_t;
+
+	std::vector<skidmark_quad_t> quads;
+	int next;                      //!< slot the next quad is written to
+	int used;                      //!< slots that were written, all of them once the ring wrapped
+	int dirtyFrom;                 //!< slots written since the last upload
+	int dirtyTo;
+	float newest;                  //!< time the last quad was added
+
+	virtual void createVertexDeclaration();
+	virtual void fillHardwareBuffers();
+
+	void reset(Ogre::String material);
+	void addQuad(const skidmark_quad_t &quad);
+	float getOldest();
+	// writes the slots [from, to) with the alpha for their age
+	void upload(int from, int to, float now, float lifetime, float fadeTime);
+};
+
+/**
+ * Keeps the skidmark textures of the ground models and draws the skidmarks of all wheels. The wheels only
+ * add quads, they are grouped into a few batches per texture and terrain region that fade out with age.
+ * The vertex buffers are dynamic, so their contents are written again after the render device was lost.
+ */
+class SkidmarkManager : public RoRSingleton<SkidmarkManager>, public Ogre::RenderSystem::Listener
 {
 public:
 
 	SkidmarkManager();
 	~SkidmarkManager();
 	
+	void init(Ogre::SceneManager *scm);
+
 	int getTexture(Ogre::String model, Ogre::String ground, float slip, Ogre::String &texture);
 
+	// adds the part of a trail between the last two points of a wheel
+	void addQuad(Ogre::String texture, const Ogre::Vector3 *from, const Ogre::Vector3 *to, float texFrom, float texTo);
+
+	// uploads the new quads, fades the old ones and recycles batches that faded out completely
+	void update(float dt);
+
+	// Ogre::RenderSystem::Listener
+	void eventOccurred(const Ogre::String &eventName, const Ogre::NameValuePairList *parameters);
+
 private:
 
 	typedef struct _skidmark_config
@@ -46,56 +105,43 @@ private:
 	int loadDefaultModels();
 	std::map <Ogre::String, std::vector<skidmark_config_t> > models;
 	int processLine(Ogre::StringVector args,  Ogre::String model);
+
+	typedef std::pair<Ogre::String, std::pair<int, int> > batch_key_t; //!< texture and region
+	Ogre::SceneManager *scm;
+	Ogre::SceneNode *snode;
+	std::map<batch_key_t, SkidmarkBatch *> batches;
+	std::vector<SkidmarkBatch *> freeBatches;
+	float time;
+	float fadeTimer;
+	float lifetime;                //!< s a quad stays on the ground
+	float fadeTime;                //!< s at the end of the lifetime it fades out
+	bool deviceRestored;           //!< the vertex buffers lost their contents, all quads are uploaded again
+
+	SkidmarkBatch *getBatch(Ogre::String texture, const Ogre::Vector3 &pos);
+	Ogre::String getMaterial(Ogre::String texture);
+	void recycle(std::map<batch_key_t, SkidmarkBatch *>::iterator it);
 };
 
+/**
+ * Trail of one wheel, remembers where the last quad ended and hands new ones to the SkidmarkManager.
+ */
 class Skidmark
 {
 public:
 
-	/// Constructor - see setOperationType() for description of argument.
-	Skidmark(Ogre::SceneManager *scm, wheel_t *wheel, HeightFinder *hfinder, Ogre::SceneNode *snode, int lenght=500, int bucketCount=20);
-	virtual ~Skidmark();
+	Skidmark(wheel_t *wheel);
 
 	void updatePoint();
 
-	void update();
-
 private:
 
-	static int instanceCounter;
-
-	typedef struct _skidmark
-	{
-		Ogre::ManualObject *obj;
-		std::vector<Ogre::Vector3> points;
-		std::vector<Ogre::Real> faceSizes;
-		std::vector<Ogre::String> groundTexture;
-		Ogre::Vector3 lastPointAv;
-		int pos;
-		Ogre::ColourValue colour;
-		Ogre::Vector3 face[2];
-		int facecounter;
-	} skidmark_t;
-
-	Ogre::SceneManager *scm;
-	Ogre::SceneNode *mNode;
-	HeightFinder *hfinder;
-	
-	bool mDirty;
+	wheel_t *wheel;
+	bool hasLast;                  //!< false if the trail was interrupted
+	Ogre::Vector3 lastPointAv;     //!< middle of the wheel at the last point
+	Ogre::Vector3 lastEdge[2];
+	float lastTexcoord;
 	float maxDistance;
-	float maxDistanceSquared;
 	float minDistance;
-	float minDistanceSquared;
-	int bucketCount;
-	int lenght;
-	static Ogre::Vector2 tex_coords[4];
-	std::queue<skidmark_t> objects;
-	wheel_t *wheel;
-	
-	void limitObjects();
-	void addObject(Ogre::Vector3 start, Ogre::String texture);
-	void setPointInt(unsigned short index, const Ogre::Vector3 &value, Ogre::Real fsize, Ogre::String texture);
-	void addPoint(const Ogre::Vector3 &value, Ogre::Real fsize, Ogre::String texture);
 };
 
 #endif // __SkidMark_H_
@@ -256,26 +256,26 @@ VideoCamera *VideoCamera::parseLine(Ogre::SceneManager *mSceneMgr, Ogre::Camera
 		char materialname[256] = {};
 		char vidCamName[256] = {};
 		
-		Ogre::StringVector args;
+		std::vector<ParserArg> args;
 		int n = truck->parse_args(c, args, 19);
 		nref    = truck->parse_node_number(c, args[0]);
 		nz      = truck->parse_node_number(c, args[1]);
 		ny      = truck->parse_node_number(c, args[2]);
-		ncam    = PARSEINT(args[3]);
-		lookto  = PARSEINT(args[4]);
-		offx    = PARSEREAL(args[5]);
-		offy    = PARSEREAL(args[6]);
-		offz    = PARSEREAL(args[7]);
-		rotx    = PARSEREAL(args[8]);
-		roty    = PARSEREAL(args[9]);
-		rotz    = PARSEREAL(args[10]);
-		fov     = PARSEREAL(args[11]);
-		texx    = PARSEINT (args[12]);
-		texy    = PARSEINT (args[13]);
-		minclip = PARSEREAL(args[14]);
-		maxclip = PARSEREAL(args[15]);
-		crole   = PARSEINT (args[16]);
-		cmode   = PARSEINT (args[17]);
+		ncam    = args[3].parseInt();
+		lookto  = args[4].parseInt();
+		offx    = args[5].parseReal();
+		offy    = args[6].parseReal();
+		offz    = args[7].parseReal();
+		rotx    = args[8].parseReal();
+		roty    = args[9].parseReal();
+		rotz    = args[10].parseReal();
+		fov     = args[11].parseReal();
+		texx    = args[12].parseInt();
+		texy    = args[13].parseInt();
+		minclip = args[14].parseReal();
+		maxclip = args[15].parseReal();
+		crole   = args[16].parseInt();
+		cmode   = args[17].parseInt();
 		strncpy(materialname, args[18].c_str(), 255);
 		materialname[255] = '\0';
 		if(n > 19)
@@ -30,7 +30,9 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 #include "heightfinder.h"
 #include "HighScoreWindow.h"
 #include "language.h"
+#include "gui_mp.h"
 #include "network.h"
+#include "NetworkStreamManager.h"
 #include "OverlayWrapper.h"
 #include "RoRFrameListener.h"
 #include "Scripting.h"
@@ -45,7 +47,7 @@ using namespace Ogre;
 
 // the delimiters that decide where a word is finished
 const UTFString Console::wordDelimiters = " \\\"\'|.,`!;<>~{}()+&%$@";
-const char *builtInCommands[] = {"/help", "/log", "/pos", "/goto", "/terrainheight", "/ver", "/save", "/whisper", "/as", NULL};
+const char *builtInCommands[] = {"/help", "/log", "/pos", "/goto", "/terrainheight", "/ver", "/save", "/whisper", "/as", "/netstats", NULL};
 
 // class
 Console::Console() : net(0), netChat(0), top_border(20), bottom_border(100), message_counter(0), mHistory(), mHistoryPosition(0), inputMode(false), linesChanged(false), scrollOffset(0), autoCompleteIndex(-1), linecount(10), scroll_size(5), angelscriptMode(false)
@@ -514,7 +516,10 @@ void Console::eventCommandAccept(MyGUI::Edit* _sender)
 			putMessage(CONSOLE_MSGTYPE_INFO, CONSOLE_HELP, _L("#dd0000/save#000000 - saves the chat history to a file"), "table_save.png");
 			putMessage(CONSOLE_MSGTYPE_INFO, CONSOLE_HELP, _L("#dd0000/log#000000  - toggles log output on the console"), "table_save.png");
 			if(net)
+			{
 				putMessage(CONSOLE_MSGTYPE_INFO, CONSOLE_HELP, _L("#dd0000/whisper <username> <message>#000000 - send someone a private message"), "script_key.png");
+				putMessage(CONSOLE_MSGTYPE_INFO, CONSOLE_HELP, _L("#dd0000/netstats [uid|show|dump <seconds>]#000000 - network statistics per user and stream"), "information.png");
+			}
 	#ifdef USE_ANGELSCRIPT
 			putMessage(CONSOLE_MSGTYPE_INFO, CONSOLE_HELP, _L("#dd0000/as#000000 - toggle AngelScript Mode: no need to put the backslash before script commands"), "script_go.png");
 	#endif // USE_ANGELSCRIPT
@@ -581,6 +586,42 @@ void Console::eventCommandAccept(MyGUI::Edit* _sender)
 			netChat->sendPrivateChat(args[1], args[2]);
 			return;
 
+		} else if(msg.substr(0, 9) == "/netstats")
+		{
+#ifdef USE_SOCKETW
+			if(!net)
+			{
+				putMessage(CONSOLE_MSGTYPE_INFO, CONSOLE_SYSTEM_NOTICE, ChatSystem::commandColour + _L("not connected to a server"), "information.png");
+				return;
+			}
+			StringVector args = StringUtil::split(msg, " ");
+			if(args.size() == 2 && args[1] == "show")
+			{
+#ifdef USE_MYGUI
+				GUI_Multiplayer::getSingleton().setNetStatsVisible(!GUI_Multiplayer::getSingleton().getNetStatsVisible());
+#endif // USE_MYGUI
+				return;
+			} else if(args.size() == 3 && args[1] == "dump")
+			{
+				int interval = std::max(0, StringConverter::parseInt(args[2]));
+				NetworkStreamManager::getSingleton().setStatsDumpInterval(interval);
+				if(interval > 0)
+					putMessage(CONSOLE_MSGTYPE_INFO, CONSOLE_SYSTEM_REPLY, ChatSystem::commandColour + _L("writing network stats to netstats.csv every ") + TOSTRING(interval) + _L(" seconds"), "information.png");
+				else
+					putMessage(CONSOLE_MSGTYPE_INFO, CONSOLE_SYSTEM_REPLY, ChatSystem::commandColour + _L("network stats dump disabled"), "information.png");
+				return;
+			}
+
+			int sourceid = -1;
+			if(args.size() == 2)
+				sourceid = StringConverter::parseInt(args[1]);
+
+			StringVector lines = StringUtil::split(NetworkStreamManager::getSingleton().getStatsText(sourceid), "\n");
+			for(unsigned int i=0; i<lines.size(); i++)
+				putMessage(CONSOLE_MSGTYPE_INFO, CONSOLE_SYSTEM_REPLY, lines[i], "information.png");
+#endif // USE_SOCKETW
+			return;
+
 		} else if(msg == "/as")
 		{
 			angelscriptMode = !angelscriptMode;
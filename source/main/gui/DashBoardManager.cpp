@@ -31,7 +31,7 @@ using namespace Ogre;
 
 #define INITDATA(key, type, name) data[key] = dashData_t(type, name)
 
-DashBoardManager::DashBoardManager(void) : visible(true), free_dashboard(0)
+DashBoardManager::DashBoardManager(void) : visible(true), free_dashboard(0), widgetUpdates(0)
 {
 	// clear some things
 	memset(&dashboards, 0, sizeof(dashboards));
@@ -156,13 +156,24 @@ int DashBoardManager::loadDashBoard( Ogre::String filename, bool textureLayer )
 
 void DashBoardManager::update(float &dt)
 {
-	// TODO: improve logic: only update visible dashboards
+	// hidden dashboards are skipped, they write all widgets once they are shown again
+	widgetUpdates = 0;
 	for(int i=0; i < free_dashboard; i++)
 	{
-		dashboards[i]->update(dt);
+		widgetUpdates += dashboards[i]->update(dt);
 	}
 }
 
+int DashBoardManager::getControlCount()
+{
+	int count = 0;
+	for(int i=0; i < free_dashboard; i++)
+	{
+		count += dashboards[i]->getControlCount();
+	}
+	return count;
+}
+
 void DashBoardManager::updateFeatures()
 {
 	for(int i=0; i < free_dashboard; i++)
@@ -214,7 +225,7 @@ void DashBoardManager::windowResized()
 
 // DASHBOARD class below
 
-DashBoard::DashBoard(DashBoardManager *manager, Ogre::String filename, bool _textureLayer) : manager(manager), filename(filename), free_controls(0), visible(false), mainWidget(nullptr), textureLayer(_textureLayer)
+DashBoard::DashBoard(DashBoardManager *manager, Ogre::String filename, bool _textureLayer) : manager(manager), filename(filename), free_controls(0), visible(false), forceUpdate(true), mainWidget(nullptr), textureLayer(_textureLayer)
 {
 	// use 'this' class pointer to make layout unique
 	prefix = MyGUI::utility::toString(this, "_");
@@ -240,11 +251,22 @@ void DashBoard::updateFeatures()
 	}
 }
 
-void DashBoard::update( float &dt )
+int DashBoard::update( float &dt )
 {
-	// walk all controls and animate them
+	if(mainWidget && !visible) return 0;
+
+	// walk all controls and animate them, widgets are only touched if what they show changed
+	int updated = 0;
 	for(int i = 0; i < free_controls; i++)
 	{
+		// throttled controls
+		if(controls[i].interval > 0 && !forceUpdate)
+		{
+			controls[i].timer += dt;
+			if(controls[i].timer < controls[i].interval) continue;
+			controls[i].timer = 0;
+		}
+
 		// get its value from its linkage
 		if(controls[i].animationType == ANIM_ROTATE)
 		{
@@ -253,12 +275,13 @@ void DashBoard::update( float &dt )
 			// calculate the angle
 			float angle = (val - controls[i].vmin) * (controls[i].wmax - controls[i].wmin) / (controls[i].vmax - controls[i].vmin) + controls[i].wmin;
 
-			if(fabs(val - controls[i].last) < 0.2f) continue;
-			controls[i].last = val;
-
 			// enforce limits
 			if     (angle < controls[i].wmin) angle = controls[i].wmin;
 			else if(angle > controls[i].wmax) angle = controls[i].wmax;
+
+			if(fabs(angle - controls[i].last) < controls[i].epsilon && !forceUpdate) continue;
+			controls[i].last = angle;
+
 			// rotate finally
 			controls[i].rotImg->setAngle(Ogre::Degree(angle).valueRadians());
 		}
@@ -280,7 +303,7 @@ void DashBoard::update( float &dt )
 				state = (manager->getNumeric(controls[i].linkID) > 0);
 			}
 
-			if(state == controls[i].lastState) continue;
+			if(state == controls[i].lastState && !forceUpdate) continue;
 			controls[i].lastState = state;
 
 			// switch states
@@ -293,23 +316,22 @@ void DashBoard::update( float &dt )
 			}
 		} else if(controls[i].animationType == ANIM_SERIES)
 		{
-			float val = manager->getNumeric(controls[i].linkID);
+			// one image per integer value
+			float val = (float)(int)manager->getNumeric(controls[i].linkID);
 
-			String fn = String(controls[i].texture) + String("-") + TOSTRING((int)val) + String(".png");
-
-			if(fabs(val - controls[i].last) < 0.2f) continue;
+			if(val == controls[i].last && !forceUpdate) continue;
 			controls[i].last = val;
 
-			controls[i].img->setImageTexture(fn);
+			controls[i].img->setImageTexture(String(controls[i].texture) + String("-") + TOSTRING((int)val) + String(".png"));
 		}
 		else if(controls[i].animationType == ANIM_SCALE)
 		{
 			float val = manager->getNumeric(controls[i].linkID);
+			float scale = (val - controls[i].vmin) * (controls[i].wmax - controls[i].wmin) / (controls[i].vmax - controls[i].vmin) + controls[i].wmin;
 
-			if(fabs(val - controls[i].last) < 0.2f) continue;
-			controls[i].last = val;
+			if(fabs(scale - controls[i].last) < controls[i].epsilon && !forceUpdate) continue;
+			controls[i].last = scale;
 
-			float scale = (val - controls[i].vmin) * (controls[i].wmax - controls[i].wmin) / (controls[i].vmax - controls[i].vmin) + controls[i].wmin;
 			if(controls[i].direction == DIRECTION_UP)
 			{
 				controls[i].widget->setPosition(controls[i].initialPosition.left, controls[i].initialPosition.top - scale);
@@ -331,11 +353,11 @@ void DashBoard::update( float &dt )
 		} else if(controls[i].animationType == ANIM_TRANSLATE)
 		{
 			float val = manager->getNumeric(controls[i].linkID);
+			float translation = (val - controls[i].vmin) * (controls[i].wmax - controls[i].wmin) / (controls[i].vmax - controls[i].vmin) + controls[i].wmin;
 
-			if(fabs(val - controls[i].last) < 0.2f) continue;
-			controls[i].last = val;
+			if(fabs(translation - controls[i].last) < controls[i].epsilon && !forceUpdate) continue;
+			controls[i].last = translation;
 
-			float translation = (val - controls[i].vmin) * (controls[i].wmax - controls[i].wmin) / (controls[i].vmax - controls[i].vmin) + controls[i].wmin;
 			if(controls[i].direction == DIRECTION_UP)
 				controls[i].widget->setPosition(controls[i].initialPosition.left, controls[i].initialPosition.top - translation);
 			else if(controls[i].direction == DIRECTION_DOWN)
@@ -349,28 +371,36 @@ void DashBoard::update( float &dt )
 		{
 			float val = manager->getNumeric(controls[i].linkID);
 
-			if(fabs(val - controls[i].last) < 0.2f) continue;
+			if(fabs(val - controls[i].last) < controls[i].epsilon && !forceUpdate) continue;
 			controls[i].last = val;
 
-			MyGUI::UString s;
+			char tmp[1024] = "";
 			if(strlen(controls[i].format) == 0)
-			{
-				s = Ogre::StringConverter::toString(val);
-			} else
-			{
-				char tmp[1024] = "";
+				strncpy(tmp, Ogre::StringConverter::toString(val).c_str(), 254);
+			else
 				sprintf(tmp, controls[i].format, val);
-				s = MyGUI::UString(tmp);
-			}
 
-			controls[i].txt->setCaption(s);
+			// most values change in digits that are not shown
+			if(!strncmp(tmp, controls[i].lastText, 254) && !forceUpdate) continue;
+			strncpy(controls[i].lastText, tmp, 254);
+
+			controls[i].txt->setCaption(MyGUI::UString(tmp));
 		}
 		else if(controls[i].animationType == ANIM_TEXTSTRING)
 		{
 			char *val = manager->getChar(controls[i].linkID);
+
+			if(!strncmp(val, controls[i].lastText, 254) && !forceUpdate) continue;
+			strncpy(controls[i].lastText, val, 254);
+
 			controls[i].txt->setCaption(MyGUI::UString(val));
-		}		
+		}
+		else continue;
+
+		updated++;
 	}
+	forceUpdate = false;
+	return updated;
 }
 
 void DashBoard::windowResized()
@@ -439,6 +469,25 @@ void DashBoard::loadLayoutRecursive(MyGUI::WidgetPtr w)
 		ctrl.initialPosition = w->getPosition();
 		ctrl.last            = 1337.1337f; // force update
 		ctrl.lastState       = true;
+
+		// change detection and throttling
+		String epsilon = w->getUserString("epsilon");
+		if(!epsilon.empty())
+			ctrl.epsilon = StringConverter::parseReal(epsilon);
+		else if(anim == "rotate")
+			ctrl.epsilon = 0.25f; // degrees
+		else if(anim == "scale" || anim == "translate")
+			ctrl.epsilon = 0.5f;  // pixels
+		else
+			ctrl.epsilon = 0.0f;  // texts compare the formatted string
+
+		String rate = w->getUserString("rate");
+		if(!rate.empty())
+			ctrl.interval = (StringConverter::parseReal(rate) > 0) ? 1.0f / StringConverter::parseReal(rate) : 0.0f;
+		else if(anim == "textformat" || anim == "textstring")
+			ctrl.interval = 1.0f / DASH_TEXT_RATE;
+		else
+			ctrl.interval = 0.0f;
 		
 		// establish the link
 		{
@@ -684,6 +733,9 @@ void DashBoard::loadLayout( Ogre::String filename )
 void DashBoard::setVisible(bool v, bool smooth)
 {
 	if(!mainWidget) return;
+	// the widgets were not updated while the dashboard was hidden
+	if(v && !visible)
+		forceUpdate = true;
 	visible = v;
 
 	/*
@@ -37,6 +37,8 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 
 #define MAX_CONTROLS      1024
 
+#define DASH_TEXT_RATE    20.0f  // updates per second of text controls without a rate attribute
+
 typedef union dataContainer_t
 {
 	bool  value_bool;
@@ -203,11 +205,16 @@ public:
 	void setVisible3d(bool visibility);
 	bool getVisible() { return visible; };
 	void windowResized();
+
+	// widgets that were changed in the last update and all animated widgets
+	int getWidgetUpdates() { return widgetUpdates; };
+	int getControlCount();
 protected:
 	bool visible;
 	dashData_t data[DD_MAX];
 	DashBoard *dashboards[MAX_DASH];
 	int free_dashboard;
+	int widgetUpdates;
 };
 
 class DashBoard
@@ -222,9 +229,12 @@ public:
 
 	bool getIsTextureLayer() { return textureLayer; }
 
-	void update(float &dt);
+	// returns the number of widgets that were changed
+	int update(float &dt);
 	void updateFeatures();
 
+	int getControlCount() { return free_controls; };
+
 	void windowResized();
 
 protected:
@@ -233,6 +243,7 @@ protected:
 	MyGUI::VectorWidgetPtr widgets;
 	MyGUI::WindowPtr mainWidget;
 	bool visible, textureLayer;
+	bool forceUpdate; // write all widgets with the next update, they were hidden or just loaded
 	std::string prefix;
 
 	enum {ANIM_NONE,      ANIM_ROTATE, ANIM_SCALE, ANIM_TEXTFORMAT, ANIM_TEXTSTRING, ANIM_LAMP, ANIM_SERIES, ANIM_TRANSLATE, ANIM_TEXTCOLOR };
@@ -264,8 +275,13 @@ protected:
 		MyGUI::IntPoint initialPosition;
 
 
-		float last;
+		float epsilon; // smallest change of the widget (degrees, pixels) that is written, attribute "epsilon"
+		float interval; // seconds between two updates, 0 for every frame, attribute "rate" in updates per second
+		float timer;
+
+		float last; // last value written to the widget, for texts the linked value
 		bool lastState;
+		char lastText[255];
 	} layoutLink_t;
 
 	void loadLayout(Ogre::String filename );
@@ -19,8 +19,8 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include "MapTextureCreator.h"
 
-#include "BeamFactory.h"
 #include "IWater.h"
+#include "LabelRenderer.h"
 #include "MapControl.h"
 #include "ResourceBuffer.h"
 
@@ -135,17 +135,9 @@ String MapTextureCreator::getRTName()
 
 void MapTextureCreator::preRenderTargetUpdate()
 {
-	Beam **trucks = BeamFactory::getSingleton().getTrucks();
-
-	float f = 20.0f + 30.0f * mMapZoom;
-
-	for (int i=0; i < BeamFactory::getSingleton().getTruckCount(); i++)
-	{
-		if ( trucks[i] )
-		{
-			trucks[i]->preMapLabelRenderUpdate(true, f);
-		}
-	}
+	// the labels face the main camera, they are not drawn on the map
+	if (LabelRenderer::singletonExists())
+		LabelRenderer::getSingleton().setAllVisible(false);
 
 	if ( mStatics )
 	{
@@ -155,15 +147,8 @@ void MapTextureCreator::preRenderTargetUpdate()
 
 void MapTextureCreator::postRenderTargetUpdate()
 {
-	Beam **trucks = BeamFactory::getSingleton().getTrucks();
-
-	for (int i=0; i < BeamFactory::getSingleton().getTruckCount(); i++)
-	{
-		if ( trucks[i] )
-		{
-			trucks[i]->preMapLabelRenderUpdate(false);
-		}
-	}
+	if (LabelRenderer::singletonExists())
+		LabelRenderer::getSingleton().setAllVisible(true);
 
 	if ( mStatics )
 	{
@@ -25,6 +25,7 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 #include "BeamFactory.h"
 #include "DashBoardManager.h"
 #include "errorutils.h"
+#include "LabelRenderer.h"
 #include "language.h"
 #include "OgreFontManager.h"
 #include "RoRVersion.h"
@@ -610,6 +611,27 @@ void OverlayWrapper::updateStats(bool detailed)
 			memoryText = memoryText + _L("Materials: ") + formatBytes(MaterialManager::getSingleton().getMemoryUsage()) + U(" / ") + formatBytes(MaterialManager::getSingleton().getMemoryBudget()) + U("\n");
 		memoryText = memoryText + U("\n");
 
+		// flexbody deformation in the last frame, see BeamFactory::updateVisual
+		BeamFactory *bf = BeamFactory::getSingletonPtr();
+		if (bf)
+		{
+			const BeamFactory::visual_stats_t &vs = bf->getVisualStats();
+			memoryText = memoryText + _L("Skinned vertices: ") + TOUTFSTRING(vs.skinned) + U(" / ") + TOUTFSTRING(vs.vertices) + U("\n");
+			memoryText = memoryText + _L("Trucks culled: ") + TOUTFSTRING(vs.culled) + U(", reduced rate: ") + TOUTFSTRING(vs.reduced) + U(" / ") + TOUTFSTRING(vs.trucks) + U("\n");
+		}
+
+		// glyphs of the name labels written in the last update, see LabelRenderer::update
+		LabelRenderer *lr = LabelRenderer::getSingletonPtrNoCreation();
+		if (lr)
+			memoryText = memoryText + _L("Label glyphs drawn: ") + TOUTFSTRING(lr->getDrawnGlyphs()) + U("\n");
+
+#ifdef USE_MYGUI
+		// dashboard widgets of the current truck that were changed in its last update
+		Beam *curr_truck = bf ? bf->getCurrentTruck() : 0;
+		if (curr_truck && curr_truck->dash && curr_truck->dash->wasLoaded())
+			memoryText = memoryText + _L("Dashboard widgets updated: ") + TOUTFSTRING(curr_truck->dash->getWidgetUpdates()) + U(" / ") + TOUTFSTRING(curr_truck->dash->getControlCount()) + U("\n");
+#endif // USE_MYGUI
+
 		OverlayElement* memoryDbg = OverlayManager::getSingleton().getOverlayElement("Core/MemoryText");
 		memoryDbg->setCaption(memoryText);
 
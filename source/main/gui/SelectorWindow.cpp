@@ -67,7 +67,8 @@ _L("Hidden");
 using namespace Ogre;
 
 SelectorWindow::SelectorWindow() :
-	  mSelectedTruck(0)
+	  mLastSearchExact(false)
+	, mSelectedTruck(0)
 	, mSelectedSkin(0)
 	, visibleCounter(0)
 {
@@ -271,6 +272,27 @@ void SelectorWindow::eventComboAcceptConfigComboBox(MyGUI::ComboBoxPtr _sender,
 	}
 }
 
+void SelectorWindow::getExtensions(std::vector<String> &fexts)
+{
+	fexts.clear();
+	if(mLoaderType == LT_Terrain)
+		fexts.push_back("terrn");
+	if(mLoaderType == LT_AllBeam || mLoaderType == LT_Vehicle || mLoaderType == LT_Truck	|| mLoaderType == LT_Network	|| mLoaderType == LT_NetworkWithBoat)
+		fexts.push_back("truck");
+	if(mLoaderType == LT_AllBeam || mLoaderType == LT_Vehicle || mLoaderType == LT_Car		|| mLoaderType == LT_Network	|| mLoaderType == LT_NetworkWithBoat)
+		fexts.push_back("car");
+	if(mLoaderType == LT_AllBeam || mLoaderType == LT_Boat																	|| mLoaderType == LT_NetworkWithBoat)
+		fexts.push_back("boat");
+	if(mLoaderType == LT_AllBeam || mLoaderType == LT_Airplane								|| mLoaderType == LT_Network	|| mLoaderType == LT_NetworkWithBoat)
+		fexts.push_back("airplane");
+	if(mLoaderType == LT_AllBeam || mLoaderType == LT_Trailer	|| mLoaderType == LT_Extension)
+		fexts.push_back("trailer");
+	if(mLoaderType == LT_AllBeam || mLoaderType == LT_Train)
+		fexts.push_back("train");
+	if(mLoaderType == LT_AllBeam || mLoaderType == LT_Load		|| mLoaderType == LT_Extension)
+		fexts.push_back("load");
+}
+
 void SelectorWindow::getData()
 {
 	std::map<int, int> mCategoryUsage;
@@ -303,55 +325,15 @@ void SelectorWindow::getData()
 		mCancelButton->setEnabled(true);
 	}
 
-	int ts = getTimeStamp();
-	std::vector<Cache_Entry> *entries = CACHE.getEntries();
-	for(std::vector<Cache_Entry>::iterator it = entries->begin(); it!=entries->end(); it++)
-	{
-		// category hidden
-		if(it->categoryid == CacheSystem::CID_Unsorted)
-			continue;
-
-		//printf("category: %d\n", it->categoryid);
-		bool add = false;
-		if(it->fext=="terrn")
-			add = (mLoaderType == LT_Terrain);
-		else if(it->fext=="truck")
-			add = (mLoaderType == LT_AllBeam || mLoaderType == LT_Vehicle || mLoaderType == LT_Truck	|| mLoaderType == LT_Network	|| mLoaderType == LT_NetworkWithBoat);
-		else if(it->fext=="car")
-			add = (mLoaderType == LT_AllBeam || mLoaderType == LT_Vehicle || mLoaderType == LT_Car		|| mLoaderType == LT_Network	|| mLoaderType == LT_NetworkWithBoat);
-		else if(it->fext=="boat")
-			add = (mLoaderType == LT_AllBeam || mLoaderType == LT_Boat																	|| mLoaderType == LT_NetworkWithBoat);
-		else if(it->fext=="airplane")
-			add = (mLoaderType == LT_AllBeam || mLoaderType == LT_Airplane								|| mLoaderType == LT_Network	|| mLoaderType == LT_NetworkWithBoat);
-		else if(it->fext=="trailer")
-			add = (mLoaderType == LT_AllBeam || mLoaderType == LT_Trailer	|| mLoaderType == LT_Extension);
-		else if(it->fext=="train")
-			add = (mLoaderType == LT_AllBeam || mLoaderType == LT_Train);
-		else if(it->fext=="load")
-			add = (mLoaderType == LT_AllBeam || mLoaderType == LT_Load		|| mLoaderType == LT_Extension);
-
-		if(!add)
-			continue;
-
-		// remove invalid category ID's
-		if(it->categoryid >= CacheSystem::CID_Max)
-			it->categoryid = -1;
-
-		// category unsorted
-		if(it->categoryid == -1)
-			it->categoryid = CacheSystem::CID_Unsorted;
-
-		mCategoryUsage[it->categoryid]++;
-
-		// category all
-		mCategoryUsage[CacheSystem::CID_All]++;
-
-		// category fresh
-		if(ts - it->addtimestamp < CACHE_FILE_FRESHNESS)
-			mCategoryUsage[CacheSystem::CID_Fresh]++;
-
-		mEntries.push_back(*it);
-	}
+	// the index knows the category usage already, no need to go through all entries
+	SearchIndex *index = CACHE.getSearchIndex();
+	std::vector<String> fexts;
+	getExtensions(fexts);
+	index->getEntries(fexts, mEntries);
+	index->getCategoryUsage(fexts, mCategoryUsage);
+	mLastSearch = "";
+	mSearchResults.clear();
+
 	int tally_categories = 0, current_category = 0;
 	std::map<int, Category_Entry> *cats = CACHE.getCategories();
 	for(std::map<int, Category_Entry>::iterator itc = cats->begin(); itc!=cats->end(); itc++)
@@ -387,103 +369,6 @@ void SelectorWindow::getData()
 	}
 }
 
-bool SelectorWindow::searchCompare(String searchString, Cache_Entry *ce)
-{
-	if(searchString.find(":") == String::npos)
-	{
-		// normal search
-
-		// the name
-		String dname_lower = ce->dname;
-		StringUtil::toLowerCase(dname_lower);
-		if(dname_lower.find(searchString) != String::npos)
-			return true;
-		
-		// the filename
-		String fname_lower = ce->fname;
-		StringUtil::toLowerCase(fname_lower);
-		if(fname_lower.find(searchString) != String::npos)
-			return true;
-
-		// the description
-		String desc = ce->description;
-		StringUtil::toLowerCase(desc);
-		if(desc.find(searchString) != String::npos)
-			return true;
-
-		// the authors
-		if(!ce->authors.empty())
-		{
-			std::vector<authorinfo_t>::const_iterator it;
-			for(it = ce->authors.begin(); it != ce->authors.end(); it++)
-			{
-				// author name
-				String aname = it->name;
-				StringUtil::toLowerCase(aname);
-				if(aname.find(searchString) != String::npos)
-					return true;
-
-				// author email
-				String aemail = it->email;
-				StringUtil::toLowerCase(aemail);
-				if(aemail.find(searchString) != String::npos)
-					return true;
-			}
-		}
-		return false;
-	} else
-	{
-		StringVector v = StringUtil::split(searchString, ":");
-		if(v.size() < 2) return false; //invalid syntax
-
-		if(v[0] == "hash")
-		{
-			String hash = ce->hash;
-			StringUtil::toLowerCase(hash);
-			return (hash.find(v[1]) != String::npos);
-		} else if(v[0] == "guid")
-		{
-			String guid = ce->guid;
-			StringUtil::toLowerCase(guid);
-			return (guid.find(v[1]) != String::npos);
-		} else if(v[0] == "author")
-		{
-			// the authors
-			if(!ce->authors.empty())
-			{
-				std::vector<authorinfo_t>::const_iterator it;
-				for(it = ce->authors.begin(); it != ce->authors.end(); it++)
-				{
-					// author name
-					String aname = it->name;
-					StringUtil::toLowerCase(aname);
-					if(aname.find(v[1]) != String::npos)
-						return true;
-
-					// author email
-					String aemail = it->email;
-					StringUtil::toLowerCase(aemail);
-					if(aemail.find(v[1]) != String::npos)
-						return true;
-				}
-			}
-			return false;
-		} else if(v[0] == "wheels")
-		{
-			String wheelsStr = TOUTFSTRING(ce->wheelcount) + "x" + TOUTFSTRING(ce->propwheelcount);
-			return (wheelsStr == v[1]);
-		} else if(v[0] == "file")
-		{
-			String fn = ce->fname;
-			StringUtil::toLowerCase(fn);
-			return (fn.find(v[1]) != String::npos);
-		}
-
-		
-	}
-	return false;
-}
-
 void SelectorWindow::onCategorySelected(int categoryID)
 {
 	if(mLoaderType == LT_SKIN) return;
@@ -492,24 +377,39 @@ void SelectorWindow::onCategorySelected(int categoryID)
 	StringUtil::toLowerCase(search_cmd);
 
 	int counter = 0;
-	int ts      = getTimeStamp();
+	SearchIndex *index = CACHE.getSearchIndex();
+	std::vector<Cache_Entry> *entries = CACHE.getEntries();
 
 	mModelList->removeAllItems();
-	
-	for(std::vector<Cache_Entry>::iterator it = mEntries.begin(); it != mEntries.end(); it++)
+
+	const std::vector<int> *ids = &mEntries;
+	if(categoryID == CacheSystem::CID_SearchResults)
+	{
+		// typing mostly appends to the query, then only the last results have to be searched again
+		bool narrow = mLastSearchExact && !mLastSearch.empty() && search_cmd.size() >= mLastSearch.size() && search_cmd.compare(0, mLastSearch.size(), mLastSearch) == 0;
+		std::vector<int> candidates;
+		if(narrow)
+			candidates.swap(mSearchResults);
+		mLastSearchExact = index->search(search_cmd, narrow ? candidates : mEntries, mSearchResults);
+		mLastSearch = search_cmd;
+		ids = &mSearchResults;
+	}
+
+	for(std::vector<int>::const_iterator it = ids->begin(); it != ids->end(); it++)
 	{
-		if(it->categoryid == categoryID || categoryID == CacheSystem::CID_All
-										|| categoryID == CacheSystem::CID_Fresh && (ts - it->addtimestamp < CACHE_FILE_FRESHNESS)
-										|| categoryID == CacheSystem::CID_SearchResults && searchCompare(search_cmd, &(*it)))
+		const search_entry_t &doc = index->getEntry(*it);
+		if(categoryID == CacheSystem::CID_SearchResults || doc.categoryid == categoryID || categoryID == CacheSystem::CID_All
+										|| categoryID == CacheSystem::CID_Fresh && doc.fresh)
 		{
+			Cache_Entry &entry = (*entries)[*it];
 			counter++;
-			String txt = TOSTRING(counter)+". " + it->dname;
+			String txt = TOSTRING(counter)+". " + entry.dname;
 			try
 			{
-				mModelList->addItem(txt, it->number);
+				mModelList->addItem(txt, entry.number);
 			} catch(...)
 			{
-				mModelList->addItem("ENCODING ERROR", it->number);
+				mModelList->addItem("ENCODING ERROR", entry.number);
 			}
 		}
 	}
@@ -63,10 +63,10 @@ private:
 
 	// other functions
 	void getData();
+	void getExtensions(std::vector<Ogre::String> &fexts);
 	void onCategorySelected(int categoryID);
 	void onEntrySelected(int entryID);
 	void selectionDone();
-	bool searchCompare(Ogre::String searchString, Cache_Entry *ce);
 
 	void updateControls(Cache_Entry *entry);
 	void setPreviewImage(Ogre::String texture);
@@ -78,7 +78,10 @@ private:
 	Skin *mSelectedSkin;
 	bool mSelectionDone;
 	int visibleCounter;
-	std::vector<Cache_Entry> mEntries;
+	std::vector<int> mEntries;              //!< ids in CacheSystem::getSearchIndex() of the shown type
+	std::vector<int> mSearchResults;
+	Ogre::String mLastSearch;
+	bool mLastSearchExact;
 	std::vector<Ogre::String> mTruckConfigs;
 	std::vector<Skin *> mCurrentSkins;
 
@@ -24,6 +24,7 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 #include "gui_mp.h"
 
 #include "BeamFactory.h"
+#include "NetworkStreamManager.h"
 #include "PlayerColours.h"
 #include "RoRFrameListener.h"
 #include "gui_manager.h"
@@ -38,6 +39,7 @@ GUI_Multiplayer::GUI_Multiplayer(Network *_net, Camera *cam) :
 	, clients(0)
 	, lineheight(16)
 	, msgwin(0)
+	, netstatsTime(0)
 {
 	setSingleton(this);
 	
@@ -75,6 +77,17 @@ GUI_Multiplayer::GUI_Multiplayer(Network *_net, Camera *cam) :
 	netmsgtext->setFontHeight(lineheight);
 	netmsgwin->setVisible(false);
 
+	// network statistics, toggled with /netstats show
+	netstatswin = MyGUI::Gui::getInstance().createWidget<MyGUI::Window>("WindowCSX", 5, 80, 700, 300,  MyGUI::Align::Default, "Overlapped");
+	netstatswin->setCaption(_L("Network Statistics"));
+	netstatswin->setAlpha(0.8f);
+	netstatstext = netstatswin->createWidget<MyGUI::Edit>("EditStretch", 0, 0, 700, 300,  MyGUI::Align::Stretch, "helptext");
+	netstatstext->setCaption("");
+	netstatstext->setFontName("VeraMono");
+	netstatstext->setEditStatic(true);
+	netstatstext->setEditMultiLine(true);
+	netstatswin->setVisible(false);
+
 
 	// now the main GUI
 	MyGUI::IntSize gui_area = MyGUI::RenderManager::getInstance().getViewSize();
@@ -415,5 +428,29 @@ bool GUI_Multiplayer::getVisible()
 	return mpPanel->getVisible();
 }
 
+void GUI_Multiplayer::setNetStatsVisible(bool value)
+{
+	netstatswin->setVisible(value);
+	netstatsTime = 0;
+	if(value) updateNetStats();
+}
+
+bool GUI_Multiplayer::getNetStatsVisible()
+{
+	return netstatswin->getVisible();
+}
+
+void GUI_Multiplayer::updateNetStats()
+{
+	if(!netstatswin->getVisible()) return;
+
+	// the stats are averaged over one second, no need to update more often
+	unsigned long now = Network::getNetTime();
+	if(netstatsTime && now - netstatsTime < 1000) return;
+	netstatsTime = now;
+
+	netstatstext->setCaption(NetworkStreamManager::getSingleton().getStatsText());
+}
+
 #endif // USE_SOCKETW
 #endif // USE_MYGUI
@@ -41,6 +41,10 @@ public:
 	int update();
 	void setVisible(bool value);
 	bool getVisible();
+
+	void setNetStatsVisible(bool value);
+	bool getNetStatsVisible();
+	void updateNetStats();
 protected:
 
 	typedef struct player_row_t {
@@ -65,6 +69,10 @@ protected:
 
 	MyGUI::WindowPtr netmsgwin;
 	MyGUI::StaticTextPtr netmsgtext;
+
+	MyGUI::WindowPtr netstatswin;
+	MyGUI::EditPtr netstatstext;
+	unsigned long netstatsTime;
 	
 	void updateSlot(player_row_t *row, user_info_t *c, bool self);
 
@@ -23,6 +23,7 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "network.h"
 #include "language.h"
+#include "Settings.h"
 #include "Streamable.h"
 #include "StreamableFactoryInterface.h"
 
@@ -31,6 +32,10 @@ using namespace Ogre;
 NetworkStreamManager::NetworkStreamManager()
 {
 	streamid=10;
+	statsTime=0;
+	statsDumpTime=0;
+	statsDumpInterval = ISETTING("Network Stats Dump Interval", 0);
+	statsDumpFile=0;
 	pthread_mutex_init(&stream_mutex, NULL);
 	pthread_mutex_init(&send_work_mutex, NULL);
 	pthread_cond_init(&send_work_cv, NULL);
@@ -38,6 +43,11 @@ NetworkStreamManager::NetworkStreamManager()
 
 NetworkStreamManager::~NetworkStreamManager()
 {
+	if(statsDumpFile)
+	{
+		fclose(statsDumpFile);
+		statsDumpFile=0;
+	}
 }
 
 void NetworkStreamManager::addLocalStream(Streamable *stream, stream_register_t *reg, unsigned int size)
@@ -80,9 +90,42 @@ void NetworkStreamManager::addRemoteStream(Streamable *stream, int rsource, int
 	//MUTEX_LOCK(&stream_mutex);
 	streams[rsource][rstreamid] = stream;
 	LOG("adding remote stream: " + TOSTRING(rsource) + ":"+ TOSTRING(rstreamid));
+
+	// hand over the data that arrived while the stream was loading
+	std::map < int, std::map < unsigned int, pendingPackets_t > >::iterator it_source = pendingStreams.find(rsource);
+	if(it_source != pendingStreams.end())
+	{
+		std::map < unsigned int, pendingPackets_t >::iterator it_stream = it_source->second.find(rstreamid);
+		if(it_stream != it_source->second.end())
+		{
+			pendingPackets_t &pending = it_stream->second;
+			for(pendingPackets_t::iterator it = pending.begin(); it != pending.end(); it++)
+				stream->addReceivedPacket(it->first, it->second.empty() ? 0 : &it->second[0]);
+			it_source->second.erase(it_stream);
+		}
+		if(it_source->second.empty())
+			pendingStreams.erase(it_source);
+	}
 	//MUTEX_UNLOCK(&stream_mutex);
 }
 
+void NetworkStreamManager::addPendingStream(int rsource, int rstreamid)
+{
+	// NO LOCKS IN HERE, called from syncRemoteStreams
+	if(pendingStreams[rsource].find(rstreamid) == pendingStreams[rsource].end())
+		pendingStreams[rsource][rstreamid] = pendingPackets_t();
+}
+
+void NetworkStreamManager::removePendingStream(int rsource, int rstreamid)
+{
+	// NO LOCKS IN HERE, called from syncRemoteStreams
+	if(pendingStreams.find(rsource) == pendingStreams.end())
+		return;
+	pendingStreams[rsource].erase(rstreamid);
+	if(pendingStreams[rsource].empty())
+		pendingStreams.erase(rsource);
+}
+
 void NetworkStreamManager::removeStream(int sourceid, int streamid)
 {
 #ifdef USE_SOCKETW
@@ -105,6 +148,8 @@ void NetworkStreamManager::removeStream(int sourceid, int streamid)
 			streams[sourceid].erase(it_stream);
 	}
 
+	removePendingStream(sourceid, streamid);
+
 	if(sourceid != mysourceid)
 	{
 		// now iterate over all factories and remove their instances (only triggers)
@@ -132,6 +177,7 @@ void NetworkStreamManager::resumeStream(Streamable *stream)
 void NetworkStreamManager::removeUser(int sourceID)
 {
 	MUTEX_LOCK(&stream_mutex);
+	pendingStreams.erase(sourceID);
 	if(streams.find(sourceID) == streams.end())
 	{
 		// no such stream?!
@@ -154,6 +200,16 @@ void NetworkStreamManager::removeUser(int sourceID)
 void NetworkStreamManager::pushReceivedStreamMessage(header_t header, char *buffer)
 {
 	MUTEX_LOCK(&stream_mutex);
+	if(pendingStreams.find(header.source) != pendingStreams.end() && pendingStreams[header.source].find(header.streamid) != pendingStreams[header.source].end())
+	{
+		// the stream is still being created, keep the newest packets for it
+		pendingPackets_t &pending = pendingStreams[header.source][header.streamid];
+		pending.push_back(std::make_pair(header, std::vector < char >(buffer, buffer + header.size)));
+		while(pending.size() > Streamable::packetBufferSizeDiscardData)
+			pending.pop_front();
+		MUTEX_UNLOCK(&stream_mutex);
+		return;
+	}
 	if(streams.find(header.source) == streams.end())
 	{
 		// no such stream?!
@@ -237,6 +293,7 @@ void NetworkStreamManager::update()
 {
 	syncRemoteStreams();
 	receiveStreams();
+	updateStats();
 }
 #endif // USE_SOCKETW
 
@@ -291,3 +348,150 @@ void NetworkStreamManager::addFactory(StreamableFactoryInterface *factory)
 	MUTEX_UNLOCK(&stream_mutex);
 }
 
+void NetworkStreamManager::getStreamStats(std::vector < stream_stats_t > &stats)
+{
+	MUTEX_LOCK(&stream_mutex);
+	std::map < int, std::map < unsigned int, Streamable *> >::iterator it;
+	for(it=streams.begin(); it!=streams.end(); it++)
+	{
+		std::map<unsigned int,Streamable *>::iterator it2;
+		for(it2=it->second.begin(); it2!=it->second.end(); it2++)
+		{
+			if(!it2->second) continue;
+			stats.push_back(it2->second->getStreamStats());
+		}
+	}
+	MUTEX_UNLOCK(&stream_mutex);
+}
+
+void NetworkStreamManager::updateStats()
+{
+#ifdef USE_SOCKETW
+	unsigned long now = Network::getNetTime();
+	if(now - statsTime < 1000) return;
+	float dt = (now - statsTime) / 1000.0f;
+	statsTime = now;
+
+	// average the byte rates over the last interval
+	MUTEX_LOCK(&stream_mutex);
+	std::map < int, std::map < unsigned int, Streamable *> >::iterator it;
+	for(it=streams.begin(); it!=streams.end(); it++)
+	{
+		std::map<unsigned int,Streamable *>::iterator it2;
+		for(it2=it->second.begin(); it2!=it->second.end(); it2++)
+		{
+			Streamable *s = it2->second;
+			if(!s) continue;
+			s->stats.rate_in      = (s->stats.bytes_in  - s->statsLastBytesIn)  / dt;
+			s->stats.rate_out     = (s->stats.bytes_out - s->statsLastBytesOut) / dt;
+			s->statsLastBytesIn   = s->stats.bytes_in;
+			s->statsLastBytesOut  = s->stats.bytes_out;
+		}
+	}
+	MUTEX_UNLOCK(&stream_mutex);
+
+	if(statsDumpInterval > 0 && now - statsDumpTime >= (unsigned long)statsDumpInterval * 1000)
+	{
+		statsDumpTime = now;
+		dumpStats(now);
+	}
+#endif // USE_SOCKETW
+}
+
+void NetworkStreamManager::dumpStats(unsigned long now)
+{
+	// one csv line per stream, so it can be loaded into a spreadsheet or plotted
+	if(!statsDumpFile)
+	{
+		String filename = SSETTING("Log Path", "") + "netstats.csv";
+		statsDumpFile = fopen(filename.c_str(), "w");
+		if(!statsDumpFile)
+		{
+			LOG("unable to open network stats file " + filename);
+			statsDumpInterval = 0;
+			return;
+		}
+		LOG("writing network stats to " + filename);
+		fprintf(statsDumpFile, "time,source,stream,name,origin,packets_in,bytes_in,packets_out,bytes_out,discarded_in,discarded_out,queue_in,queue_out,rate_in,rate_out,lag,snapshot_age\n");
+	}
+
+	std::vector < stream_stats_t > stats;
+	getStreamStats(stats);
+	for(unsigned int i=0; i<stats.size(); i++)
+	{
+		stream_stats_t &s = stats[i];
+		fprintf(statsDumpFile, "%lu,%d,%u,\"%s\",%d,%lu,%lu,%lu,%lu,%lu,%lu,%u,%u,%.0f,%.0f,%d,%d\n",
+			now, s.sourceid, s.streamid, s.name.c_str(), s.origin?1:0,
+			s.packets_in, s.bytes_in, s.packets_out, s.bytes_out, s.discarded_in, s.discarded_out,
+			s.queue_in, s.queue_out, s.rate_in, s.rate_out, s.lag, s.snapshot_age);
+	}
+	fflush(statsDumpFile);
+}
+
+String NetworkStreamManager::getStatsText(int sourceid)
+{
+	std::vector < stream_stats_t > stats;
+	getStreamStats(stats);
+
+	// per user totals first, then the single streams
+	std::map < int, stream_stats_t > users;
+	for(unsigned int i=0; i<stats.size(); i++)
+	{
+		stream_stats_t &s = stats[i];
+		if(users.find(s.sourceid) == users.end())
+		{
+			users[s.sourceid] = s;
+			continue;
+		}
+		stream_stats_t &u = users[s.sourceid];
+		u.packets_in    += s.packets_in;
+		u.bytes_in      += s.bytes_in;
+		u.packets_out   += s.packets_out;
+		u.bytes_out     += s.bytes_out;
+		u.discarded_in  += s.discarded_in;
+		u.discarded_out += s.discarded_out;
+		u.queue_in      += s.queue_in;
+		u.queue_out     += s.queue_out;
+		u.rate_in       += s.rate_in;
+		u.rate_out      += s.rate_out;
+		u.lag            = std::max(u.lag, s.lag);
+		u.snapshot_age   = std::max(u.snapshot_age, s.snapshot_age);
+	}
+
+	String txt;
+	std::map < int, stream_stats_t >::iterator it;
+	for(it=users.begin(); it!=users.end(); it++)
+	{
+		if(sourceid >= 0 && it->first != sourceid) continue;
+		stream_stats_t &u = it->second;
+
+		String username = "user " + TOSTRING(it->first);
+#ifdef USE_SOCKETW
+		if(net && (unsigned int)it->first == net->getUserID())
+			username = String(net->getLocalUserData()->username);
+		else if(net && net->getClientInfo(it->first))
+			username = String(net->getClientInfo(it->first)->user.username);
+#endif // USE_SOCKETW
+
+		txt += username + " (" + TOSTRING(it->first) + "): in " + TOSTRING((int)(u.rate_in / 1024.0f * 10.0f) / 10.0f) + " kB/s, out " + TOSTRING((int)(u.rate_out / 1024.0f * 10.0f) / 10.0f) + " kB/s, discarded " + TOSTRING(u.discarded_in) + " / " + TOSTRING(u.discarded_out) + "\n";
+
+		for(unsigned int i=0; i<stats.size(); i++)
+		{
+			stream_stats_t &s = stats[i];
+			if(s.sourceid != it->first) continue;
+			txt += "  " + TOSTRING(s.streamid) + " " + s.name + ": "
+				+ "in " + TOSTRING(s.packets_in) + " pkts / " + TOSTRING(s.bytes_in / 1024) + " kB (" + TOSTRING((int)s.rate_in) + " B/s), "
+				+ "out " + TOSTRING(s.packets_out) + " pkts / " + TOSTRING(s.bytes_out / 1024) + " kB (" + TOSTRING((int)s.rate_out) + " B/s), "
+				+ "queue " + TOSTRING(s.queue_in) + " / " + TOSTRING(s.queue_out) + ", "
+				+ "discarded " + TOSTRING(s.discarded_in) + " / " + TOSTRING(s.discarded_out);
+			if(s.lag >= 0)
+				txt += ", lag " + TOSTRING(s.lag) + " ms";
+			if(s.snapshot_age >= 0)
+				txt += ", age " + TOSTRING(s.snapshot_age) + " ms";
+			txt += "\n";
+		}
+	}
+	if(txt.empty())
+		txt = "no streams\n";
+	return txt;
+}
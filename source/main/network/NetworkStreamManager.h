@@ -36,6 +36,7 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 
 class Streamable;
 class StreamableFactoryInterface;
+struct stream_stats_t;
 
 class NetworkStreamManager : public RoRSingleton< NetworkStreamManager >
 {
@@ -48,6 +49,8 @@ public:
 	
 	void addLocalStream(Streamable *stream, stream_register_t *reg, unsigned int size=0);
 	void addRemoteStream(Streamable *stream, int source=-1, int streamid=-1);
+	void addPendingStream(int source, int streamid);
+	void removePendingStream(int source, int streamid);
 	void removeStream(int sourceid, int streamid);
 
 	void pauseStream(Streamable *stream);
@@ -67,6 +70,11 @@ public:
 
 	void addFactory(StreamableFactoryInterface *factory);
 
+	void getStreamStats(std::vector < stream_stats_t > &stats);
+	Ogre::String getStatsText(int sourceid=-1);
+	void setStatsDumpInterval(int seconds) { statsDumpInterval = seconds; };
+	int getStatsDumpInterval() { return statsDumpInterval; };
+
 protected:
 
 	pthread_mutex_t stream_mutex;
@@ -75,14 +83,24 @@ protected:
 	Network *net;
 
 	std::map < int, std::map < unsigned int, Streamable *> > streams;
+
+	// data received for streams that are still being created, handed over in addRemoteStream
+	typedef std::deque < std::pair < header_t, std::vector < char > > > pendingPackets_t;
+	std::map < int, std::map < unsigned int, pendingPackets_t > > pendingStreams;
 	std::vector < StreamableFactoryInterface * > factories;
 
 	unsigned int streamid;
 
+	unsigned long statsTime, statsDumpTime;
+	int statsDumpInterval;
+	FILE *statsDumpFile;
+
 	void pushReceivedStreamMessage(header_t header, char *buffer);
 
 	void syncRemoteStreams();
 	void receiveStreams();
+	void updateStats();
+	void dumpStats(unsigned long now);
 };
 
 #endif // __NetworkStreamManager_H_
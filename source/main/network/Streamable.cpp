@@ -26,8 +26,28 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 
 using namespace Ogre;
 
-Streamable::Streamable() : isOrigin(false), streamResultsChanged(false)
+Streamable::Streamable() :
+	  isOrigin(false)
+	, lastReceiveTime(0)
+	, statsLastBytesIn(0)
+	, statsLastBytesOut(0)
+	, streamResultsChanged(false)
 {
+	stats.sourceid      = 0;
+	stats.streamid      = 0;
+	stats.origin        = false;
+	stats.packets_in    = 0;
+	stats.bytes_in      = 0;
+	stats.packets_out   = 0;
+	stats.bytes_out     = 0;
+	stats.discarded_in  = 0;
+	stats.discarded_out = 0;
+	stats.queue_in      = 0;
+	stats.queue_out     = 0;
+	stats.rate_in       = 0.0f;
+	stats.rate_out      = 0.0f;
+	stats.lag           = -1;
+	stats.snapshot_age  = -1;
 	//NetworkStreamManager::getSingleton().addStream(this);
 	pthread_mutex_init(&recv_work_mutex, NULL);
 }
@@ -50,15 +70,18 @@ void Streamable::addPacket(int type, unsigned int len, char* content)
 {
 #ifdef USE_SOCKETW
 	if(packets.size() > packetBufferSizeDiscardData && type == MSG2_STREAM_DATA)
+	{
 		// discard unimportant data packets for some while
+		stats.discarded_out++;
 		return;
+	}
 
-	if(packets.size() > packetBufferSize)
-		// buffer full, packet discarded
-		return;
-	if(len > maxPacketLen)
-		// packet too big, discarded
+	if(packets.size() > packetBufferSize || len > maxPacketLen)
+	{
+		// buffer full or packet too big, packet discarded
+		stats.discarded_out++;
 		return;
+	}
 
 	int uid = Network::getUID();
 	unsigned int streamid = this->streamid; //we stored the streamid upon stream registration in this class
@@ -103,6 +126,8 @@ void Streamable::addPacket(int type, unsigned int len, char* content)
 	*/
 
 	packets.push_back(packet);
+	stats.packets_out++;
+	stats.bytes_out += packet.size;
 
 	// trigger buffer clearing
 	NetworkStreamManager::getSingleton().triggerSend();
@@ -111,13 +136,19 @@ void Streamable::addPacket(int type, unsigned int len, char* content)
 
 void Streamable::addReceivedPacket(header_t header, char *buffer)
 {
-	if(packets.size() > packetBufferSizeDiscardData && header.command == MSG2_STREAM_DATA)
+	if(receivedPackets.size() > packetBufferSizeDiscardData && header.command == MSG2_STREAM_DATA)
+	{
 		// discard unimportant data packets for some while
+		stats.discarded_in++;
 		return;
+	}
 
 	if(receivedPackets.size() > packetBufferSize)
+	{
 		// buffer full, packet discarded
+		stats.discarded_in++;
 		return;
+	}
 	MUTEX_LOCK(&recv_work_mutex);
 
 	// construct the data holding struct
@@ -127,6 +158,11 @@ void Streamable::addReceivedPacket(header_t header, char *buffer)
 	memcpy(packet.buffer, buffer, header.size);
 
 	receivedPackets.push_back(packet);
+	stats.packets_in++;
+	stats.bytes_in += sizeof(header_t) + header.size;
+#ifdef USE_SOCKETW
+	lastReceiveTime = Network::getNetTime();
+#endif // USE_SOCKETW
 	MUTEX_UNLOCK(&recv_work_mutex);
 }
 
@@ -162,4 +198,24 @@ bool Streamable::getStreamResultsChanged()
 		return true;
 	}
 	return false;
-}
\ No newline at end of file
+}
+
+stream_stats_t Streamable::getStreamStats()
+{
+	MUTEX_LOCK(&recv_work_mutex);
+	stream_stats_t s  = stats;
+	s.queue_in        = (unsigned int)receivedPackets.size();
+	MUTEX_UNLOCK(&recv_work_mutex);
+
+	s.sourceid        = sourceid;
+	s.streamid        = streamid;
+	s.name            = getStreamName();
+	s.origin          = isOrigin;
+	s.queue_out       = (unsigned int)packets.size();
+	s.snapshot_age    = -1;
+#ifdef USE_SOCKETW
+	if (lastReceiveTime)
+		s.snapshot_age = (int)(Network::getNetTime() - lastReceiveTime);
+#endif // USE_SOCKETW
+	return s;
+}
@@ -34,6 +34,24 @@ typedef struct recvPacket_t
 	char *buffer[MAX_MESSAGE_LENGTH];
 } recvPacket_t;
 
+/**
+ * Traffic statistics of one stream, filled by the stream itself and collected by the NetworkStreamManager.
+ */
+typedef struct stream_stats_t
+{
+	int sourceid;
+	unsigned int streamid;
+	Ogre::String name;                         //!< what the stream carries, the truck name for example
+	bool origin;                               //!< true for our own streams
+	unsigned long packets_in, bytes_in;        //!< received and queued
+	unsigned long packets_out, bytes_out;      //!< queued for sending
+	unsigned long discarded_in, discarded_out; //!< dropped because the queues were full
+	unsigned int queue_in, queue_out;          //!< current depth of receivedPackets and packets
+	float rate_in, rate_out;                   //!< bytes per second, averaged over the last second
+	int lag;                                   //!< interpolation delay in ms, -1 if the stream does not interpolate
+	int snapshot_age;                          //!< ms since the last received packet, -1 if nothing was received yet
+} stream_stats_t;
+
 /**
  * This class defines a standard interface and a buffer between the actual network code and the class that handles it.
  * The buffer must be decoupled from the separately running network thread.
@@ -55,6 +73,9 @@ public:
 	int getStreamRegisterResultForSource(int sourceid, stream_register_t *reg);
 	bool getStreamResultsChanged();
 
+	stream_stats_t getStreamStats();
+	virtual Ogre::String getStreamName() { return ""; };
+
 protected:
 	// constructor/destructor are protected, so you cannot create instances without using the factory
 	Streamable();
@@ -94,6 +115,10 @@ protected:
 	void lockReceiveQueue();
 	void unlockReceiveQueue();
 
+	stream_stats_t stats;              //!< counters, lag is set by the interpolating stream
+	unsigned long lastReceiveTime;     //!< Network::getNetTime() of the last received packet
+	unsigned long statsLastBytesIn, statsLastBytesOut;
+
 private:
 
 	std::map < int, stream_register_t > mStreamableResults;
@@ -98,14 +98,29 @@ public:
 		unlockStreams();
 	}
 
+	// return false to keep the registration queued, it is asked again on the next sync
+	// incoming data of the stream is buffered by the NetworkStreamManager meanwhile
+	virtual bool isRemoteInstanceReady(stream_reg_t *reg) { return true; };
+	// called when a stream is deleted while its registration is still queued
+	virtual void remoteInstanceCancelled(stream_reg_t *reg) {};
+
 	virtual bool syncRemoteStreams()
 	{
 		lockStreams();
 		// first registrations
 		int changes = 0;
+		std::deque < stream_reg_t > deferred;
 		while (!stream_registrations.empty())
 		{
 			stream_reg_t reg = stream_registrations.front();
+			if(!isRemoteInstanceReady(&reg))
+			{
+				// still loading, try again later
+				NetworkStreamManager::getSingleton().addPendingStream(reg.sourceid, reg.streamid);
+				deferred.push_back(reg);
+				stream_registrations.pop_front();
+				continue;
+			}
 			Streamable *s = createRemoteInstance(&reg);
 			if(s)
 			{
@@ -116,6 +131,8 @@ public:
 			{
 				// error creating stream, tell the sourceid that it failed
 				reg.reg.status = -1;
+				// its packets were buffered while it was deferred, drop them
+				NetworkStreamManager::getSingleton().removePendingStream(reg.sourceid, reg.streamid);
 			}
 			// fixup the registration information
 			reg.reg.origin_sourceid = reg.sourceid;
@@ -133,6 +150,8 @@ public:
 			changes++;
 		}
 
+		stream_registrations.insert(stream_registrations.end(), deferred.begin(), deferred.end());
+
 		// count the stream creation results into the changes
 		changes += (int)stream_creation_results.size();
 
@@ -141,6 +160,20 @@ public:
 		while (!stream_deletions.empty())
 		{
 			stream_del_t del = stream_deletions.front();
+			// drop registrations that did not finish loading yet
+			typename std::deque < stream_reg_t >::iterator it;
+			for(it=stream_registrations.begin(); it!=stream_registrations.end();)
+			{
+				if(it->sourceid == del.sourceid && (del.streamid == -1 || del.streamid == it->streamid))
+				{
+					remoteInstanceCancelled(&(*it));
+					NetworkStreamManager::getSingleton().removePendingStream(it->sourceid, it->streamid);
+					it = stream_registrations.erase(it);
+				} else
+				{
+					it++;
+				}
+			}
 			removeInstance(&del);
 			stream_deletions.pop_front();
 			changes++;
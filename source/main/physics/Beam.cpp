@@ -26,6 +26,7 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 #include "BeamData.h"
 #include "BeamEngine.h"
 #include "BeamFactory.h"
+#include "BeamRenderer.h"
 #include "BeamStats.h"
 #include "buoyance.h"
 #include "CameraManager.h"
@@ -43,6 +44,7 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 #include "heightfinder.h"
 #include "InputEngine.h"
 #include "IWater.h"
+#include "LabelRenderer.h"
 #include "language.h"
 #include "MeshObject.h"
 #include "MovableText.h"
@@ -80,6 +82,17 @@ Beam* Beam::threadbeam[MAX_TRUCKS];
 int Beam::thread_mode = THREAD_SINGLE;
 int Beam::free_tb = 0;
 
+bool  Beam::netLodEnabled        = true;
+float Beam::netLodDistance       = 150.0f;
+float Beam::netLodRigidDistance  = 500.0f;
+float Beam::netLodInterval       = 0.1f;
+float Beam::netLodVisualInterval = 0.1f;
+float Beam::netLodBlendTime      = 0.5f;
+
+bool  Beam::visualLodEnabled     = true;
+float Beam::visualLodDistance    = 200.0f;
+float Beam::visualLodInterval    = 0.05f;
+
 Beam::Beam(int tnum, SceneManager *manager, SceneNode *parent, RenderWindow* win, Network *_net, float *_mapsizex, float *_mapsizez, Real px, Real py, Real pz, Quaternion rot, const char* fname, Collisions *icollisions, HeightFinder *mfinder, Water *w, Camera *pcam, bool networked, bool networking, collision_box_t *spawnbox, bool ismachine, int _flaresMode, std::vector<String> *_truckconfig, Skin *skin, bool freeposition) :
 	  deleting(false)
 	, abs_state(false)
@@ -141,8 +154,11 @@ Beam::Beam(int tnum, SceneManager *manager, SceneNode *parent, RenderWindow* win
 	, mousepos(Vector3::ZERO)
 	, net(_net)
 	, netBrakeLight(false)
-	, netLabelNode(0)
-	, netMT(0)
+	, netLabel(-1)
+	, netLodBlend(1.0f)
+	, netLodLevel(NETLOD_FULL)
+	, netLodTimer(0.0f)
+	, netLodVisualTimer(0.0f)
 	, netReverseLight(false)
 	, networkAuthlevel(0)
 	, networkUsername("")
@@ -179,6 +195,10 @@ Beam::Beam(int tnum, SceneManager *manager, SceneNode *parent, RenderWindow* win
 	, tsm(manager)
 	, tsteps(100)
 	, ttdt(0.1)
+	, visualLodDrawnPos(Vector3::ZERO)
+	, visualLodLevel(VISLOD_FULL)
+	, visualLodTimer(0.0f)
+	, visualLodUpdate(true)
 	, watercontact(0)
 	, watercontactold(0)
 	, disableTruckTruckCollisions(false)
@@ -257,6 +277,9 @@ Beam::Beam(int tnum, SceneManager *manager, SceneNode *parent, RenderWindow* win
 
 	mrtime = 0.0;
 
+	netLodRigidRef[0] = 0;
+	netLodRigidRef[1] = 0;
+
 	origin = Vector3::ZERO;
 
 	previousCrank = 0.0f;
@@ -330,7 +353,7 @@ Beam::Beam(int tnum, SceneManager *manager, SceneNode *parent, RenderWindow* win
 	deletion_sceneNodes.push_back(simpleSkeletonNode);
 	
 	beamsRoot=parent->createChildSceneNode();
-	deletion_sceneNodes.push_back(netLabelNode);
+	beamRenderer = new BeamRenderer(beamsRoot);
 	// skidmark stuff
 	useSkidmarks = BSETTING("Skidmarks", false);
 
@@ -509,6 +532,9 @@ Beam::~Beam()
 	if(cabMesh) delete cabMesh;
 	if(materialFunctionMapper) delete materialFunctionMapper;
 	if(replay) delete replay;
+	// the marks themselves stay on the ground, they belong to the SkidmarkManager
+	for(int i=0; i<MAX_WHEELS*2; i++)
+		if(skidtrails[i]) delete skidtrails[i];
 
 	std::vector<SceneNode*> deletion_sceneNodes;
 	std::vector<Entity *> deletion_Entities;
@@ -569,7 +595,7 @@ Beam::~Beam()
 	for(int i=0; i<free_wheel;i++)
 	{
 
-		//if(vwheels[i].fm) delete vwheels[i].fm; // CRASH!
+		if(vwheels[i].fm) delete vwheels[i].fm;
 		if(vwheels[i].cnode)
 		{
 			vwheels[i].cnode->removeAndDestroyAllChildren();
@@ -662,15 +688,8 @@ Beam::~Beam()
 	}
 
 	// delete beams
-	for (int i=0; i<free_beam; i++)
-	{
-		if(beams[i].mEntity)    beams[i].mEntity->setVisible(false);
-		if(beams[i].mSceneNode)
-		{
-			beams[i].mSceneNode->removeAndDestroyAllChildren();
-			//tsm->destroySceneNode(beams[i].mSceneNode);
-		}
-	}
+	if (beamRenderer) delete beamRenderer;
+	beamRenderer = 0;
 
 	// delete Rails
 	for(std::vector< RailGroup* >::iterator it = mRailGroups.begin(); it != mRailGroups.end(); it++)
@@ -680,12 +699,9 @@ Beam::~Beam()
 		delete (*it);
 	}
 
-	if(netMT)
-	{
-		netMT->setVisible(false);
-		delete netMT;
-		netMT = 0;
-	}
+	if (netLabel >= 0 && LabelRenderer::singletonExists())
+		LabelRenderer::getSingleton().removeLabel(netLabel);
+	netLabel = -1;
 }
 
 // This method scales trucks. Stresses should *NOT* be scaled, they describe
@@ -695,6 +711,8 @@ void Beam::scaleTruck(float value)
 	BES_GFX_START(BES_GFX_ScaleTruck);
 
 	if(value<0) return;
+	// the cab mesh may still be deformed by the render prep
+	BeamFactory::getSingleton().finishVisualPrep();
 	currentScale *= value;
 	// scale beams
 	for(int i=0;i<free_beam;i++)
@@ -1040,6 +1058,8 @@ void Beam::calcNetwork()
 	if (oob2->time<rnow) {net_toffset=oob2->time-tnow; rnow=tnow+net_toffset;}
 	float tratio=(float)(rnow-oob1->time)/(float)(oob2->time-oob1->time);
 	//LOG(" network time diff: "+ TOSTRING(net_toffset));
+	// how far the displayed state trails the newest snapshot, for the network stats
+	stats.lag = oob2->time - rnow;
 	Vector3 p1ref = Vector3::ZERO;
 	Vector3 p2ref = Vector3::ZERO;
 	short *sp1 = (short*)(netb1 + sizeof(float) * 3);
@@ -1047,36 +1067,65 @@ void Beam::calcNetwork()
 
 	Vector3 p1 = Vector3::ZERO;
 	Vector3 p2 = Vector3::ZERO;
-	for (int i = 0; i < first_wheel_node; i++)
+	if (netLodLevel == NETLOD_RIGID && (int)netLodRigidLocal.size() == first_wheel_node)
 	{
-		//linear interpolation
-		if (i == 0)
+		// far away: only decode the reference nodes and move the captured shape as a rigid body
+		Vector3 r0 = getNetNodePosition(netb1, 0);
+		Vector3 ra = getNetNodePosition(netb1, netLodRigidRef[0]);
+		Vector3 rb = getNetNodePosition(netb1, netLodRigidRef[1]);
+		r0 += tratio * (getNetNodePosition(netb2, 0) - r0);
+		ra += tratio * (getNetNodePosition(netb2, netLodRigidRef[0]) - ra);
+		rb += tratio * (getNetNodePosition(netb2, netLodRigidRef[1]) - rb);
+
+		Quaternion frame = getNetLodFrame(r0, ra, rb);
+		for (int i = 0; i < first_wheel_node; i++)
 		{
-			// first node is uncompressed
-			p1.x  = ((float*)netb1)[0];
-			p1.y  = ((float*)netb1)[1];
-			p1.z  = ((float*)netb1)[2];
-			p1ref = p1;
-			p2.x  = ((float*)netb2)[0];
-			p2.y  = ((float*)netb2)[1];
-			p2.z  = ((float*)netb2)[2];
-			p2ref = p2;
+			nodes[i].AbsPosition = r0 + frame * netLodRigidLocal[i];
 		}
-		else
+	} else
+	{
+		for (int i = 0; i < first_wheel_node; i++)
 		{
-			// all other nodes are compressed:
-			// short int compared to previous node
-			p1.x = (float)(sp1[(i - 1) *3 + 0]) / 300.0f;
-			p1.y = (float)(sp1[(i - 1) *3 + 1]) / 300.0f;
-			p1.z = (float)(sp1[(i - 1) *3 + 2]) / 300.0f;
-			p1   = p1 + p1ref;
+			//linear interpolation
+			if (i == 0)
+			{
+				// first node is uncompressed
+				p1.x  = ((float*)netb1)[0];
+				p1.y  = ((float*)netb1)[1];
+				p1.z  = ((float*)netb1)[2];
+				p1ref = p1;
+				p2.x  = ((float*)netb2)[0];
+				p2.y  = ((float*)netb2)[1];
+				p2.z  = ((float*)netb2)[2];
+				p2ref = p2;
+			}
+			else
+			{
+				// all other nodes are compressed:
+				// short int compared to previous node
+				p1.x = (float)(sp1[(i - 1) *3 + 0]) / 300.0f;
+				p1.y = (float)(sp1[(i - 1) *3 + 1]) / 300.0f;
+				p1.z = (float)(sp1[(i - 1) *3 + 2]) / 300.0f;
+				p1   = p1 + p1ref;
+
+				p2.x = (float)(sp2[(i - 1) *3 + 0]) / 300.0f;
+				p2.y = (float)(sp2[(i - 1) *3 + 1]) / 300.0f;
+				p2.z = (float)(sp2[(i - 1) *3 + 2]) / 300.0f;
+				p2   = p2 + p2ref;
+			}
+			nodes[i].AbsPosition  = p1 + tratio * (p2 - p1);
+		}
+	}
 
-			p2.x = (float)(sp2[(i - 1) *3 + 0]) / 300.0f;
-			p2.y = (float)(sp2[(i - 1) *3 + 1]) / 300.0f;
-			p2.z = (float)(sp2[(i - 1) *3 + 2]) / 300.0f;
-			p2   = p2 + p2ref;
+	// hide LOD switches by blending from the shape we had at the switch
+	bool blending = netLodBlend < 1.0f && (int)netLodBlendOffset.size() == first_wheel_node;
+	for (int i = 0; i < first_wheel_node; i++)
+	{
+		if (blending && i > 0)
+		{
+			Vector3 from = nodes[0].AbsPosition + netLodBlendOffset[i];
+			nodes[i].AbsPosition = from + netLodBlend * (nodes[i].AbsPosition - from);
 		}
-		nodes[i].AbsPosition  = p1 + tratio * (p2 - p1);
 		nodes[i].smoothpos    = nodes[i].AbsPosition;
 		nodes[i].RelPosition  = nodes[i].AbsPosition - origin;
 
@@ -1211,6 +1260,159 @@ void Beam::calcNetwork()
 	BES_GFX_STOP(BES_GFX_calcNetwork);
 }
 
+Vector3 Beam::getNetNodePosition(char *netb, int node)
+{
+	// see the network buffer layout in the constructor
+	Vector3 ref = Vector3(((float*)netb)[0], ((float*)netb)[1], ((float*)netb)[2]);
+	if (node <= 0) return ref;
+
+	short *sp = (short*)(netb + sizeof(float) * 3);
+	return ref + Vector3(sp[(node - 1) * 3 + 0], sp[(node - 1) * 3 + 1], sp[(node - 1) * 3 + 2]) / 300.0f;
+}
+
+Quaternion Beam::getNetLodFrame(const Vector3 &p0, const Vector3 &pa, const Vector3 &pb)
+{
+	Vector3 x = (pa - p0).normalisedCopy();
+	Vector3 z = x.crossProduct(pb - p0).normalisedCopy();
+	Vector3 y = z.crossProduct(x);
+	return Quaternion(x, y, z);
+}
+
+void Beam::setNetworkLOD(int level)
+{
+	if (level == netLodLevel || first_wheel_node <= 0) return;
+
+	// remember the current shape, calcNetwork blends from it to the new level
+	netLodBlendOffset.resize(first_wheel_node);
+	for (int i = 0; i < first_wheel_node; i++)
+	{
+		netLodBlendOffset[i] = nodes[i].AbsPosition - nodes[0].AbsPosition;
+	}
+	netLodBlend = 0.0f;
+
+	netLodRigidLocal.clear();
+	if (level == NETLOD_RIGID)
+	{
+		// pick two reference nodes spanning the truck to build a stable frame
+		float maxdist = 0.0f, maxarea = 0.0f;
+		netLodRigidRef[0] = netLodRigidRef[1] = 0;
+		for (int i = 1; i < first_wheel_node; i++)
+		{
+			float dist = nodes[i].AbsPosition.squaredDistance(nodes[0].AbsPosition);
+			if (dist > maxdist)
+			{
+				maxdist = dist;
+				netLodRigidRef[0] = i;
+			}
+		}
+		Vector3 axis = nodes[netLodRigidRef[0]].AbsPosition - nodes[0].AbsPosition;
+		for (int i = 1; i < first_wheel_node; i++)
+		{
+			float area = axis.crossProduct(nodes[i].AbsPosition - nodes[0].AbsPosition).squaredLength();
+			if (area > maxarea)
+			{
+				maxarea = area;
+				netLodRigidRef[1] = i;
+			}
+		}
+
+		if (maxarea > 0.0f)
+		{
+			Quaternion inverse = getNetLodFrame(nodes[0].AbsPosition, nodes[netLodRigidRef[0]].AbsPosition, nodes[netLodRigidRef[1]].AbsPosition).Inverse();
+			netLodRigidLocal.resize(first_wheel_node);
+			for (int i = 0; i < first_wheel_node; i++)
+			{
+				netLodRigidLocal[i] = inverse * (nodes[i].AbsPosition - nodes[0].AbsPosition);
+			}
+		} else
+		{
+			// degenerated truck (all nodes on a line), stay with the reduced mode
+			level = NETLOD_REDUCED;
+		}
+	}
+	netLodLevel = level;
+}
+
+void Beam::calcNetworkLOD(float dt)
+{
+	if (!netLodEnabled || !mCamera)
+	{
+		calcNetwork();
+		return;
+	}
+
+	// select the level, with some hysteresis so we do not flip at the borders
+	float dist   = position.distance(mCamera->getPosition());
+	float margin = (netLodLevel == NETLOD_FULL) ? 1.0f : 0.9f;
+	int level    = NETLOD_FULL;
+	if (dist > netLodRigidDistance * ((netLodLevel == NETLOD_RIGID) ? 0.9f : 1.0f))
+		level = NETLOD_RIGID;
+	else if (dist > netLodDistance * margin)
+		level = NETLOD_REDUCED;
+	setNetworkLOD(level);
+
+	if (netLodBlend < 1.0f)
+		netLodBlend = std::min(1.0f, netLodBlend + dt / std::max(netLodBlendTime, 0.001f));
+
+	netLodTimer += dt;
+	if (netLodLevel == NETLOD_FULL || netLodBlend < 1.0f || netLodTimer >= netLodInterval)
+	{
+		netLodTimer = 0.0f;
+		calcNetwork();
+	}
+}
+
+bool Beam::netLodVisualStep(float &dt)
+{
+	// returns true if the visuals should be updated this frame, dt is then the time since the last update
+	netLodVisualTimer += dt;
+	if (netLodEnabled && netLodLevel != NETLOD_FULL && netLodBlend >= 1.0f && netLodVisualTimer < netLodVisualInterval)
+		return false;
+
+	dt = netLodVisualTimer;
+	netLodVisualTimer = 0.0f;
+	return true;
+}
+
+void Beam::calcVisualLOD(float dt, bool isCurrent, const std::vector<Camera *> &cameras)
+{
+	visualLodTimer += dt;
+	visualLodLevel  = VISLOD_FULL;
+	float dist      = 0.0f;
+	if (visualLodEnabled && mCamera && !isCurrent)
+	{
+		dist = position.distance(mCamera->getPosition());
+		// the meshes are still where the truck was drawn last, so both places have to be out of view.
+		// Otherwise a truck that moved away would leave a frozen copy of itself behind.
+		// Mirrors and videocameras look elsewhere than the main camera, so all active cameras count
+		float radius = std::max(minCameraRadius, 1.0f);
+		Sphere now(position, radius), drawn(visualLodDrawnPos, radius);
+		bool visible = mCamera->isVisible(now) || mCamera->isVisible(drawn);
+		for (size_t i = 0; i < cameras.size() && !visible; i++)
+			visible = cameras[i]->isVisible(now) || cameras[i]->isVisible(drawn);
+		// trucks outside of the view might still cast shadows into it, those are only reduced
+		bool shadows = (tsm && tsm->getShadowTechnique() != SHADOWTYPE_NONE);
+		if (!visible && !shadows)
+			visualLodLevel = VISLOD_CULLED;
+		else if (!visible || dist > visualLodDistance)
+			visualLodLevel = VISLOD_REDUCED;
+	}
+
+	if (visualLodLevel == VISLOD_CULLED)
+		// the timer keeps running, so the truck is updated right away once it is visible again
+		visualLodUpdate = false;
+	else if (visualLodLevel == VISLOD_REDUCED)
+		visualLodUpdate = (visualLodTimer >= visualLodInterval * dist / visualLodDistance);
+	else
+		visualLodUpdate = true;
+
+	if (visualLodUpdate)
+	{
+		visualLodTimer    = 0.0f;
+		visualLodDrawnPos = position;
+	}
+}
+
 void Beam::addPressure(float v)
 {
 	refpressure+=v;
@@ -1738,8 +1940,6 @@ void Beam::resetPosition(float px, float pz, bool setI, float miny)
 		minCameraRadius *= 1.2f; // ten percent buffer
 	}
 
-	//if (netLabelNode) netLabelNode->setPosition(nodes[0].Position);
-
 	resetSlideNodePositions();
 }
 
@@ -1781,8 +1981,6 @@ void Beam::resetPosition(Vector3 translation, bool setInitPosition)
 		minCameraRadius *= 1.2f; // ten percent buffer
 	}
 
-	//if (netLabelNode) netLabelNode->setPosition(nodes[0].Position);
-
 	resetSlideNodePositions();
 
 }
@@ -1927,11 +2125,10 @@ void Beam::SyncReset()
 		beams[i].lastforce=Vector3::ZERO;
 		beams[i].stress=0.0;
 		beams[i].disabled=false;
-		if (beams[i].mSceneNode && beams[i].type!=BEAM_VIRTUAL && beams[i].type!=BEAM_INVISIBLE && beams[i].type!=BEAM_INVISIBLE_HYDRO)
+		if (beams[i].mBatch>=0 && beams[i].type!=BEAM_VIRTUAL && beams[i].type!=BEAM_INVISIBLE && beams[i].type!=BEAM_INVISIBLE_HYDRO)
 		{
-			//reattach possibly detached nodes
-			//beams[i].mSceneNode->setVisible(true);
-			if (beams[i].mSceneNode->numAttachedObjects()==0) beams[i].mSceneNode->attachObject(beams[i].mEntity);
+			//show possibly hidden beams again
+			beams[i].mVisible=true;
 		}
 	}
 
@@ -1949,7 +2146,7 @@ void Beam::SyncReset()
 				(*it_truck)->hideSkeleton(true, false);
 			}
 		}
-		it->beam->mSceneNode->detachAllObjects();
+		it->beam->mVisible = false;
 		it->beam->disabled = true;
 		it->locked        = UNLOCKED;
 		it->lockNodes     = true;
@@ -1966,7 +2163,7 @@ void Beam::SyncReset()
 	{
 		it->beam->disabled = true;
 		it->beam->p2       = &nodes[0];
-		it->beam->mSceneNode->detachAllObjects();
+		it->beam->mVisible = false;
 	}
 	for (i=0; i<free_aeroengine; i++) aeroengines[i]->reset();
 	for (i=0; i<free_screwprop; i++) screwprops[i]->reset();
@@ -3411,14 +3608,11 @@ void Beam::updateSkidmarks()
 		if(wheels[i].lastContactInner == Vector3::ZERO && wheels[i].lastContactOuter == Vector3::ZERO) continue;
 		// create skidmark object for wheels with data if not existing
 		if(!skidtrails[i])
-			skidtrails[i] = new Skidmark(tsm, &wheels[i], hfinder, beamsRoot, 300, 200);
+			skidtrails[i] = new Skidmark(&wheels[i]);
 
 		skidtrails[i]->updatePoint();
 	}
-
-	//LOG("updating skidmark visuals");
-	for(int i=0;i<free_wheel;i++)
-		if(skidtrails[i]) skidtrails[i]->update();
+	// the visuals of all trucks are updated together in SkidmarkManager::update()
 
 	BES_STOP(BES_CORE_Skidmarks);
 }
@@ -3496,7 +3690,7 @@ void Beam::prepareInside(bool inside)
 				if (props[i].wheel && props[i].wheel->numAttachedObjects()) props[i].wheel->getAttachedObject(0)->setCastShadows(false);
 			}
 			for (i=0; i<free_wheel; i++) if(vwheels[i].cnode->numAttachedObjects()) vwheels[i].cnode->getAttachedObject(0)->setCastShadows(false);
-			for (i=0; i<free_beam; i++) if (beams[i].mEntity) beams[i].mEntity->setCastShadows(false);
+			if (beamRenderer) beamRenderer->setCastShadows(false);
 
 		}
 		if (cabNode)
@@ -3541,7 +3735,7 @@ void Beam::prepareInside(bool inside)
 				if (props[i].wheel && props[i].wheel->numAttachedObjects()) props[i].wheel->getAttachedObject(0)->setCastShadows(true);
 			}
 			for (i=0; i<free_wheel; i++) if(vwheels[i].cnode->numAttachedObjects()) vwheels[i].cnode->getAttachedObject(0)->setCastShadows(true);
-			for (i=0; i<free_beam; i++) if (beams[i].mEntity) beams[i].mEntity->setCastShadows(true);
+			if (beamRenderer) beamRenderer->setCastShadows(true);
 		}
 
 		if (cabNode)
@@ -4029,33 +4223,24 @@ void Beam::updateSoundSources()
 
 void Beam::updateLabels(float dt)
 {
-	if (netLabelNode && netMT && netMT->isVisible())
-	{
-		// this ensures that the nickname is always in a readable size
-		netLabelNode->setPosition(position+Vector3(0, (maxy-miny), 0));
-		Vector3 vdir=(position)-mCamera->getPosition();
-		float vlen=vdir.length();
-		float h = vlen/30.0;
-		if(h<0.6)
-			h=0.6;
-		netMT->setCharacterHeight(h);
-		if(vlen>1000)
-			netMT->setCaption(networkUsername + "  (" + TOSTRING( (float)(ceil(vlen/100)/10.0) )+ " km)");
-		else if (vlen>20 && vlen <= 1000)
-			netMT->setCaption(networkUsername + "  (" + TOSTRING((int)vlen)+ " m)");
-		else
-			netMT->setCaption(networkUsername);
-
-		//netMT->setAdditionalHeight((maxy-miny)+h+0.1);
-		netMT->setVisible(true);
-	}
+	if (netLabel < 0 || !LabelRenderer::getSingleton().getVisible(netLabel)) return;
+
+	// this ensures that the nickname is always in a readable size
+	LabelRenderer &labels = LabelRenderer::getSingleton();
+	float vlen = position.distance(mCamera->getPosition());
+	labels.setPosition(netLabel, position+Vector3(0, (maxy-miny), 0), std::max(0.6f, vlen/30.0f));
+	if(vlen>1000)
+		labels.setCaption(netLabel, networkUsername + "  (" + TOSTRING( (float)(ceil(vlen/100)/10.0) )+ " km)");
+	else if (vlen>20 && vlen <= 1000)
+		labels.setCaption(netLabel, networkUsername + "  (" + TOSTRING((int)vlen)+ " m)");
+	else
+		labels.setCaption(netLabel, networkUsername);
 }
 
-void Beam::updateVisual(float dt)
+void Beam::updateVisual(float dt, bool withFlexbodies)
 {
 	BES_GFX_START(BES_GFX_updateVisual);
 	int i;
-	Vector3 ref=Vector3(0.0,1.0,0.0);
 	autoBlinkReset();
 	//sounds too
 	updateSoundSources();
@@ -4063,10 +4248,6 @@ void Beam::updateVisual(float dt)
 	if(deleting) return;
 	if(debugVisuals) updateDebugOverlay();
 
-	//dust
-	// UH - design problem, it updates every truck dust D:
-	DustManager::getSingleton().update(WheelSpeed);
-
 #ifdef USE_OPENAL
 	//airplane radio chatter
 	if (driveable == AIRPLANE && state != SLEEPING)
@@ -4122,7 +4303,9 @@ void Beam::updateVisual(float dt)
 		}
 	}
 
-	updateProps();
+	// props, meshes and flexbodies are only moved if the visual LOD wants it, see calcVisualLOD
+	if (visualLodUpdate)
+		updateProps();
 
 	for (i=0; i<free_aeroengine; i++) aeroengines[i]->updateVisuals();
 
@@ -4159,7 +4342,8 @@ void Beam::updateVisual(float dt)
 		if (wings[i].fa->type=='h') wings[i].fa->setControlDeflection((-autoaileron+flapangles[flap])/2.0);
 		if (wings[i].fa->type=='i') wings[i].fa->setControlDeflection((-autoelevator+autorudder)/2.0);
 		if (wings[i].fa->type=='j') wings[i].fa->setControlDeflection((autoelevator+autorudder)/2.0);
-		wings[i].cnode->setPosition(wings[i].fa->flexit());
+		if (visualLodUpdate)
+			wings[i].cnode->setPosition(wings[i].fa->flexit());
 	}
 	//setup commands for hydros
 	hydroaileroncommand=autoaileron;
@@ -4187,44 +4371,37 @@ void Beam::updateVisual(float dt)
 			cabFade(1 - 0.6 * cabFadeTimer/cabFadeTime);
 	}
 
-	if (!skeleton)
+	bool stencil=(tsm->getShadowTechnique()==SHADOWTYPE_STENCIL_MODULATIVE || tsm->getShadowTechnique()==SHADOWTYPE_STENCIL_ADDITIVE);
+	if (!skeleton && visualLodUpdate)
 	{
 		for (i=0; i<free_beam; i++)
 		{
-			if (beams[i].broken==1 && beams[i].mSceneNode) {beams[i].mSceneNode->detachAllObjects();beams[i].broken=2;}
-			if (beams[i].mSceneNode!=0 && beams[i].type!=BEAM_INVISIBLE && beams[i].type!=BEAM_INVISIBLE_HYDRO && beams[i].type!=BEAM_VIRTUAL && !beams[i].disabled)
-			{
-				beams[i].mSceneNode->setPosition(beams[i].p1->smoothpos.midPoint(beams[i].p2->smoothpos));
-				beams[i].mSceneNode->setOrientation(specialGetRotationTo(ref,beams[i].p1->smoothpos-beams[i].p2->smoothpos));
-				//					beams[i].mSceneNode->setScale(default_beam_diameter/100.0,(beams[i].p1->smoothpos-beams[i].p2->smoothpos).length()/100.0,default_beam_diameter/100.0);
-				beams[i].mSceneNode->setScale(beams[i].diameter, (beams[i].p1->smoothpos-beams[i].p2->smoothpos).length(), beams[i].diameter);
-			}
+			if (beams[i].broken==1 && beams[i].mBatch>=0) {beams[i].mVisible=false;beams[i].broken=2;}
 		}
-		for (i=0; i<free_wheel; i++)
+		BES_GFX_START(BES_GFX_updateBeams);
+		if (beamRenderer) beamRenderer->update(beams, 0);
+		BES_GFX_STOP(BES_GFX_updateBeams);
+		if (withFlexbodies)
 		{
-			if(vwheels[i].cnode) vwheels[i].cnode->setPosition(vwheels[i].fm->flexit());
+			updateVisualPositions();
+			computeFlexMeshes(stencil);
+			endFlexMeshes();
 		}
-		if (cabMesh) cabNode->setPosition(cabMesh->flexit());
 	}
-	else
+	else if (skeleton)
 	{
 		if(skeleton)
 		{
-			for (i=0; i<free_beam; i++)
+			BES_GFX_START(BES_GFX_updateBeams);
+			if (beamRenderer) beamRenderer->update(beams, skeleton_beam_diameter);
+			BES_GFX_STOP(BES_GFX_updateBeams);
+			// the caller only deforms the meshes of trucks with a visual LOD update
+			if (withFlexbodies || !visualLodUpdate)
 			{
-				if (beams[i].mSceneNode!=0 && !beams[i].disabled)
-				{
-					beams[i].mSceneNode->setPosition(beams[i].p1->smoothpos.midPoint(beams[i].p2->smoothpos));
-					beams[i].mSceneNode->setOrientation(specialGetRotationTo(ref,beams[i].p1->smoothpos-beams[i].p2->smoothpos));
-					beams[i].mSceneNode->setScale(skeleton_beam_diameter,(beams[i].p1->smoothpos-beams[i].p2->smoothpos).length(),skeleton_beam_diameter);
-					//					beams[i].mSceneNode->setScale(default_beam_diameter/100.0,(beams[i].p1->smoothpos-beams[i].p2->smoothpos).length()/100.0,default_beam_diameter/100.0);
-				}
+				updateVisualPositions();
+				computeFlexMeshes(stencil);
+				endFlexMeshes();
 			}
-			for (i=0; i<free_wheel; i++)
-			{
-				vwheels[i].cnode->setPosition(vwheels[i].fm->flexit());
-			}
-			if (cabMesh) cabNode->setPosition(cabMesh->flexit());
 		}
 		if (skeleton == 2)
 			updateSimpleSkeleton();
@@ -4239,12 +4416,40 @@ void Beam::updateVisual(float dt)
 	//if(!tooFarAway)
 	//{
 	// disabled optimization for now since its buggy :-/
-	for (i=0; i<free_flexbody; i++) flexbodies[i]->flexit();
+	if (withFlexbodies && visualLodUpdate && free_flexbody)
+	{
+		// the snapshot was taken for the cab and wheel meshes above
+		for (i=0; i<free_flexbody; i++) flexbodies[i]->flexit();
+	}
 	//}
 	BES_GFX_STOP(BES_GFX_updateFlexBodies);
 	BES_GFX_STOP(BES_GFX_updateVisual);
 }
 
+void Beam::updateVisualPositions()
+{
+	for (int i=0; i<free_node; i++)
+		visualpos[i] = nodes[i].smoothpos;
+}
+
+void Beam::computeFlexMeshes(bool stencil)
+{
+	for (int i=0; i<free_wheel; i++)
+	{
+		if (vwheels[i].cnode) vwheels[i].fm->computeVertices(stencil);
+	}
+	if (cabMesh) cabMesh->computeVertices(stencil);
+}
+
+void Beam::endFlexMeshes()
+{
+	for (int i=0; i<free_wheel; i++)
+	{
+		if (vwheels[i].cnode) vwheels[i].cnode->setPosition(vwheels[i].fm->endFlexit());
+	}
+	if (cabMesh) cabNode->setPosition(cabMesh->endFlexit());
+}
+
 
 //v=0: full detail
 //v=1: no beams
@@ -4267,24 +4472,6 @@ void Beam::setDetailLevel(int v)
 
 }
 
-void Beam::preMapLabelRenderUpdate(bool mode, float charheight)
-{
-	static float orgcharheight=0;
-	if(mode && netLabelNode)
-	{
-		netMT->showOnTop(true);
-		orgcharheight = netMT->getCharacterHeight();
-		netMT->setCharacterHeight(charheight);
-		//netMT->setAdditionalHeight(0);
-		netMT->setVisible(false);
-	} else if(!mode && netLabelNode)
-	{
-		netMT->showOnTop(false);
-		netMT->setCharacterHeight(orgcharheight);
-		netMT->setVisible(true);
-	}
-}
-
 void Beam::showSkeleton(bool meshes, bool newMode, bool linked)
 {
 	if(lockSkeletonchange)
@@ -4324,15 +4511,11 @@ void Beam::showSkeleton(bool meshes, bool newMode, bool linked)
 	{
 		for (i=0; i<free_beam; i++)
 		{
-			if (beams[i].mSceneNode && beams[i].mEntity)
-			{
-				if (!beams[i].broken && beams[i].mSceneNode->numAttachedObjects()==0)
-					beams[i].mSceneNode->attachObject(beams[i].mEntity);
-				//material
-				beams[i].mEntity->setMaterialName("mat-beam-0");
-				beams[i].mEntity->setCastShadows(false);
-			}
+			if (beams[i].mBatch>=0 && !beams[i].broken)
+				beams[i].mVisible=true;
 		}
+		// coloured by stress
+		if (beamRenderer) beamRenderer->setSkeleton(true);
 	}else
 	{
 		if(simpleSkeletonNode)
@@ -4364,7 +4547,7 @@ void Beam::showSkeleton(bool meshes, bool newMode, bool linked)
 
 	for(std::vector<tie_t>::iterator it=ties.begin(); it!=ties.end(); it++)
 		if (it->beam->disabled)
-			it->beam->mSceneNode->detachAllObjects();
+			it->beam->mVisible = false;
 	
 	if (linked)
 	{
@@ -4417,14 +4600,11 @@ void Beam::hideSkeleton(bool newMode, bool linked)
 	{
 		for (i=0; i<free_beam; i++)
 		{
-			if (beams[i].mSceneNode)
-			{
-				if (beams[i].type==BEAM_VIRTUAL || beams[i].type==BEAM_INVISIBLE || beams[i].type==BEAM_INVISIBLE_HYDRO) beams[i].mSceneNode->detachAllObjects();
-				//material
-				if (beams[i].type==BEAM_HYDRO || beams[i].type==BEAM_MARKED) beams[i].mEntity->setMaterialName("tracks/Chrome");
-				else beams[i].mEntity->setMaterialName(default_beam_material);
-			}
+			if (beams[i].mBatch>=0 && (beams[i].type==BEAM_VIRTUAL || beams[i].type==BEAM_INVISIBLE || beams[i].type==BEAM_INVISIBLE_HYDRO))
+				beams[i].mVisible=false;
 		}
+		// back to the materials of the beams
+		if (beamRenderer) beamRenderer->setSkeleton(false);
 	}else
 	{
 		if(simpleSkeletonNode)
@@ -4453,7 +4633,7 @@ void Beam::hideSkeleton(bool newMode, bool linked)
 
 	for(std::vector<tie_t>::iterator it=ties.begin(); it!=ties.end(); it++)
 		if (it->beam->disabled)
-			it->beam->mSceneNode->detachAllObjects();
+			it->beam->mVisible = false;
 
 	if (linked)
 	{
@@ -4547,13 +4727,8 @@ void Beam::setMeshWireframe(SceneNode *node, bool value)
 
 void Beam::setBeamVisibility(bool visible, bool linked)
 {
-	for (int i=0; i < free_beam; i++)
-	{
-		if (beams[i].mSceneNode)
-		{
-			beams[i].mSceneNode->setVisible(visible);
-		}
-	}
+	if (beamRenderer)
+		beamRenderer->setVisible(visible);
 
 	beamsVisible = visible;
 
@@ -4686,7 +4861,7 @@ void Beam::tieToggle(int group)
 			it->beam->p2 = &nodes[0];
 			it->beam->p2truck = 0;
 			it->beam->disabled = 1;
-			it->beam->mSceneNode->detachAllObjects();
+			it->beam->mVisible = false;
 			istied = true;
 		}
 	}
@@ -4741,8 +4916,7 @@ void Beam::tieToggle(int group)
 
 					// enable the beam and visually display the beam
 					it->beam->disabled = 0;
-					if (it->beam->mSceneNode->numAttachedObjects() == 0)
-						it->beam->mSceneNode->attachObject(it->beam->mEntity);
+					it->beam->mVisible = true;
 
 					// now trigger the tying action
 					it->beam->p2 = shorter;
@@ -4889,7 +5063,7 @@ void Beam::hookToggle(int group, int mode, int node_number)
 				it->timer = it->timer_preset;	//timer reset for autolock nodes
 
 			//disable hook-assistance beam
-			it->beam->mSceneNode->detachAllObjects();
+			it->beam->mVisible = false;
 			it->beam->p2       = &nodes[0];
 			it->beam->p2truck  = 0;
 			it->beam->L        = (nodes[0].AbsPosition - it->hookNode->AbsPosition).length();
@@ -5353,56 +5527,13 @@ void Beam::updateNetworkInfo()
 		networkAuthlevel = info->authstatus;
 	}
 
-	if (netLabelNode && netMT)
-	{
-		// ha, this caused the empty caption bug, but fixed now since we change the caption if its empty:
-		netMT->setCaption(networkUsername);
-		/*
-		if(networkAuthlevel & AUTH_ADMIN)
-		{
-			netMT->setFontName("highcontrast_red");
-		} else if(networkAuthlevel & AUTH_RANKED)
-		{
-			netMT->setFontName("highcontrast_green");
-		} else
-		{
-			netMT->setFontName("highcontrast_black");
-		}
-		*/
-		netLabelNode->setVisible(true);
-	}
-	else
-	{
-		char wname[256];
-		sprintf(wname, "netlabel-%s", truckname);
-		netMT = new MovableText(wname, networkUsername);
-		netMT->setFontName("CyberbitEnglish");
-		netMT->setTextAlignment(MovableText::H_CENTER, MovableText::V_ABOVE);
-		//netMT->setAdditionalHeight(2);
-		netMT->showOnTop(false);
-		netMT->setCharacterHeight(2);
-		netMT->setColor(ColourValue::Black);
-
-		/*
-		if(networkAuthlevel & AUTH_ADMIN)
-		{
-			netMT->setFontName("highcontrast_red");
-		} else if(networkAuthlevel & AUTH_RANKED)
-		{
-			netMT->setFontName("highcontrast_green");
-		} else
-		{
-			netMT->setFontName("highcontrast_black");
-		}
-		*/
-
-		netLabelNode=parentNode->createChildSceneNode();
-		netLabelNode->attachObject(netMT);
-		netLabelNode->setPosition(position);
-		netLabelNode->setVisible(true);
-		deletion_sceneNodes.push_back(netLabelNode);
-		deletion_Objects.push_back(netMT);
-	}
+	if (!LabelRenderer::singletonExists()) return;
+	LabelRenderer &labels = LabelRenderer::getSingleton();
+	if (netLabel < 0)
+		netLabel = labels.addLabel(ColourValue::Black);
+	labels.setCaption(netLabel, networkUsername);
+	labels.setPosition(netLabel, position, 2);
+	labels.setVisible(netLabel, true);
 #endif //SOCKETW
 	BES_GFX_STOP(BES_GFX_updateNetworkInfo);
 }
@@ -5412,9 +5543,9 @@ void Beam::deleteNetTruck()
 	// TODO: properly delete things ...
 	//park and recycle vehicle
 	state=RECYCLE;
-	netMT->setVisible(false);
+	if (netLabel >= 0)
+		LabelRenderer::getSingleton().setVisible(netLabel, false);
 	resetPosition(100000, 100000, false, 100000);
-	netLabelNode->setVisible(false);
 	updateVisual();
 }
 
@@ -74,9 +74,17 @@ public:
 	//! @{ network related functions
 	void pushNetwork(char* data, int size);
 	void calcNetwork();
+	void calcNetworkLOD(float dt);
+	bool netLodVisualStep(float &dt);
 	void updateNetworkInfo();
 	//! @}
 
+	//! @{ visual LOD: decides if updateVisual() deforms the meshes this frame, the current truck always does
+	void calcVisualLOD(float dt, bool isCurrent, const std::vector<Ogre::Camera *> &cameras);
+	int getVisualLOD() { return visualLodLevel; };
+	bool getVisualLODUpdate() { return visualLodUpdate; };
+	//! @}
+
 	//! @{ physic related functions
 	void activate();
 	void desactivate();
@@ -143,7 +151,10 @@ public:
 	void prepareInside(bool inside);
 	void updateFlares(float dt, bool isCurrent=false);
 	void updateProps();
-	void updateVisual(float dt=0);
+	void updateVisual(float dt=0, bool withFlexbodies=true); // withFlexbodies=false leaves them and the cab and wheel meshes to the caller, call BeamFactory::finishVisualPrep() first
+	void updateVisualPositions(); // copies smoothpos to the snapshot the flexbodies, the cab and the wheel meshes read
+	void computeFlexMeshes(bool stencil); // deforms the cab and wheel meshes from the snapshot, may run on any thread
+	void endFlexMeshes(); // uploads them and moves their scene nodes, render thread only
 	void updateLabels(float dt=0);
 	//v=0: full detail
 	//v=1: no beams
@@ -238,6 +249,21 @@ public:
 	static int thread_mode;
 	static int free_tb;
 
+	//! @{ network LOD policy, configured by the BeamFactory
+	static bool  netLodEnabled;
+	static float netLodDistance;      //!< beyond this, remote trucks are interpolated and drawn at a reduced rate
+	static float netLodRigidDistance; //!< beyond this, remote trucks are moved as a rigid body
+	static float netLodInterval;      //!< seconds between two network interpolations when not at full detail
+	static float netLodVisualInterval;//!< seconds between two visual updates when not at full detail
+	static float netLodBlendTime;     //!< seconds used to blend between two LOD levels
+	//! @}
+
+	//! @{ visual LOD policy, configured by the BeamFactory
+	static bool  visualLodEnabled;
+	static float visualLodDistance;   //!< beyond this, meshes and flexbodies are updated at a reduced rate
+	static float visualLodInterval;   //!< seconds between two updates at visualLodDistance, grows linearly with the distance
+	//! @}
+
 	bool hasDriverSeat();
 	int calculateDriverPos(Ogre::Vector3 &pos, Ogre::Quaternion &rot);
 	float getSteeringAngle();
@@ -258,7 +284,7 @@ public:
 	int first_wheel_node;
 	int netbuffersize;
 	int nodebuffersize;
-	Ogre::SceneNode *netLabelNode;
+	int netLabel;                  //!< handle in the LabelRenderer, -1 without a label
 
 	std::string getTruckName();
 	std::string getTruckFileName();
@@ -314,7 +340,6 @@ public:
 	float getHeadingDirectionAngle();
 	bool getCustomParticleMode();
 	int getLowestNode();
-	void preMapLabelRenderUpdate(bool mode, float cheight=0);
 	
 	float tdt;
 	float ttdt;
@@ -416,7 +441,6 @@ protected:
 	Ogre::Timer *nettimer;
 	int net_toffset;
 	int netcounter;
-	Ogre::MovableText *netMT; //, *netDist;
 
 	// network properties
 	Ogre::String networkUsername;
@@ -425,6 +449,24 @@ protected:
 	bool netBrakeLight, netReverseLight;
 	Ogre::Real mTimeUntilNextToggle;
 
+	// network LOD state
+	int netLodLevel;
+	float netLodTimer;
+	float netLodVisualTimer;
+	float netLodBlend;
+	int netLodRigidRef[2];
+	std::vector<Ogre::Vector3> netLodRigidLocal;   //!< node positions in the rigid frame, captured when entering NETLOD_RIGID
+	std::vector<Ogre::Vector3> netLodBlendOffset;  //!< node offsets to node 0 at the last LOD switch
+	void setNetworkLOD(int level);
+
+	// visual LOD state
+	int visualLodLevel;
+	float visualLodTimer;
+	bool visualLodUpdate;
+	Ogre::Vector3 visualLodDrawnPos;   //!< position at the last visual update, where the meshes still are
+	Ogre::Vector3 getNetNodePosition(char *netb, int node);
+	Ogre::Quaternion getNetLodFrame(const Ogre::Vector3 &p0, const Ogre::Vector3 &pa, const Ogre::Vector3 &pb);
+
 	void checkBeamMaterial();
 
 	// cab fading stuff - begin
@@ -462,6 +504,7 @@ protected:
 	int last_net_time;
 	void sendStreamSetup();
 	void receiveStreamData(unsigned int &type, int &source, unsigned int &streamid, char *buffer, unsigned int &len);
+	Ogre::String getStreamName() { return Ogre::String(truckname); };
 
 	// dustpools
 	DustPool *dustp;
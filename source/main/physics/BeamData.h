@@ -249,6 +249,18 @@ enum {
 	DELETED,        //!< special used when truck pointer is 0
 };
 
+enum {
+	NETLOD_FULL,    //!< remote truck interpolated and drawn every frame
+	NETLOD_REDUCED, //!< remote truck interpolated and drawn at a reduced rate
+	NETLOD_RIGID    //!< remote truck collapsed to a rigid transform of node 0
+};
+
+enum {
+	VISLOD_FULL,    //!< meshes and flexbodies updated every frame
+	VISLOD_REDUCED, //!< far away or only casting shadows, meshes and flexbodies updated at a reduced rate
+	VISLOD_CULLED   //!< the truck and its last drawn position are outside of the view and there are no shadows, nothing is updated
+};
+
 enum {
 	UNLOCKED,       //!< lock not locked
 	PRELOCK,        //!< prelocking, attraction forces in action
@@ -487,8 +499,8 @@ struct beam
 	float minendmass;
 	float scale;
 	shock_t *shock;
-	Ogre::SceneNode *mSceneNode; //!< visual
-	Ogre::Entity *mEntity; //!< visual
+	int mBatch; //!< visual, batch of the BeamRenderer that draws the beam, -1 if it has no visual
+	bool mVisible; //!< visual
 };
 
 struct soundsource
@@ -840,6 +852,7 @@ struct rig
 
 	FlexBody *flexbodies[MAX_FLEXBODIES];
 	int free_flexbody;
+	Ogre::Vector3 visualpos[MAX_NODES]; //!< node positions the flexbodies are deformed with, copied from smoothpos
 
 	std::vector <VideoCamera *> vidcams;
 
@@ -980,6 +993,7 @@ struct rig
 
 	Ogre::Vector3 origin;
 	Ogre::SceneNode *beamsRoot;
+	BeamRenderer *beamRenderer;
 	//! Stores all the SlideNodes available on this truck
 	std::vector< SlideNode > mSlideNodes;
 
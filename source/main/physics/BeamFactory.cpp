@@ -23,11 +23,18 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 #include "BeamFactory.h"
 
 #include "BeamEngine.h"
+#include "CacheSystem.h"
 #include "collisions.h"
+#include "DustManager.h"
+#include "FlexBody.h"
 #include "network.h"
+#include "RigSourceCache.h"
 #include "RoRFrameListener.h"
 #include "Settings.h"
+#include "skin.h"
+#include "Skidmark.h"
 #include "SoundScriptManager.h"
+#include "ThreadPool.h"
 
 #ifdef USE_MYGUI
 #include "gui_mp.h"
@@ -40,6 +47,45 @@ using namespace Ogre;
 
 template<> BeamFactory *StreamableFactory < BeamFactory, Beam >::_instance = 0;
 
+// upper bounds of the spawn latency histogram buckets in ms, the last bucket is open
+static const unsigned long spawn_latency_limits[] = {50, 100, 250, 500, 1000, 2000, 5000};
+
+// adds the mesh names used in a truck file line
+static void collectMeshNames(const String &line, std::set < String > &meshes)
+{
+	if (line.empty() || line[0] == ';' || line[0] == '/')
+		return;
+
+	StringVector args = StringUtil::split(line, ", \t:|");
+	for (unsigned int i = 0; i < args.size(); i++)
+	{
+		if (StringUtil::endsWith(args[i], ".mesh"))
+			meshes.insert(args[i]);
+	}
+}
+
+void *s_localspawnthread(void *vspawn)
+{
+	BeamFactory::local_spawn_t *spawn = (BeamFactory::local_spawn_t *)vspawn;
+
+	// reading and hashing the truck file can take a while for big trucks, the result is
+	// stored in the RigSourceCache so loadTruck does not need to do it again
+	try
+	{
+		const compiled_rig_t *source = RigSourceCache::getSingleton().compile(spawn->fname, spawn->key, spawn->ds, spawn->rig);
+		for (size_t i = 0; i < source->lines.size(); i++)
+			collectMeshNames(source->lines[i].line, spawn->meshes);
+	} catch(Ogre::Exception& e)
+	{
+		LOG("error while preparing truck " + spawn->fname + ": " + e.getFullDescription());
+	}
+
+	MUTEX_LOCK(spawn->mutex);
+	spawn->threadDone = true;
+	MUTEX_UNLOCK(spawn->mutex);
+	return NULL;
+}
+
 BeamFactory::BeamFactory(SceneManager *manager, SceneNode *parent, RenderWindow* win, Network *net, float *mapsizex, float *mapsizez, Collisions *icollisions, HeightFinder *mfinder, Water *w, Camera *pcam) :
 	  manager(manager)
 	, parent(parent)
@@ -52,9 +98,19 @@ BeamFactory::BeamFactory(SceneManager *manager, SceneNode *parent, RenderWindow*
 	, w(w)
 	, pcam(pcam)
 	, current_truck(-1)
+	, flexbodyComputeTime(0)
+	, flexbodyFrames(0)
+	, flexbodyPool(0)
+	, flexbodyUploadTime(0)
+	, flexbodyVertices(0)
 	, free_truck(0)
+	, localLoadingAsync(true)
 	, physFrame(0)
+	, remoteLoadingAsync(true)
+	, remoteSpawnBudget(1)
 	, tdr(0)
+	, visualPrepEnabled(false)
+	, visualPrepRunning(false)
 {
 	for (int t=0; t < MAX_TRUCKS; t++)
 		trucks[t] = 0;
@@ -62,12 +118,56 @@ BeamFactory::BeamFactory(SceneManager *manager, SceneNode *parent, RenderWindow*
 	if (BSETTING("Multi-threading", true))
 		Beam::thread_mode = THREAD_MULTI;
 
+	// distance based LOD for remote trucks
+	Beam::netLodEnabled        = BSETTING("Network LOD", true);
+	Beam::netLodDistance       = FSETTING("Network LOD Distance", 150.0f);
+	Beam::netLodRigidDistance  = FSETTING("Network LOD Rigid Distance", 500.0f);
+	Beam::netLodInterval       = 1.0f / std::max(1.0f, FSETTING("Network LOD Rate", 10.0f));
+	Beam::netLodVisualInterval = 1.0f / std::max(1.0f, FSETTING("Network LOD Visual Rate", 10.0f));
+	Beam::netLodBlendTime      = FSETTING("Network LOD Blend Time", 0.5f);
+
+	// trucks outside of the view are not deformed, distant ones at a reduced rate
+	Beam::visualLodEnabled     = BSETTING("Visual LOD", true);
+	Beam::visualLodDistance    = FSETTING("Visual LOD Distance", 200.0f);
+	Beam::visualLodInterval    = 1.0f / std::max(1.0f, FSETTING("Visual LOD Rate", 20.0f));
+	memset(&visualStats, 0, sizeof(visualStats));
+
+	remoteLoadingAsync = BSETTING("Background Remote Truck Loading", true);
+	localLoadingAsync  = BSETTING("Background Truck Loading", true);
+	pthread_mutex_init(&localSpawnMutex, NULL);
+	memset(spawnLatency, 0, sizeof(spawnLatency));
+
 	if (BSETTING("2DReplay", false))
 		tdr = new TwoDReplay();
+
+	// 0 uses one thread per cpu, 1 deforms the flexbodies of each truck in its updateVisual like before
+	int flexbodyThreads = ISETTING("Flexbody Threads", 0);
+	if (flexbodyThreads != 1)
+		flexbodyPool = new ThreadPool(flexbodyThreads);
+	visualPrepEnabled = flexbodyPool && BSETTING("Background Flexbodies", true);
+
+	// the skidmarks of all trucks are drawn in a few shared batches
+	if (BSETTING("Skidmarks", false))
+		SkidmarkManager::getSingleton().init(manager);
 }
 
 BeamFactory::~BeamFactory()
 {
+	for (std::list < local_spawn_t * >::iterator it = localSpawns.begin(); it != localSpawns.end(); it++)
+	{
+		if ((*it)->state == LOCAL_SPAWN_SOURCE)
+			pthread_join((*it)->thread, NULL);
+		delete *it;
+	}
+	localSpawns.clear();
+	pthread_mutex_destroy(&localSpawnMutex);
+
+	finishVisualPrep();
+	if (flexbodyPool)
+	{
+		delete flexbodyPool;
+		flexbodyPool = 0;
+	}
 }
 
 Beam *BeamFactory::createLocal(int slotid)
@@ -115,6 +215,7 @@ Beam *BeamFactory::createLocal(Vector3 pos, Quaternion rot, String fname, collis
 		return 0;
 	}
 
+	unsigned long started = Root::getSingleton().getTimer()->getMilliseconds();
 	Beam *b = new Beam(
 		truck_num,
 		manager,
@@ -142,6 +243,7 @@ Beam *BeamFactory::createLocal(Vector3 pos, Quaternion rot, String fname, collis
 		freePosition);
 
 	trucks[truck_num] = b;
+	LOG("created truck " + fname + " in " + TOSTRING(Root::getSingleton().getTimer()->getMilliseconds() - started) + " ms");
 
 	// lock slide nodes after spawning the truck?
 	if (b->getSlideNodesLockInstant())
@@ -164,6 +266,7 @@ Beam *BeamFactory::createLocal(Vector3 pos, Quaternion rot, String fname, collis
 		b->updateNetworkInfo();
 	}
 
+	trimResources();
 	return b;
 }
 
@@ -272,6 +375,7 @@ Beam *BeamFactory::createRemoteInstance(stream_reg_t *reg)
 	GUI_MainMenu::getSingleton().triggerUpdateVehicleList();
 #endif // USE_MYGUI
 
+	trimResources();
 	return b;
 }
 
@@ -328,6 +432,10 @@ bool BeamFactory::syncRemoteStreams()
 {
 	// we override this here, so we know if something changed and could update the player list
 	// we delete and add trucks in there, so be sure that nothing runs as we delete them ...
+
+	// create at most one prepared remote truck per frame, so several spawns do not add up to a long hitch
+	remoteSpawnBudget = 1;
+
 	bool changes = StreamableFactory <BeamFactory, Beam>::syncRemoteStreams();
 	
 	if (changes)
@@ -336,6 +444,291 @@ bool BeamFactory::syncRemoteStreams()
 	return changes;
 }
 
+bool BeamFactory::isRemoteInstanceReady(stream_reg_t *reg)
+{
+	// NO LOCKS IN HERE, already locked
+	if (!remoteLoadingAsync || reg->reg.type != 0) return true;
+
+	std::pair < int, int > key(reg->sourceid, reg->streamid);
+	std::map < std::pair < int, int >, remote_load_t >::iterator it = remoteLoads.find(key);
+	if (it == remoteLoads.end())
+	{
+		remote_load_t load;
+		load.started = Root::getSingleton().getTimer()->getMilliseconds();
+		prepareRemoteResources(reg, load);
+		remoteLoads[key] = load;
+		// give the background queue at least one frame
+		return false;
+	}
+
+	bool timeout = (Root::getSingleton().getTimer()->getMilliseconds() - it->second.started > remoteLoadTimeout);
+	std::vector < BackgroundProcessTicket > &tickets = it->second.tickets;
+	while (!tickets.empty() && !timeout)
+	{
+		if (!ResourceBackgroundQueue::getSingleton().isProcessComplete(tickets.back()))
+			return false;
+		tickets.pop_back();
+	}
+
+	if (remoteSpawnBudget <= 0)
+		return false;
+	remoteSpawnBudget--;
+
+	if (timeout)
+		LOG("remote truck " + TOSTRING(reg->sourceid) + ":" + TOSTRING(reg->streamid) + " is created before its resources are prepared");
+
+	remoteLoads.erase(it);
+	return true;
+}
+
+void BeamFactory::remoteInstanceCancelled(stream_reg_t *reg)
+{
+	// NO LOCKS IN HERE, already locked
+	remoteLoads.erase(std::pair < int, int >(reg->sourceid, reg->streamid));
+}
+
+void BeamFactory::prepareRemoteResources(stream_reg_t *reg, remote_load_t &load)
+{
+	stream_register_trucks_t *treg = (stream_register_trucks_t *)&reg->reg;
+	String filename = String(treg->name);
+	String group = "";
+	if (!CACHE.checkResourceLoaded(filename, group))
+		return; // createRemoteInstance will report the missing truck
+
+	// the truck file is small, but its meshes are not: collect them and let the
+	// background queue read them from disk while the game keeps running
+	std::set < String > meshes;
+	try
+	{
+		DataStreamPtr ds = ResourceGroupManager::getSingleton().openResource(filename, group);
+		while (!ds->eof())
+			collectMeshNames(ds->getLine(), meshes);
+	} catch(Ogre::Exception& e)
+	{
+		LOG("error while scanning remote truck " + filename + ": " + e.getFullDescription());
+		return;
+	}
+
+	prepareMeshes(meshes, load.tickets);
+	LOG("preparing " + TOSTRING(load.tickets.size()) + " meshes for remote truck " + filename + " in the background");
+}
+
+void BeamFactory::prepareMeshes(std::set < String > &meshes, std::vector < BackgroundProcessTicket > &tickets)
+{
+	for (std::set < String >::iterator it = meshes.begin(); it != meshes.end(); it++)
+	{
+		if (MeshManager::getSingleton().resourceExists(*it))
+			continue;
+
+		String meshgroup = "";
+		try
+		{
+			meshgroup = ResourceGroupManager::getSingleton().findGroupContainingResource(*it);
+		} catch(...)
+		{
+		}
+		if (meshgroup.empty())
+			continue;
+
+		tickets.push_back(ResourceBackgroundQueue::getSingleton().prepare(MeshManager::getSingleton().getResourceType(), *it, meshgroup));
+	}
+}
+
+bool BeamFactory::createLocalAsync(Vector3 pos, Quaternion rot, String fname, collision_box_t *spawnbox, bool ismachine, int flareMode, std::vector<String> *truckconfig, Skin *skin, bool freePosition)
+{
+	if (!localLoadingAsync)
+		return createLocal(pos, rot, fname, spawnbox, ismachine, flareMode, truckconfig, skin, freePosition) != 0;
+
+	local_spawn_t *spawn = new local_spawn_t();
+	spawn->pos            = pos;
+	spawn->rot            = rot;
+	spawn->fname          = fname;
+	spawn->spawnbox       = spawnbox;
+	spawn->ismachine      = ismachine;
+	spawn->flareMode      = flareMode;
+	spawn->hasTruckconfig = (truckconfig != 0);
+	if (truckconfig)
+		spawn->truckconfig = *truckconfig;
+	spawn->skin           = skin;
+	spawn->freePosition   = freePosition;
+	spawn->mutex          = &localSpawnMutex;
+	spawn->threadDone     = false;
+	spawn->started        = Root::getSingleton().getTimer()->getMilliseconds();
+	spawn->sourceReady    = spawn->started;
+	spawn->state          = LOCAL_SPAWN_RESOURCES;
+
+	// the cache and the resource groups are not thread safe, so look everything up here
+	String group = "";
+	if (CACHE.checkResourceLoaded(spawn->fname, group))
+	{
+		spawn->key = RigSourceCache::getKey(spawn->fname, group);
+		const compiled_rig_t *source = RigSourceCache::getSingleton().get(spawn->fname, spawn->key);
+		if (source)
+		{
+			for (size_t i = 0; i < source->lines.size(); i++)
+				collectMeshNames(source->lines[i].line, spawn->meshes);
+		} else
+		{
+			try
+			{
+				// archive streams share state with their archive (i.e. the zip handle), so the file is read
+				// into memory right here. The thread only works on that copy
+				DataStreamPtr file = ResourceGroupManager::getSingleton().openResource(spawn->fname, group);
+				spawn->ds = DataStreamPtr(new MemoryDataStream(file, true));
+			} catch(Ogre::Exception& e)
+			{
+				LOG("error while opening truck " + spawn->fname + ": " + e.getFullDescription());
+			}
+			if (!spawn->ds.isNull() && !pthread_create(&spawn->thread, NULL, s_localspawnthread, (void *)spawn))
+				spawn->state = LOCAL_SPAWN_SOURCE;
+			else
+				spawn->ds.setNull();
+		}
+	}
+	// if anything went wrong, the truck is created right away and loadTruck reports the error
+
+	if (spawn->state == LOCAL_SPAWN_RESOURCES)
+		prepareMeshes(spawn->meshes, spawn->tickets);
+
+	localSpawns.push_back(spawn);
+	return true;
+}
+
+Beam *BeamFactory::updateLocalSpawns()
+{
+	unsigned long now = Root::getSingleton().getTimer()->getMilliseconds();
+	for (std::list < local_spawn_t * >::iterator it = localSpawns.begin(); it != localSpawns.end(); it++)
+	{
+		local_spawn_t *spawn = *it;
+		if (spawn->state == LOCAL_SPAWN_SOURCE)
+		{
+			MUTEX_LOCK(&localSpawnMutex);
+			bool done = spawn->threadDone;
+			MUTEX_UNLOCK(&localSpawnMutex);
+			if (!done)
+				continue;
+
+			pthread_join(spawn->thread, NULL);
+			spawn->ds.setNull();
+			spawn->sourceReady = now;
+			spawn->state = LOCAL_SPAWN_RESOURCES;
+			prepareMeshes(spawn->meshes, spawn->tickets);
+			// give the background queue at least one frame
+			continue;
+		}
+
+		bool timeout = (now - spawn->sourceReady > localLoadTimeout);
+		bool ready = true;
+		while (!spawn->tickets.empty() && !timeout)
+		{
+			if (!ResourceBackgroundQueue::getSingleton().isProcessComplete(spawn->tickets.back()))
+			{
+				ready = false;
+				break;
+			}
+			spawn->tickets.pop_back();
+		}
+		if (!ready)
+			continue;
+
+		if (timeout)
+			LOG("truck " + spawn->fname + " is created before its meshes are prepared");
+
+		// one truck per frame, the others follow in the next frames
+		localSpawns.erase(it);
+		unsigned long resourcesReady = Root::getSingleton().getTimer()->getMilliseconds();
+		Beam *b = createLocal(spawn->pos, spawn->rot, spawn->fname, spawn->spawnbox, spawn->ismachine, spawn->flareMode, spawn->hasTruckconfig ? &spawn->truckconfig : 0, spawn->skin, spawn->freePosition);
+		unsigned long finished = Root::getSingleton().getTimer()->getMilliseconds();
+
+		LOG("spawned truck " + spawn->fname + " after " + TOSTRING(finished - spawn->started) + " ms (source: " + TOSTRING(spawn->sourceReady - spawn->started)
+			+ " ms, resources: " + TOSTRING(resourcesReady - spawn->sourceReady) + " ms, creation: " + TOSTRING(finished - resourcesReady) + " ms)");
+		addSpawnLatency(finished - spawn->started);
+		delete spawn;
+		return b;
+	}
+	return 0;
+}
+
+void BeamFactory::addSpawnLatency(unsigned long ms)
+{
+	int bucket = 0;
+	while (bucket < SPAWN_LATENCY_BUCKETS - 1 && ms >= spawn_latency_limits[bucket])
+		bucket++;
+	spawnLatency[bucket]++;
+
+	String str = "spawn latency histogram:";
+	for (int i = 0; i < SPAWN_LATENCY_BUCKETS; i++)
+	{
+		if (i < SPAWN_LATENCY_BUCKETS - 1)
+			str += " <" + TOSTRING(spawn_latency_limits[i]) + "ms: ";
+		else
+			str += " >=" + TOSTRING(spawn_latency_limits[i - 1]) + "ms: ";
+		str += TOSTRING(spawnLatency[i]);
+	}
+	LOG(str);
+}
+
+void BeamFactory::trimResources()
+{
+	if (!CACHE.isResourceBudgetExceeded())
+		return;
+
+	std::set < String > usedGroups;
+	for (int t = 0; t < free_truck; t++)
+	{
+		if (!trucks[t]) continue;
+		try
+		{
+			usedGroups.insert(ResourceGroupManager::getSingleton().findGroupContainingResource(trucks[t]->getTruckFileName()));
+		} catch(...)
+		{
+		}
+		if (trucks[t]->usedSkin)
+			usedGroups.insert(trucks[t]->usedSkin->getGroup());
+	}
+	// trucks use meshes, materials and textures from other groups as well, i.e. shared props or skins
+	collectSceneResourceGroups(usedGroups);
+	CACHE.trimResourceGroups(usedGroups);
+}
+
+void BeamFactory::collectSceneResourceGroups(std::set < String > &groups)
+{
+	SceneManager::MovableObjectIterator it = manager->getMovableObjectIterator(EntityFactory::FACTORY_TYPE_NAME);
+	while (it.hasMoreElements())
+	{
+		Entity *e = static_cast<Entity *>(it.getNext());
+		if (!e->getMesh().isNull())
+			groups.insert(e->getMesh()->getGroup());
+
+		for (unsigned int i = 0; i < e->getNumSubEntities(); i++)
+		{
+			MaterialPtr mat = e->getSubEntity(i)->getMaterial();
+			if (mat.isNull()) continue;
+			groups.insert(mat->getGroup());
+
+			Material::TechniqueIterator techniques = mat->getTechniqueIterator();
+			while (techniques.hasMoreElements())
+			{
+				Technique::PassIterator passes = techniques.getNext()->getPassIterator();
+				while (passes.hasMoreElements())
+				{
+					Pass::TextureUnitStateIterator units = passes.getNext()->getTextureUnitStateIterator();
+					while (units.hasMoreElements())
+					{
+						TextureUnitState *tus = units.getNext();
+						for (unsigned int f = 0; f < tus->getNumFrames(); f++)
+						{
+							ResourcePtr tex = TextureManager::getSingleton().getByName(tus->getFrameTextureName(f));
+							if (!tex.isNull())
+								groups.insert(tex->getGroup());
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
 void BeamFactory::updateGUI()
 {
 #ifdef USE_MYGUI
@@ -510,6 +903,7 @@ void BeamFactory::repairTruck(Collisions *collisions, char* inst, char* box, boo
 		Vector3 ipos=trucks[rtruck]->nodes[0].AbsPosition;
 		trucks[rtruck]->reset();
 		trucks[rtruck]->resetPosition(ipos.x, ipos.z, false);
+		finishVisualPrep();
 		trucks[rtruck]->updateVisual();
 	}
 }
@@ -542,10 +936,17 @@ void BeamFactory::_deleteTruck(Beam *b)
 {
 	if (b == 0)	return;
 
+	// the render prep might still use its flexbodies
+	finishVisualPrep();
+	visualPrepTrucks[b->trucknum] = false;
+	visualPrepared[b->trucknum] = false;
+
 	trucks[b->trucknum] = 0;
 	delete b;
 	b = 0;
 
+	trimResources();
+
 #ifdef USE_MYGUI
 	GUI_MainMenu::getSingleton().triggerUpdateVehicleList();
 #endif // USE_MYGUI
@@ -596,6 +997,25 @@ bool BeamFactory::enterRescueTruck()
 
 void BeamFactory::updateVisual(float dt)
 {
+	// applies what the render prep computed since the last frame
+	finishVisualPrep();
+
+	flexbodyBatch.clear();
+	flexmeshBatch.clear();
+	memset(&visualStats, 0, sizeof(visualStats));
+
+	// mirrors, videocameras, reflections and the envmap draw the trucks as well. Trucks are only
+	// culled if none of the cameras that render into an active target can see them
+	visualLodCameras.clear();
+	SceneManager::CameraIterator camit = manager->getCameraIterator();
+	while (camit.hasMoreElements())
+	{
+		Camera *cam = camit.getNext();
+		Viewport *vp = cam->getViewport();
+		if (vp && vp->getTarget() && vp->getTarget()->isActive())
+			visualLodCameras.push_back(cam);
+	}
+
 	for (int t=0; t < free_truck; t++)
 	{
 		if (!trucks[t]) continue;
@@ -605,13 +1025,217 @@ void BeamFactory::updateVisual(float dt)
 
 		if (trucks[t]->state != SLEEPING && trucks[t]->loading_finished)
 		{
+			// distant remote trucks are only drawn at a reduced rate
+			float tdt = dt;
+			if (trucks[t]->state == NETWORKED && !trucks[t]->netLodVisualStep(tdt))
+				continue;
+
+			trucks[t]->calcVisualLOD(tdt, (t==current_truck), visualLodCameras);
 			trucks[t]->updateSkidmarks();
-			trucks[t]->updateVisual(dt);
-			trucks[t]->updateFlares(dt, (t==current_truck) );
+			trucks[t]->updateVisual(tdt, !flexbodyPool);
+			trucks[t]->updateFlares(tdt, (t==current_truck) );
+
+			// prepared trucks are done already, the others are deformed in the batch below
+			bool update = trucks[t]->getVisualLODUpdate();
+			if (update && !visualPrepared[t] && flexbodyPool)
+			{
+				trucks[t]->updateVisualPositions();
+				flexmeshBatch.push_back(trucks[t]);
+			}
+			for (int i=0; i < trucks[t]->free_flexbody; i++)
+			{
+				FlexBody *fb = trucks[t]->flexbodies[i];
+				visualStats.vertices += fb->getVertexCount();
+				if (visualPrepared[t])
+				{
+					if (fb->wasDeformed())
+						visualStats.skinned += fb->getVertexCount();
+				} else if (update)
+				{
+					flexbodyBatch.push_back(fb);
+				}
+			}
+			visualPrepTrucks[t] = visualPrepEnabled && update;
+			visualStats.trucks++;
+			if (trucks[t]->getVisualLOD() == VISLOD_CULLED)
+				visualStats.culled++;
+			else if (trucks[t]->getVisualLOD() == VISLOD_REDUCED)
+				visualStats.reduced++;
+		}
+	}
+	visualPrepared.reset();
+
+	if (flexbodyPool && (!flexbodyBatch.empty() || !flexmeshBatch.empty()))
+		updateFlexbodies();
+
+	// flexbodies that only moved as a whole were not deformed again
+	for (size_t i=0; i < flexbodyBatch.size(); i++)
+	{
+		if (flexbodyBatch[i]->wasDeformed())
+			visualStats.skinned += flexbodyBatch[i]->getVertexCount();
+	}
+
+	if (SkidmarkManager::singletonExists())
+		SkidmarkManager::getSingleton().update(dt);
+
+	// the particles of all trucks, the physics queued them since the last frame
+	if (DustManager::singletonExists())
+	{
+		float wheelSpeed = 0;
+		if (current_truck >= 0 && current_truck < free_truck && trucks[current_truck])
+			wheelSpeed = trucks[current_truck]->WheelSpeed;
+		DustManager::getSingleton().update(wheelSpeed);
+	}
+
+	if (flexbodyPool)
+		logFlexbodyStats();
+}
+
+void BeamFactory::flexbodyJob(void *data, int index)
+{
+	flexbody_job_t &job = (*(std::vector < flexbody_job_t > *)data)[index];
+	if (job.truck)
+		job.truck->computeFlexMeshes(job.stencil);
+	else
+		job.flexbody->computeVertices(job.from, job.to);
+}
+
+void BeamFactory::addFlexbodyJobs(FlexBody *fb)
+{
+	if (!fb->beginFlexit())
+		return;
+	int count = fb->getVertexCount();
+	for (int from=0; from < count; from += flexbodyChunkSize)
+	{
+		flexbody_job_t job;
+		job.flexbody = fb;
+		job.from     = from;
+		job.to       = std::min(count, from + flexbodyChunkSize);
+		job.truck    = 0;
+		job.stencil  = false;
+		flexbodyJobs.push_back(job);
+	}
+	flexbodyVertices += count;
+}
+
+void BeamFactory::addFlexmeshJob(Beam *truck, bool stencil)
+{
+	flexbody_job_t job;
+	job.flexbody = 0;
+	job.from     = 0;
+	job.to       = 0;
+	job.truck    = truck;
+	job.stencil  = stencil;
+	flexbodyJobs.push_back(job);
+}
+
+bool BeamFactory::useStencilShadows()
+{
+	return manager->getShadowTechnique() == SHADOWTYPE_STENCIL_MODULATIVE || manager->getShadowTechnique() == SHADOWTYPE_STENCIL_ADDITIVE;
+}
+
+void BeamFactory::updateFlexbodies()
+{
+	Timer *timer = Root::getSingleton().getTimer();
+	unsigned long started = timer->getMicroseconds();
+
+	flexbodyJobs.clear();
+	bool stencil = useStencilShadows();
+	for (size_t i=0; i < flexmeshBatch.size(); i++)
+		addFlexmeshJob(flexmeshBatch[i], stencil);
+	for (size_t i=0; i < flexbodyBatch.size(); i++)
+		addFlexbodyJobs(flexbodyBatch[i]);
+
+	// only reads the position snapshots and writes the vertex arrays of the meshes, the buffers are written below
+	if (!flexbodyJobs.empty())
+		flexbodyPool->parallelFor((int)flexbodyJobs.size(), flexbodyJob, &flexbodyJobs);
+
+	unsigned long computed = timer->getMicroseconds();
+	for (size_t i=0; i < flexmeshBatch.size(); i++)
+		flexmeshBatch[i]->endFlexMeshes();
+	for (size_t i=0; i < flexbodyBatch.size(); i++)
+		flexbodyBatch[i]->endFlexit();
+	unsigned long uploaded = timer->getMicroseconds();
+
+	flexbodyComputeTime += computed - started;
+	flexbodyUploadTime  += uploaded - computed;
+}
+
+void BeamFactory::startVisualPrep()
+{
+	finishVisualPrep();
+	if (!visualPrepEnabled || visualPrepTrucks.none())
+		return;
+
+	flexbodyJobs.clear();
+	bool stencil = useStencilShadows();
+	for (int t=0; t < free_truck; t++)
+	{
+		if (!visualPrepTrucks[t] || !trucks[t]) continue;
+
+		// the snapshot stays untouched until the results are applied, so the nodes may change meanwhile
+		trucks[t]->updateVisualPositions();
+		visualPrepMeshes.push_back(trucks[t]);
+		addFlexmeshJob(trucks[t], stencil);
+		for (int i=0; i < trucks[t]->free_flexbody; i++)
+		{
+			visualPrepBatch.push_back(trucks[t]->flexbodies[i]);
+			addFlexbodyJobs(trucks[t]->flexbodies[i]);
 		}
+		visualPrepared[t] = true;
+	}
+	visualPrepTrucks.reset();
+
+	if (!flexbodyJobs.empty())
+	{
+		flexbodyPool->start((int)flexbodyJobs.size(), flexbodyJob, &flexbodyJobs);
+		visualPrepRunning = true;
 	}
 }
 
+void BeamFactory::finishVisualPrep()
+{
+	if (!visualPrepRunning && visualPrepBatch.empty() && visualPrepMeshes.empty())
+		return;
+
+	Timer *timer = Root::getSingleton().getTimer();
+	unsigned long started = timer->getMicroseconds();
+
+	if (visualPrepRunning)
+	{
+		while (!flexbodyPool->waitFor(1000));
+		visualPrepRunning = false;
+	}
+
+	unsigned long computed = timer->getMicroseconds();
+	for (size_t i=0; i < visualPrepMeshes.size(); i++)
+		visualPrepMeshes[i]->endFlexMeshes();
+	visualPrepMeshes.clear();
+	for (size_t i=0; i < visualPrepBatch.size(); i++)
+		visualPrepBatch[i]->endFlexit();
+	visualPrepBatch.clear();
+	unsigned long uploaded = timer->getMicroseconds();
+
+	// only the time the render thread was blocked
+	flexbodyComputeTime += computed - started;
+	flexbodyUploadTime  += uploaded - computed;
+}
+
+void BeamFactory::logFlexbodyStats()
+{
+	if (++flexbodyFrames < flexbodyStatsFrames)
+		return;
+
+	LOG("flexbodies: " + TOSTRING(flexbodyVertices / flexbodyFrames) + " vertices per frame on " + TOSTRING(flexbodyPool->getThreadCount()) + " threads, "
+		+ TOSTRING(flexbodyComputeTime / (float)flexbodyFrames / 1000.0f) + " ms deformation, "
+		+ TOSTRING(flexbodyUploadTime / (float)flexbodyFrames / 1000.0f) + " ms upload per frame"
+		+ (visualPrepEnabled ? String(" on the render thread") : String("")));
+	flexbodyFrames      = 0;
+	flexbodyVertices    = 0;
+	flexbodyComputeTime = 0;
+	flexbodyUploadTime  = 0;
+}
+
 void BeamFactory::updateAI(float dt)
 {
 	for (int t=0; t < free_truck; t++)
@@ -631,6 +1255,7 @@ void BeamFactory::calcPhysics(float dt)
 	if (current_truck >= 0 && current_truck < free_truck)
 		trucks[current_truck]->frameStep(dt);
 
+
 	// update 2D replay if activated
 	if (tdr) tdr->update(dt);
 
@@ -644,7 +1269,7 @@ void BeamFactory::calcPhysics(float dt)
 		{
 			case NETWORKED:
 			{
-				trucks[t]->calcNetwork();
+				trucks[t]->calcNetworkLOD(dt);
 				break;
 			}
 			case RECYCLE:
@@ -661,12 +1286,16 @@ void BeamFactory::calcPhysics(float dt)
 			break;
 		}
 	}
+
+	// the frame is published, deform the flexbodies while it is drawn
+	startVisualPrep();
 }
 
 void BeamFactory::removeInstance(Beam *b)
 {
 	if (b == 0) return;
 	// hide the truck
+	finishVisualPrep();
 	b->deleteNetTruck();
 	//_deleteTruck(b);
 }
@@ -26,15 +26,18 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 #include "RoRPrerequisites.h"
 
 #include "Beam.h"
+#include "RigSourceCache.h"
 #include "StreamableFactory.h"
 #include "TwoDReplay.h"
 
+#include <OgreResourceBackgroundQueue.h>
 #include <pthread.h>
 
 class BeamFactory : public StreamableFactory < BeamFactory, Beam >
 {
 	friend class Network;
 	friend class RoRFrameListener;
+	friend void *s_localspawnthread(void *vspawn);
 public:
 	BeamFactory(Ogre::SceneManager *manager, Ogre::SceneNode *parent, Ogre::RenderWindow* win, Network *net, float *mapsizex, float *mapsizez, Collisions *icollisions, HeightFinder *mfinder, Water *w, Ogre::Camera *pcam);
 	~BeamFactory();
@@ -43,6 +46,13 @@ public:
 	Beam *createLocal(Ogre::Vector3 pos, Ogre::Quaternion rot, Ogre::String fname, collision_box_t *spawnbox=NULL, bool ismachine=false, int flareMode=0, std::vector<Ogre::String> *truckconfig=0, Skin *skin=0, bool freePosition=false);
 	Beam *createRemoteInstance(stream_reg_t *reg);
 
+	// prepares the truck in the background and creates it once it is ready, see updateLocalSpawns
+	bool createLocalAsync(Ogre::Vector3 pos, Ogre::Quaternion rot, Ogre::String fname, collision_box_t *spawnbox=NULL, bool ismachine=false, int flareMode=0, std::vector<Ogre::String> *truckconfig=0, Skin *skin=0, bool freePosition=false);
+	// creates at most one truck whose preparation finished, returns it or 0
+	Beam *updateLocalSpawns();
+	bool isLocalSpawnAsync() { return localLoadingAsync; };
+	int getPendingLocalSpawns() { return (int)localSpawns.size(); };
+
 	Beam *getBeam(int source_id, int stream_id); // used by character
 
 	Beam *getCurrentTruck() { return (current_truck<0)?0:trucks[current_truck]; };
@@ -64,6 +74,20 @@ public:
 	void updateVisual(float dt);
 	void updateAI(float dt);
 
+	// waits for the render prep and applies its results, call before touching the flexbodies, cab or wheel meshes of a truck
+	void finishVisualPrep();
+
+	// what updateVisual() did in the last frame, for the debug overlay
+	typedef struct visual_stats_t
+	{
+		int trucks;
+		int culled;                  //!< outside of the view, not deformed
+		int reduced;                 //!< far away, deformed at a reduced rate
+		unsigned long vertices;      //!< flexbody vertices of all updated trucks
+		unsigned long skinned;       //!< flexbody vertices that were deformed
+	} visual_stats_t;
+	const visual_stats_t &getVisualStats() { return visualStats; };
+
 	inline unsigned long getPhysFrame() { return physFrame; };
 
 	void calcPhysics(float dt);
@@ -98,6 +122,109 @@ protected:
 
 	unsigned long physFrame;
 
+	// background preparation of remote trucks, they are only created once their meshes are ready
+	typedef struct remote_load_t
+	{
+		std::vector < Ogre::BackgroundProcessTicket > tickets;
+		unsigned long started;
+	} remote_load_t;
+	std::map < std::pair < int, int >, remote_load_t > remoteLoads;
+	bool remoteLoadingAsync;
+	int remoteSpawnBudget;
+	static const unsigned long remoteLoadTimeout = 10000; //!< ms after which a truck is created even if its resources are not prepared
+
+	bool isRemoteInstanceReady(stream_reg_t *reg);
+	void remoteInstanceCancelled(stream_reg_t *reg);
+	void prepareRemoteResources(stream_reg_t *reg, remote_load_t &load);
+	void prepareMeshes(std::set < Ogre::String > &meshes, std::vector < Ogre::BackgroundProcessTicket > &tickets);
+
+	// lets the cache unload archives that are not used by any truck or entity if the memory budget is exceeded
+	void trimResources();
+	// groups of the meshes, materials and textures of all entities in the scene
+	void collectSceneResourceGroups(std::set < Ogre::String > &groups);
+
+	// the flexbodies of all trucks are deformed in one batch that is spread over the worker threads,
+	// the vertices are split into chunks so a single large flexbody uses several threads as well.
+	// The cab and wheel meshes of a truck are one job of the same batch.
+	typedef struct flexbody_job_t
+	{
+		FlexBody *flexbody;
+		int from;
+		int to;
+		Beam *truck;   //!< instead of a flexbody chunk: the cab and wheel meshes of this truck
+		bool stencil;  //!< the meshes fill the arrays for stencil shadows
+	} flexbody_job_t;
+	ThreadPool *flexbodyPool;
+	std::vector < FlexBody * > flexbodyBatch;
+	std::vector < Beam * > flexmeshBatch;
+	std::vector < flexbody_job_t > flexbodyJobs;
+	static const int flexbodyChunkSize = 4096;
+	static const int flexbodyStatsFrames = 1000; //!< timing is logged as average over this many frames
+	int flexbodyFrames;
+	unsigned long flexbodyVertices;
+	unsigned long flexbodyComputeTime; //!< us
+	unsigned long flexbodyUploadTime;  //!< us
+
+	static void flexbodyJob(void *data, int index);
+	void addFlexbodyJobs(FlexBody *fb);
+	void addFlexmeshJob(Beam *truck, bool stencil);
+	bool useStencilShadows();
+	void updateFlexbodies();
+	void logFlexbodyStats();
+
+	// render prep: once calcPhysics() published a frame, the flexbodies, cab and wheel meshes of the trucks that
+	// were updated in the last frame are deformed on the pool while the frame is drawn and the next physics step
+	// runs. They read a snapshot of the node positions, the next updateVisual() only uploads the results.
+	bool visualPrepEnabled;
+	bool visualPrepRunning;
+	std::vector < FlexBody * > visualPrepBatch;
+	std::vector < Beam * > visualPrepMeshes;
+	std::bitset < MAX_TRUCKS > visualPrepTrucks;  //!< trucks to prepare after the next physics frame
+	std::bitset < MAX_TRUCKS > visualPrepared;    //!< trucks whose meshes the prep already applied this frame
+
+	void startVisualPrep();
+
+	visual_stats_t visualStats;
+	std::vector < Ogre::Camera * > visualLodCameras; //!< cameras that render into an active target, see Beam::calcVisualLOD
+
+	// background preparation of local trucks: the source is compiled on a thread, then the meshes are
+	// prepared by the background queue and the truck is created in the frame after everything is ready
+	enum {LOCAL_SPAWN_SOURCE, LOCAL_SPAWN_RESOURCES};
+	typedef struct local_spawn_t
+	{
+		Ogre::Vector3 pos;
+		Ogre::Quaternion rot;
+		Ogre::String fname;
+		Ogre::String key;
+		collision_box_t *spawnbox;
+		bool ismachine;
+		int flareMode;
+		std::vector<Ogre::String> truckconfig;
+		bool hasTruckconfig;
+		Skin *skin;
+		bool freePosition;
+
+		int state;
+		pthread_t thread;
+		pthread_mutex_t *mutex;
+		bool threadDone;                  //!< protected by mutex
+		Ogre::DataStreamPtr ds;           //!< copy of the truck file in memory, only used by the thread
+		compiled_rig_t rig;
+		std::set < Ogre::String > meshes;
+		std::vector < Ogre::BackgroundProcessTicket > tickets;
+		unsigned long started;
+		unsigned long sourceReady;
+	} local_spawn_t;
+	std::list < local_spawn_t * > localSpawns;
+	pthread_mutex_t localSpawnMutex;
+	bool localLoadingAsync;
+	static const unsigned long localLoadTimeout = 10000; //!< ms after which a truck is created even if its meshes are not prepared
+
+	// spawn latency histogram, from the request until the truck exists
+	static const int SPAWN_LATENCY_BUCKETS = 8;
+	unsigned int spawnLatency[SPAWN_LATENCY_BUCKETS];
+	void addSpawnLatency(unsigned long ms);
+
 	int getFreeTruckSlot();
 	int findTruckInsideBox(Collisions *collisions, char* inst, char* box);
 
@@ -657,24 +657,16 @@ void Beam::calcForcesEuler(int doUpdate, Real dt, int step, int maxstep)
 		{
 			if (!beams[i].disabled)
 			{
-				if (((doUpdate && skeleton == 2) || replay) && !beams[i].broken && beams[i].mEntity && beams[i].mSceneNode)
+				// the BeamRenderer picks the colour from the scale
+				if ((doUpdate || replay) && !beams[i].broken && beams[i].mBatch>=0)
 				{
 					float tmp=beams[i].stress/beams[i].minmaxposnegstress;
 					float sqtmp=tmp*tmp;
 					beams[i].scale = (sqtmp*sqtmp)*100.0f*sign(tmp);
 				}
-				if (doUpdate && skeleton == 1 && !beams[i].broken && beams[i].mEntity && beams[i].mSceneNode)
+				else if(doUpdate && skeleton && beams[i].mBatch>=0 && (beams[i].broken || beams[i].disabled))
 				{
-					int scale=(int)beams[i].scale * 100;
-					if(scale>100) scale=100;
-					if(scale<-100) scale=-100;
-					char bname[256];
-					sprintf(bname, "mat-beam-%d", scale);
-					beams[i].mEntity->setMaterialName(bname);
-				}
-				else if(doUpdate && skeleton && beams[i].mSceneNode && (beams[i].broken || beams[i].disabled) && beams[i].mSceneNode)
-				{
-					beams[i].mSceneNode->detachAllObjects();
+					beams[i].mVisible = false;
 				}
 			}
 		}
@@ -753,8 +745,8 @@ void Beam::calcForcesEuler(int doUpdate, Real dt, int step, int maxstep)
 				it->beam->p2truck  = it->lockTruck;
 				it->beam->L = (it->hookNode->AbsPosition - it->lockNode->AbsPosition).length();
 				it->beam->disabled = false;
-				if (it->beam->mSceneNode->numAttachedObjects() == 0 && it->visible)
-					it->beam->mSceneNode->attachObject(it->beam->mEntity);
+				if (it->visible)
+					it->beam->mVisible = true;
 			} else
 			{
 				if (it->beam->L < it->beam->commandShort)
@@ -784,7 +776,7 @@ void Beam::calcForcesEuler(int doUpdate, Real dt, int step, int maxstep)
 							} else
 							{
 								//force exceeded reset the hook node
-								it->beam->mSceneNode->detachAllObjects();
+								it->beam->mVisible = false;
 								it->locked = UNLOCKED;
 								if (it->lockNode) it->lockNode->lockednode=0;
 								it->lockNode       = 0;
@@ -852,9 +844,9 @@ void Beam::calcForcesEuler(int doUpdate, Real dt, int step, int maxstep)
 		{
 			nodes[i].wettime+=dt;
 			if (nodes[i].wettime>5.0) nodes[i].wetstate=DRY; //dry!
-			if (!nodes[i].iswheel && dripp) dripp->allocDrip(nodes[i].smoothpos, nodes[i].Velocity, nodes[i].wettime);
+			if (!nodes[i].iswheel && dripp) dripp->allocDrip(nodes[i].smoothpos, nodes[i].Velocity, nodes[i].wettime, &nodes[i]);
 			//also for hot engine
-			if (nodes[i].isHot && dustp) dustp->allocVapour(nodes[i].smoothpos, nodes[i].Velocity, nodes[i].wettime);
+			if (nodes[i].isHot && dustp) dustp->allocVapour(nodes[i].smoothpos, nodes[i].Velocity, nodes[i].wettime, &nodes[i]);
 		}
 		//locked nodes
 		if (nodes[i].lockednode)
@@ -884,14 +876,14 @@ void Beam::calcForcesEuler(int doUpdate, Real dt, int step, int maxstep)
 					{
 						if (gm->fx_type==Collisions::FX_DUSTY && !nodes[i].disable_particles)
 						{
-							if(dustp) dustp->malloc(nodes[i].AbsPosition, nodes[i].Velocity/2.0, gm->fx_colour);
+							if(dustp) dustp->malloc(nodes[i].AbsPosition, nodes[i].Velocity/2.0, gm->fx_colour, &nodes[i]);
 						}else if (gm->fx_type==Collisions::FX_HARD && !nodes[i].disable_particles)
 						{
 							float thresold=10.0;
 							//smokey
 							if (nodes[i].iswheel && ns>thresold)
 							{
-								if(dustp) dustp->allocSmoke(nodes[i].AbsPosition, nodes[i].Velocity);
+								if(dustp) dustp->allocSmoke(nodes[i].AbsPosition, nodes[i].Velocity, &nodes[i]);
 #ifdef USE_OPENAL
 								SoundScriptManager::getSingleton().modulate(trucknum, SS_MOD_SCREETCH, (ns-thresold)/thresold);
 								SoundScriptManager::getSingleton().trigOnce(trucknum, SS_TRIG_SCREETCH);
@@ -902,11 +894,11 @@ void Beam::calcForcesEuler(int doUpdate, Real dt, int step, int maxstep)
 							if (!nodes[i].iswheel && ns>1.0 && !nodes[i].disable_sparks)
 							{
 								// friction < 10 will remove the 'f' nodes from the spark generation nodes
-								if(sparksp) sparksp->allocSparks(nodes[i].AbsPosition, nodes[i].Velocity);
+								if(sparksp) sparksp->allocSparks(nodes[i].AbsPosition, nodes[i].Velocity, &nodes[i]);
 							}
 						} else if (gm->fx_type==Collisions::FX_CLUMPY && !nodes[i].disable_particles)
 						{
-							if (clumpp && nodes[i].Velocity.squaredLength()>1.0) clumpp->allocClump(nodes[i].AbsPosition, nodes[i].Velocity/2.0, gm->fx_colour);
+							if (clumpp && nodes[i].Velocity.squaredLength()>1.0) clumpp->allocClump(nodes[i].AbsPosition, nodes[i].Velocity/2.0, gm->fx_colour, &nodes[i]);
 						}
 					}
 
@@ -1002,8 +994,8 @@ void Beam::calcForcesEuler(int doUpdate, Real dt, int step, int maxstep)
 					//basic splashing
 					if (splashp && water->getHeight()-nodes[i].AbsPosition.y<0.2 && nodes[i].Velocity.squaredLength()>4.0 && !nodes[i].disable_particles)
 					{
-						splashp->allocSplash(nodes[i].AbsPosition, nodes[i].Velocity);
-						ripplep->allocRipple(nodes[i].AbsPosition, nodes[i].Velocity);
+						splashp->allocSplash(nodes[i].AbsPosition, nodes[i].Velocity, &nodes[i]);
+						ripplep->allocRipple(nodes[i].AbsPosition, nodes[i].Velocity, &nodes[i]);
 					}
 					//engine stall
 					if (i==cinecameranodepos[0] && engine) engine->stop();
@@ -27,22 +27,44 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 
 using namespace Ogre;
 
-FlexBody::FlexBody(SceneManager *manager, node_t *nds, int numnds, char* meshname, char* uname, int ref, int nx, int ny, Vector3 offset, Quaternion rot, char* setdef, MaterialFunctionMapper *mfm, Skin *usedSkin, bool enableShadows, MaterialReplacer *mr) :
+FlexBody::FlexBody(SceneManager *manager, node_t *nds, Vector3 *positions, int numnds, char* meshname, char* uname, int ref, int nx, int ny, Vector3 offset, Quaternion rot, char* setdef, MaterialFunctionMapper *mfm, Skin *usedSkin, bool enableShadows, MaterialReplacer *mr, rig_template_t *rigTemplate, int templateIndex) :
 	  cameramode(-2)	
+	, center(Vector3::ZERO)
 	, coffset(offset)
 	, cref(ref)
+	, currentorientation(Quaternion::IDENTITY)
 	, cx(nx)
 	, cy(ny)
+	, deformed(false)
+	, dstnormals(0)
+	, dstpos(0)
 	, enabled(true)
 	, faulty(false)
+	, framelocal(0)
+	, framenodes(0)
+	, frameorientation(Quaternion::IDENTITY)
+	, framevalid(false)
 	, freenodeset(0)
+	, numframenodes(0)
 	, hasblend(true)
 	, hastangents(false)
+	, locs(0)
 	, mr(mr)
 	, nodes(nds)
 	, numnodes(numnds)
+	, numsubmeshbuf(0)
+	, pending(false)
+	, positions(positions)
+	, sharedlocs(false)
 	, snode(0)
+	, srccolors(0)
+	, srcnormals(0)
+	, submeshnums(0)
+	, subnodecounts(0)
+	, vertex_count(0)
+	, vertices(0)
 {
+	memset(&bindings, 0, sizeof(flexbody_bindings_t));
 	nodes[cref].iIsSkin=true;
 	nodes[cx].iIsSkin=true;
 	nodes[cy].iIsSkin=true;
@@ -350,8 +372,25 @@ FlexBody::FlexBody(SceneManager *manager, node_t *nds, int numnds, char* meshnam
 		vertices[i]=(orientation*vertices[i])+position;
 	}
 
-	locs=(Locator_t*)malloc(sizeof(Locator_t)*vertex_count);
-	for (int i=0; i<(int)vertex_count; i++)
+	// the vertex bindings are the same for all instances of this rig, so only the first one has to search for the nodes
+	flexbody_template_t *tmpl = RigTemplateCache::getSingleton().getFlexBody(rigTemplate, templateIndex, String(meshname), numnodes, vertex_count);
+	bool fromtemplate = (tmpl != 0);
+	if (fromtemplate)
+	{
+		free(srcnormals);
+		srcnormals = 0;
+		bindings = tmpl->bindings;
+		sharedlocs = true;
+		for (int i=0; i<(int)vertex_count; i++)
+		{
+			nodes[bindings.ref[i]].iIsSkin=true;
+			nodes[bindings.nx[i]].iIsSkin=true;
+			nodes[bindings.ny[i]].iIsSkin=true;
+		}
+	}
+
+	if (!sharedlocs) locs=(flexbody_locator_t*)malloc(sizeof(flexbody_locator_t)*vertex_count);
+	for (int i=0; i<(int)vertex_count && !sharedlocs; i++)
 	{
 		//search nearest node as the local origin
 		float mindist=100000.0;
@@ -519,7 +558,7 @@ FlexBody::FlexBody(SceneManager *manager, node_t *nds, int numnds, char* meshnam
 
 	// If something unexpected happens here, then
 	// replace fast_normalise(a) with a.normalisedCopy()
-	for (int i=0; i<(int)vertex_count; i++)
+	for (int i=0; i<(int)vertex_count && !sharedlocs; i++)
 	{
 		Matrix3 mat;
 		Vector3 diffX = nodes[locs[i].nx].smoothpos-nodes[locs[i].ref].smoothpos;
@@ -535,7 +574,78 @@ FlexBody::FlexBody(SceneManager *manager, node_t *nds, int numnds, char* meshnam
 		srcnormals[i] = mat*(orientation * srcnormals[i]);
 	}
 
-	LOG("FLEXBODY ready");
+	if (!sharedlocs)
+	{
+		// the deformation reads the bindings as separate arrays per component
+		RigTemplateCache::createBindings(bindings, locs, srcnormals, vertex_count);
+		free(locs);
+		free(srcnormals);
+		locs = 0;
+		srcnormals = 0;
+	}
+
+	// hand the bindings over to the rig template, so the next instance can use them
+	if (!sharedlocs && rigTemplate)
+	{
+		tmpl = new flexbody_template_t();
+		tmpl->meshname     = String(meshname);
+		tmpl->numnodes     = numnodes;
+		tmpl->vertex_count = vertex_count;
+		tmpl->bindings     = bindings;
+		if (RigTemplateCache::getSingleton().storeFlexBody(rigTemplate, templateIndex, tmpl))
+			sharedlocs = true;
+		else
+			delete tmpl;
+	}
+
+	// the original vertex positions are not needed anymore
+	free(vertices);
+	vertices = 0;
+
+	// collect the nodes the vertices depend on, for the change detection
+	frametolerance = FSETTING("Flexbody Tolerance", 0.002f);
+	frametolerance *= frametolerance;
+	if (bindings.data)
+	{
+		std::vector<bool> used(numnodes, false);
+		for (int i=0; i<(int)vertex_count; i++)
+		{
+			used[bindings.ref[i]] = true;
+			used[bindings.nx[i]]  = true;
+			used[bindings.ny[i]]  = true;
+		}
+		framenodes = (int*)malloc(sizeof(int)*numnodes);
+		for (int i=0; i<numnodes; i++)
+			if (used[i]) framenodes[numframenodes++] = i;
+		framelocal = (Vector3*)malloc(sizeof(Vector3)*std::max(numframenodes, 1));
+	}
+
+	LOG(String("FLEXBODY ready") + (fromtemplate ? " (shared vertex bindings)" : ""));
+}
+
+FlexBody::~FlexBody()
+{
+	free(vertices);
+	free(dstpos);
+	free(dstnormals);
+	free(srccolors);
+	free(submeshnums);
+	free(subnodecounts);
+	free(framenodes);
+	free(framelocal);
+	free(locs);
+	free(srcnormals);
+	if (!sharedlocs)
+		RigTemplateCache::freeBindings(bindings);
+}
+
+size_t FlexBody::getInstanceMemorySize()
+{
+	size_t size = sizeof(FlexBody) + vertex_count * 2 * sizeof(Vector3);
+	if (hasblend) size += vertex_count * sizeof(ARGB);
+	if (!sharedlocs) size += RigTemplateCache::getBindingsSize(vertex_count);
+	size += numframenodes * (sizeof(int) + sizeof(Vector3));
+	return size;
 }
 
 void FlexBody::setEnabled(bool e)
@@ -615,44 +725,142 @@ bool FlexBody::isinset(int n)
 
 Vector3 FlexBody::flexit()
 {
-	if (faulty) return Vector3::ZERO;
-	if (!enabled) return Vector3::ZERO;
-	if (hasblend) updateBlend();
+	if (beginFlexit()) computeVertices(0, (int)vertex_count);
+	return endFlexit();
+}
+
+bool FlexBody::beginFlexit()
+{
+	deformed = false;
+	pending = false;
+	if (faulty) return false;
+	if (!enabled) return false;
 	
 	// compute the local center
-	Vector3 normal;
-	Vector3 center;
-
 	if(cref >= 0)
 	{
-		Vector3 diffX = nodes[cx].smoothpos-nodes[cref].smoothpos;
-		Vector3 diffY = nodes[cy].smoothpos-nodes[cref].smoothpos;
-		normal = diffY.crossProduct(diffX).normalisedCopy();
+		Vector3 diffX = positions[cx]-positions[cref];
+		Vector3 diffY = positions[cy]-positions[cref];
+		Vector3 normal = diffY.crossProduct(diffX).normalisedCopy();
 
-		center = nodes[cref].smoothpos + coffset.x*diffX + coffset.y*diffY;
+		center = positions[cref] + coffset.x*diffX + coffset.y*diffY;
 		center = center + coffset.z*normal;
 	} else
 	{
-		normal = Vector3::UNIT_Y;
-		center = nodes[0].smoothpos;
+		center = positions[0];
 	}
 
-	// If something unexpected happens here, then
-	// replace fast_normalise(a) with a.normalisedCopy()
-	for (int i=0; i<(int)vertex_count; i++)
+	currentorientation = getFrameOrientation();
+	deformed = hasDeformed();
+	if (deformed && framelocal)
 	{
-		Matrix3 mat;
-		Vector3 diffX = nodes[locs[i].nx].smoothpos-nodes[locs[i].ref].smoothpos;
-		Vector3 diffY = nodes[locs[i].ny].smoothpos-nodes[locs[i].ref].smoothpos;
+		// the vertices are computed in world orientation now, remember the frame they belong to
+		Quaternion inverse = currentorientation.Inverse();
+		for (int i=0; i<numframenodes; i++)
+			framelocal[i] = inverse * (positions[framenodes[i]] - center);
+		frameorientation = currentorientation;
+		framevalid = true;
+	}
+	pending = true;
+	return deformed;
+}
 
-		mat.SetColumn(0, diffX);
-		mat.SetColumn(1, diffY);
-		mat.SetColumn(2, fast_normalise(diffX.crossProduct(diffY))); // Old version: mat.SetColumn(2, nodes[loc.nz].smoothpos-nodes[loc.ref].smoothpos);
+Quaternion FlexBody::getFrameOrientation()
+{
+	if (cref < 0) return Quaternion::IDENTITY;
+
+	Vector3 diffX = positions[cx]-positions[cref];
+	Vector3 diffY = positions[cy]-positions[cref];
+	Vector3 axisX = diffX.normalisedCopy();
+	Vector3 axisZ = diffY.crossProduct(diffX).normalisedCopy();
+	Vector3 axisY = axisZ.crossProduct(axisX);
+	return Quaternion(axisX, axisY, axisZ);
+}
+
+bool FlexBody::hasDeformed()
+{
+	if (!framevalid || !framelocal) return true;
 
-		dstpos[i] = mat * locs[i].coords + nodes[locs[i].ref].smoothpos - center;
-		dstnormals[i] = fast_normalise(mat * srcnormals[i]);
+	Quaternion inverse = currentorientation.Inverse();
+	for (int i=0; i<numframenodes; i++)
+	{
+		Vector3 local = inverse * (positions[framenodes[i]] - center);
+		if (local.squaredDistance(framelocal[i]) > frametolerance) return true;
 	}
-	
+	return false;
+}
+
+void FlexBody::computeVertices(int from, int to)
+{
+	// the vertices are done in blocks: first the node positions are gathered into plain arrays,
+	// then the transformation runs over those arrays without any indirection, so it can be vectorized
+	static const int BLOCK = 64;
+	float dx[3][BLOCK], dy[3][BLOCK], dn[3][BLOCK], rp[3][BLOCK];
+
+	for (int start=from; start<to; start+=BLOCK)
+	{
+		int n = std::min(BLOCK, to-start);
+
+		for (int j=0; j<n; j++)
+		{
+			const Vector3 &r = positions[bindings.ref[start+j]];
+			const Vector3 &x = positions[bindings.nx[start+j]];
+			const Vector3 &y = positions[bindings.ny[start+j]];
+			for (int a=0; a<3; a++)
+			{
+				rp[a][j] = r[a] - center[a];
+				dx[a][j] = x[a] - r[a];
+				dy[a][j] = y[a] - r[a];
+			}
+		}
+
+		// the third axis is the normalised cross product of the other two
+		for (int j=0; j<n; j++)
+		{
+			float crx = dx[1][j]*dy[2][j] - dx[2][j]*dy[1][j];
+			float cry = dx[2][j]*dy[0][j] - dx[0][j]*dy[2][j];
+			float crz = dx[0][j]*dy[1][j] - dx[1][j]*dy[0][j];
+			float inv = fast_invSqrt(crx*crx + cry*cry + crz*crz);
+			dn[0][j] = crx*inv;
+			dn[1][j] = cry*inv;
+			dn[2][j] = crz*inv;
+		}
+
+		const float *c0 = bindings.coords[0]  + start, *c1 = bindings.coords[1]  + start, *c2 = bindings.coords[2]  + start;
+		const float *n0 = bindings.normals[0] + start, *n1 = bindings.normals[1] + start, *n2 = bindings.normals[2] + start;
+		Vector3 *ppt = dstpos + start;
+		Vector3 *npt = dstnormals + start;
+		for (int j=0; j<n; j++)
+		{
+			ppt[j].x = dx[0][j]*c0[j] + dy[0][j]*c1[j] + dn[0][j]*c2[j] + rp[0][j];
+			ppt[j].y = dx[1][j]*c0[j] + dy[1][j]*c1[j] + dn[1][j]*c2[j] + rp[1][j];
+			ppt[j].z = dx[2][j]*c0[j] + dy[2][j]*c1[j] + dn[2][j]*c2[j] + rp[2][j];
+
+			float nx = dx[0][j]*n0[j] + dy[0][j]*n1[j] + dn[0][j]*n2[j];
+			float ny = dx[1][j]*n0[j] + dy[1][j]*n1[j] + dn[1][j]*n2[j];
+			float nz = dx[2][j]*n0[j] + dy[2][j]*n1[j] + dn[2][j]*n2[j];
+			float inv = fast_invSqrt(nx*nx + ny*ny + nz*nz);
+			npt[j].x = nx*inv;
+			npt[j].y = ny*inv;
+			npt[j].z = nz*inv;
+		}
+	}
+}
+
+Vector3 FlexBody::endFlexit()
+{
+	if (!pending) return center;
+	pending = false;
+	if (hasblend) updateBlend();
+
+	if (!deformed)
+	{
+		// moved as a whole only, turn the already deformed mesh along
+		snode->setOrientation(currentorientation * frameorientation.Inverse());
+		snode->setPosition(center);
+		return center;
+	}
+
 	Vector3 *ppt=dstpos;
 	Vector3 *npt=dstnormals;
 	if (hasshared)
@@ -670,6 +878,8 @@ Vector3 FlexBody::flexit()
 		npt+=subnodecounts[i];
 	}
 
+	// the vertices are in world orientation
+	snode->setOrientation(Quaternion::IDENTITY);
 	snode->setPosition(center);
 	return center;
 }
@@ -707,7 +917,7 @@ void FlexBody::updateBlend() //so easy!
 	bool changed=false;
 	for (int i=0; i<(int)vertex_count; i++)
 	{
-		node_t *nd=&nodes[locs[i].ref];
+		node_t *nd=&nodes[bindings.ref[i]];
 		ARGB col=srccolors[i];
 		if (nd->contacted && !(col&0xFF000000))
 		{
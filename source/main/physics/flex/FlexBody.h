@@ -25,6 +25,7 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 #include "BeamData.h"
 #include "materialFunctionMapper.h"
 #include "Ogre.h"
+#include "RigTemplateCache.h"
 
 class FlexBody
 {
@@ -37,18 +38,10 @@ private:
 		int to;
 	} interval_t;
 
-	typedef struct
-	{
-		int ref;
-		int nx;
-		int ny;
-		int nz;
-		Ogre::Vector3 coords;
-	} Locator_t;
-
 	static const int MAX_SET_INTERVALS = 256;
 
 	node_t *nodes;
+	Ogre::Vector3 *positions; //!< snapshot of the node positions the body is deformed with, see Beam::updateVisualPositions()
 	int numnodes;
 	size_t vertex_count;
 	Ogre::Vector3* vertices;
@@ -56,7 +49,25 @@ private:
 	Ogre::Vector3* srcnormals;
 	Ogre::Vector3* dstnormals;
 	Ogre::ARGB* srccolors;
-	Locator_t *locs; //1 loc per vertex
+	flexbody_locator_t *locs; //1 loc per vertex, only used while the bindings are created
+	flexbody_bindings_t bindings;
+	bool sharedlocs; //bindings belong to the rig template
+	Ogre::Vector3 center;
+
+	// change detection: positions of all bound nodes in the local frame at the last deformation,
+	// as long as they stay the same the body only moved and the scene node is turned instead
+	int *framenodes;
+	int numframenodes;
+	Ogre::Vector3 *framelocal;
+	Ogre::Quaternion frameorientation;     //!< orientation of the local frame at the last deformation
+	Ogre::Quaternion currentorientation;
+	float frametolerance;                  //!< squared distance in m a node may move before the body is deformed again
+	bool framevalid;
+	bool deformed;
+	bool pending;                          //!< beginFlexit() ran, endFlexit() has not applied the result yet
+
+	Ogre::Quaternion getFrameOrientation();
+	bool hasDeformed();
 
 	int cref;
 	int cx;
@@ -90,13 +101,24 @@ private:
 	Ogre::MeshPtr msh;
 
 public:
-	FlexBody(Ogre::SceneManager *manager, node_t *nds, int numnodes, char* meshname, char* uname, int ref, int nx, int ny, Ogre::Vector3 offset, Ogre::Quaternion rot, char* setdef, MaterialFunctionMapper *mfm, Skin *usedSkin, bool forceNoShadows, MaterialReplacer *mr);
+	FlexBody(Ogre::SceneManager *manager, node_t *nds, Ogre::Vector3 *positions, int numnodes, char* meshname, char* uname, int ref, int nx, int ny, Ogre::Vector3 offset, Ogre::Quaternion rot, char* setdef, MaterialFunctionMapper *mfm, Skin *usedSkin, bool forceNoShadows, MaterialReplacer *mr, rig_template_t *rigTemplate, int templateIndex);
+	~FlexBody();
 
 	void addinterval(int from, int to);
 	bool isinset(int n);
 	void printMeshInfo(Ogre::Mesh* mesh);
 	void setVisible(bool visible);
 	Ogre::Vector3 flexit();
+
+	// flexit() split up, so the vertices of many flexbodies can be computed on several threads:
+	// beginFlexit() returns false if there are no vertices to compute, it and computeVertices() only read the
+	// position snapshot and write the body's own data, so both may run on any thread. endFlexit() uploads
+	// the vertices or moves the scene node and has to run on the render thread
+	bool beginFlexit();
+	void computeVertices(int from, int to);
+	Ogre::Vector3 endFlexit();
+	int getVertexCount() { return (int)vertex_count; };
+	bool wasDeformed() { return deformed; }; //!< false if the last beginFlexit() only moved the scene node
 	void reset();
 	void updateBlend();
 	void writeBlend();
@@ -104,6 +126,9 @@ public:
 
 	int cameramode;
 	void setEnabled(bool e);
+
+	// memory used by this instance only, without the data shared with other instances
+	size_t getInstanceMemorySize();
 };
 
 #endif // __FlexBody_H__
@@ -20,16 +20,30 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 #include "FlexMesh.h"
 
 #include "Ogre.h"
+#include "approxmath.h"
 #include "ResourceBuffer.h"
 
 using namespace Ogre;
 
-FlexMesh::FlexMesh(SceneManager *manager, char* name, node_t *nds, int n1, int n2, int nstart, int nrays, char* texface, char* texband, bool rimmed, float rimratio) :
+// squared distance in m the wheel nodes may move relative to the center before the mesh is updated
+#define FLEXMESH_TOLERANCE 0.00000025f
+
+static inline Vector3 fastNormalise(const Vector3 &v)
+{
+	float l2=v.squaredLength();
+	return (l2>0) ? v*fast_invSqrt(l2) : Vector3::ZERO;
+}
+
+FlexMesh::FlexMesh(SceneManager *manager, char* name, node_t *nds, Vector3 *positions, int n1, int n2, int nstart, int nrays, char* texface, char* texband, bool rimmed, float rimratio) :
 	  is_rimmed(rimmed)
 	, nbrays(nrays)
 	, nodes(nds)
+	, positions(positions)
 	, rim_ratio(rimratio)
+	, shadowlayout(false)
 	, smanager(manager)
+	, valid(false)
+	, changed(false)
 {
 	/// Create the mesh via the MeshManager
 	msh = MeshManager::getSingleton().createManual(name, ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME,new ResourceBuffer());
@@ -47,10 +61,11 @@ FlexMesh::FlexMesh(SceneManager *manager, char* name, node_t *nds, int n1, int n
 	if (is_rimmed) nVertices+=2*nrays;
 	vbufCount = (2*3+2)*nVertices;
 	vertices=(float*)malloc(vbufCount*sizeof(float));
-	//shadow
-	shadownorvertices=(float*)malloc(nVertices*(3+2)*sizeof(float));
-	shadowposvertices=(float*)malloc(nVertices*3*2*sizeof(float));
+	//shadow, allocated when they are used the first time
+	shadownorvertices=0;
+	shadowposvertices=0;
 	nodeIDs=(int*)malloc(nVertices*sizeof(int));
+	lastpos=(Vector3*)malloc(nVertices*sizeof(Vector3));
 
 	//define node ids
 	nodeIDs[0]=n1;
@@ -222,86 +237,115 @@ FlexMesh::FlexMesh(SceneManager *manager, char* name, node_t *nds, int n1, int n
 	//msh->buildEdgeList();
 }
 
+FlexMesh::~FlexMesh()
+{
+	free(vertices);
+	free(shadowposvertices);
+	free(shadownorvertices);
+	free(nodeIDs);
+	free(facefaces);
+	free(bandfaces);
+	free(lastpos);
+}
+
+bool FlexMesh::hasMoved(const Vector3 &center)
+{
+	size_t i;
+	bool moved=!valid;
+	for (i=0; i<nVertices && !moved; i++)
+		moved=((positions[nodeIDs[i]]-center).squaredDistance(lastpos[i])>FLEXMESH_TOLERANCE);
+	if (!moved)
+		return false;
+
+	for (i=0; i<nVertices; i++)
+		lastpos[i]=positions[nodeIDs[i]]-center;
+	valid=true;
+	return true;
+}
 
 Vector3 FlexMesh::updateVertices()
 {
-		int i;
+	int i;
 	Vector3 center;
-	center=(nodes[nodeIDs[0]].smoothpos+nodes[nodeIDs[1]].smoothpos)/2.0;
-	//optimization possible here : just copy bands on face
-	covertices[0].vertex=nodes[nodeIDs[0]].smoothpos-center;
-		//normals
-	covertices[0].normal=nodes[nodeIDs[0]].smoothpos-nodes[nodeIDs[1]].smoothpos;
-	covertices[0].normal.normalise();
+	center=(positions[nodeIDs[0]]+positions[nodeIDs[1]])/2.0;
+	changed=hasMoved(center);
+	if (!changed)
+		return center;
+
+	//the faces all point along the axis
+	Vector3 axis=fastNormalise(lastpos[0]-lastpos[1]);
+	covertices[0].vertex=lastpos[0];
+	covertices[0].normal=axis;
+	covertices[1].vertex=lastpos[1];
+	covertices[1].normal=-axis;
+	for (i=0; i<nbrays*2; i+=2)
+	{
+		covertices[2+i].vertex=lastpos[2+i];
+		covertices[2+i].normal=axis;
+		covertices[2+i+1].vertex=lastpos[2+i+1];
+		covertices[2+i+1].normal=-axis;
+	}
 
-	covertices[1].vertex=nodes[nodeIDs[1]].smoothpos-center;
-		//normals
-	covertices[1].normal=-covertices[0].normal;
-//	covertices[1].normal.normalise();
-	for (i=0; i<nbrays*2; i++)
+	//the band is copied from the outer face
+	int outer=2;
+	if (is_rimmed)
 	{
-		covertices[2+i].vertex=nodes[nodeIDs[2+i]].smoothpos-center;
-		//normals
-		if ((i%2)==0)
+		outer=2+4*nbrays;
+		for (i=0; i<nbrays*2; i+=2)
 		{
-			covertices[2+i].normal=nodes[nodeIDs[0]].smoothpos-nodes[nodeIDs[1]].smoothpos;
-			covertices[2+i].normal.normalise();
-		} else covertices[2+i].normal=-covertices[2+i-1].normal;
-		if (is_rimmed)
-		{
-			covertices[2+4*nbrays+i].vertex=nodes[nodeIDs[2+4*nbrays+i]].smoothpos-center;
-			//normals
-			if ((i%2)==0)
-			{
-				covertices[2+4*nbrays+i].normal=nodes[nodeIDs[2+4*nbrays+i]].smoothpos-nodes[nodeIDs[2+4*nbrays+i+1]].smoothpos;
-				covertices[2+4*nbrays+i].normal.normalise();
-			} else covertices[2+4*nbrays+i].normal=-covertices[2+4*nbrays+i-1].normal;
-			//bands
-			covertices[2+2*nbrays+i].vertex=covertices[2+4*nbrays+i].vertex;
-			covertices[2+2*nbrays+i].normal=covertices[2+4*nbrays+i].vertex;
-			covertices[2+2*nbrays+i].normal.normalise();
-		}
-		else
-		{
-			//bands
-			covertices[2+2*nbrays+i].vertex=covertices[2+i].vertex;
-			covertices[2+2*nbrays+i].normal=covertices[2+i].vertex;
-			covertices[2+2*nbrays+i].normal.normalise();
+			Vector3 normal=fastNormalise(lastpos[outer+i]-lastpos[outer+i+1]);
+			covertices[outer+i].vertex=lastpos[outer+i];
+			covertices[outer+i].normal=normal;
+			covertices[outer+i+1].vertex=lastpos[outer+i+1];
+			covertices[outer+i+1].normal=-normal;
 		}
 	}
+	for (i=0; i<nbrays*2; i++)
+	{
+		covertices[2+2*nbrays+i].vertex=covertices[outer+i].vertex;
+		covertices[2+2*nbrays+i].normal=fastNormalise(covertices[outer+i].vertex);
+	}
 	return center;
 }
 
-
 Vector3 FlexMesh::updateShadowVertices()
 {
 		int i;
 	Vector3 center;
 //msh->buildEdgeList();
-	center=(nodes[nodeIDs[0]].smoothpos+nodes[nodeIDs[1]].smoothpos)/2.0;
+	center=(positions[nodeIDs[0]]+positions[nodeIDs[1]])/2.0;
+	changed=hasMoved(center);
+	if (!changed)
+		return center;
 
-	coshadowposvertices[0].vertex=nodes[nodeIDs[0]].smoothpos-center;
+	if (!shadowposvertices)
+	{
+		shadownorvertices=(float*)malloc(nVertices*(3+2)*sizeof(float));
+		shadowposvertices=(float*)malloc(nVertices*3*2*sizeof(float));
+	}
+
+	coshadowposvertices[0].vertex=positions[nodeIDs[0]]-center;
 	//normals
-	coshadownorvertices[0].normal=nodes[nodeIDs[0]].smoothpos-nodes[nodeIDs[1]].smoothpos;
-//	coshadownorvertices[0].normal=nodes[nodeIDs[0]].smoothpos-center;
+	coshadownorvertices[0].normal=positions[nodeIDs[0]]-positions[nodeIDs[1]];
+//	coshadownorvertices[0].normal=positions[nodeIDs[0]]-center;
 	coshadownorvertices[0].normal.normalise();
 
-	coshadowposvertices[1].vertex=nodes[nodeIDs[1]].smoothpos-center;
+	coshadowposvertices[1].vertex=positions[nodeIDs[1]]-center;
 	//normals
 	coshadownorvertices[1].normal=-coshadownorvertices[0].normal;
-//	coshadownorvertices[1].normal=nodes[nodeIDs[1]].smoothpos-center;
+//	coshadownorvertices[1].normal=positions[nodeIDs[1]]-center;
 //	coshadownorvertices[1].normal.normalise();
 
 	for (i=0; i<nbrays*2; i++)
 	{
-		coshadowposvertices[2+i].vertex=nodes[nodeIDs[2+i]].smoothpos-center;
+		coshadowposvertices[2+i].vertex=positions[nodeIDs[2+i]]-center;
 
-		coshadownorvertices[2+i].normal=nodes[nodeIDs[2+i]].smoothpos-center;
+		coshadownorvertices[2+i].normal=positions[nodeIDs[2+i]]-center;
 		coshadownorvertices[2+i].normal.normalise();
 		//normals
 		if ((i%2)==0)
 		{
-			coshadownorvertices[2+i].normal=nodes[nodeIDs[0]].smoothpos-nodes[nodeIDs[1]].smoothpos;
+			coshadownorvertices[2+i].normal=positions[nodeIDs[0]]-positions[nodeIDs[1]];
 			coshadownorvertices[2+i].normal.normalise();
 		} else
 		{
@@ -309,14 +353,14 @@ Vector3 FlexMesh::updateShadowVertices()
 		}
 		if (is_rimmed)
 		{
-			coshadowposvertices[2+4*nbrays+i].vertex=nodes[nodeIDs[2+4*nbrays+i]].smoothpos-center;
+			coshadowposvertices[2+4*nbrays+i].vertex=positions[nodeIDs[2+4*nbrays+i]]-center;
 
-			coshadownorvertices[2+4*nbrays+i].normal=nodes[nodeIDs[2+4*nbrays+i]].smoothpos-center;
+			coshadownorvertices[2+4*nbrays+i].normal=positions[nodeIDs[2+4*nbrays+i]]-center;
 			coshadownorvertices[2+4*nbrays+i].normal.normalise();
 			//normals
 			if ((i%2)==0)
 			{
-				coshadownorvertices[2+4*nbrays+i].normal=nodes[nodeIDs[2+4*nbrays+i]].smoothpos-nodes[nodeIDs[2+4*nbrays+i+1]].smoothpos;
+				coshadownorvertices[2+4*nbrays+i].normal=positions[nodeIDs[2+4*nbrays+i]]-positions[nodeIDs[2+4*nbrays+i+1]];
 				coshadownorvertices[2+4*nbrays+i].normal.normalise();
 			} else
 			{
@@ -326,10 +370,10 @@ Vector3 FlexMesh::updateShadowVertices()
 			coshadowposvertices[2+2*nbrays+i].vertex=coshadowposvertices[2+4*nbrays+i].vertex;
 			if ((i%2)==0)
 			{
-				coshadownorvertices[2+2*nbrays+i].normal=nodes[nodeIDs[2+i]].smoothpos-nodes[nodeIDs[0]].smoothpos;
+				coshadownorvertices[2+2*nbrays+i].normal=positions[nodeIDs[2+i]]-positions[nodeIDs[0]];
 			} else
 			{
-				coshadownorvertices[2+2*nbrays+i].normal=nodes[nodeIDs[2+i]].smoothpos-nodes[nodeIDs[1]].smoothpos;
+				coshadownorvertices[2+2*nbrays+i].normal=positions[nodeIDs[2+i]]-positions[nodeIDs[1]];
 			};
 	//		coshadownorvertices[2+2*nbrays+i].normal=coshadowposvertices[2+i].vertex;
 			coshadownorvertices[2+2*nbrays+i].normal.normalise();
@@ -340,10 +384,10 @@ Vector3 FlexMesh::updateShadowVertices()
 			coshadowposvertices[2+2*nbrays+i].vertex=coshadowposvertices[2+i].vertex;
 			if ((i%2)==0)
 			{
-				coshadownorvertices[2+2*nbrays+i].normal=nodes[nodeIDs[2+i]].smoothpos-nodes[nodeIDs[0]].smoothpos;
+				coshadownorvertices[2+2*nbrays+i].normal=positions[nodeIDs[2+i]]-positions[nodeIDs[0]];
 			} else
 			{
-				coshadownorvertices[2+2*nbrays+i].normal=nodes[nodeIDs[2+i]].smoothpos-nodes[nodeIDs[1]].smoothpos;
+				coshadownorvertices[2+2*nbrays+i].normal=positions[nodeIDs[2+i]]-positions[nodeIDs[1]];
 			};
 	//		coshadownorvertices[2+2*nbrays+i].normal=coshadowposvertices[2+i].vertex;
 			coshadownorvertices[2+2*nbrays+i].normal.normalise();
@@ -410,10 +454,23 @@ Vector3 FlexMesh::updateShadowVertices()
 
 Vector3 FlexMesh::flexit()
 {
-	Vector3 center;
-	if (smanager->getShadowTechnique()==SHADOWTYPE_STENCIL_MODULATIVE || smanager->getShadowTechnique()==SHADOWTYPE_STENCIL_ADDITIVE)
+	computeVertices(smanager->getShadowTechnique()==SHADOWTYPE_STENCIL_MODULATIVE || smanager->getShadowTechnique()==SHADOWTYPE_STENCIL_ADDITIVE);
+	return endFlexit();
+}
+
+void FlexMesh::computeVertices(bool stencil)
+{
+	shadowlayout=stencil;
+	center=stencil ? updateShadowVertices() : updateVertices();
+}
+
+Vector3 FlexMesh::endFlexit()
+{
+	//the wheel only moved as a whole, the buffers are still up to date
+	if (!changed)
+		return center;
+	if (shadowlayout)
 	{
-		center=updateShadowVertices();
 		//find the binding
 		unsigned posbinding=msh->sharedVertexData->vertexDeclaration->findElementBySemantic(VES_POSITION)->getSource();
 		HardwareVertexBufferSharedPtr pbuf=msh->sharedVertexData->vertexBufferBinding->getBuffer(posbinding);
@@ -432,12 +489,12 @@ Vector3 FlexMesh::flexit()
 	}
 		else
 	{
-		center=updateVertices();
 		//vbuf->lock(HardwareBuffer::HBL_NORMAL);
 		vbuf->writeData(0, vbuf->getSizeInBytes(), vertices, true);
 		//vbuf->unlock();
 		//msh->sharedVertexData->vertexBufferBinding->getBuffer(0)->writeData(0, vbuf->getSizeInBytes(), vertices, true);
 	}
+	changed=false;
 	return center;
 }
 
@@ -28,9 +28,15 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 class Flexable
 {
 public:
+	virtual ~Flexable() {};
 	virtual Ogre::Vector3 flexit()=0;
 	virtual void setVisible(bool visible) = 0;
 
+	// flexit() in two steps: computeVertices() only reads the position snapshot and writes the mesh's own
+	// arrays, so it may run on any thread. endFlexit() uploads the result on the render thread and returns the center
+	virtual void computeVertices(bool stencil)=0;
+	virtual Ogre::Vector3 endFlexit()=0;
+
 };
 
 class FlexMesh: public Flexable
@@ -88,16 +94,28 @@ typedef struct
 	unsigned short *facefaces;
 	unsigned short *bandfaces;
 	node_t *nodes;
+	Ogre::Vector3 *positions; //!< snapshot of the node positions the mesh is deformed with, see Beam::updateVisualPositions()
 	int nbrays;
 	Ogre::SceneManager *smanager;
 	bool is_rimmed;
 	float rim_ratio;
 
+	Ogre::Vector3 *lastpos;  //!< node positions relative to the center at the last update
+	bool valid;
+	bool changed;            //!< the last update moved the wheel relative to its center, the buffers need an upload
+	bool shadowlayout;       //!< the last update filled the stencil shadow arrays
+	Ogre::Vector3 center;    //!< center of the last update
+
+	bool hasMoved(const Ogre::Vector3 &center);
+
 public:
-	FlexMesh(Ogre::SceneManager *manager, char* name, node_t *nds, int n1, int n2, int nstart, int nrays, char* texface, char* texband, bool rimmed=false, float rimratio=1.0);
+	FlexMesh(Ogre::SceneManager *manager, char* name, node_t *nds, Ogre::Vector3 *positions, int n1, int n2, int nstart, int nrays, char* texface, char* texband, bool rimmed=false, float rimratio=1.0);
+	~FlexMesh();
 	Ogre::Vector3 updateVertices();
 	Ogre::Vector3 updateShadowVertices();
 	Ogre::Vector3 flexit();
+	void computeVertices(bool stencil);
+	Ogre::Vector3 endFlexit();
 	void setVisible(bool visible);
 };
 
@@ -25,15 +25,17 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 
 using namespace Ogre;
 
-FlexMeshWheel::FlexMeshWheel(SceneManager *manager, char* name, node_t *nds, int n1, int n2, int nstart, int nrays, char* meshname, char* texband, float rimradius, bool rimreverse, MaterialFunctionMapper *mfm, Skin *usedSkin, MaterialReplacer *mr) :
+FlexMeshWheel::FlexMeshWheel(SceneManager *manager, char* name, node_t *nds, Vector3 *positions, int n1, int n2, int nstart, int nrays, char* meshname, char* texband, float rimradius, bool rimreverse, MaterialFunctionMapper *mfm, Skin *usedSkin, MaterialReplacer *mr) :
 	  id0(n1)
 	, id1(n2)
 	, idstart(nstart)
 	, mr(mr)
 	, nbrays(nrays)
 	, nodes(nds)
+	, positions(positions)
 	, revrim(rimreverse)
 	, rim_radius(rimradius)
+	, shadowlayout(false)
 	, smanager(manager)
 {
 
@@ -180,39 +182,37 @@ Vector3 FlexMeshWheel::updateVertices()
 {
 	 int i;
 	Vector3 center;
-	center=(nodes[id0].smoothpos+nodes[id1].smoothpos)/2.0;
-	Vector3 axis=nodes[id0].smoothpos-nodes[id1].smoothpos;
+	center=(positions[id0]+positions[id1])/2.0;
+	Vector3 axis=positions[id0]-positions[id1];
 	axis.normalise();
 
-	rnode->setPosition(center);
-
 	Vector3 raxis=axis;
 	if (revrim) raxis=-raxis;
-	Vector3 ray=nodes[idstart].smoothpos-nodes[id0].smoothpos;
+	Vector3 ray=positions[idstart]-positions[id0];
 	Vector3 onormal=raxis.crossProduct(ray);
 	onormal.normalise();
 	ray=raxis.crossProduct(onormal);
-	rnode->setOrientation(Quaternion(raxis, onormal, ray));
+	rimorientation=Quaternion(raxis, onormal, ray);
 
 
 	for (i=0; i<nbrays; i++)
 	{
-		Plane pl=Plane(axis, nodes[id0].smoothpos);
-		ray=nodes[idstart+i*2].smoothpos-nodes[id0].smoothpos;
+		Plane pl=Plane(axis, positions[id0]);
+		ray=positions[idstart+i*2]-positions[id0];
 		ray=pl.projectVector(ray);
 		ray.normalise();
-		covertices[i*6  ].vertex=nodes[id0].smoothpos+rim_radius*ray-center;
+		covertices[i*6  ].vertex=positions[id0]+rim_radius*ray-center;
 
-		covertices[i*6+1].vertex=nodes[idstart+i*2].smoothpos-0.05*(nodes[idstart+i*2].smoothpos-nodes[id0].smoothpos)-center;
-		covertices[i*6+2].vertex=nodes[idstart+i*2].smoothpos-0.1*(nodes[idstart+i*2].smoothpos-nodes[idstart+i*2+1].smoothpos)-center;
-		covertices[i*6+3].vertex=nodes[idstart+i*2+1].smoothpos-0.1*(nodes[idstart+i*2+1].smoothpos-nodes[idstart+i*2].smoothpos)-center;
-		covertices[i*6+4].vertex=nodes[idstart+i*2+1].smoothpos-0.05*(nodes[idstart+i*2+1].smoothpos-nodes[id1].smoothpos)-center;
+		covertices[i*6+1].vertex=positions[idstart+i*2]-0.05*(positions[idstart+i*2]-positions[id0])-center;
+		covertices[i*6+2].vertex=positions[idstart+i*2]-0.1*(positions[idstart+i*2]-positions[idstart+i*2+1])-center;
+		covertices[i*6+3].vertex=positions[idstart+i*2+1]-0.1*(positions[idstart+i*2+1]-positions[idstart+i*2])-center;
+		covertices[i*6+4].vertex=positions[idstart+i*2+1]-0.05*(positions[idstart+i*2+1]-positions[id1])-center;
 
-		pl=Plane(-axis, nodes[id1].smoothpos);
-		ray=nodes[idstart+i*2+1].smoothpos-nodes[id1].smoothpos;
+		pl=Plane(-axis, positions[id1]);
+		ray=positions[idstart+i*2+1]-positions[id1];
 		ray=pl.projectVector(ray);
 		ray.normalise();
-		covertices[i*6+5].vertex=nodes[id1].smoothpos+rim_radius*ray-center;
+		covertices[i*6+5].vertex=positions[id1]+rim_radius*ray-center;
 
 		//normals
 		covertices[i*6  ].normal=axis;
@@ -235,39 +235,37 @@ Vector3 FlexMeshWheel::updateShadowVertices()
 {
 	 int i;
 	Vector3 center;
-	center=(nodes[id0].smoothpos+nodes[id1].smoothpos)/2.0;
-	Vector3 axis=nodes[id0].smoothpos-nodes[id1].smoothpos;
+	center=(positions[id0]+positions[id1])/2.0;
+	Vector3 axis=positions[id0]-positions[id1];
 	axis.normalise();
 
-	rnode->setPosition(center);
-
 	Vector3 raxis=axis;
 	if (revrim) raxis=-raxis;
-	Vector3 ray=nodes[idstart].smoothpos-nodes[id0].smoothpos;
+	Vector3 ray=positions[idstart]-positions[id0];
 	Vector3 onormal=raxis.crossProduct(ray);
 	onormal.normalise();
 	ray=raxis.crossProduct(onormal);
-	rnode->setOrientation(Quaternion(raxis, onormal, ray));
+	rimorientation=Quaternion(raxis, onormal, ray);
 
 
 	for (i=0; i<nbrays; i++)
 	{
-		Plane pl=Plane(axis, nodes[id0].smoothpos);
-		ray=nodes[idstart+i*2].smoothpos-nodes[id0].smoothpos;
+		Plane pl=Plane(axis, positions[id0]);
+		ray=positions[idstart+i*2]-positions[id0];
 		ray=pl.projectVector(ray);
 		ray.normalise();
-		coshadowposvertices[i*6  ].vertex=nodes[id0].smoothpos+rim_radius*ray-center;
+		coshadowposvertices[i*6  ].vertex=positions[id0]+rim_radius*ray-center;
 
-		coshadowposvertices[i*6+1].vertex=nodes[idstart+i*2].smoothpos-0.05*(nodes[idstart+i*2].smoothpos-nodes[id0].smoothpos)-center;
-		coshadowposvertices[i*6+2].vertex=nodes[idstart+i*2].smoothpos-0.1*(nodes[idstart+i*2].smoothpos-nodes[idstart+i*2+1].smoothpos)-center;
-		coshadowposvertices[i*6+3].vertex=nodes[idstart+i*2+1].smoothpos-0.1*(nodes[idstart+i*2+1].smoothpos-nodes[idstart+i*2].smoothpos)-center;
-		coshadowposvertices[i*6+4].vertex=nodes[idstart+i*2+1].smoothpos-0.05*(nodes[idstart+i*2+1].smoothpos-nodes[id1].smoothpos)-center;
+		coshadowposvertices[i*6+1].vertex=positions[idstart+i*2]-0.05*(positions[idstart+i*2]-positions[id0])-center;
+		coshadowposvertices[i*6+2].vertex=positions[idstart+i*2]-0.1*(positions[idstart+i*2]-positions[idstart+i*2+1])-center;
+		coshadowposvertices[i*6+3].vertex=positions[idstart+i*2+1]-0.1*(positions[idstart+i*2+1]-positions[idstart+i*2])-center;
+		coshadowposvertices[i*6+4].vertex=positions[idstart+i*2+1]-0.05*(positions[idstart+i*2+1]-positions[id1])-center;
 
-		pl=Plane(-axis, nodes[id1].smoothpos);
-		ray=nodes[idstart+i*2+1].smoothpos-nodes[id1].smoothpos;
+		pl=Plane(-axis, positions[id1]);
+		ray=positions[idstart+i*2+1]-positions[id1];
 		ray=pl.projectVector(ray);
 		ray.normalise();
-		coshadowposvertices[i*6+5].vertex=nodes[id1].smoothpos+rim_radius*ray-center;
+		coshadowposvertices[i*6+5].vertex=positions[id1]+rim_radius*ray-center;
 
 		//normals
 		coshadownorvertices[i*6  ].normal=axis;
@@ -302,10 +300,22 @@ void FlexMeshWheel::setVisible(bool visible)
 
 Vector3 FlexMeshWheel::flexit()
 {
-	Vector3 center;
-	if (smanager->getShadowTechnique()==SHADOWTYPE_STENCIL_MODULATIVE || smanager->getShadowTechnique()==SHADOWTYPE_STENCIL_ADDITIVE)
+	computeVertices(smanager->getShadowTechnique()==SHADOWTYPE_STENCIL_MODULATIVE || smanager->getShadowTechnique()==SHADOWTYPE_STENCIL_ADDITIVE);
+	return endFlexit();
+}
+
+void FlexMeshWheel::computeVertices(bool stencil)
+{
+	shadowlayout=stencil;
+	center=stencil ? updateShadowVertices() : updateVertices();
+}
+
+Vector3 FlexMeshWheel::endFlexit()
+{
+	rnode->setPosition(center);
+	rnode->setOrientation(rimorientation);
+	if (shadowlayout)
 	{
-		center=updateShadowVertices();
 		//find the binding
 		unsigned posbinding=msh->sharedVertexData->vertexDeclaration->findElementBySemantic(VES_POSITION)->getSource();
 		HardwareVertexBufferSharedPtr pbuf=msh->sharedVertexData->vertexBufferBinding->getBuffer(posbinding);
@@ -324,7 +334,6 @@ Vector3 FlexMeshWheel::flexit()
 	}
 		else
 	{
-		center=updateVertices();
 		//vbuf->lock(HardwareBuffer::HBL_NORMAL);
 		vbuf->writeData(0, vbuf->getSizeInBytes(), vertices, true);
 		//vbuf->unlock();
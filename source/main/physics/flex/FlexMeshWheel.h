@@ -86,6 +86,7 @@ private:
 	size_t ibufCount;
 	unsigned short *faces;
 	node_t *nodes;
+	Ogre::Vector3 *positions; //!< snapshot of the node positions the mesh is deformed with, see Beam::updateVisualPositions()
 	int nbrays;
 	Ogre::SceneManager *smanager;
 	float rim_radius;
@@ -93,12 +94,17 @@ private:
 	float normy;
 	bool revrim;
 	Ogre::Entity *rimEnt;
+	bool shadowlayout;                  //!< the last update filled the stencil shadow arrays
+	Ogre::Vector3 center;               //!< center of the last update
+	Ogre::Quaternion rimorientation;    //!< the rim node is only moved on the render thread
 public:
-	FlexMeshWheel(Ogre::SceneManager *manager, char* name, node_t *nds, int n1, int n2, int nstart, int nrays, char* meshname, char* texband, float rimradius, bool rimreverse, MaterialFunctionMapper *mfm, Skin *usedSkin, MaterialReplacer *mr);
+	FlexMeshWheel(Ogre::SceneManager *manager, char* name, node_t *nds, Ogre::Vector3 *positions, int n1, int n2, int nstart, int nrays, char* meshname, char* texband, float rimradius, bool rimreverse, MaterialFunctionMapper *mfm, Skin *usedSkin, MaterialReplacer *mr);
 
 	Ogre::Vector3 updateVertices();
 	Ogre::Vector3 updateShadowVertices();
 	Ogre::Vector3 flexit();
+	void computeVertices(bool stencil);
+	Ogre::Vector3 endFlexit();
 	Ogre::Entity *getRimEntity() { return rimEnt; };
 	void setVisible(bool visible);
 };
@@ -18,6 +18,8 @@ You should have received a copy of the GNU General Public License
 along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include "FlexObj.h"
+
+#include "approxmath.h"
 #include "ResourceBuffer.h"
 
 // some gcc fixes
@@ -27,7 +29,10 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 
 using namespace Ogre;
 
-FlexObj::FlexObj(SceneManager *manager, node_t *nds, int numtexcoords, Vector3* texcoords, int numtriangles, int* triangles, int numsubmeshes, int* subtexindex, int* subtriindex, char* texname, char* name, int* subisback, char* backtexname, char* transtexname)
+// squared distance in m a vertex may move relative to the center before the mesh is updated
+#define FLEXOBJ_TOLERANCE 0.00000025f
+
+FlexObj::FlexObj(SceneManager *manager, node_t *nds, Vector3 *pos, int numtexcoords, Vector3* texcoords, int numtriangles, int* triangles, int numsubmeshes, int* subtexindex, int* subtriindex, char* texname, char* name, int* subisback, char* backtexname, char* transtexname)
 {
 	unsigned int i;
 	int j;
@@ -82,6 +87,7 @@ FlexObj::FlexObj(SceneManager *manager, node_t *nds, int numtexcoords, Vector3*
 	//finished munching
 	smanager=manager;
 	nodes=nds;
+	positions=pos;
 	/// Create the mesh via the MeshManager
     msh = MeshManager::getSingleton().createManual(name, ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME,new ResourceBuffer());
 
@@ -105,9 +111,9 @@ FlexObj::FlexObj(SceneManager *manager, node_t *nds, int numtexcoords, Vector3*
     nVertices = numtexcoords;
     vbufCount = (2*3+2)*nVertices;
 	vertices=(float*)malloc(vbufCount*sizeof(float));
-	//shadow
-	shadownorvertices=(float*)malloc(nVertices*(3+2)*sizeof(float));
-	shadowposvertices=(float*)malloc(nVertices*3*2*sizeof(float));
+	//shadow, allocated when they are used the first time
+	shadownorvertices=0;
+	shadowposvertices=0;
 	nodeIDs=(int*)malloc(nVertices*sizeof(int));
 
 	//define node ids
@@ -142,6 +148,26 @@ FlexObj::FlexObj(SceneManager *manager, node_t *nds, int numtexcoords, Vector3*
 		sref[i]=v1.length()*2.0;
 	}
 
+	// faces of every vertex, for the normals
+	lastpos=(Vector3*)malloc(nVertices*sizeof(Vector3));
+	facenormals=(Vector3*)malloc(numtriangles*sizeof(Vector3));
+	largefaces=(unsigned char*)malloc(numtriangles*sizeof(unsigned char));
+	vertexfacestart=(int*)calloc(nVertices+1, sizeof(int));
+	vertexfaces=(int*)malloc(ibufCount*sizeof(int));
+	movedvertices=(unsigned char*)malloc((nVertices+numtriangles)*sizeof(unsigned char));
+	movedfaces=movedvertices+nVertices;
+	for (i=0; i<ibufCount; i++)
+		vertexfacestart[faces[i]+1]++;
+	for (i=0; i<nVertices; i++)
+		vertexfacestart[i+1]+=vertexfacestart[i];
+	{
+		std::vector<int> fill(vertexfacestart, vertexfacestart+nVertices);
+		for (i=0; i<ibufCount; i++)
+			vertexfaces[fill[faces[i]]++]=i/3;
+	}
+	valid=false;
+	changed=false;
+	shadowlayout=false;
 
 	//update coords
 	updateVertices();
@@ -220,6 +246,8 @@ void FlexObj::scale(float factor)
 	{
 		sref[i] *= factor;
 	}
+	//the large faces have to be checked again
+	valid=false;
 }
 
 //find the zeroed id of the node v in the context of the tidx triangle
@@ -256,101 +284,109 @@ Vector3 FlexObj::updateVertices()
 {
 	unsigned int i;
 	Vector3 center;
-	center=(nodes[nodeIDs[0]].smoothpos+nodes[nodeIDs[1]].smoothpos)/2.0;
+	center=(positions[nodeIDs[0]]+positions[nodeIDs[1]])/2.0;
+
+	//positions relative to the center, vertices that did not move keep their last position
+	changed=false;
 	for (i=0; i<nVertices; i++)
 	{
-		//set position
-		covertices[i].vertex=nodes[nodeIDs[i]].smoothpos-center;
-		//reset normals
-		covertices[i].normal=Vector3::ZERO;
+		Vector3 pos=positions[nodeIDs[i]]-center;
+		movedvertices[i]=(!valid || pos.squaredDistance(lastpos[i])>FLEXOBJ_TOLERANCE);
+		if (!movedvertices[i]) continue;
+		lastpos[i]=pos;
+		changed=true;
 	}
-	//accumulate normals per triangle
-	for (i=0; i<ibufCount/3; i++)
+	if (!changed)
+		return center;
+
+	//normals of the faces with a moved vertex
+	for (i=0; i<(unsigned int)triangleCount; i++)
 	{
-		Vector3 v1, v2;
-		v1=nodes[nodeIDs[faces[i*3+1]]].smoothpos-nodes[nodeIDs[faces[i*3]]].smoothpos;
-		v2=nodes[nodeIDs[faces[i*3+2]]].smoothpos-nodes[nodeIDs[faces[i*3]]].smoothpos;
-		v1=v1.crossProduct(v2);
-		float s=v1.length();
+		int a=faces[i*3], b=faces[i*3+1], c=faces[i*3+2];
+		movedfaces[i]=(movedvertices[a] | movedvertices[b] | movedvertices[c]);
+		if (!movedfaces[i]) continue;
+
+		Vector3 n=(lastpos[b]-lastpos[a]).crossProduct(lastpos[c]-lastpos[a]);
+		float s2=n.squaredLength();
 		//avoid large tris
-		if (s>sref[i])
-		{
-			covertices[faces[i*3+1]].vertex=covertices[faces[i*3]].vertex+Vector3(0.1,0,0);
-			covertices[faces[i*3+2]].vertex=covertices[faces[i*3]].vertex+Vector3(0,0,0.1);
-		}
-		//v1.normalise();
-		if(s == 0)
-			continue;
-		v1=v1/s;
-		covertices[faces[i*3]].normal+=v1;
-		covertices[faces[i*3+1]].normal+=v1;
-		covertices[faces[i*3+2]].normal+=v1;
+		largefaces[i]=(s2>sref[i]*sref[i]);
+		facenormals[i]=(s2>0) ? n*fast_invSqrt(s2) : Vector3::ZERO;
 	}
-	//normalize
+
 	for (i=0; i<nVertices; i++)
 	{
-		covertices[i].normal.normalise();
+		//set position
+		covertices[i].vertex=lastpos[i];
+	}
+	for (i=0; i<(unsigned int)triangleCount; i++)
+	{
+		if (!largefaces[i]) continue;
+		covertices[faces[i*3+1]].vertex=covertices[faces[i*3]].vertex+Vector3(0.1,0,0);
+		covertices[faces[i*3+2]].vertex=covertices[faces[i*3]].vertex+Vector3(0,0,0.1);
+	}
+
+	//accumulate the normals of the faces around the vertices that changed
+	for (i=0; i<nVertices; i++)
+	{
+		int from=vertexfacestart[i], to=vertexfacestart[i+1];
+		bool dirty=!valid;
+		for (int k=from; k<to && !dirty; k++)
+			dirty=(movedfaces[vertexfaces[k]]!=0);
+		if (!dirty) continue;
+
+		Vector3 n=Vector3::ZERO;
+		for (int k=from; k<to; k++)
+			n+=facenormals[vertexfaces[k]];
+		float l2=n.squaredLength();
+		covertices[i].normal=(l2>0) ? n*fast_invSqrt(l2) : Vector3::ZERO;
 	}
 
+	valid=true;
 	return center;
 }
 
 //with normals
 Vector3 FlexObj::updateShadowVertices()
 {
-	unsigned int i;
-	Vector3 center;
-	center=(nodes[nodeIDs[0]].smoothpos+nodes[nodeIDs[1]].smoothpos)/2.0;
-	for (i=0; i<nVertices; i++)
-	{
-		//set position
-		coshadowposvertices[i].vertex=nodes[nodeIDs[i]].smoothpos-center;
-		coshadowposvertices[i+nVertices].vertex=nodes[nodeIDs[i]].smoothpos-center;
-		//reset normals
-		coshadownorvertices[i].normal=Vector3::ZERO;
-	}
-	//accumulate normals per triangle
-	for (i=0; i<ibufCount/3; i++)
+	Vector3 center=updateVertices();
+	if (!changed)
+		return center;
+
+	if (!shadowposvertices)
 	{
-		Vector3 v1, v2;
-		v1=nodes[nodeIDs[faces[i*3+1]]].smoothpos-nodes[nodeIDs[faces[i*3]]].smoothpos;
-		v2=nodes[nodeIDs[faces[i*3+2]]].smoothpos-nodes[nodeIDs[faces[i*3]]].smoothpos;
-		v1=v1.crossProduct(v2);
-		float s=v1.length();
-		//avoid large tris
-		if (s>sref[i])
-		{
-			coshadowposvertices[faces[i*3+1]].vertex=coshadowposvertices[faces[i*3]].vertex+Vector3(0.1,0,0);
-			coshadowposvertices[faces[i*3+2]].vertex=coshadowposvertices[faces[i*3]].vertex+Vector3(0,0,0.1);
-			coshadowposvertices[faces[i*3+1]+nVertices].vertex=coshadowposvertices[faces[i*3+1]].vertex;
-			coshadowposvertices[faces[i*3+2]+nVertices].vertex=coshadowposvertices[faces[i*3+2]].vertex;
-		}
-		//v1.normalise();
-		if(s == 0)
-			continue;
-		v1=v1/s;
-
-		coshadownorvertices[faces[i*3]].normal+=v1;
-		coshadownorvertices[faces[i*3+1]].normal+=v1;
-		coshadownorvertices[faces[i*3+2]].normal+=v1;
+		shadownorvertices=(float*)malloc(nVertices*(3+2)*sizeof(float));
+		shadowposvertices=(float*)malloc(nVertices*3*2*sizeof(float));
 	}
-	//normalize
-	for (i=0; i<nVertices; i++)
+	for (unsigned int i=0; i<nVertices; i++)
 	{
-		coshadownorvertices[i].normal.normalise();
+		coshadowposvertices[i].vertex=covertices[i].vertex;
+		coshadowposvertices[i+nVertices].vertex=covertices[i].vertex;
+		coshadownorvertices[i].normal=covertices[i].normal;
 		//texcoords
 		coshadownorvertices[i].texcoord=covertices[i].texcoord;
 	}
-
 	return center;
 }
 
 Vector3 FlexObj::flexit()
 {
-	Vector3 center;
-	if (smanager->getShadowTechnique()==SHADOWTYPE_STENCIL_MODULATIVE || smanager->getShadowTechnique()==SHADOWTYPE_STENCIL_ADDITIVE)
+	computeVertices(smanager->getShadowTechnique()==SHADOWTYPE_STENCIL_MODULATIVE || smanager->getShadowTechnique()==SHADOWTYPE_STENCIL_ADDITIVE);
+	return endFlexit();
+}
+
+void FlexObj::computeVertices(bool stencil)
+{
+	shadowlayout=stencil;
+	center=stencil ? updateShadowVertices() : updateVertices();
+}
+
+Vector3 FlexObj::endFlexit()
+{
+	//nothing moved relative to the center, the buffers are still up to date
+	if (!changed)
+		return center;
+	if (shadowlayout)
 	{
-		center=updateShadowVertices();
 		//find the binding
 		unsigned posbinding=msh->sharedVertexData->vertexDeclaration->findElementBySemantic(VES_POSITION)->getSource();
 		HardwareVertexBufferSharedPtr pbuf=msh->sharedVertexData->vertexBufferBinding->getBuffer(posbinding);
@@ -368,16 +404,29 @@ Vector3 FlexObj::flexit()
 	}
 		else
 	{
-		center=updateVertices();
 		//vbuf->lock(HardwareBuffer::HBL_NORMAL);
 		vbuf->writeData(0, vbuf->getSizeInBytes(), vertices, true);
 		//vbuf->unlock();
 		//msh->sharedVertexData->vertexBufferBinding->getBuffer(0)->writeData(0, vbuf->getSizeInBytes(), vertices, true);
 	}
+	changed=false;
 	return center;
 }
 
 FlexObj::~FlexObj()
 {
 	if(!msh.isNull()) msh->unload();
+	free(subs);
+	free(vertices);
+	free(shadowposvertices);
+	free(shadownorvertices);
+	free(nodeIDs);
+	free(faces);
+	free(sref);
+	free(lastpos);
+	free(facenormals);
+	free(largefaces);
+	free(vertexfaces);
+	free(vertexfacestart);
+	free(movedvertices);
 }
@@ -78,24 +78,41 @@ private:
 	size_t ibufCount;
 	unsigned short *faces;
 	node_t *nodes;
+	Ogre::Vector3 *positions;      //!< snapshot of the node positions the mesh is deformed with, see Beam::updateVisualPositions()
 	int nbrays;
 	Ogre::SceneManager *smanager;
 
 	float *sref;
 	int triangleCount;
 
+	// the normals are only recomputed for faces with a moved vertex
+	Ogre::Vector3 *lastpos;        //!< vertex positions relative to the center at the last change
+	Ogre::Vector3 *facenormals;
+	unsigned char *largefaces;     //!< faces that are stretched too far and get collapsed
+	int *vertexfaces;              //!< faces of every vertex, vertexfacestart[i] .. vertexfacestart[i+1]-1
+	int *vertexfacestart;
+	unsigned char *movedvertices;  //!< vertices that moved in the current update, followed by the faces around them
+	unsigned char *movedfaces;
+	bool valid;                    //!< false until all normals were computed once
+	bool changed;                  //!< the last update moved at least one vertex, the buffers need an upload
+	bool shadowlayout;             //!< the last update filled the stencil shadow arrays
+	Ogre::Vector3 center;          //!< center of the last update
+
 public:
 
-	FlexObj(Ogre::SceneManager *manager, node_t *nds, int numtexcoords, Ogre::Vector3* texcoords, int numtriangles, int* triangles, int numsubmeshes, int* subtexindex, int* subtriindex, char* texname, char* name, int* subisback, char* backtexname, char* transtexname);
+	FlexObj(Ogre::SceneManager *manager, node_t *nds, Ogre::Vector3 *pos, int numtexcoords, Ogre::Vector3* texcoords, int numtriangles, int* triangles, int numsubmeshes, int* subtexindex, int* subtriindex, char* texname, char* name, int* subisback, char* backtexname, char* transtexname);
 	~FlexObj();
 
 	//find the zeroed id of the node v in the context of the tidx triangle
 	int findID(int tidx, int v, int numsubmeshes, int* subtexindex, int* subtriindex);
-	//with normals
+	//with normals, only changes the vertices that moved relative to the center
 	Ogre::Vector3 updateVertices();
-	//with normals
+	//with normals, same as updateVertices() in the layout for stencil shadows
 	Ogre::Vector3 updateShadowVertices();
 	Ogre::Vector3 flexit();
+	// flexit() in two steps like Flexable, computeVertices() may run on any thread, endFlexit() uploads on the render thread
+	void computeVertices(bool stencil);
+	Ogre::Vector3 endFlexit();
 	void scale(float factor);
 };
 
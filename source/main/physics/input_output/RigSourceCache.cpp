@@ -0,0 +1,266 @@
+/*
+This source file is part of Rigs of Rods
+Copyright 2005-2012 Pierre-Michel Ricordel
+Copyright 2007-2012 Thomas Fischer
+
+For more information, see http://www.rigsofrods.com/
+
+Rigs of Rods is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 3, as
+published by the Free Software Foundation.
+
+Rigs of Rods is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "RigSourceCache.h"
+
+#include "CacheSystem.h"
+#include "SerializedRig.h"
+#include "Settings.h"
+#include "sha1.h"
+
+using namespace Ogre;
+
+static void writeString(FILE *f, const String &str)
+{
+	unsigned int len = (unsigned int)str.size();
+	fwrite(&len, sizeof(unsigned int), 1, f);
+	if (len) fwrite(str.c_str(), 1, len, f);
+}
+
+static bool readString(FILE *f, String &str)
+{
+	unsigned int len = 0;
+	if (fread(&len, sizeof(unsigned int), 1, f) != 1 || len > 1024 * 1024)
+		return false;
+	str.resize(len);
+	return !len || fread(&str[0], 1, len, f) == len;
+}
+
+RigSourceCache::RigSourceCache()
+{
+	pthread_mutex_init(&lock, NULL);
+	enabled = BSETTING("Compiled Rig Cache", true);
+}
+
+RigSourceCache::~RigSourceCache()
+{
+	clear();
+	pthread_mutex_destroy(&lock);
+}
+
+void RigSourceCache::clear()
+{
+	MUTEX_LOCK(&lock);
+	for (std::map<String, compiled_rig_t *>::iterator it = rigs.begin(); it != rigs.end(); it++)
+		delete it->second;
+	rigs.clear();
+	for (size_t i = 0; i < retired.size(); i++)
+		delete retired[i];
+	retired.clear();
+	MUTEX_UNLOCK(&lock);
+}
+
+String RigSourceCache::getKey(String filename, String group)
+{
+	if (group.empty())
+		return "";
+
+	// several zips can contain a file with the same name, so use the one in the archive the group loads it from
+	FileInfoListPtr files = ResourceGroupManager::getSingleton().findResourceFileInfo(group, filename);
+	if (files.isNull() || files->empty() || !files->front().archive)
+		return "";
+	Archive *archive = files->front().archive;
+
+	// only zips are covered by the hash in the mod cache, files in directories are always parsed from the source
+	if (archive->getType() != "Zip")
+		return "";
+	Cache_Entry *entry = CACHE.getEntryInArchive(filename, archive->getName());
+	if (!entry || entry->hash.empty() || entry->hash == "none")
+		return "";
+	return entry->hash + "/" + archive->getName() + "/" + entry->fname;
+}
+
+String RigSourceCache::getCompiledFilename(String filename)
+{
+	return SSETTING("Cache Path", "") + "rig_" + filename + "c";
+}
+
+const compiled_rig_t *RigSourceCache::get(String filename, String key)
+{
+	if (!enabled || key.empty())
+		return 0;
+
+	MUTEX_LOCK(&lock);
+	std::map<String, compiled_rig_t *>::iterator it = rigs.find(filename);
+	if (it != rigs.end() && it->second->key == key)
+	{
+		compiled_rig_t *rig = it->second;
+		MUTEX_UNLOCK(&lock);
+		return rig;
+	}
+	MUTEX_UNLOCK(&lock);
+
+	compiled_rig_t *rig = loadCompiled(filename, key);
+	if (rig)
+		storeRig(rig);
+	return rig;
+}
+
+void RigSourceCache::storeRig(compiled_rig_t *rig)
+{
+	MUTEX_LOCK(&lock);
+	std::map<String, compiled_rig_t *>::iterator it = rigs.find(rig->filename);
+	if (it != rigs.end())
+		// a truck might be loading from the old version right now, so it is only freed in clear()
+		retired.push_back(it->second);
+	rigs[rig->filename] = rig;
+	MUTEX_UNLOCK(&lock);
+}
+
+const compiled_rig_t *RigSourceCache::compile(String filename, String key, DataStreamPtr ds, compiled_rig_t &rig)
+{
+	rig.filename = filename;
+	rig.key      = key;
+	rig.lines.clear();
+
+	// first line is the truck name
+	rig.truckname = ds->getLine(true);
+	StringUtil::trim(rig.truckname);
+
+	unsigned int linecounter = 1;
+	while (!ds->eof())
+	{
+		compiled_rig_line_t l;
+		l.line = ds->getLine(true);
+		StringUtil::trim(l.line);
+		l.linecounter = ++linecounter;
+
+		// the parser ignores those anyways
+		if (l.line.empty() || l.line[0] == ';' || l.line[0] == '/')
+			continue;
+
+		// everything the parser looks up for every line is done once here
+		l.section = SerializedRig::findSection(l.line.c_str(), l.line.size(), l.sectionWrongCase);
+		l.keyword = SerializedRig::findKeyword(l.line.c_str(), l.line.size());
+		SerializedRig::splitArgs(l.line.c_str(), l.line.size(), l.args);
+		rig.lines.push_back(l);
+	}
+
+	// now generate the hash over the whole file
+	{
+		String code;
+		ds->seek(0); // from start
+		code.resize(ds->size());
+		if (!code.empty())
+			ds->read(&code[0], ds->size());
+
+		char hash_result[250];
+		memset(hash_result, 0, 249);
+		RoR::CSHA1 sha1;
+		sha1.UpdateHash((uint8_t *)code.c_str(), (uint32_t)code.size());
+		sha1.Final();
+		sha1.ReportHash(hash_result, RoR::CSHA1::REPORT_HEX_SHORT);
+		rig.beamHash = String(hash_result);
+	}
+
+	if (!enabled || key.empty())
+		return &rig;
+
+	compiled_rig_t *stored = new compiled_rig_t(rig);
+	saveCompiled(stored);
+	storeRig(stored);
+	return stored;
+}
+
+compiled_rig_t *RigSourceCache::loadCompiled(String filename, String key)
+{
+	FILE *f = fopen(getCompiledFilename(filename).c_str(), "rb");
+	if (!f)
+		return 0;
+
+	compiled_rig_t *rig = new compiled_rig_t();
+	char magic[8];
+	unsigned int version = 0, count = 0;
+	bool ok = fread(magic, 1, 8, f) == 8 && !memcmp(magic, COMPILED_RIG_MAGIC, 8)
+		&& fread(&version, sizeof(unsigned int), 1, f) == 1 && version == COMPILED_RIG_VERSION
+		&& readString(f, rig->key) && rig->key == key
+		&& readString(f, rig->filename) && rig->filename == filename
+		&& readString(f, rig->truckname)
+		&& readString(f, rig->beamHash)
+		&& fread(&count, sizeof(unsigned int), 1, f) == 1;
+
+	if (ok)
+	{
+		rig->lines.resize(count);
+		for (unsigned int i = 0; i < count && ok; i++)
+		{
+			compiled_rig_line_t &l = rig->lines[i];
+			unsigned char wrongCase = 0;
+			unsigned int argcount = 0;
+			ok = fread(&l.linecounter, sizeof(unsigned int), 1, f) == 1
+				&& readString(f, l.line)
+				&& fread(&l.section, sizeof(int), 1, f) == 1 && l.section >= -1 && l.section < BTS_END
+				&& fread(&wrongCase, 1, 1, f) == 1
+				&& fread(&l.keyword, sizeof(int), 1, f) == 1 && l.keyword >= -1 && l.keyword < BTK_COUNT
+				&& fread(&argcount, sizeof(unsigned int), 1, f) == 1 && argcount <= l.line.size();
+			if (!ok) break;
+			l.sectionWrongCase = (wrongCase != 0);
+			l.args.resize(argcount);
+			if (argcount)
+				ok = fread(&l.args[0], sizeof(compiled_rig_arg_t), argcount, f) == argcount;
+			// a broken file must never make the parser read outside of the line
+			for (unsigned int k = 0; k < argcount && ok; k++)
+				ok = (unsigned long long)l.args[k].start + l.args[k].length <= l.line.size();
+		}
+	}
+	fclose(f);
+
+	if (!ok)
+	{
+		// outdated or broken, will be compiled again
+		delete rig;
+		return 0;
+	}
+	return rig;
+}
+
+void RigSourceCache::saveCompiled(compiled_rig_t *rig)
+{
+	String fn = getCompiledFilename(rig->filename);
+	FILE *f = fopen(fn.c_str(), "wb");
+	if (!f)
+	{
+		LOG("unable to write compiled rig: " + fn);
+		return;
+	}
+	unsigned int version = COMPILED_RIG_VERSION;
+	unsigned int count   = (unsigned int)rig->lines.size();
+	fwrite(COMPILED_RIG_MAGIC, 1, 8, f);
+	fwrite(&version, sizeof(unsigned int), 1, f);
+	writeString(f, rig->key);
+	writeString(f, rig->filename);
+	writeString(f, rig->truckname);
+	writeString(f, rig->beamHash);
+	fwrite(&count, sizeof(unsigned int), 1, f);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		compiled_rig_line_t &l = rig->lines[i];
+		unsigned char wrongCase = l.sectionWrongCase ? 1 : 0;
+		unsigned int argcount   = (unsigned int)l.args.size();
+		fwrite(&l.linecounter, sizeof(unsigned int), 1, f);
+		writeString(f, l.line);
+		fwrite(&l.section, sizeof(int), 1, f);
+		fwrite(&wrongCase, 1, 1, f);
+		fwrite(&l.keyword, sizeof(int), 1, f);
+		fwrite(&argcount, sizeof(unsigned int), 1, f);
+		if (argcount)
+			fwrite(&l.args[0], sizeof(compiled_rig_arg_t), argcount, f);
+	}
+	fclose(f);
+}
@@ -0,0 +1,104 @@
+/*
+This source file is part of Rigs of Rods
+Copyright 2005-2012 Pierre-Michel Ricordel
+Copyright 2007-2012 Thomas Fischer
+
+For more information, see http://www.rigsofrods.com/
+
+Rigs of Rods is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 3, as
+published by the Free Software Foundation.
+
+Rigs of Rods is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __RigSourceCache_H_
+#define __RigSourceCache_H_
+
+#include "RoRPrerequisites.h"
+
+#include "Singleton.h"
+
+#include <OgreDataStream.h>
+#include <pthread.h>
+
+#define COMPILED_RIG_MAGIC   "RORRIGC\0"
+#define COMPILED_RIG_VERSION 3
+
+// one argument of a line, as split by SerializedRig::parse_args
+typedef struct compiled_rig_arg_t
+{
+	unsigned int start;        //!< offset into the line
+	unsigned int length;
+} compiled_rig_arg_t;
+
+typedef struct compiled_rig_line_t
+{
+	unsigned int linecounter;  //!< line number in the original file, for parser warnings
+	Ogre::String line;
+	int section;               //!< index into truck_sections if the line is a section name, -1 otherwise
+	bool sectionWrongCase;     //!< the section name only matched case insensitive
+	int keyword;               //!< index into truck_keywords if the line is a one line command, -1 otherwise
+	std::vector<compiled_rig_arg_t> args;
+} compiled_rig_line_t;
+
+/**
+ * Truck file as the parser sees it: the first line (truck name), then all lines
+ * trimmed and without empty lines and comments, each with its section and keyword
+ * lookup and argument positions. Also holds the hash over the original file, so it does not
+ * need to be read again for Beam::getTruckHash.
+ * This is only the preparsed source, SerializedRig::loadTruck still resolves the
+ * nodes, beams and everything else from it for every spawn.
+ * Compiled rigs are shared and never changed once they are created.
+ */
+typedef struct compiled_rig_t
+{
+	Ogre::String filename;
+	Ogre::String key;          //!< identifies the version of the file, see RigSourceCache::getKey
+	Ogre::String truckname;
+	Ogre::String beamHash;
+	std::vector<compiled_rig_line_t> lines;
+} compiled_rig_t;
+
+/**
+ * Keeps the compiled sources of all loaded rigs in memory and in the cache directory,
+ * so spawning a rig again does not need to open, read and hash the truck file.
+ */
+class RigSourceCache : public RoRSingleton<RigSourceCache>
+{
+	friend class RoRSingleton<RigSourceCache>;
+public:
+	// returns the compiled rig or 0 if there is none for this version of the file
+	const compiled_rig_t *get(Ogre::String filename, Ogre::String key);
+
+	// compiles the rig from the stream into rig. If key is not empty, it is stored and the
+	// stored copy is returned, otherwise the result points to rig
+	const compiled_rig_t *compile(Ogre::String filename, Ogre::String key, Ogre::DataStreamPtr ds, compiled_rig_t &rig);
+
+	// key of the version of the file that group loads, made of the hash and the name of the zip it is in.
+	// Empty if the file can change without the mod cache noticing (i.e. directories)
+	static Ogre::String getKey(Ogre::String filename, Ogre::String group);
+
+	void clear();
+
+protected:
+	RigSourceCache();
+	~RigSourceCache();
+
+	pthread_mutex_t lock;
+	bool enabled;
+	std::map<Ogre::String, compiled_rig_t *> rigs;   //!< by filename
+	std::vector<compiled_rig_t *> retired;           //!< replaced by a newer version of the file
+
+	Ogre::String getCompiledFilename(Ogre::String filename);
+	compiled_rig_t *loadCompiled(Ogre::String filename, Ogre::String key);
+	void saveCompiled(compiled_rig_t *rig);
+	void storeRig(compiled_rig_t *rig);
+};
+
+#endif // __RigSourceCache_H_
@@ -0,0 +1,181 @@
+/*
+This source file is part of Rigs of Rods
+Copyright 2005-2012 Pierre-Michel Ricordel
+Copyright 2007-2012 Thomas Fischer
+
+For more information, see http://www.rigsofrods.com/
+
+Rigs of Rods is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 3, as
+published by the Free Software Foundation.
+
+Rigs of Rods is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "RigTemplateCache.h"
+
+using namespace Ogre;
+
+RigTemplateCache::RigTemplateCache()
+{
+	pthread_mutex_init(&lock, NULL);
+}
+
+RigTemplateCache::~RigTemplateCache()
+{
+	MUTEX_LOCK(&lock);
+	for (std::map<String, rig_template_t *>::iterator it = templates.begin(); it != templates.end(); it++)
+		destroy(it->second);
+	templates.clear();
+	MUTEX_UNLOCK(&lock);
+	pthread_mutex_destroy(&lock);
+}
+
+String RigTemplateCache::getKey(String beamHash, std::vector<String> &truckconfig)
+{
+	String key = beamHash + "|";
+	for (size_t i = 0; i < truckconfig.size(); i++)
+	{
+		if (i) key += ",";
+		key += truckconfig[i];
+	}
+	return key;
+}
+
+rig_template_t *RigTemplateCache::acquire(String key)
+{
+	MUTEX_LOCK(&lock);
+	rig_template_t *tmpl = 0;
+	std::map<String, rig_template_t *>::iterator it = templates.find(key);
+	if (it != templates.end())
+	{
+		tmpl = it->second;
+	} else
+	{
+		tmpl = new rig_template_t();
+		tmpl->key      = key;
+		tmpl->refcount = 0;
+		memset(tmpl->flexbodies, 0, sizeof(tmpl->flexbodies));
+		templates[key] = tmpl;
+	}
+	tmpl->refcount++;
+	MUTEX_UNLOCK(&lock);
+	return tmpl;
+}
+
+void RigTemplateCache::release(rig_template_t *tmpl)
+{
+	if (!tmpl) return;
+	MUTEX_LOCK(&lock);
+	tmpl->refcount--;
+	if (tmpl->refcount <= 0)
+	{
+		// last instance is gone
+		templates.erase(tmpl->key);
+		destroy(tmpl);
+	}
+	MUTEX_UNLOCK(&lock);
+}
+
+flexbody_template_t *RigTemplateCache::getFlexBody(rig_template_t *tmpl, int index, String meshname, int numnodes, size_t vertex_count)
+{
+	if (!tmpl || index < 0 || index >= MAX_FLEXBODIES)
+		return 0;
+
+	MUTEX_LOCK(&lock);
+	flexbody_template_t *fb = tmpl->flexbodies[index];
+	if (fb && (fb->meshname != meshname || fb->numnodes != numnodes || fb->vertex_count != vertex_count))
+		fb = 0;
+	MUTEX_UNLOCK(&lock);
+	return fb;
+}
+
+bool RigTemplateCache::storeFlexBody(rig_template_t *tmpl, int index, flexbody_template_t *flexbody)
+{
+	if (!tmpl || index < 0 || index >= MAX_FLEXBODIES)
+		return false;
+
+	MUTEX_LOCK(&lock);
+	bool stored = false;
+	if (!tmpl->flexbodies[index])
+	{
+		tmpl->flexbodies[index] = flexbody;
+		stored = true;
+	}
+	MUTEX_UNLOCK(&lock);
+	return stored;
+}
+
+size_t RigTemplateCache::getMemorySize(rig_template_t *tmpl)
+{
+	if (!tmpl) return 0;
+
+	size_t size = sizeof(rig_template_t);
+	MUTEX_LOCK(&lock);
+	for (int i = 0; i < MAX_FLEXBODIES; i++)
+	{
+		flexbody_template_t *fb = tmpl->flexbodies[i];
+		if (!fb) continue;
+		size += sizeof(flexbody_template_t) + getBindingsSize(fb->vertex_count);
+	}
+	MUTEX_UNLOCK(&lock);
+	return size;
+}
+
+void RigTemplateCache::destroy(rig_template_t *tmpl)
+{
+	for (int i = 0; i < MAX_FLEXBODIES; i++)
+	{
+		flexbody_template_t *fb = tmpl->flexbodies[i];
+		if (!fb) continue;
+		freeBindings(fb->bindings);
+		delete fb;
+	}
+	delete tmpl;
+}
+
+size_t RigTemplateCache::getBindingsSize(size_t count)
+{
+	// every array is padded to a multiple of 4 elements, so they all stay 16 byte aligned
+	size_t padded = (count + 3) & ~(size_t)3;
+	return padded * (3 * sizeof(int) + 6 * sizeof(float));
+}
+
+void RigTemplateCache::createBindings(flexbody_bindings_t &bindings, flexbody_locator_t *locs, Vector3 *normals, size_t count)
+{
+	size_t padded = (count + 3) & ~(size_t)3;
+	bindings.data = malloc(getBindingsSize(count));
+	memset(bindings.data, 0, getBindingsSize(count));
+
+	bindings.ref = (int *)bindings.data;
+	bindings.nx  = bindings.ref + padded;
+	bindings.ny  = bindings.nx  + padded;
+	float *fpt = (float *)(bindings.ny + padded);
+	for (int a = 0; a < 3; a++, fpt += padded)
+		bindings.coords[a] = fpt;
+	for (int a = 0; a < 3; a++, fpt += padded)
+		bindings.normals[a] = fpt;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		bindings.ref[i] = locs[i].ref;
+		bindings.nx[i]  = locs[i].nx;
+		bindings.ny[i]  = locs[i].ny;
+		for (int a = 0; a < 3; a++)
+		{
+			bindings.coords[a][i]  = locs[i].coords[a];
+			bindings.normals[a][i] = normals[i][a];
+		}
+	}
+}
+
+void RigTemplateCache::freeBindings(flexbody_bindings_t &bindings)
+{
+	free(bindings.data);
+	memset(&bindings, 0, sizeof(flexbody_bindings_t));
+}
@@ -0,0 +1,113 @@
+/*
+This source file is part of Rigs of Rods
+Copyright 2005-2012 Pierre-Michel Ricordel
+Copyright 2007-2012 Thomas Fischer
+
+For more information, see http://www.rigsofrods.com/
+
+Rigs of Rods is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 3, as
+published by the Free Software Foundation.
+
+Rigs of Rods is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __RigTemplateCache_H_
+#define __RigTemplateCache_H_
+
+#include "RoRPrerequisites.h"
+
+#include "BeamData.h"
+#include "Singleton.h"
+
+#include <pthread.h>
+
+// binds one flexbody vertex to three nodes
+typedef struct flexbody_locator_t
+{
+	int ref;
+	int nx;
+	int ny;
+	Ogre::Vector3 coords;      //!< vertex position in the basis formed by the nodes
+} flexbody_locator_t;
+
+/**
+ * Vertex bindings in structure of arrays layout, the way FlexBody::computeVertices reads them.
+ * All arrays are 16 byte aligned and live in one allocation.
+ */
+typedef struct flexbody_bindings_t
+{
+	int *ref;
+	int *nx;
+	int *ny;
+	float *coords[3];          //!< vertex position in the basis formed by the nodes, x, y and z arrays
+	float *normals[3];         //!< source normal in the same basis
+	void *data;
+} flexbody_bindings_t;
+
+/**
+ * Vertex bindings of a flexbody. They only depend on the mesh and the initial node positions
+ * relative to each other, so all instances of the same rig can use the same ones.
+ */
+typedef struct flexbody_template_t
+{
+	Ogre::String meshname;
+	int numnodes;              //!< nodes that existed when the flexbody was created
+	size_t vertex_count;
+	flexbody_bindings_t bindings;
+} flexbody_template_t;
+
+/**
+ * Data shared by all instances of the same file and configuration. For now these are only the
+ * flexbody vertex bindings: nodes, beams, cabs and texcoords live in the fixed size arrays of
+ * rig_t, which every instance allocates anyways, so sharing them would not save any memory.
+ * Not touched after it was created, apart from the reference count.
+ */
+typedef struct rig_template_t
+{
+	Ogre::String key;
+	int refcount;
+	flexbody_template_t *flexbodies[MAX_FLEXBODIES];
+} rig_template_t;
+
+class RigTemplateCache : public RoRSingleton<RigTemplateCache>
+{
+	friend class RoRSingleton<RigTemplateCache>;
+public:
+	// key of the template for the file with the given hash and truck configuration
+	static Ogre::String getKey(Ogre::String beamHash, std::vector<Ogre::String> &truckconfig);
+
+	// returns the template for this key and adds a reference, creates an empty one if there is none
+	rig_template_t *acquire(Ogre::String key);
+	void release(rig_template_t *tmpl);
+
+	// returns the flexbody template if it was created already and matches the mesh and node count
+	flexbody_template_t *getFlexBody(rig_template_t *tmpl, int index, Ogre::String meshname, int numnodes, size_t vertex_count);
+
+	// hands over the vertex bindings of a flexbody to the template, returns false if there is one already
+	bool storeFlexBody(rig_template_t *tmpl, int index, flexbody_template_t *flexbody);
+
+	// memory used by the shared data of the template
+	size_t getMemorySize(rig_template_t *tmpl);
+
+	// converts the locators and normals of count vertices, freeBindings() releases them again
+	static void createBindings(flexbody_bindings_t &bindings, flexbody_locator_t *locs, Ogre::Vector3 *normals, size_t count);
+	static void freeBindings(flexbody_bindings_t &bindings);
+	static size_t getBindingsSize(size_t count);
+
+protected:
+	RigTemplateCache();
+	~RigTemplateCache();
+
+	pthread_mutex_t lock;
+	std::map<Ogre::String, rig_template_t *> templates;
+
+	void destroy(rig_template_t *tmpl);
+};
+
+#endif // __RigTemplateCache_H_
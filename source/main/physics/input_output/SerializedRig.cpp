@@ -23,6 +23,7 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 #include "airbrake.h"
 #include "Airfoil.h"
 #include "autopilot.h"
+#include "BeamRenderer.h"
 #include "BeamEngine.h"
 #include "buoyance.h"
 #include "CacheSystem.h"
@@ -38,6 +39,8 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 #include "JSON.h"
 #include "MaterialReplacer.h"
 #include "MeshObject.h"
+#include "RigSourceCache.h"
+#include "RigTemplateCache.h"
 #include "RoRFrameListener.h"
 #include "RoRVersion.h"
 #include "ScopeLog.h"
@@ -46,6 +49,7 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 #include "skin.h"
 #include "SlideNode.h"
 #include "SoundScriptManager.h"
+#include "Timer.h"
 #include "TorqueCurve.h"
 #include "turboprop.h"
 #include "turbojet.h"
@@ -131,6 +135,180 @@ trucksection_t truck_sections[] = {
 	{BTS_END, "end", false},
 };
 
+// section names are looked up in an open addressing hash table instead of comparing every line
+// against all of them. Lines are hashed where they are, so a lookup neither copies nor converts them.
+// The case insensitive table is only used to warn about section names with the wrong character case
+#define TRUCK_SECTION_HASH_SIZE 512 // power of two, well above twice the number of sections
+
+static int truck_section_hash[TRUCK_SECTION_HASH_SIZE];       //!< index into truck_sections, -1 if empty
+static int truck_section_hash_nocase[TRUCK_SECTION_HASH_SIZE];
+
+// FNV-1a over the characters of the view
+static unsigned int hashSectionName(const char *name, size_t len, bool nocase)
+{
+	unsigned int h = 2166136261u;
+	for (size_t i = 0; i < len; i++)
+	{
+		unsigned char ch = (unsigned char)name[i];
+		if (nocase) ch = (unsigned char)tolower(ch);
+		h = (h ^ ch) * 16777619u;
+	}
+	return h;
+}
+
+// true if the NUL terminated section name equals the view
+static bool matchSectionName(const char *section, const char *name, size_t len, bool nocase)
+{
+	for (size_t i = 0; i < len; i++, section++)
+	{
+		if (!*section) return false;
+		if (nocase ? tolower((unsigned char)*section) != tolower((unsigned char)name[i]) : *section != name[i])
+			return false;
+	}
+	return *section == 0;
+}
+
+static int lookupSectionHash(const int *table, const char *name, size_t len, bool nocase)
+{
+	unsigned int slot = hashSectionName(name, len, nocase) & (TRUCK_SECTION_HASH_SIZE - 1);
+	while (table[slot] >= 0)
+	{
+		if (matchSectionName(truck_sections[table[slot]].name, name, len, nocase))
+			return table[slot];
+		slot = (slot + 1) & (TRUCK_SECTION_HASH_SIZE - 1);
+	}
+	return -1;
+}
+
+static void insertSectionHash(int *table, int section, bool nocase)
+{
+	const char *name = truck_sections[section].name;
+	size_t len = strlen(name);
+	// the first section wins, same as in the old linear search
+	if (lookupSectionHash(table, name, len, nocase) >= 0)
+		return;
+	unsigned int slot = hashSectionName(name, len, nocase) & (TRUCK_SECTION_HASH_SIZE - 1);
+	while (table[slot] >= 0)
+		slot = (slot + 1) & (TRUCK_SECTION_HASH_SIZE - 1);
+	table[slot] = section;
+}
+
+static bool buildTruckSectionHash()
+{
+	for (int i = 0; i < TRUCK_SECTION_HASH_SIZE; i++)
+	{
+		truck_section_hash[i]        = -1;
+		truck_section_hash_nocase[i] = -1;
+	}
+	for (int i = 0; i < BTS_END; i++)
+	{
+		insertSectionHash(truck_section_hash, i, false);
+		insertSectionHash(truck_section_hash_nocase, i, true);
+	}
+	return true;
+}
+
+static bool truck_section_hash_built = buildTruckSectionHash();
+
+int SerializedRig::findSection(const char *line, size_t len, bool &wrongCase)
+{
+	wrongCase = false;
+	// all section names start with a letter, this skips the data lines
+	if (!len || !isalpha((unsigned char)line[0]))
+		return -1;
+
+	int section = lookupSectionHash(truck_section_hash, line, len, false);
+	if (section >= 0)
+		return section;
+
+	section = lookupSectionHash(truck_section_hash_nocase, line, len, true);
+	if (section >= 0)
+		wrongCase = true;
+	return section;
+}
+
+// one line commands. The ones with arguments only need to start the line, but the line has to be at
+// least minLength long: "SlopeBrake" works without arguments, "fileinfo" does not.
+// If one keyword starts with another one, the longer one has to come first
+truckkeyword_t truck_keywords[] = {
+	{BTK_END, "end", 0},
+	{BTK_PATCHENGINETORQUE, "patchEngineTorque", 0},
+	{BTK_END_DESCRIPTION, "end_description", 0},
+	{BTK_END_COMMENT, "end_comment", 0},
+	{BTK_END_SECTION, "end_section", 0},
+	{BTK_FORWARDCOMMANDS, "forwardcommands", 0},
+	{BTK_IMPORTCOMMANDS, "importcommands", 0},
+	{BTK_ROLLON, "rollon", 0},
+	{BTK_RESCUER, "rescuer", 0},
+	{BTK_COMMENT, "comment", 0},
+	{BTK_DISABLEDEFAULTSOUNDS, "disabledefaultsounds", 0},
+	{BTK_SECTIONCONFIG, "sectionconfig", 14},
+	{BTK_SECTION, "section", 8},
+	{BTK_DETACHER_GROUP, "detacher_group", 15},
+	{BTK_FILEINFO, "fileinfo", 9},
+	{BTK_EXTCAMERA, "extcamera", 10},
+	{BTK_SUBMESH_GROUNDMODEL, "submesh_groundmodel", 21},
+	{BTK_SLOPEBRAKE, "SlopeBrake", 10},
+	{BTK_ANTILOCKBRAKES, "AntiLockBrakes", 15},
+	{BTK_TRACTIONCONTROL, "TractionControl", 15},
+	{BTK_CRUISECONTROL, "cruisecontrol", 14},
+	{BTK_SPEEDLIMITER, "speedlimiter", 13},
+	{BTK_FILEFORMATVERSION, "fileformatversion", 18},
+	{BTK_AUTHOR, "author", 7},
+	{BTK_SLIDENODE_CONNECT_INSTANTLY, "slidenode_connect_instantly", 0},
+	{BTK_ENABLE_ADVANCED_DEFORMATION, "enable_advanced_deformation", 0},
+	{BTK_HIDEINCHOOSER, "hideInChooser", 0},
+	{BTK_LOCKGROUP_DEFAULT_NOLOCK, "lockgroup_default_nolock", 0},
+	{BTK_SET_SHADOWS, "set_shadows", 0},
+	{BTK_PROP_CAMERA_MODE, "prop_camera_mode", 17},
+	{BTK_FLEXBODY_CAMERA_MODE, "flexbody_camera_mode", 21},
+	{BTK_ADD_ANIMATION, "add_animation", 14},
+	{BTK_SET_MANAGEDMATERIALS_OPTIONS, "set_managedmaterials_options", 29},
+	{BTK_SET_BEAM_DEFAULTS_SCALE, "set_beam_defaults_scale", 24},
+	{BTK_GUID, "guid", 5},
+	{BTK_SET_BEAM_DEFAULTS, "set_beam_defaults", 18},
+	{BTK_SET_INERTIA_DEFAULTS, "set_inertia_defaults", 21},
+	{BTK_SET_NODE_DEFAULTS, "set_node_defaults", 18},
+	{BTK_SET_SKELETON_SETTINGS, "set_skeleton_settings", 22},
+	{BTK_BACKMESH, "backmesh", 0},
+	{BTK_SUBMESH, "submesh", 0},
+	{BTK_SET_COLLISION_RANGE, "set_collision_range", 20},
+};
+
+int SerializedRig::findKeyword(const char *line, size_t len)
+{
+	// all keywords start with a letter, this skips the data lines
+	if (!len || !isalpha((unsigned char)line[0]))
+		return -1;
+
+	for (int i = 0; i < BTK_COUNT; i++)
+	{
+		const truckkeyword_t &kw = truck_keywords[i];
+		if (kw.name[0] != line[0])
+			continue;
+		size_t kwlen = strlen(kw.name);
+		if (kw.minLength ? (len < kw.minLength) : (len != kwlen))
+			continue;
+		if (!strncmp(line, kw.name, kwlen))
+			return kw.keywordID;
+	}
+	return -1;
+}
+
+// characters that separate arguments, see parse_args
+static const char *parse_delimiters = ":|, \t";
+
+static bool *buildDelimiterTable()
+{
+	static bool table[256];
+	memset(table, 0, sizeof(table));
+	for (const char *c = parse_delimiters; *c; c++)
+		table[(unsigned char)*c] = true;
+	return table;
+}
+
+static const bool *parse_delimiter_table = buildDelimiterTable();
+
 SerializedRig::SerializedRig()
 {
 	mCamera=0;
@@ -326,6 +504,7 @@ SerializedRig::SerializedRig()
 	freePositioned=false;
 	lowestnode=0;
 	beamsRoot=0;
+	beamRenderer=0;
 
 	virtuallyLoaded=false;
 	ignoreProblems=false;
@@ -333,6 +512,7 @@ SerializedRig::SerializedRig()
 	subMeshGroundModelName = "";
 
 	materialReplacer = NULL;
+	rigTemplate = NULL;
 	if(!virtuallyLoaded)
 		materialReplacer = new MaterialReplacer();
 
@@ -361,6 +541,12 @@ SerializedRig::~SerializedRig()
 		delete(engine);
 		engine=NULL;
 	}
+	// the flexbodies using it are gone already
+	if(rigTemplate)
+	{
+		RigTemplateCache::getSingleton().release(rigTemplate);
+		rigTemplate=NULL;
+	}
 }
 
 int SerializedRig::loadTruckVirtual(String fname, bool ignorep)
@@ -396,6 +582,7 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 	c.warningText  = String();
 	c.linecounter  = 0;
 	c.line[0]      = 0;
+	c.source       = 0;
 	c.mode         = BTS_NONE;
 
 	warnings.clear();
@@ -411,8 +598,7 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 	Real inertia_startDelay=-1, inertia_stopDelay=-1;
 	char inertia_default_startFunction[50]="", inertia_default_stopFunction[50]="";
 	int shadowmode = 1;
-	Ogre::StringVector args;
-	args.resize(20);
+	std::vector<ParserArg> args;
 	float fuse_z_min = 1000.0f;
 	float fuse_z_max = -1000.0f;
 	float fuse_y_min = 1000.0f;
@@ -428,56 +614,71 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 	parser_warning(c, "Start of truck loading: " + filename, PARSER_INFO);
 
 
+	PrecisionTimer loadTimer;
 	DataStreamPtr ds = DataStreamPtr();
 	String group = String();
 	String errorStr = String();
 	try
 	{
 		CACHE.checkResourceLoaded(filename, group);
-		// error on ds open lower
-		// open the stream and start reading :)
-		ds = ResourceGroupManager::getSingleton().openResource(filename, group);
 	} catch(Ogre::Exception& e)
 	{
 		errorStr = String(e.what());
 	}
 
-	//this->cacheEntryInfo = CACHE.getResourceInfo(filename);
-	if(ds.isNull() || !ds->isReadable())
+	// use the compiled source if this version of the file was loaded before
+	String rigKey = errorStr.empty() ? RigSourceCache::getKey(filename, group) : String();
+	compiled_rig_t uncachedSource;
+	const compiled_rig_t *source = errorStr.empty() ? RigSourceCache::getSingleton().get(filename, rigKey) : 0;
+	bool fromCompiledSource = (source != 0);
+	if(!source)
 	{
+		try
+		{
+			// error on ds open lower
+			// open the stream and start reading :)
+			if(errorStr.empty())
+				ds = ResourceGroupManager::getSingleton().openResource(filename, group);
+		} catch(Ogre::Exception& e)
+		{
+			errorStr = String(e.what());
+		}
+
+		//this->cacheEntryInfo = CACHE.getResourceInfo(filename);
+		if(ds.isNull() || !ds->isReadable())
+		{
 #ifdef USE_MYGUI
-		Console *console = Console::getSingletonPtrNoCreation();
-		if(console) console->putMessage(Console::CONSOLE_MSGTYPE_INFO, Console::CONSOLE_SYSTEM_ERROR, "unable to load vehicle (unable to open file): " + filename + " : " + errorStr, "error.png", 30000, true);
+			Console *console = Console::getSingletonPtrNoCreation();
+			if(console) console->putMessage(Console::CONSOLE_MSGTYPE_INFO, Console::CONSOLE_SYSTEM_ERROR, "unable to load vehicle (unable to open file): " + filename + " : " + errorStr, "error.png", 30000, true);
 #endif // USE_MYGUI
-		parser_warning(c, "Can't open truck file '"+filename+"'", PARSER_FATAL_ERROR);
-		return -1;
+			parser_warning(c, "Can't open truck file '"+filename+"'", PARSER_FATAL_ERROR);
+			return -1;
+		}
+		source = RigSourceCache::getSingleton().compile(filename, rigKey, ds, uncachedSource);
 	}
 
+	// immutable data is shared with the other instances of this file and configuration
+	if(!virtuallyLoaded && !rigTemplate)
+		rigTemplate = RigTemplateCache::getSingleton().acquire(RigTemplateCache::getKey(source->beamHash, truckconfig));
+
 
 	// read in truckname on first line
-	c.line = ds->getLine(true);
-	StringUtil::trim(c.line);
+	c.line = source->truckname;
 	realtruckname = c.line;
 	c.linecounter++;
 
-	// then loop through the rest of the lines
-	while (!ds->eof())
+	// then loop through the rest of the lines, empty lines and comments were already removed
+	for (size_t linepos = 0; linepos < source->lines.size(); linepos++)
 	{
-		c.line = ds->getLine(true);
-		StringUtil::trim(c.line);
-		c.linecounter++;
-		
-		// clear arguments, just to be sure
-		args.clear();
-
-		if (c.line.size() == 0 || c.line[0]==';' || c.line[0]=='/')
-			continue;
+		c.line = source->lines[linepos].line;
+		c.linecounter = source->lines[linepos].linecounter;
+		c.source = &source->lines[linepos];
 
 		// try for parsing exceptions
 		try
 		{
 
-			if (c.line == "end")
+			if (c.source->keyword == BTK_END)
 			{
 				parser_warning(c, "End of truck loading", PARSER_INFO);
 				c.modeString = "end";
@@ -485,30 +686,30 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				break;
 			}
 
-			if (c.line == "patchEngineTorque")
+			if (c.source->keyword == BTK_PATCHENGINETORQUE)
 			{
 				patchEngineTorque = true;
 				continue;
 			}
 
-			if (c.line == "end_description" && c.mode == BTS_DESCRIPTION)
+			if (c.source->keyword == BTK_END_DESCRIPTION && c.mode == BTS_DESCRIPTION)
 			{
 				c.mode = BTS_NONE;
 				continue;
 			}
 
-			if (c.line == "end_comment" && c.mode == BTS_COMMENT)
+			if (c.source->keyword == BTK_END_COMMENT && c.mode == BTS_COMMENT)
 			{
 				c.mode = savedmode;
 				continue;
 			}
-			if (c.line == "end_section" && c.mode == BTS_IN_SECTION )
+			if (c.source->keyword == BTK_END_SECTION && c.mode == BTS_IN_SECTION )
 			{
 				c.mode = savedmode;
 				in_section = false;
 				continue;
 			}
-			if (c.line == "end_section" && in_section)
+			if (c.source->keyword == BTK_END_SECTION && in_section)
 			{
 				// compatibility mode: do not restore the section
 				in_section = false;
@@ -536,28 +737,10 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				continue;
 			}
 
-			// now check if we are in a new section
-			trucksection_t *foundSection = 0;
-			for(int i=0; i < BTS_END; i++)
-			{
-				// check for classical sections
-				if (c.line == truck_sections[i].name)
-				{
-					foundSection = &truck_sections[i];
-					break;
-				}
-				else if(compareCaseInsensitive(c.line, truck_sections[i].name))
-				{
-					parser_warning(c, "section has wrong character case, section names are case sensitive", PARSER_ERROR);
-					foundSection = &truck_sections[i];
-					break;
-				}
-				else
-				{
-					if(c.line[0] == ' ' || c.line[c.line.size()-1] == ' ')
-						parser_warning(c, "spaces in section declarations not allowed", PARSER_ERROR);
-				}
-			}
+			// now check if we are in a new section, the lookup was done when the source was compiled
+			trucksection_t *foundSection = (c.source->section >= 0) ? &truck_sections[c.source->section] : 0;
+			if (c.source->sectionWrongCase)
+				parser_warning(c, "section has wrong character case, section names are case sensitive", PARSER_ERROR);
 
 			if(foundSection)
 			{
@@ -571,22 +754,41 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 
 			}
 
-			// check for commands (one line sections)
-			if (c.line == "forwardcommands") {forwardcommands=1;continue;};
-			if (c.line == "importcommands") {importcommands=1;continue;};
-			if (c.line == "rollon") {wheel_contact_requested=true;continue;};
-			if (c.line == "rescuer") {rescuer=true;continue;};
-			if (c.line == "comment") {savedmode=c.mode; c.mode=BTS_COMMENT; continue;};
-			if (c.line == "disabledefaultsounds") {disable_default_sounds=true;continue;};
-			if (c.line.size() > 13 && c.line.substr(0, 13) == "sectionconfig") {savedmode=c.mode;c.mode=BTS_SECTIONCONFIG; /* NOT continue */};
-			if (c.line.size() > 7 && c.line.substr(0, 7) == "section" && c.mode!=BTS_SECTIONCONFIG)
+			// check for commands (one line sections), the keyword was looked up when the source was compiled
+			switch (c.source->keyword)
 			{
-				c.mode=BTS_SECTION;
+			case BTK_FORWARDCOMMANDS:
+				forwardcommands=1;
+				continue;
+			case BTK_IMPORTCOMMANDS:
+				importcommands=1;
+				continue;
+			case BTK_ROLLON:
+				wheel_contact_requested=true;
+				continue;
+			case BTK_RESCUER:
+				rescuer=true;
+				continue;
+			case BTK_COMMENT:
+				savedmode=c.mode;
+				c.mode=BTS_COMMENT;
+				continue;
+			case BTK_DISABLEDEFAULTSOUNDS:
+				disable_default_sounds=true;
+				continue;
+			case BTK_SECTIONCONFIG:
+				savedmode=c.mode;
+				c.mode=BTS_SECTIONCONFIG;
 				/* NOT continue */
-			}
+				break;
+			case BTK_SECTION:
+				if (c.mode != BTS_SECTIONCONFIG)
+					c.mode = BTS_SECTION;
+				/* NOT continue */
+				break;
 			/* BTS_IN_SECTION = reserved for ignored section */
 		
-			if (c.line.size() > 14 && c.line.substr(0, 14) == "detacher_group")
+			case BTK_DETACHER_GROUP:
 			{
 				parse_args(c, args, 1);
 				if(args[1] == "end")
@@ -595,19 +797,20 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 					continue;
 				} else
 				{
-					detacher_group_state = PARSEINT(args[1]);
+					detacher_group_state = args[1].parseInt();
 					continue;
 				}
 			}
-			if (c.line.size() > 8 && c.line.substr(0, 8) == "fileinfo")
+			break;
+			case BTK_FILEINFO:
 			{
 				int n = parse_args(c, args, 2);
 				strncpy(uniquetruckid, args[1].c_str(), 254);
-				if(n > 2) categoryid   = PARSEINT(args[2]);
-				if(n > 3) truckversion = PARSEINT(args[3]);
+				if(n > 2) categoryid   = args[2].parseInt();
+				if(n > 3) truckversion = args[3].parseInt();
 				continue;
 			}
-			if (c.line.size() > 9 && c.line.substr(0, 9) == "extcamera")
+			case BTK_EXTCAMERA:
 			{
 				int n = parse_args(c, args, 2);
 				if(args[1] == "classic") externalcameramode = 0;
@@ -618,13 +821,14 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 			}
 
 
-			if (c.line.size() > 20 && c.line.substr(0, 19) == "submesh_groundmodel")
+			case BTK_SUBMESH_GROUNDMODEL:
 			{
 				int n = parse_args(c, args, 2);
 				subMeshGroundModelName = args[1];
 			}
+			break;
 
-			if (c.line.size() > 9 && c.line.substr(0, 10) == "SlopeBrake")
+			case BTK_SLOPEBRAKE:
 			{
 				slopeBrake=true;
 				slopeBrakeFactor   = 6.0f;
@@ -637,9 +841,9 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 					continue;
 				}
 				int n = parse_args(c, args, 1);
-				if(n > 1) slopeBrakeFactor      = PARSEINT(args[1]);
-				if(n > 2) slopeBrakeAttAngle    = PARSEINT(args[2]);
-				if(n > 3) slopeBrakeRelAngle    = PARSEINT(args[3]);
+				if(n > 1) slopeBrakeFactor      = args[1].parseInt();
+				if(n > 2) slopeBrakeAttAngle    = args[2].parseInt();
+				if(n > 3) slopeBrakeRelAngle    = args[3].parseInt();
 
 				if (slopeBrakeFactor   < 1.0f)  slopeBrakeFactor   = 1.0f;
 				if (slopeBrakeFactor   > 20.0f) slopeBrakeFactor   = 20.0f;
@@ -651,7 +855,7 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				parser_warning(c,"Slope-Brake enhancment added. " + String(fname) +" line " + StringConverter::toString(c.linecounter) + ". Slopebrake-Factor: " + StringConverter::toString(slopeBrakeFactor) + ". Free Rollback Offset: " + StringConverter::toString(slopeBrakeAttAngle) + "degree. Release at Offset: " + StringConverter::toString(slopeBrakeRelAngle) + "degree.", PARSER_INFO);
 				continue;
 			}
-			if (c.line.size() > 14 && c.line.substr(0, 14) == "AntiLockBrakes")
+			case BTK_ANTILOCKBRAKES:
 			{
 				float ratio  = -1.0f;
 				c.modeString = "antilockbrake";
@@ -750,7 +954,7 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				}
 				continue;
 			}
-			if (c.line.size() > 14 && c.line.substr(0, 15) == "TractionControl")
+			case BTK_TRACTIONCONTROL:
 			{
 				float ratio = 0.0f;
 				c.modeString = "tractioncontrol";
@@ -851,11 +1055,11 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				}
 				continue;
 			}
-			if (c.line.size() > 13 && c.line.substr(0, 13) == "cruisecontrol")
+			case BTK_CRUISECONTROL:
 			{
 				parse_args(c, args, 3);
-				cc_target_speed_lower_limit = PARSEREAL(args[1]);
-				cc_can_brake = PARSEINT(args[2]) != 0;
+				cc_target_speed_lower_limit = args[1].parseReal();
+				cc_can_brake = args[2].parseInt() != 0;
 				if (cc_target_speed_lower_limit <= 0.0f)
 				{
 					parser_warning(c, "CruiseControl: First parameter must be a decimal and greater than zero (e.g. 5.6)");
@@ -863,10 +1067,10 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				}
 				continue;
 			}
-			if (c.line.size() > 12 && c.line.substr(0, 12) == "speedlimiter")
+			case BTK_SPEEDLIMITER:
 			{
 				parse_args(c, args, 2);
-				sl_speed_limit = PARSEREAL(args[1]);
+				sl_speed_limit = args[1].parseReal();
 				if (sl_speed_limit <= 0.0f)
 				{
 					parser_warning(c, "SpeedLimiter: Parameter must be a decimal and greater than zero (e.g. 69.445)");
@@ -875,10 +1079,10 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				sl_enabled = true;
 				continue;
 			}
-			if (c.line.size() > 17 && c.line.substr(0, 17) == "fileformatversion")
+			case BTK_FILEFORMATVERSION:
 			{
 				parse_args(c, args, 2);
-				fileformatversion = PARSEINT(args[1]);
+				fileformatversion = args[1].parseInt();
 				if (fileformatversion > TRUCKFILEFORMATVERSION)
 				{
 					parser_warning(c, "The file is for a newer RoR version", PARSER_WARNING);
@@ -886,55 +1090,55 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				}
 				continue;
 			}
-			if (c.line.size() > 6 && c.line.substr(0, 6) == "author")
+			case BTK_AUTHOR:
 			{
 				int n = parse_args(c, args, 2);
 				authorinfo_t author;
 				if(n > 1) author.type  = args[1];
-				if(n > 2) author.id    = PARSEINT(args[2]);
+				if(n > 2) author.id    = args[2].parseInt();
 				if(n > 3) author.name  = args[3];
 				if(n > 4) author.email = args[4];
 				authors.push_back(author);
 				continue;
 			}
 
-			if(c.line == "slidenode_connect_instantly")
+			case BTK_SLIDENODE_CONNECT_INSTANTLY:
 			{
 				slideNodesConnectInstantly = true;
 				continue;
 			}
 
-			if (c.line == "enable_advanced_deformation")
+			case BTK_ENABLE_ADVANCED_DEFORMATION:
 			{
 				enable_advanced_deformation = true;
 				continue;
 			}
 
-			if (c.line == "hideInChooser")
+			case BTK_HIDEINCHOOSER:
 			{
 				hideInChooser = true;
 				continue;
 			}
 
 
-			if (c.line == "lockgroup_default_nolock")
+			case BTK_LOCKGROUP_DEFAULT_NOLOCK:
 			{
 				lockgroup_default = 9999;
 				continue;
 			}
 
 
-			if (c.line == "set_shadows")
+			case BTK_SET_SHADOWS:
 			{
 				parse_args(c, args, 2);
-				shadowmode = PARSEINT(args[1]);
+				shadowmode = args[1].parseInt();
 				continue;
 			}
 
-			if (c.line.size() > 16 && c.line.substr(0, 16) == "prop_camera_mode")
+			case BTK_PROP_CAMERA_MODE:
 			{
 				parse_args(c, args, 2);
-				int pmode = PARSEINT(args[1]);
+				int pmode = args[1].parseInt();
 
 				// always use the last prop
 				prop_t *prop = &props[free_prop-1];
@@ -942,10 +1146,10 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				continue;
 			}
 
-			if (c.line.size() > 20 && c.line.substr(0, 20) == "flexbody_camera_mode")
+			case BTK_FLEXBODY_CAMERA_MODE:
 			{
 				parse_args(c, args, 2);
-				int pmode = PARSEINT(args[1]);
+				int pmode = args[1].parseInt();
 
 				// always use the last flexbody
 				FlexBody *flex = flexbodies[free_flexbody-1];
@@ -953,7 +1157,7 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				continue;
 			}
 
-			if (c.line.size() > 13 && c.line.substr(0, 13) == "add_animation")
+			case BTK_ADD_ANIMATION:
 			{
 				c.modeString = "add_animation";
 				Ogre::StringVector options = Ogre::StringUtil::split(c.line.substr(14), ","); // "add_animation " = 14 characters
@@ -1187,40 +1391,41 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				}
 				continue;
 			}
-			if (c.line.size() > 28 && c.line.substr(0, 28) == "set_managedmaterials_options")
+			case BTK_SET_MANAGEDMATERIALS_OPTIONS:
 			{
 				parse_args(c, args, 2);
-				managedmaterials_doublesided = PARSEINT(args[1]);
+				managedmaterials_doublesided = args[1].parseInt();
 				continue;
 			}
-			if (c.line.size() > 23 && c.line.substr(0, 23) == "set_beam_defaults_scale")
+			case BTK_SET_BEAM_DEFAULTS_SCALE:
 			{
 				int n = parse_args(c, args, 5);
-				default_spring_scale = PARSEREAL(args[1]);
-				if(n > 2) default_damp_scale   = PARSEREAL(args[2]);
-				if(n > 3) default_deform_scale = PARSEREAL(args[3]);
-				if(n > 4) default_break_scale  = PARSEREAL(args[4]);
+				default_spring_scale = args[1].parseReal();
+				if(n > 2) default_damp_scale   = args[2].parseReal();
+				if(n > 3) default_deform_scale = args[3].parseReal();
+				if(n > 4) default_break_scale  = args[4].parseReal();
 				continue;
 			}
-			if (c.line.size() > 4 && c.line.substr(0, 4) == "guid")
+			case BTK_GUID:
 			{
 				parse_args(c, args, 2);
-				StringUtil::trim(args[1]);
-				strncpy(guid, args[1].c_str(), 128);
+				String guidArg = args[1];
+				StringUtil::trim(guidArg);
+				strncpy(guid, guidArg.c_str(), 128);
 				continue;
 			}
-			if (c.line.size() > 17 && c.line.substr(0, 17) == "set_beam_defaults")
+			case BTK_SET_BEAM_DEFAULTS:
 			{
 				String default_beam_material2;
 				float tmpdefault_plastic_coef=-1.0f;
 				int n = parse_args(c, args, 2);
-				default_spring = PARSEREAL(args[1]);
-				if(n > 2) default_damp            = PARSEREAL(args[2]);
-				if(n > 3) default_deform          = PARSEREAL(args[3]);
-				if(n > 4) default_break           = PARSEREAL(args[4]);
-				if(n > 5) default_beam_diameter   = PARSEREAL(args[5]);
+				default_spring = args[1].parseReal();
+				if(n > 2) default_damp            = args[2].parseReal();
+				if(n > 3) default_deform          = args[3].parseReal();
+				if(n > 4) default_break           = args[4].parseReal();
+				if(n > 5) default_beam_diameter   = args[5].parseReal();
 				if(n > 6) default_beam_material2  = args[6];
-				if(n > 7) tmpdefault_plastic_coef = PARSEREAL(args[7]);
+				if(n > 7) tmpdefault_plastic_coef = args[7].parseReal();
 
 				if(!default_beam_material2.empty())
 				{
@@ -1256,11 +1461,11 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				}
 				continue;
 			}
-			if (c.line.size() > 20 && c.line.substr(0, 20) == "set_inertia_defaults")
+			case BTK_SET_INERTIA_DEFAULTS:
 			{
 				int n = parse_args(c, args, 2);
-				inertia_startDelay = PARSEREAL(args[1]);
-				if(n > 2) inertia_stopDelay = PARSEREAL(args[2]);
+				inertia_startDelay = args[1].parseReal();
+				if(n > 2) inertia_stopDelay = args[2].parseReal();
 				if(n > 3) strncpy(inertia_default_startFunction, args[3].c_str(), 50);
 				if(n > 4) strncpy(inertia_default_stopFunction, args[4].c_str(), 50);
 
@@ -1275,13 +1480,13 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				continue;
 			}
 
-			if (c.line.size() > 17 && c.line.substr(0, 17) == "set_node_defaults")
+			case BTK_SET_NODE_DEFAULTS:
 			{
 				int n = parse_args(c, args, 2);
-				default_node_loadweight = PARSEREAL(args[1]);
-				if(n > 2) default_node_friction = PARSEREAL(args[2]);
-				if(n > 3) default_node_volume   = PARSEREAL(args[3]);
-				if(n > 4) default_node_surface  = PARSEREAL(args[4]);
+				default_node_loadweight = args[1].parseReal();
+				if(n > 2) default_node_friction = args[2].parseReal();
+				if(n > 3) default_node_volume   = args[3].parseReal();
+				if(n > 4) default_node_surface  = args[4].parseReal();
 				if(n > 5) strncpy(default_node_options, args[5].c_str(), 50);
 				
 				if (default_node_friction < 0)   default_node_friction=NODE_FRICTION_COEF_DEFAULT;
@@ -1293,11 +1498,11 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				continue;
 			}
 
-			if (c.line.size() > 21 && c.line.substr(0, 21) == "set_skeleton_settings")
+			case BTK_SET_SKELETON_SETTINGS:
 			{
 				int n = parse_args(c, args, 2);
-				fadeDist = PARSEREAL(args[1]);
-				if(n > 2) skeleton_beam_diameter = PARSEREAL(args[2]);
+				fadeDist = args[1].parseReal();
+				if(n > 2) skeleton_beam_diameter = args[2].parseReal();
 				if(fadeDist < 0)
 					fadeDist = 150;
 				if(skeleton_beam_diameter < 0)
@@ -1305,7 +1510,7 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				continue;
 			}
 
-			if (c.line == "backmesh")
+			case BTK_BACKMESH:
 			{
 				//close the current mesh
 				subtexcoords[free_sub]=free_texcoord;
@@ -1367,8 +1572,8 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				//we don't finish, there will be a submesh statement later
 				subisback[free_sub]=1;
 				continue;
-			};
-			if (c.line == "submesh")
+			}
+			case BTK_SUBMESH:
 			{
 				subtexcoords[free_sub]=free_texcoord;
 				subcabs[free_sub]=free_cab;
@@ -1381,18 +1586,22 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				//initialize the next
 				subisback[free_sub]=0;
 				continue;
-			};
+			}
 
-			if (c.line.size() > 21 && c.line.substr(0, 21) == "set_collision_range")
+			case BTK_SET_COLLISION_RANGE:
 			{
 				parse_args(c, args, 2);
-				collrange = PARSEREAL(args[1]);
+				collrange = args[1].parseReal();
 				if(collrange < 0)
 					collrange = DEFAULT_COLLISION_RANGE;
 				continue;
-			};
+			}
+			}
 
-			if (c.mode == BTS_NODES || c.mode == BTS_NODES2)
+			switch (c.mode)
+			{
+			case BTS_NODES:
+			case BTS_NODES2:
 			{
 				//parse nodes
 				int id = 0;
@@ -1403,7 +1612,7 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				if(c.mode == BTS_NODES)
 				{
 					// classic approach, number needs to be in sync with free node count
-					id = PARSEINT (args[0]);
+					id = args[0].parseInt();
 				} else if(c.mode == BTS_NODES2)
 				{
 					// named nodes, we use the free_node counter and use the first argument as name instead
@@ -1412,11 +1621,11 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 					node_names[args[0]] = id;
 				}
 				
-				x  = PARSEREAL(args[1]);
-				y  = PARSEREAL(args[2]);
-				z  = PARSEREAL(args[3]);
+				x  = args[1].parseReal();
+				y  = args[2].parseReal();
+				z  = args[3].parseReal();
 				if(n > 4) strncpy(options, args[4].c_str(), 255);
-				if(n > 5) mass = PARSEREAL(args[5]);
+				if(n > 5) mass = args[5].parseReal();
 
 				if (id != free_node)
 				{
@@ -1561,8 +1770,7 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 							beams[pos].commandShort      = 0.0f;
 							beams[pos].commandLong       = 1.0f;
 							beams[pos].maxtiestress      = HOOK_FORCE_DEFAULT;
-							if(!virtuallyLoaded && beams[pos].mSceneNode)
-								beams[pos].mSceneNode->detachAllObjects();
+							beams[pos].mVisible = false;
 
 							hook_t h;
 							h.hookNode     = &nodes[id];
@@ -1616,7 +1824,7 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 
 				continue;
 			}
-			else if (c.mode == BTS_CAMERARAIL)
+			case BTS_CAMERARAIL:
 			{
 				int n = parse_args(c, args, 1);
 				if (n>0 && free_camerarail < MAX_CAMERARAIL)
@@ -1625,14 +1833,15 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 					free_camerarail++;
 				}
 			}
-			else if (c.mode == BTS_LOCKGROUPS)
+			break;
+			case BTS_LOCKGROUPS:
 			{
 				//parse lockgroups
 				int lockgroup = 0, id = 0, i = 0;
 				int n = parse_args(c, args, 1);
 				if (n>1)
 				{
-					lockgroup = PARSEINT(args[0]);
+					lockgroup = args[0].parseInt();
 				} else
 				{
 					parser_warning(c, "Trying to parse a lockgroup without nodes defined.", PARSER_ERROR);
@@ -1657,7 +1866,7 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				}
 				continue;
 			}
-			else if (c.mode == BTS_HOOKS)
+			case BTS_HOOKS:
 			{
 				//parse hooks
 				float speedcoef = 1.0f, hookforce=HOOK_FORCE_DEFAULT, hookrange=HOOK_RANGE_DEFAULT, hooktimer=HOOK_LOCK_TIMER_DEFAULT, hook_shortlimit = 0.0f;
@@ -1693,45 +1902,38 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 					if      (arg == "hookrange" && n > i)
 					{
 						i++;
-						String arg2 = args[i];
-						hookrange = PARSEREAL(arg2);
+						hookrange = args[i].parseReal();
 					}
 					else if (arg == "speedcoef" && n > i)
 					{
 						i++;
-						String arg2 = args[i];
-						speedcoef = PARSEREAL(arg2);
+						speedcoef = args[i].parseReal();
 					}
 					else if (arg == "maxforce" && n > i)
 					{
 						i++;
-						String arg2 = args[i];
-						hookforce = PARSEREAL(arg2);
+						hookforce = args[i].parseReal();
 					}
 					else if ((arg == "hookgroup" || arg == "hgroup") && n > i)
 					{
 						i++;
-						String arg2 = args[i];
-						hgroup = PARSEINT(arg2);
+						hgroup = args[i].parseInt();
 					}
 					else if ((arg == "lockgroup" || arg == "lgroup") && n > i)
 					{
 						i++;
-						String arg2 = args[i];
-						lgroup = PARSEINT(arg2);
+						lgroup = args[i].parseInt();
 					}
 
 					else if (arg == "timer" && n >= i)
 					{
 						i++;
-						String arg2 = args[i];
-						hooktimer = PARSEREAL(arg2);
+						hooktimer = args[i].parseReal();
 					}
 					else if ((arg == "shortlimit" || arg == "short_limit" || arg == "short_limit") && n >= i)
 					{
 						i++;
-						String arg2 = args[i];
-						hook_shortlimit = PARSEREAL(arg2);
+						hook_shortlimit = args[i].parseReal();
 					}
 					else if (arg == "selflock" || arg == "self-lock" || arg == "self_lock")
 					{
@@ -1748,11 +1950,10 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 					{
 						hook_nodisable = true;
 					}
-					else if ((arg == "visible" || arg == "vis") && !virtuallyLoaded && itfound->beam->mSceneNode)
+					else if ((arg == "visible" || arg == "vis") && !virtuallyLoaded && itfound->beam->mBatch >= 0)
 					{
 						hookbeam_visble = true;
-						if (itfound->beam->mSceneNode->numAttachedObjects() == 0)
-							itfound->beam->mSceneNode->attachObject(itfound->beam->mEntity);
+						itfound->beam->mVisible = true;
 					}
 					else if (arg == "norope" || arg == "no-rope" || arg == "no_rope")
 					{
@@ -1773,7 +1974,7 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				itfound->beam->commandShort = hook_shortlimit;
 				continue;
 			}
-			else if (c.mode == BTS_BEAMS)
+			case BTS_BEAMS:
 			{
 				//parse beams
 				int id1, id2;
@@ -1785,7 +1986,7 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				id1 = parse_node_number(c, args[0]);
 				id2 = parse_node_number(c, args[1]);
 				if(n > 2) strncpy(options, args[2].c_str(), 50);
-				if(n > 3) support_break_factor = PARSEINT(args[3]);
+				if(n > 3) support_break_factor = args[3].parseInt();
 
 				if(free_beam >= MAX_BEAMS)
 				{
@@ -1836,7 +2037,7 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				}
 				continue;
 			}
-			else if (c.mode == BTS_TRIGGER)
+			case BTS_TRIGGER:
 			{
 				//parse triggers
 				int id1, id2, triggershort, triggerlong;
@@ -1845,12 +2046,12 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				int n = parse_args(c, args, 6);
 				id1          = parse_node_number(c, args[0]);
 				id2          = parse_node_number(c, args[1]);
-				sbound       = PARSEREAL(args[2]);
-				lbound       = PARSEREAL(args[3]);
-				triggershort = PARSEINT (args[4]);
-				triggerlong  = PARSEINT (args[5]);
+				sbound       = args[2].parseReal();
+				lbound       = args[3].parseReal();
+				triggershort = args[4].parseInt();
+				triggerlong  = args[5].parseInt();
 				if(n > 6) strncpy(options, args[6].c_str(), 50);
-				if(n > 7) boundarytimer = PARSEREAL(args[7]);
+				if(n > 7) boundarytimer = args[7].parseReal();
 
 				// checks ...
 				if(free_beam >= MAX_BEAMS)
@@ -1984,7 +2185,7 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				free_shock++;
 				continue;
 			}
-			else if (c.mode == BTS_SHOCKS)
+			case BTS_SHOCKS:
 			{
 				//parse shocks
 				int id1, id2;
@@ -1993,11 +2194,11 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				int n = parse_args(c, args, 7);
 				id1          = parse_node_number(c, args[0]);
 				id2          = parse_node_number(c, args[1]);
-				s            = PARSEREAL(args[2]);
-				d            = PARSEREAL(args[3]);
-				sbound       = PARSEREAL(args[4]);
-				lbound       = PARSEREAL(args[5]);
-				precomp      = PARSEREAL(args[6]);
+				s            = args[2].parseReal();
+				d            = args[3].parseReal();
+				sbound       = args[4].parseReal();
+				lbound       = args[5].parseReal();
+				precomp      = args[6].parseReal();
 				if(n > 7) strncpy(options, args[7].c_str(), 50);
 
 				// checks ...
@@ -2058,7 +2259,7 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				free_shock++;
 				continue;
 			}
-			else if (c.mode == BTS_SHOCKS2)
+			case BTS_SHOCKS2:
 			{
 				//parse shocks2
 				int id1, id2;
@@ -2067,17 +2268,17 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				int n = parse_args(c, args, 13);
 				id1          = parse_node_number(c, args[0]);
 				id2          = parse_node_number(c, args[1]);
-				sin          = PARSEREAL(args[2]);
-				din          = PARSEREAL(args[3]);
-				psin         = PARSEREAL(args[4]);
-				pdin         = PARSEREAL(args[5]);
-				sout         = PARSEREAL(args[6]);
-				dout         = PARSEREAL(args[7]);
-				psout        = PARSEREAL(args[8]);
-				pdout        = PARSEREAL(args[9]);
-				sbound       = PARSEREAL(args[10]);
-				lbound       = PARSEREAL(args[11]);
-				precomp      = PARSEREAL(args[12]);
+				sin          = args[2].parseReal();
+				din          = args[3].parseReal();
+				psin         = args[4].parseReal();
+				pdin         = args[5].parseReal();
+				sout         = args[6].parseReal();
+				dout         = args[7].parseReal();
+				psout        = args[8].parseReal();
+				pdout        = args[9].parseReal();
+				sbound       = args[10].parseReal();
+				lbound       = args[11].parseReal();
+				precomp      = args[12].parseReal();
 				if(n > 13) strncpy(options, args[13].c_str(), 50);
 
 				// checks ...
@@ -2176,7 +2377,7 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				continue;
 			}
 
-			else if (c.mode == BTS_FIXES)
+			case BTS_FIXES:
 			{
 				//parse fixes
 				parse_args(c, args, 1);
@@ -2186,7 +2387,7 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				free_fixes++;
 				continue;
 			}
-			else if (c.mode == BTS_HYDROS)
+			case BTS_HYDROS:
 			{
 				//parse hydros
 				int id1, id2;
@@ -2200,10 +2401,10 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				int n = parse_args(c, args, 3);
 				id1 = parse_node_number(c, args[0]);
 				id2 = parse_node_number(c, args[1]);
-				ratio = PARSEREAL(args[2]);
+				ratio = args[2].parseReal();
 				if(n > 3) strncpy(options, args[3].c_str(), 50);
-				if(n > 4) startDelay = PARSEREAL(args[4]);
-				if(n > 5) stopDelay = PARSEREAL(args[5]);
+				if(n > 4) startDelay = args[4].parseReal();
+				if(n > 5) stopDelay = args[5].parseReal();
 				if(n > 6) strncpy(startFunction, args[6].c_str(), 50);
 				if(n > 7) strncpy(stopFunction, args[7].c_str(), 50);
 
@@ -2297,7 +2498,7 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				}
 				continue;
 			}
-			else if (c.mode == BTS_ANIMATORS)
+			case BTS_ANIMATORS:
 			{
 				//parse animators
 				int id1, id2;
@@ -2455,7 +2656,7 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				continue;
 			}
 
-			else if (c.mode == BTS_WHEELS)
+			case BTS_WHEELS:
 			{
 				//parse wheels
 				float radius, width, mass, spring, damp;
@@ -2463,9 +2664,9 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				char texb[256];
 				int rays, node1, node2, snode, braked, propulsed, torquenode;
 				int n = parse_args(c, args, 14);
-				radius     = PARSEREAL(args[0]);
-				width      = PARSEREAL(args[1]);
-				rays       = PARSEINT (args[2]);
+				radius     = args[0].parseReal();
+				width      = args[1].parseReal();
+				rays       = args[2].parseInt();
 				node1      = parse_node_number(c, args[3]);
 				node2      = parse_node_number(c, args[4]);
 
@@ -2475,18 +2676,18 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 
 				snode = parse_node_number(c, args[5], &special_numbers); // special behavior, beware
 
-				braked     = PARSEINT (args[6]);
-				propulsed  = PARSEINT (args[7]);
+				braked     = args[6].parseInt();
+				propulsed  = args[7].parseInt();
 				torquenode = parse_node_number(c, args[8]);
-				mass       = PARSEREAL(args[9]);
-				spring     = PARSEREAL(args[10]);
-				damp       = PARSEREAL(args[11]);
+				mass       = args[9].parseReal();
+				spring     = args[10].parseReal();
+				damp       = args[11].parseReal();
 				strncpy(texf, args[12].c_str(), 255);
 				strncpy(texb, args[13].c_str(), 255);
 				addWheel(manager, parent, radius,width,rays,node1,node2,snode,braked,propulsed, torquenode, mass, spring, damp, texf, texb);
 				continue;
 			}
-			else if (c.mode == BTS_WHEELS2)
+			case BTS_WHEELS2:
 			{
 				//parse wheels2
 				char texf[256];
@@ -2494,10 +2695,10 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				float radius, radius2, width, mass, spring, damp, spring2, damp2;
 				int rays, node1, node2, snode, braked, propulsed, torquenode;
 				int n = parse_args(c, args, 17);
-				radius     = PARSEREAL(args[0]);
-				radius2    = PARSEREAL(args[1]);
-				width      = PARSEREAL(args[2]);
-				rays       = PARSEINT (args[3]);
+				radius     = args[0].parseReal();
+				radius2    = args[1].parseReal();
+				width      = args[2].parseReal();
+				rays       = args[3].parseInt();
 				node1      = parse_node_number(c, args[4]);
 				node2      = parse_node_number(c, args[5]);
 				
@@ -2507,14 +2708,14 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 
 				snode = parse_node_number(c, args[6], &special_numbers); // special behavior, beware
 				
-				braked     = PARSEINT (args[7]);
-				propulsed  = PARSEINT (args[8]);
+				braked     = args[7].parseInt();
+				propulsed  = args[8].parseInt();
 				torquenode = parse_node_number(c, args[9]);
-				mass       = PARSEREAL(args[10]);
-				spring     = PARSEREAL(args[11]);
-				damp       = PARSEREAL(args[12]);
-				spring2    = PARSEREAL(args[13]);
-				damp2      = PARSEREAL(args[14]);
+				mass       = args[10].parseReal();
+				spring     = args[11].parseReal();
+				damp       = args[12].parseReal();
+				spring2    = args[13].parseReal();
+				damp2      = args[14].parseReal();
 				strncpy(texf, args[15].c_str(), 255);
 				strncpy(texb, args[16].c_str(), 255);
 
@@ -2524,7 +2725,7 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 					addWheel(manager, parent, radius2,width,rays,node1,node2,snode,braked,propulsed, torquenode, mass, spring2, damp2, texf, texb);
 				continue;
 			}
-			else if (c.mode == BTS_MESHWHEELS)
+			case BTS_MESHWHEELS:
 			{
 				//parse meshwheels
 				char meshw[256];
@@ -2535,10 +2736,10 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 
 				int n = parse_args(c, args, 16);
 
-				radius     = PARSEREAL(args[0]);
-				rimradius  = PARSEREAL(args[1]);
-				width      = PARSEREAL(args[2]);
-				rays       = PARSEINT (args[3]);
+				radius     = args[0].parseReal();
+				rimradius  = args[1].parseReal();
+				width      = args[2].parseReal();
+				rays       = args[3].parseInt();
 				node1      = parse_node_number(c, args[4]);
 				node2      = parse_node_number(c, args[5]);
 				
@@ -2548,12 +2749,12 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 
 				snode = parse_node_number(c, args[6], &special_numbers); // special behavior, beware
 				
-				braked     = PARSEINT (args[7]);
-				propulsed  = PARSEINT (args[8]);
+				braked     = args[7].parseInt();
+				propulsed  = args[8].parseInt();
 				torquenode = parse_node_number(c, args[9]);
-				mass       = PARSEREAL(args[10]);
-				spring     = PARSEREAL(args[11]);
-				damp       = PARSEREAL(args[12]);
+				mass       = args[10].parseReal();
+				spring     = args[11].parseReal();
+				damp       = args[12].parseReal();
 				side       = args[13][0];
 				strncpy(meshw, args[14].c_str(), 255);
 				strncpy(texb, args[15].c_str(), 255);
@@ -2561,7 +2762,7 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				addWheel(manager, parent, radius,width,rays,node1,node2,snode,braked,propulsed, torquenode, mass, spring, damp, meshw, texb, true, false, rimradius, side!='r');
 				continue;
 			}
-			else if (c.mode == BTS_MESHWHEELS2)
+			case BTS_MESHWHEELS2:
 			{
 				//parse meshwheels2
 				char meshw[256];
@@ -2572,10 +2773,10 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 
 				int n = parse_args(c, args, 16);
 
-				radius     = PARSEREAL(args[0]);
-				rimradius  = PARSEREAL(args[1]);
-				width      = PARSEREAL(args[2]);
-				rays       = PARSEINT (args[3]);
+				radius     = args[0].parseReal();
+				rimradius  = args[1].parseReal();
+				width      = args[2].parseReal();
+				rays       = args[3].parseInt();
 				node1      = parse_node_number(c, args[4]);
 				node2      = parse_node_number(c, args[5]);
 				
@@ -2585,12 +2786,12 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 
 				snode = parse_node_number(c, args[6], &special_numbers); // special behavior, beware
 
-				braked     = PARSEINT (args[7]);
-				propulsed  = PARSEINT (args[8]);
+				braked     = args[7].parseInt();
+				propulsed  = args[8].parseInt();
 				torquenode = parse_node_number(c, args[9]);
-				mass       = PARSEREAL(args[10]);
-				spring     = PARSEREAL(args[11]);
-				damp       = PARSEREAL(args[12]);
+				mass       = args[10].parseReal();
+				spring     = args[11].parseReal();
+				damp       = args[12].parseReal();
 				side       = args[13][0];
 				strncpy(meshw, args[14].c_str(), 255);
 				strncpy(texb, args[15].c_str(), 255);
@@ -2598,7 +2799,7 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				addWheel(manager, parent, radius,width,rays,node1,node2,snode,braked,propulsed, torquenode, mass, spring, damp, meshw, texb, true, true, rimradius, side!='r');
 				continue;
 			}
-			else if (c.mode == BTS_FLEXBODYWHEELS)
+			case BTS_FLEXBODYWHEELS:
 			{
 				//parse flexbodywheels, meshwheels2 with rim and flexbody tire
 				char meshw[256]    = "";
@@ -2610,10 +2811,10 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 
 				int n = parse_args(c, args, 16);
 
-				radius     = PARSEREAL(args[0]);
-				rimradius  = PARSEREAL(args[1]);
-				width      = PARSEREAL(args[2]);
-				rays       = PARSEINT (args[3]);
+				radius     = args[0].parseReal();
+				rimradius  = args[1].parseReal();
+				width      = args[2].parseReal();
+				rays       = args[3].parseInt();
 				node1      = parse_node_number(c, args[4]);
 				node2      = parse_node_number(c, args[5]);
 				
@@ -2623,14 +2824,14 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 
 				snode = parse_node_number(c, args[6], &special_numbers); // special behavior, beware
 
-				braked     = PARSEINT (args[7]);
-				propulsed  = PARSEINT (args[8]);
+				braked     = args[7].parseInt();
+				propulsed  = args[8].parseInt();
 				torquenode = parse_node_number(c, args[9]);
-				mass       = PARSEREAL(args[10]);
-				spring     = PARSEREAL(args[11]);
-				damp       = PARSEREAL(args[12]);
-				rimspring  = PARSEREAL(args[13]);
-				rimdamp    = PARSEREAL(args[14]);
+				mass       = args[10].parseReal();
+				spring     = args[11].parseReal();
+				damp       = args[12].parseReal();
+				rimspring  = args[13].parseReal();
+				rimdamp    = args[14].parseReal();
 				side       = args[15][0];
 				strncpy(meshw, args[16].c_str(), 255);
 				strncpy(flexmesh, args[17].c_str(), 255);
@@ -2656,16 +2857,16 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				sprintf(tmp_for_str, "%d-%d", node3, node3 + (rays * 4) - 1);
 
 				if(!virtuallyLoaded)
-					flexbodies[free_flexbody]=new FlexBody(manager, nodes, free_node, flexmesh, uname, node1, node2, node3, Vector3(0.5,0,0), Quaternion::ZERO, tmp_for_str, materialFunctionMapper, usedSkin, (shadowmode!=0), materialReplacer);
+					flexbodies[free_flexbody]=new FlexBody(manager, nodes, visualpos, free_node, flexmesh, uname, node1, node2, node3, Vector3(0.5,0,0), Quaternion::ZERO, tmp_for_str, materialFunctionMapper, usedSkin, (shadowmode!=0), materialReplacer, rigTemplate, free_flexbody);
 				free_flexbody++;
 				continue;
 			}
-			else if (c.mode == BTS_GLOBALS)
+			case BTS_GLOBALS:
 			{
 				//parse globals
 				int n = parse_args(c, args, 2);
-				truckmass = PARSEREAL(args[0]);
-				loadmass = PARSEREAL(args[1]);
+				truckmass = args[0].parseReal();
+				loadmass = args[1].parseReal();
 				if(n > 2)
 				{
 					strncpy(texname, args[2].c_str(), 1024);
@@ -2707,7 +2908,7 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				}
 				continue;
 			}
-			else if (c.mode == BTS_CAMERAS)
+			case BTS_CAMERAS:
 			{
 				//parse cameras
 				int n = parse_args(c, args, 3);
@@ -2723,7 +2924,7 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				addCamera(nodepos, nodedir, dir);
 				continue;
 			}
-			else if (c.mode == BTS_ENGINE)
+			case BTS_ENGINE:
 			{
 				//parse engine
 				if(driveable == MACHINE)
@@ -2732,20 +2933,16 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				driveable=TRUCK;
 				parse_args(c, args, 7);
 
-				float minrpm = PARSEREAL(args[0]);
-				args.erase(args.begin());
-				float maxrpm = PARSEREAL(args[0]);
-				args.erase(args.begin());
-				float torque = PARSEREAL(args[0]);
-				args.erase(args.begin());
-				float dratio = PARSEREAL(args[0]);
-				args.erase(args.begin());
+				float minrpm = args[0].parseReal();
+				float maxrpm = args[1].parseReal();
+				float torque = args[2].parseReal();
+				float dratio = args[3].parseReal();
 
 				std::vector<float> gears;
 
-				for(Ogre::StringVector::iterator it = args.begin(); it != args.end(); it++)
+				for(size_t i = 4; i < args.size(); i++)
 				{
-					float tmpf = PARSEREAL(*it);
+					float tmpf = args[i].parseReal();
 					if( tmpf <= 0.0f ) break;
 					gears.push_back(tmpf);
 				}
@@ -2773,13 +2970,13 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				continue;
 			}
 
-			else if (c.mode == BTS_TEXCOORDS)
+			case BTS_TEXCOORDS:
 			{
 				//parse texcoords
 				parse_args(c, args, 3);
 				int   id = parse_node_number(c, args[0]);
-				float x  = PARSEREAL(args[1]);
-				float y  = PARSEREAL(args[2]);
+				float x  = args[1].parseReal();
+				float y  = args[2].parseReal();
 
 				if(free_texcoord >= MAX_BEAMS)
 				{
@@ -2789,8 +2986,9 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				texcoords[free_texcoord] = Vector3(id, x, y);
 				free_texcoord++;
 			}
+			break;
 
-			else if (c.mode == BTS_CAB)
+			case BTS_CAB:
 			{
 				//parse cab
 				char type='n';
@@ -2836,8 +3034,10 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				}
 				free_cab++;
 			}
+			break;
 
-			else if (c.mode == BTS_COMMANDS || c.mode == BTS_COMMANDS2)
+			case BTS_COMMANDS:
+			case BTS_COMMANDS2:
 			{
 				//parse commands
 				int id1, id2,keys,keyl;
@@ -2857,15 +3057,15 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 					int n = parse_args(c, args, 7);
 					id1        = parse_node_number(c, args[0]);
 					id2        = parse_node_number(c, args[1]);
-					rateShort  = PARSEREAL(args[2]);
-					shortl     = PARSEREAL(args[3]);
-					longl      = PARSEREAL(args[4]);
-					keys       = PARSEINT (args[5]);
-					keyl       = PARSEINT (args[6]);
+					rateShort  = args[2].parseReal();
+					shortl     = args[3].parseReal();
+					longl      = args[4].parseReal();
+					keys       = args[5].parseInt();
+					keyl       = args[6].parseInt();
 					if(n > 7)  opt = args[7][0];
 					if(n > 8)  descr = args[8];
-					if(n > 9)  startDelay = PARSEREAL(args[9]);
-					if(n > 10) stopDelay  = PARSEREAL(args[10]);
+					if(n > 9)  startDelay = args[9].parseReal();
+					if(n > 10) stopDelay  = args[10].parseReal();
 					if(n > 11) strncpy(startFunction, args[11].c_str(), 255);
 					if(n > 12) strncpy(stopFunction,  args[12].c_str(), 255);
 
@@ -2878,19 +3078,19 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 					int n = parse_args(c, args, 8);
 					id1        = parse_node_number(c, args[0]);
 					id2        = parse_node_number(c, args[1]);
-					rateShort  = PARSEREAL(args[2]);
-					rateLong   = PARSEREAL(args[3]);
-					shortl     = PARSEREAL(args[4]);
-					longl      = PARSEREAL(args[5]);
-					keys       = PARSEINT (args[6]);
-					keyl       = PARSEINT (args[7]);
+					rateShort  = args[2].parseReal();
+					rateLong   = args[3].parseReal();
+					shortl     = args[4].parseReal();
+					longl      = args[5].parseReal();
+					keys       = args[6].parseInt();
+					keyl       = args[7].parseInt();
 					if(n > 8)  strncpy(options, args[8].c_str(), 250);
 					if(n > 9)  descr = args[9];
-					if(n > 10) startDelay = PARSEREAL(args[10]);
-					if(n > 11) stopDelay  = PARSEREAL(args[11]);
+					if(n > 10) startDelay = args[10].parseReal();
+					if(n > 11) stopDelay  = args[11].parseReal();
 					if(n > 12) strncpy(startFunction, args[12].c_str(), 255);
 					if(n > 13) strncpy(stopFunction,  args[13].c_str(), 255);
-					if(n > 14) commandCoupling = PARSEREAL(args[14]);
+					if(n > 14) commandCoupling = args[14].parseReal();
 				}
 
 				//verify array limits so we dont overflow
@@ -3021,7 +3221,8 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 
 				free_commands++;
 			}
-			else if (c.mode == BTS_CONTACTERS)
+			break;
+			case BTS_CONTACTERS:
 			{
 				//parse contacters
 				int n = parse_args(c, args, 1);
@@ -3039,7 +3240,8 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				nodes[id1].iIsSkin = true;
 				free_contacter++;;
 			}
-			else if (c.mode == BTS_ROPES)
+			break;
+			case BTS_ROPES:
 			{
 				//parse ropes
 				int group=0; //TODO: to be used
@@ -3069,14 +3271,15 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				nodes[id1].iIsSkin = true;
 				nodes[id2].iIsSkin = true;
 			}
-			else if (c.mode == BTS_ROPABLES)
+			break;
+			case BTS_ROPABLES:
 			{
 				//parse ropables
 				int group = -1, multilock = 0;
 				int n = parse_args(c, args, 1);
 				int id1 = parse_node_number(c, args[0]);
-				if(n > 1) group     = PARSEINT(args[1]);
-				if(n > 2) multilock = PARSEINT(args[2]);
+				if(n > 1) group     = args[1].parseInt();
+				if(n > 2) multilock = args[2].parseInt();
 
 				ropable_t r;
 				r.node      = &nodes[id1];
@@ -3087,7 +3290,8 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 
 				nodes[id1].iIsSkin = true;
 			}
-			else if (c.mode == BTS_TIES)
+			break;
+			case BTS_TIES:
 			{
 				//parse ties
 				int id1=0, group=-1;
@@ -3096,13 +3300,13 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				hascommands=1;
 				int n = parse_args(c, args, 5);
 				id1     = parse_node_number(c, args[0]);
-				maxl    = PARSEREAL(args[1]);
-				rate    = PARSEREAL(args[2]);
-				shortl  = PARSEREAL(args[3]);
-				longl   = PARSEREAL(args[4]);
+				maxl    = args[1].parseReal();
+				rate    = args[2].parseReal();
+				shortl  = args[3].parseReal();
+				longl   = args[4].parseReal();
 				if(n > 5) option = args[5][0];
-				if(n > 6) maxstress = PARSEREAL(args[6]);
-				if(n > 7) group = PARSEINT(args[7]);
+				if(n > 6) maxstress = args[6].parseReal();
+				if(n > 7) group = args[7].parseInt();
 
 				if(free_beam >= MAX_BEAMS)
 				{
@@ -3124,8 +3328,7 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				beams[pos].Lhydro=maxl;
 				beams[pos].bounded=ROPE;
 				beams[pos].disabled=true;
-				if(!virtuallyLoaded && beams[pos].mSceneNode)
-					beams[pos].mSceneNode->detachAllObjects();
+				beams[pos].mVisible = false;
 				beams[pos].commandRatioShort=rate;
 				beams[pos].commandRatioLong=rate;
 				beams[pos].commandShort=shortl;
@@ -3140,15 +3343,17 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				t.beam=&beams[pos];
 				ties.push_back(t);
 			}
+			break;
 
-			else if (c.mode == BTS_HELP)
+			case BTS_HELP:
 			{
 				//help material
 				parse_args(c, args, 1);
 				strncpy(helpmat, args[0].c_str(), 255);
 				hashelp = 1;
 			}
-			else if (c.mode == BTS_CINECAM)
+			break;
+			case BTS_CINECAM:
 			{
 				//cinecam
 				float x,y,z;
@@ -3156,9 +3361,9 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				float spring=8000.0;
 				float damp=800.0;
 				int n = parse_args(c, args, 11);
-				x      = PARSEREAL(args[0]);
-				y      = PARSEREAL(args[1]);
-				z      = PARSEREAL(args[2]);
+				x      = args[0].parseReal();
+				y      = args[1].parseReal();
+				z      = args[2].parseReal();
 				n1     = parse_node_number(c, args[3]);
 				n2     = parse_node_number(c, args[4]);
 				n3     = parse_node_number(c, args[5]);
@@ -3167,8 +3372,8 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				n6     = parse_node_number(c, args[8]);
 				n7     = parse_node_number(c, args[9]);
 				n8     = parse_node_number(c, args[10]);
-				if(n > 11) spring = PARSEREAL(args[11]);
-				if(n > 12) damp   = PARSEREAL(args[12]);
+				if(n > 11) spring = args[11].parseReal();
+				if(n > 12) damp   = args[12].parseReal();
 
 				if(free_beam >= MAX_BEAMS)
 				{
@@ -3224,7 +3429,9 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 
 				freecinecamera++;
 			}
-			else if (c.mode == BTS_FLARES || c.mode == BTS_FLARES2)
+			break;
+			case BTS_FLARES:
+			case BTS_FLARES2:
 			{
 				if(flaresMode==0)
 					continue;
@@ -3240,12 +3447,12 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 					ref = parse_node_number(c, args[0]);
 					nx  = parse_node_number(c, args[1]);
 					ny  = parse_node_number(c, args[2]);
-					ox  = PARSEREAL(args[3]);
-					oy  = PARSEREAL(args[4]);
+					ox  = args[3].parseReal();
+					oy  = args[4].parseReal();
 					if(n > 5) type          = args[5][0];
-					if(n > 6) controlnumber = PARSEINT (args[6]);
-					if(n > 7) blinkdelay    = PARSEINT (args[7]);
-					if(n > 8) size          = PARSEREAL (args[8]);
+					if(n > 6) controlnumber = args[6].parseInt();
+					if(n > 7) blinkdelay    = args[7].parseInt();
+					if(n > 8) size          = args[8].parseReal();
 					if(n > 9) strncpy(matname, args[9].c_str(), 255);
 				} else if(c.mode == BTS_FLARES2)
 				{
@@ -3254,13 +3461,13 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 					ref = parse_node_number(c, args[0]);
 					nx  = parse_node_number(c, args[1]);
 					ny  = parse_node_number(c, args[2]);
-					ox  = PARSEREAL(args[3]);
-					oy  = PARSEREAL(args[4]);
-					oz  = PARSEREAL(args[5]);
+					ox  = args[3].parseReal();
+					oy  = args[4].parseReal();
+					oz  = args[5].parseReal();
 					if(n > 6) type          = args[6][0];
-					if(n > 7) controlnumber = PARSEINT (args[7]);
-					if(n > 8) blinkdelay    = PARSEINT (args[8]);
-					if(n > 9) size          = PARSEREAL (args[9]);
+					if(n > 7) controlnumber = args[7].parseInt();
+					if(n > 8) blinkdelay    = args[8].parseInt();
+					if(n > 9) size          = args[9].parseReal();
 					if(n > 10) strncpy(matname, args[10].c_str(), 255);
 				}
 
@@ -3417,7 +3624,8 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				flares.push_back(f);
 				free_flare++;
 			}
-			else if (c.mode == BTS_PROPS)
+			break;
+			case BTS_PROPS:
 			{
 				//parse props
 				int ref, nx, ny;
@@ -3429,12 +3637,12 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				ref = parse_node_number(c, args[0]);
 				nx  = parse_node_number(c, args[1]);
 				ny  = parse_node_number(c, args[2]);
-				ox  = PARSEREAL(args[3]);
-				oy  = PARSEREAL(args[4]);
-				oz  = PARSEREAL(args[5]);
-				rx  = PARSEREAL(args[6]);
-				ry  = PARSEREAL(args[7]);
-				rz  = PARSEREAL(args[8]);
+				ox  = args[3].parseReal();
+				oy  = args[4].parseReal();
+				oz  = args[5].parseReal();
+				rx  = args[6].parseReal();
+				ry  = args[7].parseReal();
+				rz  = args[8].parseReal();
 				strncpy(meshname, args[9].c_str(), 255);
 
 				if(free_prop >= MAX_PROPS)
@@ -3488,10 +3696,10 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 						stdpos=Vector3(0.67, -0.61,0.24);
 					String diwmeshname = "dirwheel.mesh";
 					if(n > 10) strncpy(dirwheelmeshname, args[10].c_str(), 255);
-					if(n > 11) dwx = PARSEREAL(args[11]);
-					if(n > 12) dwy = PARSEREAL(args[12]);
-					if(n > 13) dwz = PARSEREAL(args[13]);
-					if(n > 14) rotdegrees = PARSEREAL(args[14]);
+					if(n > 11) dwx = args[11].parseReal();
+					if(n > 12) dwy = args[12].parseReal();
+					if(n > 13) dwz = args[13].parseReal();
+					if(n > 14) rotdegrees = args[14].parseReal();
 					if(n >= 14)
 					{
 						stdpos = Vector3(dwx, dwy, dwz);
@@ -3553,9 +3761,9 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 						float br=0, bg=0, bb=0;
 
 						if(n > 10) strncpy(beaconmaterial, args[10].c_str(), 255);
-						if(n > 11) br = PARSEREAL(args[11]);
-						if(n > 12) bg = PARSEREAL(args[12]);
-						if(n > 13) bb = PARSEREAL(args[13]);
+						if(n > 11) br = args[11].parseReal();
+						if(n > 12) bg = args[12].parseReal();
+						if(n > 13) bb = args[13].parseReal();
 						if(n >= 14)
 						{
 							color = ColourValue(br, bg, bb);
@@ -3671,20 +3879,22 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 
 				free_prop++;
 			}
-			else if (c.mode == BTS_GLOBEAMS)
+			break;
+			case BTS_GLOBEAMS:
 			{
 				//parse globeams
 				int n = parse_args(c, args, 1);
-				default_deform = PARSEREAL(args[0]);
-				if(n > 1) default_deform        = PARSEREAL(args[1]);
-				if(n > 2) default_break         = PARSEREAL(args[2]);
-				if(n > 3) default_beam_diameter = PARSEREAL(args[3]);
+				default_deform = args[0].parseReal();
+				if(n > 1) default_deform        = args[1].parseReal();
+				if(n > 2) default_break         = args[2].parseReal();
+				if(n > 3) default_beam_diameter = args[3].parseReal();
 				if(n > 4) strncpy(default_beam_material, args[4].c_str(), 255);
 
 				// hacky hack there ...
 				fadeDist = 1000;
 			}
-			else if (c.mode == BTS_WINGS)
+			break;
+			case BTS_WINGS:
 			{
 				//parse wings
 				int nds[8];
@@ -3696,13 +3906,13 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				for(int i = 0;i < 8; i++)
 					nds[i]  = parse_node_number(c, args[i]);
 				for(int i = 0;i < 8; i++)
-					txes[i] = PARSEREAL(args[i + 8]);
+					txes[i] = args[i + 8].parseReal();
 				if(n > 16) type     = args[16][0];
-				if(n > 17) cratio   = PARSEREAL(args[17]);
-				if(n > 18) mind     = PARSEREAL(args[18]);
-				if(n > 19) maxd     = PARSEREAL(args[19]);
+				if(n > 17) cratio   = args[17].parseReal();
+				if(n > 18) mind     = args[18].parseReal();
+				if(n > 19) maxd     = args[19].parseReal();
 				if(n > 20) strncpy(afname, args[20].c_str(), 255);
-				if(n > 21) liftcoef = PARSEREAL(args[21]);
+				if(n > 21) liftcoef = args[21].parseReal();
 
 				if(free_wing >= MAX_WINGS)
 				{
@@ -3923,7 +4133,10 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 
 				free_wing++;
 			}
-			else if (c.mode == BTS_TURBOPROPS || c.mode == BTS_TURBOPROPS2 || c.mode == BTS_PISTONPROPS) //turboprops, turboprops2, pistonprops
+			break;
+			case BTS_TURBOPROPS:
+			case BTS_TURBOPROPS2:
+			case BTS_PISTONPROPS: //turboprops, turboprops2, pistonprops
 			{
 				//parse turboprops
 				int ref,back,p1,p2,p3,p4;
@@ -3945,7 +4158,7 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 					p2     = parse_node_number(c, args[3]);
 					p3     = parse_node_number(c, args[4], &special_node_numbers);
 					p4     = parse_node_number(c, args[5], &special_node_numbers);
-					power  = PARSEREAL(args[6]);
+					power  = args[6].parseReal();
 					strncpy(propfoil, args[7].c_str(),  255);
 				}
 				if (c.mode == BTS_TURBOPROPS2)
@@ -3959,7 +4172,7 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 					p3     = parse_node_number(c, args[4], &special_node_numbers);
 					p4     = parse_node_number(c, args[5], &special_node_numbers);
 					couplenode = parse_node_number(c, args[6], &special_node_numbers);
-					power  = PARSEREAL(args[7]);
+					power  = args[7].parseReal();
 					strncpy(propfoil, args[8].c_str(),  255);
 				}
 				if (c.mode == BTS_PISTONPROPS)
@@ -3972,8 +4185,8 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 					p3     = parse_node_number(c, args[4], &special_node_numbers);
 					p4     = parse_node_number(c, args[5], &special_node_numbers);
 					couplenode = parse_node_number(c, args[6], &special_node_numbers);
-					power  = PARSEREAL(args[7]);
-					pitch  = PARSEREAL(args[8]);
+					power  = args[7].parseReal();
+					pitch  = args[8].parseReal();
 					strncpy(propfoil, args[9].c_str(),  255);
 					isturboprops = false;
 				}
@@ -4015,7 +4228,8 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 
 				free_aeroengine++;
 			}
-			else if (c.mode == BTS_FUSEDRAG)
+			break;
+			case BTS_FUSEDRAG:
 			{
 				//parse fusedrag
 				int front,back;
@@ -4030,7 +4244,7 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 					back   = parse_node_number(c, args[1]);
 					// calculate fusedrag by truck size
 					if (n > 3)
-						factor  = PARSEREAL(args[3]);
+						factor  = args[3].parseReal();
 					width  =  (fuse_z_max - fuse_z_min) * (fuse_y_max - fuse_y_min) * factor;
 					if (n > 4)
 						strncpy(fusefoil, args[4].c_str(), 255);
@@ -4045,7 +4259,7 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 					// original fusedrag calculation
 					front  = parse_node_number(c, args[0]);
 					back   = parse_node_number(c, args[1]);
-					width  = PARSEREAL(args[2]);
+					width  = args[2].parseReal();
 					if (n > 3)
 						strncpy(fusefoil, args[3].c_str(), 255);
 					
@@ -4056,32 +4270,36 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 					fuseWidth   = width;
 				}
 			}
-			else if (c.mode == BTS_ENGOPTION)
+			break;
+			case BTS_ENGOPTION:
 			{
 				//parse engoption
 				float inertia;
 				char type;
 				float clutch = -1.0f, shifttime = -1.0f, clutchtime = -1.0f, postshifttime = -1.0f;
 				int n = parse_args(c, args, 1);
-				inertia = PARSEREAL(args[0]);
+				inertia = args[0].parseReal();
 				if(n > 1) type = args[1][0];
-				if(n > 2) clutch = PARSEREAL(args[2]);
-				if(n > 3) shifttime = PARSEREAL(args[3]);
-				if(n > 4) clutchtime = PARSEREAL(args[4]);
-				if(n > 5) postshifttime = PARSEREAL(args[5]);
+				if(n > 2) clutch = args[2].parseReal();
+				if(n > 3) shifttime = args[3].parseReal();
+				if(n > 4) clutchtime = args[4].parseReal();
+				if(n > 5) postshifttime = args[5].parseReal();
 
 				if (engine) engine->setOptions(inertia, type, clutch, shifttime, clutchtime, postshifttime);
 			}
-			else if (c.mode == BTS_BRAKES)
+			break;
+			case BTS_BRAKES:
 			{
 				// parse brakes
 				int n = parse_args(c, args, 1);
-				brakeforce = PARSEREAL(args[0]);
+				brakeforce = args[0].parseReal();
 				// Read in footbrake force and handbrake force. If handbrakeforce is not present, set it to the default value 2*footbrake force to preserve older functionality
 				hbrakeforce = 2.0f * brakeforce;
-				if(n > 1) hbrakeforce = PARSEREAL(args[1]);
+				if(n > 1) hbrakeforce = args[1].parseReal();
 			}
-			else if (c.mode == BTS_ROTATORS || c.mode == BTS_ROTATORS2)
+			break;
+			case BTS_ROTATORS:
+			case BTS_ROTATORS2:
 			{
 				//parse rotators
 				int axis1, axis2,keys,keyl;
@@ -4106,24 +4324,24 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				p2[1] = parse_node_number(c, args[7]);
 				p2[2] = parse_node_number(c, args[8]);
 				p2[3] = parse_node_number(c, args[9]);
-				rate = PARSEREAL(args[10]);
-				keys = PARSEINT(args[11]);
-				keyl = PARSEINT(args[12]);
+				rate = args[10].parseReal();
+				keys = args[11].parseInt();
+				keyl = args[12].parseInt();
 
 				if (c.mode == BTS_ROTATORS)
 				{
-					if(n > 13) startDelay = PARSEREAL(args[13]);
-					if(n > 14) stopDelay = PARSEREAL(args[14]);
+					if(n > 13) startDelay = args[13].parseReal();
+					if(n > 14) stopDelay = args[14].parseReal();
 					if(n > 15) strncpy(startFunction, args[15].c_str(), 50);
 					if(n > 16) strncpy(stopFunction, args[16].c_str(), 50);
 				} else
 				if (c.mode == BTS_ROTATORS2)
 				{
-					if(n > 13) force = PARSEREAL(args[13]);
-					if(n > 14) tolerance = PARSEREAL(args[14]);
+					if(n > 13) force = args[13].parseReal();
+					if(n > 14) tolerance = args[14].parseReal();
 					if(n > 15) strncpy(description, args[15].c_str(), 50);
-					if(n > 16) startDelay = PARSEREAL(args[16]);
-					if(n > 17) stopDelay = PARSEREAL(args[17]);
+					if(n > 16) startDelay = args[16].parseReal();
+					if(n > 17) stopDelay = args[17].parseReal();
 					if(n > 18) strncpy(startFunction, args[18].c_str(), 50);
 					if(n > 19) strncpy(stopFunction, args[19].c_str(), 50);
 				}
@@ -4168,7 +4386,8 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				}
 				free_rotator++;
 			}
-			else if (c.mode == BTS_SCREWPROPS)
+			break;
+			case BTS_SCREWPROPS:
 			{
 				//parse screwprops
 				int ref,back,up;
@@ -4178,7 +4397,7 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				ref   = parse_node_number(c, args[0]);
 				back  = parse_node_number(c, args[1]);
 				up    = parse_node_number(c, args[2]);
-				power = PARSEREAL(args[3]);
+				power = args[3].parseReal();
 
 				//if (audio) audio->setupBoat(truckmass);
 
@@ -4192,7 +4411,8 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				driveable=BOAT;
 				free_screwprop++;
 			}
-			else if (c.mode == BTS_GUISETTINGS)
+			break;
+			case BTS_GUISETTINGS:
 			{
 				// guisettings
 				char keyword[256];
@@ -4238,15 +4458,17 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				}
 
 			}
-			else if (c.mode == BTS_MINIMASS)
+			break;
+			case BTS_MINIMASS:
 			{
 				//parse minimass
 				//sets the minimum node mass
 				//usefull for very light vehicles with lots of nodes (e.g. small airplanes)
 				parse_args(c, args, 1);
-				minimass = PARSEREAL(args[0]);
+				minimass = args[0].parseReal();
 			}
-			else if (c.mode == BTS_EXHAUSTS)
+			break;
+			case BTS_EXHAUSTS:
 			{
 				// parse exhausts
 				if (disable_smoke)
@@ -4258,7 +4480,7 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				int n = parse_args(c, args, 2);
 				id1 = parse_node_number(c, args[0]);
 				id2 = parse_node_number(c, args[1]);
-				if(n > 2) factor = PARSEREAL(args[2]);
+				if(n > 2) factor = args[2].parseReal();
 				if(n > 3) strncpy(material, args[3].c_str(), 255);
 
 				exhaust_t e;
@@ -4292,7 +4514,8 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				nodes[id2].iIsSkin=true;
 				exhausts.push_back(e);
 			}
-			else if (c.mode == BTS_PARTICLES)
+			break;
+			case BTS_PARTICLES:
 			{
 				//particles
 				if(!cparticle_enabled)
@@ -4330,7 +4553,8 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				}
 				free_cparticle++;
 			}
-			else if (c.mode == BTS_TURBOJETS) //turbojets
+			break;
+			case BTS_TURBOJETS: //turbojets
 			{
 				//parse turbojets
 				int front,back,ref, rev;
@@ -4339,12 +4563,12 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				front = parse_node_number(c, args[0]);
 				back  = parse_node_number(c, args[1]);
 				ref   = parse_node_number(c, args[2]);
-				rev   = PARSEINT(args[3]);
-				drthrust = PARSEREAL(args[4]);
-				abthrust = PARSEREAL(args[5]);
-				fdiam = PARSEREAL(args[6]);
-				bdiam = PARSEREAL(args[7]);
-				len   = PARSEREAL(args[8]);
+				rev   = args[3].parseInt();
+				drthrust = args[4].parseReal();
+				abthrust = args[5].parseReal();
+				fdiam = args[6].parseReal();
+				bdiam = args[7].parseReal();
+				len   = args[8].parseReal();
 
 				if(free_aeroengine >= MAX_AEROENGINES)
 				{
@@ -4365,7 +4589,8 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				}
 				free_aeroengine++;
 			}
-			else if (c.mode == BTS_RIGIDIFIERS)
+			break;
+			case BTS_RIGIDIFIERS:
 			{
 				//parse rigidifiers
 				int na,nb,nc;
@@ -4375,8 +4600,8 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				na = parse_node_number(c, args[0]);
 				nb = parse_node_number(c, args[1]);
 				nc = parse_node_number(c, args[2]);
-				if(n > 3) k  = PARSEREAL(args[3]);
-				if(n > 4) d  = PARSEREAL(args[4]);
+				if(n > 3) k  = args[3].parseReal();
+				if(n > 4) d  = args[4].parseReal();
 
 				if(free_rigidifier >= MAX_RIGIDIFIERS)
 				{
@@ -4401,7 +4626,8 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				}
 				free_rigidifier++;
 			}
-			else if (c.mode == BTS_AIRBRAKES)
+			break;
+			case BTS_AIRBRAKES:
 			{
 				//parse airbrakes
 				int ref, nx, ny, na;
@@ -4414,17 +4640,17 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				nx = parse_node_number(c, args[1]);
 				ny = parse_node_number(c, args[2]);
 				na = parse_node_number(c, args[3]);
-				ox = PARSEREAL(args[4]);
-				oy = PARSEREAL(args[5]);
-				oz = PARSEREAL(args[6]);
-				wd = PARSEREAL(args[7]);
-				len = PARSEREAL(args[8]);
-				maxang = PARSEREAL(args[9]);
-				tx1 = PARSEREAL(args[10]);
-				tx2 = PARSEREAL(args[11]);
-				tx3 = PARSEREAL(args[12]);
-				tx4 = PARSEREAL(args[13]);
-				if(n > 14) liftcoef = PARSEREAL(args[14]);
+				ox = args[4].parseReal();
+				oy = args[5].parseReal();
+				oz = args[6].parseReal();
+				wd = args[7].parseReal();
+				len = args[8].parseReal();
+				maxang = args[9].parseReal();
+				tx1 = args[10].parseReal();
+				tx2 = args[11].parseReal();
+				tx3 = args[12].parseReal();
+				tx4 = args[13].parseReal();
+				if(n > 14) liftcoef = args[14].parseReal();
 
 				if(free_airbrake >= MAX_AIRBRAKES)
 				{
@@ -4438,7 +4664,8 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 					airbrakes[free_airbrake]=new Airbrake(manager, truckname, free_airbrake, &nodes[ref], &nodes[nx], &nodes[ny], &nodes[na], Vector3(ox,oy,oz), wd, len, maxang, texname, tx1,tx2,tx3,tx4,liftcoef);
 				free_airbrake++;
 			}
-			else if (c.mode == BTS_FLEXBODIES)
+			break;
+			case BTS_FLEXBODIES:
 			{
 				//parse flexbodies
 				int ref, nx, ny;
@@ -4453,12 +4680,12 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				ref = parse_node_number(c, args[0], &special_numbers);
 				nx = parse_node_number(c, args[1], &special_numbers);
 				ny = parse_node_number(c, args[2], &special_numbers);
-				ox = PARSEREAL(args[3]);
-				oy = PARSEREAL(args[4]);
-				oz = PARSEREAL(args[5]);
-				rx = PARSEREAL(args[6]);
-				ry = PARSEREAL(args[7]);
-				rz = PARSEREAL(args[8]);
+				ox = args[3].parseReal();
+				oy = args[4].parseReal();
+				oz = args[5].parseReal();
+				rx = args[6].parseReal();
+				ry = args[7].parseReal();
+				rz = args[8].parseReal();
 				strncpy(meshname, args[9].c_str(), 255);
 
 				Vector3 offset=Vector3(ox, oy, oz);
@@ -4468,9 +4695,17 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				char uname[256];
 				sprintf(uname, "flexbody-%s-%i", truckname, free_flexbody);
 				//read an extra line!
-				c.line = ds->getLine();
-				StringUtil::trim(c.line);
-				c.linecounter++;
+				if (linepos + 1 < source->lines.size())
+				{
+					linepos++;
+					c.line = source->lines[linepos].line;
+					c.linecounter = source->lines[linepos].linecounter;
+					c.source = &source->lines[linepos];
+				} else
+				{
+					c.line = String();
+					c.source = 0;
+				}
 				if (c.line == "forset")
 				{
 					parser_warning(c, "No forset statement after a flexbody", PARSER_ERROR);
@@ -4483,18 +4718,19 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 					continue;
 				}
 				if(!virtuallyLoaded)
-					flexbodies[free_flexbody]=new FlexBody(manager, nodes, free_node, meshname, uname, ref, nx, ny, offset, rot, const_cast<char *>(c.line.substr(6).c_str()), materialFunctionMapper, usedSkin, (shadowmode!=0), materialReplacer);
+					flexbodies[free_flexbody]=new FlexBody(manager, nodes, visualpos, free_node, meshname, uname, ref, nx, ny, offset, rot, const_cast<char *>(c.line.substr(6).c_str()), materialFunctionMapper, usedSkin, (shadowmode!=0), materialReplacer, rigTemplate, free_flexbody);
 				free_flexbody++;
 			}
-			else if (c.mode == BTS_HOOKGROUP)
+			break;
+			case BTS_HOOKGROUP:
 			{
 				//parse hookgroups
 				int id1=0, group=-1;
 				bool lockNodes = true;
 				int n = parse_args(c, args, 2);
 				id1       = parse_node_number(c, args[0]);
-				group     = PARSEINT(args[1]);
-				if(n > 2) lockNodes = (PARSEINT(args[2]) != 0);
+				group     = args[1].parseInt();
+				if(n > 2) lockNodes = (args[2].parseInt() != 0);
 
 				hook_t h;
 				h.hookNode  = &nodes[id1];
@@ -4506,7 +4742,8 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				hooks.push_back(h);
 
 			}
-			else if (c.mode == BTS_MATERIALFLAREBINDINGS)
+			break;
+			case BTS_MATERIALFLAREBINDINGS:
 			{
 				// parse materialflarebindings
 				int flareid;
@@ -4514,7 +4751,7 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				memset(material, 0, 255);
 
 				int n = parse_args(c, args, 2);
-				flareid = PARSEINT(args[0]);
+				flareid = args[0].parseInt();
 				strncpy(material, args[1].c_str(), 255);
 
 				String materialName = String(material);
@@ -4535,41 +4772,44 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				if(materialFunctionMapper)
 					materialFunctionMapper->addMaterial(flareid, t);
 			}
-			else if (c.mode == BTS_SOUNDSOURCES)
+			break;
+			case BTS_SOUNDSOURCES:
 			{
 				//parse soundsources
 				int ref;
 				char script[256];
 				int n = parse_args(c, args, 2);
-				ref = PARSEINT(args[0]); // DO NOT check nodes here, they may come afterwards
+				ref = args[0].parseInt(); // DO NOT check nodes here, they may come afterwards
 				strncpy(script, args[1].c_str(), 255);
 
 	#ifdef USE_OPENAL
 				addSoundSource(SoundScriptManager::getSingleton().createInstance(script, trucknum), ref, -2, &c);
 	#endif //OPENAL
 			}
-			else if (c.mode == BTS_SOUNDSOURCES2)
+			break;
+			case BTS_SOUNDSOURCES2:
 			{
 				//parse soundsources2
 				int ref, type;
 				char script[256];
 				int n = parse_args(c, args, 3);
-				ref = PARSEINT(args[0]); // DO NOT check nodes here, they may come afterwards
-				type = PARSEINT(args[1]);
+				ref = args[0].parseInt(); // DO NOT check nodes here, they may come afterwards
+				type = args[1].parseInt();
 				strncpy(script, args[2].c_str(), 255);
 
 #ifdef USE_OPENAL
 				addSoundSource(SoundScriptManager::getSingleton().createInstance(script, trucknum), ref, type, &c);
 #endif //OPENAL
 			}
-			else if (c.mode == BTS_SOUNDSOURCES3)
+			break;
+			case BTS_SOUNDSOURCES3:
 			{
 				//parse soundsources3
 				int ref, mode, itemNum;
 				char script[256];
 				int n = parse_args(c, args, 5);
-				ref = PARSEINT(args[0]); // DO NOT check nodes here, they may come afterwards
-				mode = PARSEINT(args[1]);
+				ref = args[0].parseInt(); // DO NOT check nodes here, they may come afterwards
+				mode = args[1].parseInt();
 				int slType = SL_DEFAULT;
 				if     (args[2] == "command")     slType = SL_COMMAND;
 				else if(args[2] == "hydro")       slType = SL_HYDRO;
@@ -4585,18 +4825,20 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				else if(args[2] == "exhaust")     slType = SL_EXHAUSTS;
 				else if(args[2] == "videocamera") slType = SL_VIDEOCAMERA;
 
-				itemNum = PARSEINT(args[3]);
+				itemNum = args[3].parseInt();
 				strncpy(script, args[4].c_str(), 255);
 #ifdef USE_OPENAL
 				addSoundSource(SoundScriptManager::getSingleton().createInstance(script, trucknum, NULL, slType, itemNum), ref, mode, &c);
 #endif //OPENAL
 			}
-			else if (c.mode == BTS_ENVMAP)
+			break;
+			case BTS_ENVMAP:
 			{
 				// parse envmap
 				// we do nothing of this for the moment
 			}
-			else if (c.mode == BTS_MANAGEDMATERIALS)
+			break;
+			case BTS_MANAGEDMATERIALS:
 			{
 				// parse managedmaterials
 				char material[256];
@@ -4931,7 +5173,8 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				}
 
 			}
-			else if (c.mode == BTS_SECTIONCONFIG)
+			break;
+			case BTS_SECTIONCONFIG:
 			{
 				// parse sectionconfig
 				int n = parse_args(c, args, 2);
@@ -4941,7 +5184,8 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				sectionconfigs.push_back(sectionName);
 				c.mode=savedmode;
 			}
-			else if (c.mode == BTS_SECTION)
+			break;
+			case BTS_SECTION:
 			{
 				// parse section
 				int version=0;
@@ -4949,7 +5193,7 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				for(int i=0;i<10;i++) memset(sectionName, 0, 255); // clear
 				if(c.line.size() < 8) continue;
 				int n = parse_args(c, args, 2);
-				version = PARSEINT(args[0]);
+				version = args[0].parseInt();
 				for(int i = 0; i < 10; i++)
 				{
 					if(n > (i + 1))
@@ -4983,22 +5227,26 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 					// wait for end_section otherwise
 					c.mode=BTS_IN_SECTION;
 			}
+			break;
 			/* c.mode BTS_IN_SECTION is reserved */
-			else if (c.mode == BTS_TORQUECURVE)
+			case BTS_TORQUECURVE:
 			{
 				// parse torquecurve
 				if (engine && engine->getTorqueCurve())
 					engine->getTorqueCurve()->processLine(String(c.line));
-			} else if (c.mode == BTS_ADVANCEDDRAG)
+			}
+			break;
+			case BTS_ADVANCEDDRAG:
 			{
 				//parse advanced drag
 				float drag;
 				int n = parse_args(c, args, 1);
-				drag = PARSEREAL(args[0]);
+				drag = args[0].parseReal();
 				advanced_total_drag = drag;
 				advanced_drag       = true;
 			}
-			else if (c.mode == BTS_AXLES)
+			break;
+			case BTS_AXLES:
 			{
 				// parse axle section
 				// search for wheel
@@ -5121,24 +5369,30 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 					TOSTRING(wheel_node[1][1]) + ")", PARSER_INFO);
 				++free_axle;
 			}
+			break;
 
-			else if (c.mode == BTS_RAILGROUPS) parseRailGroupLine(c);
-			else if (c.mode == BTS_SLIDENODES) parseSlideNodeLine(c);
-			else if (c.mode == BTS_NODECOLLISION)
+			case BTS_RAILGROUPS:
+				parseRailGroupLine(c);
+				break;
+			case BTS_SLIDENODES:
+				parseSlideNodeLine(c);
+				break;
+			case BTS_NODECOLLISION:
 			{
 				// parse nodecollision
 				int nodenum  = -1;
 				float radius =  0;
 				int n = parse_args(c, args, 2);
 				nodenum = parse_node_number(c, args[0]);
-				radius = PARSEREAL(args[1]);
+				radius = args[1].parseReal();
 
 				if(nodenum >= free_node || nodenum < 0)
 					continue;
 
 				nodes[nodenum].collRadius = radius;
 			}
-			else if (c.mode == BTS_VIDCAM)
+			break;
+			case BTS_VIDCAM:
 			{
 				if(virtuallyLoaded) continue;
 
@@ -5149,6 +5403,7 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 				}
 				continue;
 			}
+			}
 
 		} catch(ParseException &)
 		{
@@ -5306,7 +5561,7 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 		parser_warning(c, "creating mesh", PARSER_INFO);
 		cabMesh = NULL;
 		if(!virtuallyLoaded)
-			cabMesh=new FlexObj(manager, nodes, free_texcoord, texcoords, free_cab, cabs, free_sub, subtexcoords, subcabs, texname, wname, subisback, backmatname, transmatname);
+			cabMesh=new FlexObj(manager, nodes, visualpos, free_texcoord, texcoords, free_cab, cabs, free_sub, subtexcoords, subcabs, texname, wname, subisback, backmatname, transmatname);
 		parser_warning(c, "creating entity", PARSER_INFO);
 
 		if(!virtuallyLoaded)
@@ -5350,23 +5605,8 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 		parser_warning(c, "vehicle uses no GUID, skinning will be impossible", PARSER_OBSOLETE);
 	}
 
-   // now generate the hash of it
-	{
-		// copy whole truck into a string
-		String code;
-		ds->seek(0); // from start
-		code.resize(ds->size());
-		ds->read(&code[0], ds->size());
-
-		// and build the hash over it
-		char hash_result[250];
-		memset(hash_result, 0, 249);
-		RoR::CSHA1 sha1;
-		sha1.UpdateHash((uint8_t *)code.c_str(), (uint32_t)code.size());
-		sha1.Final();
-		sha1.ReportHash(hash_result, RoR::CSHA1::REPORT_HEX_SHORT);
-		beamHash = String(hash_result);
-	}
+	// the hash over the whole file was generated when the source was compiled
+	beamHash = source->beamHash;
 
 
 	// WARNING: this must come LAST
@@ -5381,6 +5621,14 @@ int SerializedRig::loadTruck(String fname, SceneManager *manager, SceneNode *par
 
 
 	parser_warning(c, "parsing done", PARSER_INFO);
+	if(rigTemplate && free_flexbody)
+	{
+		size_t instanceMemory = 0;
+		for(int i = 0; i < free_flexbody; i++)
+			if(flexbodies[i]) instanceMemory += flexbodies[i]->getInstanceMemorySize();
+		LOG("flexbody memory: " + TOSTRING((int)(instanceMemory / 1024)) + " kB for this instance, " + TOSTRING((int)(RigTemplateCache::getSingleton().getMemorySize(rigTemplate) / 1024)) + " kB shared by " + TOSTRING(rigTemplate->refcount) + " instance(s)");
+	}
+	LOG("loaded " + filename + " in " + TOSTRING((int)(loadTimer.elapsed() * 1000)) + " ms" + (fromCompiledSource ? " (compiled source)" : ""));
 	return 0;
 }
 
@@ -5507,6 +5755,7 @@ void SerializedRig::init_node(int pos, Real x, Real y, Real z, int type, Real m,
 	nodes[pos].AbsPosition=Vector3(x,y,z);
 	nodes[pos].RelPosition=Vector3(x,y,z)-origin;
 	nodes[pos].smoothpos=nodes[pos].AbsPosition;
+	visualpos[pos]=nodes[pos].AbsPosition; // the cab and wheel meshes are built from it
 	nodes[pos].iPosition=Vector3(x,y,z);
 	if(pos != 0)
 		nodes[pos].iDistance=(nodes[0].AbsPosition - Vector3(x,y,z)).squaredLength();
@@ -5603,8 +5852,8 @@ int SerializedRig::add_beam(node_t *p1, node_t *p2, SceneManager *manager, Scene
 	beams[pos].minendmass=1.0;
 	beams[pos].diameter = diameter;
 	beams[pos].scale=0.0;
-	beams[pos].mEntity=NULL;
-	beams[pos].mSceneNode=NULL;
+	beams[pos].mBatch=-1;
+	beams[pos].mVisible=false;
 	if (shortbound!=-1.0)
 	{
 		beams[pos].bounded    = SHOCK1;
@@ -5619,42 +5868,23 @@ int SerializedRig::add_beam(node_t *p1, node_t *p2, SceneManager *manager, Scene
 	//        if (type!=BEAM_VIRTUAL && type!=BEAM_INVISIBLE)
 	if (type!=BEAM_VIRTUAL && !virtuallyLoaded)
 	{
-		//setup visuals
-		//the cube is 100x100x100
-		char bname[256];
-		sprintf(bname, "beam-%s-%i", truckname, pos);
-		try
-		{
-			beams[pos].mEntity = manager->createEntity(bname, "beam.mesh");
-		}catch(...)
-		{
-			parser_warning(c, "error loading mesh: beam.mesh", PARSER_ERROR);
-		}
+		//setup visuals, all beams of the truck are drawn by the BeamRenderer
 		// no materialmapping for beams!
-		//		ec->setCastShadows(false);
-
-		if (beams[pos].mEntity && (type==BEAM_HYDRO || type==BEAM_MARKED))
-			beams[pos].mEntity->setMaterialName("tracks/Chrome");
-		else if(beams[pos].mEntity)
-			beams[pos].mEntity->setMaterialName(default_beam_material);
-		beams[pos].mSceneNode = beamsRoot->createChildSceneNode();
-		//            beams[pos].mSceneNode->attachObject(ec);
-		//            beams[pos].mSceneNode->setScale(default_beam_diameter/100.0,length/100.0,default_beam_diameter/100.0);
-		beams[pos].mSceneNode->setScale(beams[pos].diameter, length, beams[pos].diameter);
-
-		// colourize beams in simple c.mode
-		ColourValue c = ColourValue::Blue;
+		String material = default_beam_material;
+		if (type==BEAM_HYDRO || type==BEAM_MARKED)
+			material = "tracks/Chrome";
+
+		// colour in simple c.mode
+		ColourValue colour = ColourValue::Blue;
 		if(type == BEAM_HYDRO)
-			c = ColourValue::Red;
-		else if(type == BEAM_HYDRO)
-			c = ColourValue::Red;
-		if (beams[pos].mEntity)
-			MaterialFunctionMapper::replaceSimpleMeshMaterials(beams[pos].mEntity, c);
+			colour = ColourValue::Red;
 
+		if (beamRenderer)
+			beams[pos].mBatch = beamRenderer->addBeam(pos, material, colour);
 	}
 
- 	if (beams[pos].mSceneNode && beams[pos].mEntity && !(type==BEAM_VIRTUAL || type==BEAM_INVISIBLE || type==BEAM_INVISIBLE_HYDRO))
-		beams[pos].mSceneNode->attachObject(beams[pos].mEntity);//beams[pos].mSceneNode->setVisible(0);
+	if (beams[pos].mBatch >= 0 && !(type==BEAM_VIRTUAL || type==BEAM_INVISIBLE || type==BEAM_INVISIBLE_HYDRO))
+		beams[pos].mVisible = true;
 
 	free_beam++;
 	return pos;
@@ -5840,7 +6070,7 @@ void SerializedRig::addWheel(SceneManager *manager, SceneNode *parent, Real radi
 	{
 		if (meshwheel)
 		{
-			vwheels[free_wheel].fm=new FlexMeshWheel(manager, wname, nodes, node1, node2, nodebase, rays, texf, texb, rimradius, rimreverse, materialFunctionMapper, usedSkin, materialReplacer);
+			vwheels[free_wheel].fm=new FlexMeshWheel(manager, wname, nodes, visualpos, node1, node2, nodebase, rays, texf, texb, rimradius, rimreverse, materialFunctionMapper, usedSkin, materialReplacer);
 			try
 			{
 				Entity *ec = manager->createEntity(wnamei, wname);
@@ -5858,7 +6088,7 @@ void SerializedRig::addWheel(SceneManager *manager, SceneNode *parent, Real radi
 		}
 		else
 		{
-			vwheels[free_wheel].fm=new FlexMesh(manager, wname, nodes, node1, node2, nodebase, rays, texf, texb);
+			vwheels[free_wheel].fm=new FlexMesh(manager, wname, nodes, visualpos, node1, node2, nodebase, rays, texf, texb);
 			try
 			{
 				Entity *ec = manager->createEntity(wnamei, wname);
@@ -6055,7 +6285,7 @@ void SerializedRig::addWheel2(SceneManager *manager, SceneNode *parent, Real rad
 	//	strcpy(texf, "tracks/wheelface,");
 	if(!virtuallyLoaded)
 	{
-		vwheels[free_wheel].fm=new FlexMesh(manager, wname, nodes, node1, node2, nodebase, rays, texf, texb, true, radius/radius2);
+		vwheels[free_wheel].fm=new FlexMesh(manager, wname, nodes, visualpos, node1, node2, nodebase, rays, texf, texb, true, radius/radius2);
 		try
 		{
 			Entity *ec = manager->createEntity(wnamei, wname);
@@ -6280,7 +6510,7 @@ void SerializedRig::addWheel3(SceneManager *manager, SceneNode *parent, Real rad
 
 	if(!virtuallyLoaded)
 	{
-		vwheels[free_wheel].fm=new FlexMeshWheel(manager, wname, nodes, node1, node2, nodebase, rays, texf, texb, rimradius, rimreverse, materialFunctionMapper, usedSkin, materialReplacer);
+		vwheels[free_wheel].fm=new FlexMeshWheel(manager, wname, nodes, visualpos, node1, node2, nodebase, rays, texf, texb, rimradius, rimreverse, materialFunctionMapper, usedSkin, materialReplacer);
 		try
 		{
 			Entity *ec = manager->createEntity(wnamei, wname);
@@ -6713,18 +6943,21 @@ void SerializedRig::parser_warning(parsecontext_t *context, Ogre::String text, i
 		LOG(text);
 }
 
-int SerializedRig::parse_args(parsecontext_t &context, Ogre::StringVector &args, int minArgNum)
+int SerializedRig::parse_args(parsecontext_t &context, std::vector<ParserArg> &args, int minArgNum)
 {
-	try
-	{
-		args = Ogre::StringUtil::split(context.line, ":|, \t");
-	} catch(Exception &e)
-	{
-		parser_warning(context, "Exception on parsing: "+e.getFullDescription(), PARSER_ERROR);
-		args.clear();
-		throw(ParseException());
-	}
-	int n = (int)args.size();
+	// lines of the compiled source were already split, all others are split here
+	std::vector<compiled_rig_arg_t> split;
+	const std::vector<compiled_rig_arg_t> *spans = &split;
+	if (context.source)
+		spans = &context.source->args;
+	else
+		splitArgs(context.line.c_str(), context.line.size(), split);
+
+	// the arguments only point into the line, nothing is copied until a value is used
+	int n = (int)spans->size();
+	args.resize(n);
+	for (int i = 0; i < n; i++)
+		args[i].set(&context.line, (*spans)[i].start, (*spans)[i].length);
 	if(n < minArgNum)
 	{
 		parser_warning(context, "Too less arguments: "+TOSTRING(n)+" provided, "+TOSTRING(minArgNum)+" required. ", PARSER_ERROR);
@@ -6734,6 +6967,106 @@ int SerializedRig::parse_args(parsecontext_t &context, Ogre::StringVector &args,
 	return n;
 }
 
+void ParserArg::set(const Ogre::String *line, unsigned int start, unsigned int length)
+{
+	this->line   = line;
+	this->start  = start;
+	this->length = length;
+	copied = false;
+}
+
+const char *ParserArg::c_str() const
+{
+	if (!copied)
+	{
+		if (line)
+			copy.assign(*line, start, length);
+		else
+			copy.clear();
+		copied = true;
+	}
+	return copy.c_str();
+}
+
+bool ParserArg::operator==(const char *s) const
+{
+	for (unsigned int i = 0; i < length; i++, s++)
+		if (!*s || *s != (*line)[start + i])
+			return false;
+	return *s == 0;
+}
+
+// plain numbers are converted right from the line. The conversion does not depend on the C locale
+// (language.cpp sets it), same as the stream StringConverter uses. Everything else goes through StringConverter
+int ParserArg::parseInt() const
+{
+	const char *p   = line ? line->c_str() + start : "";
+	const char *end = p + length;
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+		negative = (*p++ == '-');
+	if (p == end || *p < '0' || *p > '9' || end - p > 9)
+		return StringConverter::parseInt(str());
+
+	int value = 0;
+	for (; p < end && *p >= '0' && *p <= '9'; p++)
+		value = value * 10 + (*p - '0');
+	return negative ? -value : value;
+}
+
+Real ParserArg::parseReal() const
+{
+	static const double pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15 };
+
+	const char *p   = line ? line->c_str() + start : "";
+	const char *end = p + length;
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+		negative = (*p++ == '-');
+
+	// up to 15 digits are exact in a double, so the division is the only rounding
+	double mantissa = 0;
+	int digits = 0, decimals = 0;
+	bool dot = false;
+	for (; p < end; p++)
+	{
+		if (*p >= '0' && *p <= '9')
+		{
+			mantissa = mantissa * 10 + (*p - '0');
+			digits++;
+			if (dot) decimals++;
+		}
+		else if (*p == '.' && !dot)
+			dot = true;
+		else
+			break;
+	}
+	if (!digits || digits > 15 || (p < end && (*p == 'e' || *p == 'E')))
+		return StringConverter::parseReal(str());
+
+	double value = mantissa / pow10[decimals];
+	return (Real)(negative ? -value : value);
+}
+
+void SerializedRig::splitArgs(const char *line, size_t len, std::vector<compiled_rig_arg_t> &args)
+{
+	// empty arguments are skipped like StringUtil::split does
+	args.clear();
+	const char *p   = line;
+	const char *end = line + len;
+	while (p < end)
+	{
+		while (p < end && parse_delimiter_table[(unsigned char)*p]) p++;
+		const char *start = p;
+		while (p < end && !parse_delimiter_table[(unsigned char)*p]) p++;
+		if (p == start) continue;
+		compiled_rig_arg_t arg;
+		arg.start  = (unsigned int)(start - line);
+		arg.length = (unsigned int)(p - start);
+		args.push_back(arg);
+	}
+}
+
 int SerializedRig::parse_node_number(parsecontext_t &context, Ogre::String s, std::vector<int> *special_numbers)
 {
 	if(free_node == 0)
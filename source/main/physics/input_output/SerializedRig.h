@@ -24,6 +24,8 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "RoRPrerequisites.h"
 #include "BeamData.h" // for rig_t
+#include "RigSourceCache.h"
+#include "RigTemplateCache.h"
 
 #include <OgreStringVector.h>
 
@@ -35,6 +37,94 @@ typedef struct trucksection_t
 	bool titleContainsInfo;
 } trucksection_t;
 
+// one line commands, the lines are matched against truck_keywords when the source is compiled
+enum TRUCK_KEYWORDS {
+	BTK_END=0,
+	BTK_PATCHENGINETORQUE,
+	BTK_END_DESCRIPTION,
+	BTK_END_COMMENT,
+	BTK_END_SECTION,
+	BTK_FORWARDCOMMANDS,
+	BTK_IMPORTCOMMANDS,
+	BTK_ROLLON,
+	BTK_RESCUER,
+	BTK_COMMENT,
+	BTK_DISABLEDEFAULTSOUNDS,
+	BTK_SECTIONCONFIG,
+	BTK_SECTION,
+	BTK_DETACHER_GROUP,
+	BTK_FILEINFO,
+	BTK_EXTCAMERA,
+	BTK_SUBMESH_GROUNDMODEL,
+	BTK_SLOPEBRAKE,
+	BTK_ANTILOCKBRAKES,
+	BTK_TRACTIONCONTROL,
+	BTK_CRUISECONTROL,
+	BTK_SPEEDLIMITER,
+	BTK_FILEFORMATVERSION,
+	BTK_AUTHOR,
+	BTK_SLIDENODE_CONNECT_INSTANTLY,
+	BTK_ENABLE_ADVANCED_DEFORMATION,
+	BTK_HIDEINCHOOSER,
+	BTK_LOCKGROUP_DEFAULT_NOLOCK,
+	BTK_SET_SHADOWS,
+	BTK_PROP_CAMERA_MODE,
+	BTK_FLEXBODY_CAMERA_MODE,
+	BTK_ADD_ANIMATION,
+	BTK_SET_MANAGEDMATERIALS_OPTIONS,
+	BTK_SET_BEAM_DEFAULTS_SCALE,
+	BTK_GUID,
+	BTK_SET_BEAM_DEFAULTS,
+	BTK_SET_INERTIA_DEFAULTS,
+	BTK_SET_NODE_DEFAULTS,
+	BTK_SET_SKELETON_SETTINGS,
+	BTK_BACKMESH,
+	BTK_SUBMESH,
+	BTK_SET_COLLISION_RANGE,
+	BTK_COUNT,
+};
+
+typedef struct truckkeyword_t
+{
+	int keywordID;
+	const char *name;
+	unsigned int minLength;  //!< 0 if the line has to be the keyword, otherwise the line has to start with it and be at least this long
+} truckkeyword_t;
+
+/**
+ * One argument of a line as parse_args splits it. It only points into the line of the
+ * parser context, the characters are converted or copied when a value is asked for.
+ * Only valid until the line of the context changes.
+ */
+class ParserArg
+{
+public:
+	ParserArg() : copied(false), length(0), line(0), start(0) {};
+
+	void set(const Ogre::String *line, unsigned int start, unsigned int length);
+
+	int parseInt() const;          //!< same result as PARSEINT, without copying the argument
+	Ogre::Real parseReal() const;  //!< same result as PARSEREAL, without copying the argument
+
+	Ogre::String str() const { return line ? line->substr(start, length) : Ogre::String(); };
+	operator Ogre::String() const { return str(); };
+	const char *c_str() const;
+	size_t size() const { return length; };
+	char operator[](size_t i) const { return (i < length) ? (*line)[start + i] : 0; };
+
+	bool operator==(const char *s) const;
+	bool operator==(const Ogre::String &s) const { return s.size() == length && !s.compare(0, length, *line, start, length); };
+	bool operator!=(const char *s) const { return !(*this == s); };
+	bool operator!=(const Ogre::String &s) const { return !(*this == s); };
+
+protected:
+	mutable Ogre::String copy;  //!< the buffer is reused from line to line
+	mutable bool copied;
+	unsigned int length;
+	const Ogre::String *line;
+	unsigned int start;
+};
+
 typedef struct parsecontext_t
 {
 	Ogre::String filename;
@@ -43,6 +133,7 @@ typedef struct parsecontext_t
 	int warningLvl;
 	unsigned int linecounter;
 	Ogre::String line;
+	const compiled_rig_line_t *source; //!< compiled line that line was taken from, 0 if there is none
 	int mode;
 } parsecontext_t;
 
@@ -71,7 +162,12 @@ public:
 	// real truck loading
 	int loadTruck(Ogre::String filename, Ogre::SceneManager *manager, Ogre::SceneNode *parent, Ogre::Vector3 pos, Ogre::Quaternion rot, collision_box_t *spawnbox);	
 
-	int parse_args(parsecontext_t &context, Ogre::StringVector &v, int minArgNum);
+	int parse_args(parsecontext_t &context, std::vector<ParserArg> &v, int minArgNum);
+
+	// used to compile rig sources, see RigSourceCache: return the index into the section or keyword table or -1
+	static int findSection(const char *line, size_t len, bool &wrongCase);
+	static int findKeyword(const char *line, size_t len);
+	static void splitArgs(const char *line, size_t len, std::vector<compiled_rig_arg_t> &args);
 	int parse_node_number(parsecontext_t &context, Ogre::String s, std::vector<int> *special_numbers=NULL);
 	void parser_warning(parsecontext_t &context, Ogre::String text, int errlvl = PARSER_WARNING);
 	void parser_warning(parsecontext_t *context, Ogre::String text, int errlvl = PARSER_WARNING);
@@ -81,6 +177,7 @@ public:
 	std::vector <parsecontext_t> &getWarnings() { return warnings; };
 protected:
 	bool virtuallyLoaded;
+	rig_template_t *rigTemplate; //!< shared with the other instances of the same rig
 	bool ignoreProblems;
 
 	std::vector <parsecontext_t> warnings;
@@ -86,6 +86,7 @@ BeamEngineStats::BeamEngineStats()
 	typeDescriptions_gfx[BES_GFX_updateSoundSources]        = "updateSoundSources";
 	typeDescriptions_gfx[BES_GFX_updateVisual]              = "updateVisual";
 	typeDescriptions_gfx[BES_GFX_updateFlexBodies]          = "updateFlexBodies";
+	typeDescriptions_gfx[BES_GFX_updateBeams]               = "updateBeams";
 	typeDescriptions_gfx[BES_GFX_updateNetworkInfo]         = "updateNetworkInfo";
 
 	stats->setCaption("calculating ...");
@@ -102,6 +102,7 @@ enum {
 	BES_GFX_updateSoundSources,
 	BES_GFX_updateVisual,
 	BES_GFX_updateFlexBodies,
+	BES_GFX_updateBeams,
 	BES_GFX_updateNetworkInfo
 	// if you change this, change MAX_TIMINGS as well
 };
@@ -52,8 +52,8 @@ void Screwprop::updateForces(int update)
 	nodes[noderef].Forces+=dir;
 	if (update && splashp && throtle>0.1)
 	{
-		if (depth<0.2) splashp->allocSplash(nodes[noderef].AbsPosition, 10.0*dir/fullpower);
-		ripplep->allocRipple(nodes[noderef].AbsPosition, 10.0*dir/fullpower);
+		if (depth<0.2) splashp->allocSplash(nodes[noderef].AbsPosition, 10.0*dir/fullpower, this);
+		ripplep->allocRipple(nodes[noderef].AbsPosition, 10.0*dir/fullpower, this);
 	}
 }
 
@@ -0,0 +1,194 @@
+/*
+This source file is part of Rigs of Rods
+Copyright 2005-2012 Pierre-Michel Ricordel
+Copyright 2007-2012 Thomas Fischer
+
+For more information, see http://www.rigsofrods.com/
+
+Rigs of Rods is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 3, as
+published by the Free Software Foundation.
+
+Rigs of Rods is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "ThreadPool.h"
+
+#ifdef WIN32
+#include <windows.h>
+#include <sys/timeb.h>
+#else
+#include <sys/time.h>
+#include <unistd.h>
+#endif // WIN32
+
+void *s_threadpoolworker(void *vpool)
+{
+	((ThreadPool *)vpool)->workerThread();
+	return NULL;
+}
+
+ThreadPool::ThreadPool(int numthreads) :
+	  completed(0)
+	, count(0)
+	, fn(0)
+	, next(0)
+	, shutdown(false)
+	, userdata(0)
+{
+	pthread_mutex_init(&mutex, NULL);
+	pthread_cond_init(&work_cv, NULL);
+	pthread_cond_init(&done_cv, NULL);
+
+	if (numthreads <= 0)
+		numthreads = getCPUCount();
+
+	for (int i = 0; i < numthreads; i++)
+	{
+		pthread_t thread;
+		if (pthread_create(&thread, NULL, s_threadpoolworker, (void *)this))
+		{
+			LOG("ThreadPool: unable to start worker thread");
+			break;
+		}
+		threads.push_back(thread);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	MUTEX_LOCK(&mutex);
+	shutdown = true;
+	pthread_cond_broadcast(&work_cv);
+	MUTEX_UNLOCK(&mutex);
+
+	for (size_t i = 0; i < threads.size(); i++)
+		pthread_join(threads[i], NULL);
+
+	pthread_cond_destroy(&done_cv);
+	pthread_cond_destroy(&work_cv);
+	pthread_mutex_destroy(&mutex);
+}
+
+int ThreadPool::getCPUCount()
+{
+#ifdef WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return std::max(1, (int)info.dwNumberOfProcessors);
+#else
+	return std::max(1, (int)sysconf(_SC_NPROCESSORS_ONLN));
+#endif // WIN32
+}
+
+void ThreadPool::start(int _count, job_fn_t _fn, void *_userdata)
+{
+	MUTEX_LOCK(&mutex);
+	// there is only one batch at a time, the jobs of the running one still use its fn and counters
+	while (completed < count)
+		pthread_cond_wait(&done_cv, &mutex);
+	fn        = _fn;
+	userdata  = _userdata;
+	count     = _count;
+	next      = 0;
+	completed = 0;
+	pthread_cond_broadcast(&work_cv);
+	MUTEX_UNLOCK(&mutex);
+
+	// no workers, so do the work right here
+	if (threads.empty())
+		while (runNextJob());
+}
+
+bool ThreadPool::waitFor(unsigned int ms)
+{
+	struct timespec deadline;
+#ifdef WIN32
+	struct _timeb tb;
+	_ftime(&tb);
+	deadline.tv_sec  = (long)tb.time + ms / 1000;
+	deadline.tv_nsec = (tb.millitm + ms % 1000) * 1000000L;
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	deadline.tv_sec  = tv.tv_sec + ms / 1000;
+	deadline.tv_nsec = tv.tv_usec * 1000L + (ms % 1000) * 1000000L;
+#endif // WIN32
+	if (deadline.tv_nsec >= 1000000000L)
+	{
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000L;
+	}
+
+	MUTEX_LOCK(&mutex);
+	while (completed < count)
+	{
+		if (pthread_cond_timedwait(&done_cv, &mutex, &deadline))
+			break;
+	}
+	bool done = (completed >= count);
+	MUTEX_UNLOCK(&mutex);
+	return done;
+}
+
+int ThreadPool::getCompleted()
+{
+	MUTEX_LOCK(&mutex);
+	int res = completed;
+	MUTEX_UNLOCK(&mutex);
+	return res;
+}
+
+void ThreadPool::parallelFor(int _count, job_fn_t _fn, void *_userdata)
+{
+	if (_count <= 0) return;
+	start(_count, _fn, _userdata);
+	// help out instead of just waiting
+	while (runNextJob());
+	while (!waitFor(1000));
+}
+
+bool ThreadPool::runNextJob()
+{
+	MUTEX_LOCK(&mutex);
+	if (!fn || next >= count)
+	{
+		MUTEX_UNLOCK(&mutex);
+		return false;
+	}
+	int index = next++;
+	job_fn_t jobfn = fn;
+	void *jobdata = userdata;
+	MUTEX_UNLOCK(&mutex);
+
+	jobfn(jobdata, index);
+
+	MUTEX_LOCK(&mutex);
+	completed++;
+	if (completed >= count)
+		pthread_cond_broadcast(&done_cv);
+	MUTEX_UNLOCK(&mutex);
+	return true;
+}
+
+void ThreadPool::workerThread()
+{
+	MUTEX_LOCK(&mutex);
+	while (!shutdown)
+	{
+		if (fn && next < count)
+		{
+			MUTEX_UNLOCK(&mutex);
+			runNextJob();
+			MUTEX_LOCK(&mutex);
+			continue;
+		}
+		pthread_cond_wait(&work_cv, &mutex);
+	}
+	MUTEX_UNLOCK(&mutex);
+}
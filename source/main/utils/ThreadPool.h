@@ -0,0 +1,73 @@
+/*
+This source file is part of Rigs of Rods
+Copyright 2005-2012 Pierre-Michel Ricordel
+Copyright 2007-2012 Thomas Fischer
+
+For more information, see http://www.rigsofrods.com/
+
+Rigs of Rods is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 3, as
+published by the Free Software Foundation.
+
+Rigs of Rods is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __ThreadPool_H_
+#define __ThreadPool_H_
+
+#include "RoRPrerequisites.h"
+
+#include <pthread.h>
+
+/**
+ * Small pool of worker threads that runs one batch of independent jobs at a time.
+ * A job is a plain function that gets called once for every index of the batch,
+ * it must not touch Ogre resources or the scene, as those are not thread safe.
+ */
+class ThreadPool
+{
+public:
+	typedef void (*job_fn_t)(void *userdata, int index);
+
+	// threads <= 0 uses one thread per cpu
+	ThreadPool(int threads=0);
+	~ThreadPool();
+
+	// runs fn(userdata, i) for every i in [0, count) and blocks until all are done, the calling thread helps out
+	void parallelFor(int count, job_fn_t fn, void *userdata);
+
+	// starts a batch and returns immediately, use waitFor() to wait for it (i.e. to update a progress bar meanwhile).
+	// If the previous batch is still running, this blocks until it is finished, so never call it from a job.
+	void start(int count, job_fn_t fn, void *userdata);
+	// waits up to ms milliseconds, returns true if the batch is finished
+	bool waitFor(unsigned int ms);
+	int getCompleted();
+
+	int getThreadCount() { return (int)threads.size(); };
+	static int getCPUCount();
+
+	void workerThread();
+
+protected:
+	std::vector<pthread_t> threads;
+	pthread_mutex_t mutex;
+	pthread_cond_t work_cv;
+	pthread_cond_t done_cv;
+
+	// the current batch, guarded by the mutex
+	job_fn_t fn;
+	void *userdata;
+	int count;
+	int next;
+	int completed;
+	bool shutdown;
+
+	bool runNextJob();
+};
+
+#endif // __ThreadPool_H_
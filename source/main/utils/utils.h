@@ -36,6 +36,13 @@ along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
 # include <windows.h> // Sleep()
 #endif // WIN32
 
+// full memory barrier, a lock-free producer uses it to finish writing an entry before it publishes it
+#if WIN32
+# define MEMORY_BARRIER() MemoryBarrier()
+#else
+# define MEMORY_BARRIER() __sync_synchronize()
+#endif // WIN32
+
 
 // from http://stahlforce.com/dev/index.php?tool=csc01
 Ogre::String hexdump(void *pAddressIn, long  lSize);
@@ -0,0 +1,461 @@
+/*
+This source file is part of Rigs of Rods
+Copyright 2005-2012 Pierre-Michel Ricordel
+Copyright 2007-2012 Thomas Fischer
+
+For more information, see http://www.rigsofrods.com/
+
+Rigs of Rods is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 3, as
+published by the Free Software Foundation.
+
+Rigs of Rods is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "LoadClient.h"
+
+#include <math.h>
+
+// mirror of Character::pos_netdata_t, keep in sync
+typedef struct nlg_character_pos_t
+{
+	int command;
+	float posx, posy, posz;
+	float rotx, roty, rotz, rotw;
+	char animationMode[256];
+	float animationTime;
+} nlg_character_pos_t;
+
+void *s_loadclientsendthread(void *vclient)
+{
+	((LoadClient *)vclient)->sendThread();
+	return NULL;
+}
+
+void *s_loadclientreceivethread(void *vclient)
+{
+	((LoadClient *)vclient)->receiveThread();
+	return NULL;
+}
+
+LoadClient::LoadClient(int number, load_client_config_t *cfg) :
+	  number(number)
+	, uid(0)
+	, connected(false)
+	, shutdown(false)
+	, cfg(cfg)
+	, bytes_sent(0)
+	, bytes_recv(0)
+	, start_time(0)
+{
+	pthread_mutex_init(&send_mutex, NULL);
+}
+
+LoadClient::~LoadClient()
+{
+	disconnect();
+	pthread_mutex_destroy(&send_mutex);
+}
+
+int LoadClient::send(int command, unsigned int streamid, unsigned int len, const char *content)
+{
+	bytes_sent += sizeof(header_t) + len;
+	return nlgSendMessage(&socket, &send_mutex, command, uid, streamid, len, content);
+}
+
+bool LoadClient::connect()
+{
+	SWBaseSocket::SWBaseError error;
+	socket.set_timeout(10, 10000);
+	socket.connect(cfg->port, cfg->host, &error);
+	if (error != SWBaseSocket::ok)
+	{
+		printf("client %d: unable to connect to %s:%d\n", number, cfg->host.c_str(), cfg->port);
+		return false;
+	}
+
+	header_t header;
+	char buffer[MAX_MESSAGE_LENGTH];
+	if (send(MSG2_HELLO, 0, (unsigned int)strlen(RORNET_VERSION), RORNET_VERSION) || nlgReceiveMessage(&socket, &header, buffer) || header.command != MSG2_HELLO)
+	{
+		printf("client %d: server hello failed\n", number);
+		return false;
+	}
+
+	user_info_t c;
+	memset(&c, 0, sizeof(user_info_t));
+	sprintf((char *)c.username, "loadgen_%03d", number);
+	strcpy(c.clientname, "netloadgen");
+	strcpy(c.language, "en");
+	strcpy(c.sessiontype, "bot");
+	if (send(MSG2_USER_INFO, 0, sizeof(user_info_t), (char *)&c) || nlgReceiveMessage(&socket, &header, buffer))
+	{
+		printf("client %d: sending user info failed\n", number);
+		return false;
+	}
+	if (header.command != MSG2_WELCOME)
+	{
+		printf("client %d: not welcome, server answered with command %d\n", number, header.command);
+		return false;
+	}
+	uid = header.source;
+	socket.set_timeout(0, 0);
+	connected  = true;
+	start_time = nlgGetTime();
+
+	pthread_create(&receivethread, NULL, s_loadclientreceivethread, (void *)this);
+	registerStreams();
+	pthread_create(&sendthread, NULL, s_loadclientsendthread, (void *)this);
+	return true;
+}
+
+void LoadClient::disconnect()
+{
+	if (!connected) return;
+	shutdown = true;
+	pthread_join(sendthread, NULL);
+	send(MSG2_USER_LEAVE, 0, 0, 0);
+
+	SWBaseSocket::SWBaseError error;
+	socket.set_timeout(1, 1000);
+	socket.disconnect(&error);
+	pthread_join(receivethread, NULL);
+	connected = false;
+}
+
+void LoadClient::registerStreams()
+{
+	// stream ids are counted from 10 upwards, as the NetworkStreamManager does
+	unsigned int streamid = 10;
+
+	if (cfg->with_character)
+	{
+		stream_register_t reg;
+		memset(&reg, 0, sizeof(reg));
+		reg.status          = 1;
+		reg.type            = 1;
+		reg.data[0]         = 2;
+		reg.origin_sourceid = uid;
+		reg.origin_streamid = streamid;
+		strcpy(reg.name, "default");
+		send(MSG2_STREAM_REGISTER, streamid++, sizeof(reg), (char *)&reg);
+	}
+
+	if (cfg->replay)
+	{
+		// register every truck stream of the recording as one of ours
+		for (size_t i = 0; i < cfg->replay->size(); i++)
+		{
+			recorded_packet_t &p = (*cfg->replay)[i];
+			if (p.header.command != MSG2_STREAM_REGISTER) continue;
+
+			stream_register_trucks_t reg;
+			memset(&reg, 0, sizeof(reg));
+			memcpy(&reg, &p.data[0], std::min<size_t>(sizeof(reg), p.data.size()));
+			reg.status          = 0;
+			reg.origin_sourceid = uid;
+			reg.origin_streamid = streamid;
+			replayStreams.push_back(std::make_pair(p.header.source, p.header.streamid));
+			send(MSG2_STREAM_REGISTER, streamid++, sizeof(reg), (char *)&reg);
+		}
+	} else if (cfg->with_truck)
+	{
+		// see Beam::sendStreamSetup
+		stream_register_trucks_t reg;
+		memset(&reg, 0, sizeof(reg));
+		reg.status          = 0;
+		reg.type            = 0;
+		reg.bufferSize      = sizeof(float) * 3 + (cfg->nodes - 1) * sizeof(short int) * 3 + cfg->wheels * sizeof(float);
+		reg.origin_sourceid = uid;
+		reg.origin_streamid = streamid;
+		strncpy(reg.name, cfg->truck.c_str(), 127);
+		send(MSG2_STREAM_REGISTER, streamid++, sizeof(reg), (char *)&reg);
+	}
+}
+
+void LoadClient::sendTruckData(unsigned int streamid, float t)
+{
+	// see Beam::sendStreamData for the layout
+	char buffer[MAX_MESSAGE_LENGTH];
+	memset(buffer, 0, MAX_MESSAGE_LENGTH);
+
+	oob_t *oob = (oob_t *)buffer;
+	oob->time          = (int)(t * 1000.0f);
+	oob->engine_speed  = 1500.0f + 500.0f * sinf(t);
+	oob->engine_force  = 0.5f;
+	oob->engine_clutch = 1.0f;
+	oob->engine_gear   = 2;
+	oob->hydrodirstate = 0.2f * sinf(t * 0.5f);
+	oob->wheelspeed    = 10.0f;
+	oob->flagmask      = NETMASK_ENGINE_CONT + NETMASK_ENGINE_RUN + NETMASK_ENGINE_MODE_AUTOMATIC + NETMASK_LIGHTS;
+
+	// every user drives on its own circle around the spawn area
+	float radius  = 20.0f + number * 4.0f;
+	float angle   = t * 10.0f / radius;
+	float heading = angle + 1.5708f;
+	float cx = 1000.0f + radius * cosf(angle);
+	float cz = 1000.0f + radius * sinf(angle);
+
+	float *refpos = (float *)(buffer + sizeof(oob_t));
+	refpos[0] = cx;
+	refpos[1] = 10.0f;
+	refpos[2] = cz;
+
+	// lay the nodes out as a 2m x 5m x 2m box
+	short *sbuf = (short *)(buffer + sizeof(oob_t) + sizeof(float) * 3);
+	for (int i = 1; i < cfg->nodes; i++)
+	{
+		float lx = 2.0f * (float)(i % 3) / 2.0f - 1.0f;
+		float ly = 2.0f * (float)((i / 3) % 2);
+		float lz = 5.0f * (float)(i / 6) / (float)std::max(1, (cfg->nodes - 1) / 6) - 2.5f;
+		float rx = lx * cosf(heading) - lz * sinf(heading);
+		float rz = lx * sinf(heading) + lz * cosf(heading);
+		sbuf[(i - 1) * 3 + 0] = (short int)(rx * 300.0f);
+		sbuf[(i - 1) * 3 + 1] = (short int)(ly * 300.0f);
+		sbuf[(i - 1) * 3 + 2] = (short int)(rz * 300.0f);
+	}
+
+	float *wfbuf = (float *)(sbuf + std::max(0, cfg->nodes - 1) * 3);
+	for (int i = 0; i < cfg->wheels; i++)
+		wfbuf[i] = t * 10.0f;
+
+	unsigned int len = sizeof(oob_t) + sizeof(float) * 3 + std::max(0, cfg->nodes - 1) * sizeof(short int) * 3 + cfg->wheels * sizeof(float);
+	send(MSG2_STREAM_DATA, streamid, len, buffer);
+}
+
+void LoadClient::sendCharacterData(unsigned int streamid, float t)
+{
+	// see Character::sendStreamData
+	nlg_character_pos_t data;
+	memset(&data, 0, sizeof(data));
+	float radius = 10.0f + number * 2.0f;
+	float angle  = t * 1.5f / radius;
+	data.command = 0; // CHARCMD_POSITION
+	data.posx = 1000.0f + radius * cosf(angle);
+	data.posy = 10.0f;
+	data.posz = 1000.0f + radius * sinf(angle);
+	data.rotx = 0.0f;
+	data.roty = sinf(-angle * 0.5f);
+	data.rotz = 0.0f;
+	data.rotw = cosf(-angle * 0.5f);
+	strcpy(data.animationMode, "Walk");
+	data.animationTime = fmodf(t, 1.0f);
+	send(MSG2_STREAM_DATA, streamid, sizeof(data), (char *)&data);
+}
+
+void LoadClient::replayPackets(float t, size_t &pos, unsigned long &loop_start)
+{
+	std::vector<recorded_packet_t> &rec = *cfg->replay;
+	if (rec.empty()) return;
+
+	unsigned int now = (unsigned int)((t * 1000.0f) - loop_start);
+	while (pos < rec.size() && rec[pos].time <= now)
+	{
+		recorded_packet_t &p = rec[pos++];
+		if (p.header.command != MSG2_STREAM_DATA) continue;
+
+		for (size_t i = 0; i < replayStreams.size(); i++)
+		{
+			if (replayStreams[i].first != p.header.source || replayStreams[i].second != p.header.streamid) continue;
+
+			// keep the remote time monotonic across loops
+			std::vector<char> data = p.data;
+			if (data.size() >= sizeof(oob_t))
+				((oob_t *)&data[0])->time = (int)(t * 1000.0f);
+			send(MSG2_STREAM_DATA, 10 + (cfg->with_character ? 1 : 0) + (unsigned int)i, (unsigned int)data.size(), &data[0]);
+			break;
+		}
+	}
+
+	if (pos >= rec.size())
+	{
+		// loop the recording
+		pos = 0;
+		loop_start = (unsigned long)(t * 1000.0f);
+	}
+}
+
+void LoadClient::sendThread()
+{
+	unsigned int character_stream = 10;
+	unsigned int truck_stream = cfg->with_character ? 11 : 10;
+
+	float truck_interval     = 1.0f / std::max(0.1f, cfg->truck_rate);
+	float character_interval = 1.0f / std::max(0.1f, cfg->character_rate);
+	// spread the users a bit so they do not all send in the same millisecond
+	float next_truck     = (number % 10) * 0.01f;
+	float next_character = next_truck;
+
+	size_t replay_pos = 0;
+	unsigned long replay_loop_start = 0;
+
+	while (!shutdown)
+	{
+		float t = (nlgGetTime() - start_time) / 1000.0f;
+
+		if (cfg->replay)
+		{
+			replayPackets(t, replay_pos, replay_loop_start);
+		} else if (cfg->with_truck && t >= next_truck)
+		{
+			sendTruckData(truck_stream, t);
+			next_truck += truck_interval;
+		}
+
+		if (cfg->with_character && t >= next_character)
+		{
+			sendCharacterData(character_stream, t);
+			next_character += character_interval;
+		}
+
+		nlgSleep(5);
+	}
+}
+
+void LoadClient::receiveThread()
+{
+	header_t header;
+	char *buffer = (char *)malloc(MAX_MESSAGE_LENGTH);
+	while (!shutdown)
+	{
+		if (nlgReceiveMessage(&socket, &header, buffer))
+			break;
+		bytes_recv += sizeof(header_t) + header.size;
+
+		// acknowledge remote streams, like the game does after creating the instance
+		if (header.command == MSG2_STREAM_REGISTER && header.source != uid)
+		{
+			stream_register_t *reg = (stream_register_t *)buffer;
+			reg->status = 1;
+			send(MSG2_STREAM_REGISTER_RESULT, 0, sizeof(stream_register_t), (char *)reg);
+		}
+	}
+	free(buffer);
+}
+
+int recordStreams(std::string host, int port, std::string filename, int seconds)
+{
+	FILE *file = fopen(filename.c_str(), "wb");
+	if (!file)
+	{
+		printf("error opening output file: %s\n", filename.c_str());
+		return 1;
+	}
+	fwrite(NLG_RECORD_MAGIC, 1, 8, file);
+
+	SWInetSocket socket;
+	SWBaseSocket::SWBaseError error;
+	socket.set_timeout(10, 10000);
+	socket.connect(port, host, &error);
+	if (error != SWBaseSocket::ok)
+	{
+		printf("unable to connect to %s:%d\n", host.c_str(), port);
+		fclose(file);
+		return 1;
+	}
+
+	header_t header;
+	char *buffer = (char *)malloc(MAX_MESSAGE_LENGTH);
+	nlgSendMessage(&socket, 0, MSG2_HELLO, 0, 0, (unsigned int)strlen(RORNET_VERSION), RORNET_VERSION);
+	if (nlgReceiveMessage(&socket, &header, buffer) || header.command != MSG2_HELLO)
+	{
+		printf("server hello failed\n");
+		free(buffer);
+		fclose(file);
+		return 1;
+	}
+	user_info_t c;
+	memset(&c, 0, sizeof(user_info_t));
+	strcpy((char *)c.username, "loadgen_recorder");
+	strcpy(c.clientname, "netloadgen");
+	strcpy(c.sessiontype, "bot");
+	nlgSendMessage(&socket, 0, MSG2_USER_INFO, 0, 0, sizeof(user_info_t), (char *)&c);
+	if (nlgReceiveMessage(&socket, &header, buffer) || header.command != MSG2_WELCOME)
+	{
+		printf("not welcome on the server\n");
+		free(buffer);
+		fclose(file);
+		return 1;
+	}
+	int uid = header.source;
+	// blocking reads that give up after a second, so the duration is checked even if nothing is sent
+	socket.set_timeout(1, 0);
+
+	// only truck streams are recorded, characters are synthesized anyway
+	std::vector< std::pair<int, unsigned int> > truckStreams;
+	unsigned long start = nlgGetTime();
+	int count = 0;
+	while (nlgGetTime() - start < (unsigned long)seconds * 1000)
+	{
+		int res = nlgReceiveMessage(&socket, &header, buffer);
+		if (res == NLG_RECV_TIMEOUT)
+			continue;
+		if (res)
+		{
+			printf("connection to the server lost\n");
+			break;
+		}
+
+		bool record = false;
+		if (header.command == MSG2_STREAM_REGISTER && ((stream_register_t *)buffer)->type == 0)
+		{
+			truckStreams.push_back(std::make_pair(header.source, header.streamid));
+			record = true;
+		}
+		else if (header.command == MSG2_STREAM_DATA)
+		{
+			record = std::find(truckStreams.begin(), truckStreams.end(), std::make_pair(header.source, header.streamid)) != truckStreams.end();
+		}
+		if (!record) continue;
+
+		unsigned int t = (unsigned int)(nlgGetTime() - start);
+		fwrite(&t, sizeof(unsigned int), 1, file);
+		fwrite(&header, sizeof(header_t), 1, file);
+		fwrite(buffer, 1, header.size, file);
+		count++;
+	}
+
+	nlgSendMessage(&socket, 0, MSG2_USER_LEAVE, uid, 0, 0, 0);
+	socket.disconnect(&error);
+	free(buffer);
+	fclose(file);
+	printf("recorded %d packets of %d truck streams into %s\n", count, (int)truckStreams.size(), filename.c_str());
+	return 0;
+}
+
+bool loadRecording(std::string filename, std::vector<recorded_packet_t> &packets)
+{
+	FILE *file = fopen(filename.c_str(), "rb");
+	if (!file)
+	{
+		printf("error opening recording: %s\n", filename.c_str());
+		return false;
+	}
+
+	char magic[9] = "";
+	if (fread(magic, 1, 8, file) != 8 || strncmp(magic, NLG_RECORD_MAGIC, 8))
+	{
+		printf("unsupported recording format: %s\n", filename.c_str());
+		fclose(file);
+		return false;
+	}
+
+	recorded_packet_t p;
+	while (fread(&p.time, sizeof(unsigned int), 1, file) == 1 && fread(&p.header, sizeof(header_t), 1, file) == 1)
+	{
+		if (p.header.size >= MAX_MESSAGE_LENGTH)
+			break;
+		p.data.resize(p.header.size);
+		if (p.header.size && fread(&p.data[0], 1, p.header.size, file) != p.header.size)
+			break;
+		packets.push_back(p);
+	}
+	fclose(file);
+	printf("loaded %d packets from %s\n", (int)packets.size(), filename.c_str());
+	return !packets.empty();
+}
@@ -0,0 +1,106 @@
+/*
+This source file is part of Rigs of Rods
+Copyright 2005-2012 Pierre-Michel Ricordel
+Copyright 2007-2012 Thomas Fischer
+
+For more information, see http://www.rigsofrods.com/
+
+Rigs of Rods is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 3, as
+published by the Free Software Foundation.
+
+Rigs of Rods is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __LoadClient_H_
+#define __LoadClient_H_
+
+#include "NetLoadUtils.h"
+
+#include <string>
+#include <vector>
+
+// recording file layout: NLG_RECORD_MAGIC, then for every packet:
+// unsigned int time offset in ms, header_t, header.size bytes of payload
+#define NLG_RECORD_MAGIC "RORNLG01"
+
+typedef struct recorded_packet_t
+{
+	unsigned int time;
+	header_t header;
+	std::vector<char> data;
+} recorded_packet_t;
+
+typedef struct load_client_config_t
+{
+	std::string host;
+	int port;
+	std::string truck;       //!< truck filename that is registered, must exist in the cache of the profiled client
+	int nodes;               //!< number of non-wheel nodes of that truck (first_wheel_node)
+	int wheels;              //!< number of wheels of that truck
+	float truck_rate;        //!< truck packets per second
+	float character_rate;    //!< character packets per second
+	bool with_truck;
+	bool with_character;
+	std::vector<recorded_packet_t> *replay; //!< if set, truck streams from this recording are replayed
+} load_client_config_t;
+
+/**
+ * Headless fake user: connects to a server, registers truck and character streams
+ * the same way Beam::sendStreamSetup and Character::sendStreamSetup do, and sends synthetic
+ * or recorded stream data at the configured rate.
+ */
+class LoadClient
+{
+public:
+	LoadClient(int number, load_client_config_t *cfg);
+	~LoadClient();
+
+	bool connect();
+	void disconnect();
+	bool isConnected() { return connected; };
+
+	void sendThread();
+	void receiveThread();
+
+	unsigned long getBytesSent() { return bytes_sent; };
+	unsigned long getBytesReceived() { return bytes_recv; };
+
+protected:
+	int number;
+	int uid;
+	bool connected;
+	bool shutdown;
+	load_client_config_t *cfg;
+	SWInetSocket socket;
+	pthread_t sendthread, receivethread;
+	pthread_mutex_t send_mutex;
+	unsigned long bytes_sent, bytes_recv;
+	unsigned long start_time;
+
+	// mapping of recorded (source, stream) pairs to our own stream ids
+	std::vector< std::pair<int, unsigned int> > replayStreams;
+
+	int send(int command, unsigned int streamid, unsigned int len, const char *content);
+	void registerStreams();
+	void sendTruckData(unsigned int streamid, float t);
+	void sendCharacterData(unsigned int streamid, float t);
+	void replayPackets(float t, size_t &pos, unsigned long &loop_start);
+};
+
+/**
+ * Connects to a server and writes all received truck registrations and truck stream data into a recording file.
+ */
+int recordStreams(std::string host, int port, std::string filename, int seconds);
+
+/**
+ * Loads a recording file written by recordStreams, returns false on error.
+ */
+bool loadRecording(std::string filename, std::vector<recorded_packet_t> &packets);
+
+#endif // __LoadClient_H_
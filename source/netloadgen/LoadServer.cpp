@@ -0,0 +1,402 @@
+/*
+This source file is part of Rigs of Rods
+Copyright 2005-2012 Pierre-Michel Ricordel
+Copyright 2007-2012 Thomas Fischer
+
+For more information, see http://www.rigsofrods.com/
+
+Rigs of Rods is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 3, as
+published by the Free Software Foundation.
+
+Rigs of Rods is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "LoadServer.h"
+
+struct server_thread_arg_t
+{
+	LoadServer *server;
+	int slot;
+};
+
+void *s_serverclientthread(void *varg)
+{
+	server_thread_arg_t *arg = (server_thread_arg_t *)varg;
+	arg->server->clientThread(arg->slot);
+	delete arg;
+	return NULL;
+}
+
+void *s_serversendthread(void *varg)
+{
+	server_thread_arg_t *arg = (server_thread_arg_t *)varg;
+	arg->server->sendThread(arg->slot);
+	delete arg;
+	return NULL;
+}
+
+LoadServer::LoadServer(int port, std::string terrain) :
+	  port(port)
+	, terrain(terrain)
+	, shutdown(false)
+	, next_uid(1)
+	, stats_time(0)
+{
+	pthread_mutex_init(&clients_mutex, NULL);
+	for (int i = 0; i < MAX_PEERS; i++)
+	{
+		clients[i].used       = false;
+		clients[i].ready      = false;
+		clients[i].has_thread = false;
+		clients[i].closing    = false;
+		clients[i].socket     = 0;
+		clients[i].dropped    = 0;
+		pthread_mutex_init(&clients[i].send_mutex, NULL);
+		pthread_cond_init(&clients[i].send_cond, NULL);
+	}
+}
+
+LoadServer::~LoadServer()
+{
+	stop();
+
+	// wake up the client threads that wait for data, they clean up their slots
+	pthread_mutex_lock(&clients_mutex);
+	for (int i = 0; i < MAX_PEERS; i++)
+	{
+		if (!clients[i].used || !clients[i].socket) continue;
+		SWBaseSocket::SWBaseError error;
+		clients[i].socket->disconnect(&error);
+	}
+	pthread_mutex_unlock(&clients_mutex);
+
+	for (int i = 0; i < MAX_PEERS; i++)
+	{
+		if (clients[i].has_thread)
+			pthread_join(clients[i].thread, NULL);
+		clients[i].has_thread = false;
+		pthread_cond_destroy(&clients[i].send_cond);
+		pthread_mutex_destroy(&clients[i].send_mutex);
+	}
+	pthread_mutex_destroy(&clients_mutex);
+}
+
+bool LoadServer::start()
+{
+	SWBaseSocket::SWBaseError error;
+	listener.bind(port, &error);
+	if (error != SWBaseSocket::ok)
+	{
+		printf("server: unable to bind to port %d\n", port);
+		return false;
+	}
+	listener.listen(MAX_PEERS, &error);
+	if (error != SWBaseSocket::ok)
+	{
+		printf("server: unable to listen on port %d\n", port);
+		return false;
+	}
+	printf("server: listening on port %d, terrain '%s'\n", port, terrain.c_str());
+	return true;
+}
+
+void LoadServer::run()
+{
+	SWBaseSocket::SWBaseError error;
+	while (!shutdown)
+	{
+		SWBaseSocket *socket = listener.accept(&error);
+		if (!socket || error != SWBaseSocket::ok)
+			continue;
+
+		pthread_mutex_lock(&clients_mutex);
+		int slot = -1;
+		for (int i = 0; i < MAX_PEERS; i++)
+		{
+			if (!clients[i].used)
+			{
+				slot = i;
+				break;
+			}
+		}
+		if (slot < 0)
+		{
+			pthread_mutex_unlock(&clients_mutex);
+			nlgSendMessage(socket, 0, MSG2_FULL, -1, 0, 0, 0);
+			socket->disconnect(&error);
+			delete socket;
+			continue;
+		}
+		client_slot_t &c = clients[slot];
+		c.used = true;
+		pthread_mutex_unlock(&clients_mutex);
+
+		// the last user of the slot left, but its thread may still be returning
+		if (c.has_thread)
+			pthread_join(c.thread, NULL);
+		c.has_thread = false;
+
+		pthread_mutex_lock(&clients_mutex);
+		c.ready      = false;
+		c.closing    = false;
+		c.socket     = socket;
+		c.bytes_in   = 0;
+		c.packets_in = 0;
+		c.dropped    = 0;
+		c.streams.clear();
+		c.send_queue.clear();
+		memset(&c.user, 0, sizeof(user_info_t));
+		pthread_mutex_unlock(&clients_mutex);
+
+		server_thread_arg_t *arg = new server_thread_arg_t;
+		arg->server = this;
+		arg->slot   = slot;
+		pthread_create(&c.thread, NULL, s_serverclientthread, (void *)arg);
+		c.has_thread = true;
+	}
+}
+
+void LoadServer::stop()
+{
+	if (shutdown) return;
+	shutdown = true;
+	SWBaseSocket::SWBaseError error;
+	listener.disconnect(&error);
+}
+
+bool LoadServer::handshake(int slot)
+{
+	client_slot_t *c = &clients[slot];
+	header_t header;
+	char buffer[MAX_MESSAGE_LENGTH];
+
+	if (nlgReceiveMessage(c->socket, &header, buffer) || header.command != MSG2_HELLO)
+		return false;
+
+	if (strncmp(buffer, RORNET_VERSION, strlen(RORNET_VERSION)))
+	{
+		queue(slot, MSG2_WRONG_VER, -1, 0, 0, 0);
+		return false;
+	}
+
+	server_info_t info;
+	memset(&info, 0, sizeof(server_info_t));
+	strncpy(info.protocolversion, RORNET_VERSION, sizeof(info.protocolversion) - 1);
+	strncpy(info.terrain, terrain.c_str(), sizeof(info.terrain) - 1);
+	strncpy(info.servername, "netloadgen", sizeof(info.servername) - 1);
+	queue(slot, MSG2_HELLO, -1, 0, sizeof(server_info_t), (char *)&info);
+
+	if (nlgReceiveMessage(c->socket, &header, buffer) || header.command != MSG2_USER_INFO)
+		return false;
+
+	pthread_mutex_lock(&clients_mutex);
+	memcpy(&c->user, buffer, std::min<unsigned int>(sizeof(user_info_t), header.size));
+	c->user.uniqueid   = next_uid++;
+	c->user.colournum  = c->user.uniqueid % 8;
+	c->user.authstatus = AUTH_NONE;
+	pthread_mutex_unlock(&clients_mutex);
+
+	queue(slot, MSG2_WELCOME, c->user.uniqueid, 0, sizeof(user_info_t), (char *)&c->user);
+	return true;
+}
+
+void LoadServer::clientThread(int slot)
+{
+	client_slot_t *c = &clients[slot];
+
+	// everything this client is sent goes through its own thread
+	server_thread_arg_t *arg = new server_thread_arg_t;
+	arg->server = this;
+	arg->slot   = slot;
+	pthread_create(&c->send_thread, NULL, s_serversendthread, (void *)arg);
+
+	if (!handshake(slot))
+	{
+		printf("server: handshake with slot %d failed\n", slot);
+		disconnectClient(slot);
+		return;
+	}
+	int uid = c->user.uniqueid;
+	printf("server: user %d joined: %s\n", uid, (char *)c->user.username);
+
+	// tell everyone about the new user and the new user about everyone, including their streams
+	pthread_mutex_lock(&clients_mutex);
+	for (int i = 0; i < MAX_PEERS; i++)
+	{
+		if (i == slot || !clients[i].used || !clients[i].ready) continue;
+		queue(i, MSG2_USER_JOIN, uid, 0, sizeof(user_info_t), (char *)&c->user);
+		queue(slot, MSG2_USER_INFO, clients[i].user.uniqueid, 0, sizeof(user_info_t), (char *)&clients[i].user);
+
+		std::map<unsigned int, std::vector<char> >::iterator it;
+		for (it = clients[i].streams.begin(); it != clients[i].streams.end(); it++)
+			queue(slot, MSG2_STREAM_REGISTER, clients[i].user.uniqueid, it->first, (unsigned int)it->second.size(), &it->second[0]);
+	}
+	c->ready = true;
+	pthread_mutex_unlock(&clients_mutex);
+	queue(slot, MSG2_USER_INFO, uid, 0, sizeof(user_info_t), (char *)&c->user);
+
+	header_t header;
+	char *buffer = (char *)malloc(MAX_MESSAGE_LENGTH);
+	while (!shutdown)
+	{
+		if (nlgReceiveMessage(c->socket, &header, buffer))
+			break;
+
+		c->bytes_in += sizeof(header_t) + header.size;
+		c->packets_in++;
+
+		if (header.command == MSG2_USER_LEAVE)
+			break;
+
+		if (header.command == MSG2_STREAM_REGISTER)
+		{
+			pthread_mutex_lock(&clients_mutex);
+			c->streams[header.streamid] = std::vector<char>(buffer, buffer + header.size);
+			pthread_mutex_unlock(&clients_mutex);
+		}
+		else if (header.command == MSG2_STREAM_REGISTER_RESULT)
+		{
+			// only the origin of the stream is interested in the result
+			stream_register_t *reg = (stream_register_t *)buffer;
+			pthread_mutex_lock(&clients_mutex);
+			for (int i = 0; i < MAX_PEERS; i++)
+			{
+				if (clients[i].used && clients[i].ready && (int)clients[i].user.uniqueid == reg->origin_sourceid)
+					queue(i, header.command, uid, header.streamid, header.size, buffer);
+			}
+			pthread_mutex_unlock(&clients_mutex);
+			continue;
+		}
+
+		// everything else is relayed to all other users
+		broadcast(slot, header.command, uid, header.streamid, header.size, buffer);
+		printStats();
+	}
+	free(buffer);
+
+	printf("server: user %d left\n", uid);
+	broadcast(slot, MSG2_USER_LEAVE, uid, 0, 0, 0);
+	disconnectClient(slot);
+}
+
+void LoadServer::sendThread(int slot)
+{
+	client_slot_t *c = &clients[slot];
+	while (true)
+	{
+		pthread_mutex_lock(&c->send_mutex);
+		while (c->send_queue.empty() && !c->closing)
+			pthread_cond_wait(&c->send_cond, &c->send_mutex);
+		if (c->send_queue.empty())
+		{
+			// closing and everything was sent
+			pthread_mutex_unlock(&c->send_mutex);
+			break;
+		}
+		queued_message_t msg;
+		msg.command  = c->send_queue.front().command;
+		msg.source   = c->send_queue.front().source;
+		msg.streamid = c->send_queue.front().streamid;
+		msg.content.swap(c->send_queue.front().content);
+		c->send_queue.pop_front();
+		pthread_mutex_unlock(&c->send_mutex);
+
+		// only this thread writes to the socket
+		if (nlgSendMessage(c->socket, 0, msg.command, msg.source, msg.streamid, (unsigned int)msg.content.size(), msg.content.empty() ? 0 : &msg.content[0]))
+			break;
+	}
+}
+
+void LoadServer::queue(int slot, int command, int source, unsigned int streamid, unsigned int len, const char *content)
+{
+	client_slot_t &c = clients[slot];
+	pthread_mutex_lock(&c.send_mutex);
+	if (c.closing)
+	{
+		pthread_mutex_unlock(&c.send_mutex);
+		return;
+	}
+	if (c.send_queue.size() >= NLG_SEND_QUEUE)
+	{
+		// the client does not keep up, the others are not slowed down by it
+		c.dropped++;
+		pthread_mutex_unlock(&c.send_mutex);
+		return;
+	}
+	c.send_queue.push_back(queued_message_t());
+	queued_message_t &msg = c.send_queue.back();
+	msg.command  = command;
+	msg.source   = source;
+	msg.streamid = streamid;
+	if (len)
+		msg.content.assign(content, content + len);
+	pthread_cond_signal(&c.send_cond);
+	pthread_mutex_unlock(&c.send_mutex);
+}
+
+void LoadServer::broadcast(int except_slot, int command, int source, unsigned int streamid, unsigned int len, const char *content)
+{
+	// only queues, so the lock is never held across a send
+	pthread_mutex_lock(&clients_mutex);
+	for (int i = 0; i < MAX_PEERS; i++)
+	{
+		if (i == except_slot || !clients[i].used || !clients[i].ready) continue;
+		queue(i, command, source, streamid, len, content);
+	}
+	pthread_mutex_unlock(&clients_mutex);
+}
+
+void LoadServer::disconnectClient(int slot)
+{
+	client_slot_t &c = clients[slot];
+	pthread_mutex_lock(&clients_mutex);
+	c.ready = false;
+	pthread_mutex_unlock(&clients_mutex);
+
+	// let the sending thread write what is left, then close the socket
+	pthread_mutex_lock(&c.send_mutex);
+	c.closing = true;
+	pthread_cond_signal(&c.send_cond);
+	pthread_mutex_unlock(&c.send_mutex);
+	pthread_join(c.send_thread, NULL);
+
+	pthread_mutex_lock(&clients_mutex);
+	if (c.socket)
+	{
+		SWBaseSocket::SWBaseError error;
+		c.socket->disconnect(&error);
+		delete c.socket;
+		c.socket = 0;
+	}
+	c.used  = false;
+	c.streams.clear();
+	c.send_queue.clear();
+	pthread_mutex_unlock(&clients_mutex);
+}
+
+void LoadServer::printStats()
+{
+	unsigned long t = nlgGetTime();
+	if (t - stats_time < 10000) return;
+	stats_time = t;
+
+	int users = 0;
+	unsigned long bytes = 0, packets = 0, dropped = 0;
+	pthread_mutex_lock(&clients_mutex);
+	for (int i = 0; i < MAX_PEERS; i++)
+	{
+		if (!clients[i].used) continue;
+		users++;
+		bytes   += clients[i].bytes_in;
+		packets += clients[i].packets_in;
+		dropped += clients[i].dropped;
+	}
+	pthread_mutex_unlock(&clients_mutex);
+	printf("server: %d users, %lu packets / %lu bytes received in total, %lu dropped for slow clients\n", users, packets, bytes, dropped);
+}
@@ -0,0 +1,96 @@
+/*
+This source file is part of Rigs of Rods
+Copyright 2005-2012 Pierre-Michel Ricordel
+Copyright 2007-2012 Thomas Fischer
+
+For more information, see http://www.rigsofrods.com/
+
+Rigs of Rods is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 3, as
+published by the Free Software Foundation.
+
+Rigs of Rods is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __LoadServer_H_
+#define __LoadServer_H_
+
+#include "NetLoadUtils.h"
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#define NLG_SEND_QUEUE 1024   //!< messages waiting for one client, newer ones are dropped beyond that
+
+/**
+ * Minimal stand-in for the multiplayer server.
+ * It performs the handshake of the real server, relays stream registrations and stream data
+ * between all connected clients and sends the known streams to late joiners.
+ * Every client has a receiving and a sending thread, relayed messages are queued for the sending
+ * thread, so a client that does not read only delays itself.
+ * There is no authentication, no chat handling and no flood protection.
+ */
+class LoadServer
+{
+public:
+	LoadServer(int port, std::string terrain);
+	~LoadServer();
+
+	bool start();
+	void run();
+	void stop();
+
+	void clientThread(int slot);
+	void sendThread(int slot);
+
+protected:
+	typedef struct queued_message_t
+	{
+		int command;
+		int source;
+		unsigned int streamid;
+		std::vector<char> content;
+	} queued_message_t;
+
+	typedef struct client_slot_t
+	{
+		bool used;
+		bool ready;
+		bool has_thread;              //!< thread has to be joined before the slot is used again
+		bool closing;                 //!< the sending thread stops once this is set
+		SWBaseSocket *socket;
+		pthread_t thread;
+		pthread_t send_thread;
+		pthread_mutex_t send_mutex;   //!< protects the queue and closing
+		pthread_cond_t send_cond;
+		std::deque<queued_message_t> send_queue;
+		user_info_t user;
+		std::map<unsigned int, std::vector<char> > streams; //!< registrations, resent to late joiners
+		unsigned long bytes_in, packets_in, dropped;
+	} client_slot_t;
+
+	int port;
+	std::string terrain;
+	bool shutdown;
+	int next_uid;
+	unsigned long stats_time;
+	SWInetSocket listener;
+	pthread_mutex_t clients_mutex;
+	client_slot_t clients[MAX_PEERS];
+
+	bool handshake(int slot);
+	void broadcast(int except_slot, int command, int source, unsigned int streamid, unsigned int len, const char *content);
+	// queues a message for the sending thread of the slot, never blocks on the socket
+	void queue(int slot, int command, int source, unsigned int streamid, unsigned int len, const char *content);
+	void disconnectClient(int slot);
+	void printStats();
+};
+
+#endif // __LoadServer_H_
@@ -0,0 +1,150 @@
+/*
+This source file is part of Rigs of Rods
+Copyright 2005-2012 Pierre-Michel Ricordel
+Copyright 2007-2012 Thomas Fischer
+
+For more information, see http://www.rigsofrods.com/
+
+Rigs of Rods is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 3, as
+published by the Free Software Foundation.
+
+Rigs of Rods is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __NetLoadUtils_H_
+#define __NetLoadUtils_H_
+
+#include "rornet.h"
+#include "SocketW.h"
+
+#include <algorithm>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+# include <windows.h>
+#else
+# include <sys/time.h>
+# include <unistd.h>
+#endif // _WIN32
+
+// small helpers shared by the stand-in server and the synthetic clients
+// they do not depend on Ogre, so the tool can run headless
+
+inline unsigned long nlgGetTime()
+{
+#ifdef _WIN32
+	return GetTickCount();
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000 + tv.tv_usec / 1000;
+#endif // _WIN32
+}
+
+inline void nlgSleep(unsigned int ms)
+{
+#ifdef _WIN32
+	Sleep(ms);
+#else
+	usleep(ms * 1000);
+#endif // _WIN32
+}
+
+/**
+ * Writes one protocol message (header_t + payload) to the socket, returns 0 on success.
+ * The mutex is optional and protects sockets that are written from several threads.
+ */
+inline int nlgSendMessage(SWBaseSocket *socket, pthread_mutex_t *mutex, int command, int source, unsigned int streamid, unsigned int len, const char *content)
+{
+	if (sizeof(header_t) + len >= MAX_MESSAGE_LENGTH)
+		return -2;
+
+	char buffer[MAX_MESSAGE_LENGTH];
+	header_t *head = (header_t *)buffer;
+	memset(head, 0, sizeof(header_t));
+	head->command  = command;
+	head->source   = source;
+	head->size     = len;
+	head->streamid = streamid;
+	if (len)
+		memcpy(buffer + sizeof(header_t), content, len);
+
+	int msgsize = sizeof(header_t) + len;
+	int rlen = 0;
+	SWBaseSocket::SWBaseError error;
+	if (mutex) pthread_mutex_lock(mutex);
+	while (rlen < msgsize)
+	{
+		int sendnum = socket->send(buffer + rlen, msgsize - rlen, &error);
+		if (sendnum < 0)
+		{
+			if (mutex) pthread_mutex_unlock(mutex);
+			return -1;
+		}
+		rlen += sendnum;
+	}
+	if (mutex) pthread_mutex_unlock(mutex);
+	return 0;
+}
+
+#define NLG_RECV_TIMEOUT  -4   //!< nothing arrived within the socket timeout, the stream is still in sync
+#define NLG_RECV_RETRIES  10   //!< socket timeouts that are waited for the rest of a message that already started
+
+/**
+ * Reads exactly len bytes. If canTimeout is set and not a single byte arrived within the socket timeout,
+ * NLG_RECV_TIMEOUT is returned. Once a byte was read, timeouts are retried so the stream does not lose sync.
+ * Returns 0 on success and -1 if the connection was lost.
+ */
+inline int nlgReceiveBytes(SWBaseSocket *socket, char *buffer, int len, bool canTimeout)
+{
+	SWBaseSocket::SWBaseError error;
+	int got = 0, timeouts = 0;
+	while (got < len)
+	{
+		int recvnum = socket->recv(buffer + got, len - got, &error);
+		if (recvnum > 0)
+		{
+			got += recvnum;
+			timeouts = 0;
+			continue;
+		}
+		if (error != SWBaseSocket::timeout)
+			return -1;
+		if (canTimeout && !got)
+			return NLG_RECV_TIMEOUT;
+		if (++timeouts >= NLG_RECV_RETRIES)
+			return -1;
+	}
+	return 0;
+}
+
+/**
+ * Reads one protocol message, the payload is written into content (which must hold MAX_MESSAGE_LENGTH bytes).
+ * Returns 0 on success, NLG_RECV_TIMEOUT if the socket has a timeout and no message started within it,
+ * any other value if the connection was lost or the message is invalid.
+ */
+inline int nlgReceiveMessage(SWBaseSocket *socket, header_t *head, char *content)
+{
+	int res = nlgReceiveBytes(socket, (char *)head, sizeof(header_t), true);
+	if (res)
+		return res;
+
+	if (head->size >= MAX_MESSAGE_LENGTH)
+		return -3;
+
+	if (nlgReceiveBytes(socket, content, head->size, false))
+		return -1;
+	content[head->size] = 0;
+	return 0;
+}
+
+#endif // __NetLoadUtils_H_
@@ -0,0 +1,200 @@
+/*
+This source file is part of Rigs of Rods
+Copyright 2005-2012 Pierre-Michel Ricordel
+Copyright 2007-2012 Thomas Fischer
+
+For more information, see http://www.rigsofrods.com/
+
+Rigs of Rods is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License version 3, as
+published by the Free Software Foundation.
+
+Rigs of Rods is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Rigs of Rods.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// netloadgen: local multiplayer load generator
+//
+// usage examples:
+//   netloadgen local --count 50 --truck agoras.truck --nodes 120 --wheels 6
+//     starts a stand-in server on port 12000 and connects 50 fake users to it,
+//     then connect the game to 127.0.0.1:12000 to profile it under load
+//   netloadgen record --host myserver --port 12000 --out session.nlg --duration 60
+//     records the truck streams of a real server session
+//   netloadgen clients --count 50 --replay session.nlg
+//     replays the recorded truck streams from 50 fake users
+
+#include "LoadClient.h"
+#include "LoadServer.h"
+
+void *s_loadserverthread(void *vserver)
+{
+	((LoadServer *)vserver)->run();
+	return NULL;
+}
+
+void usage(const char *name)
+{
+	printf("usage: %s <server|clients|local|record> [options]\n", name);
+	printf("  --host <host>          server to connect to (default 127.0.0.1)\n");
+	printf("  --port <port>          server port (default 12000)\n");
+	printf("  --terrain <name>       terrain the stand-in server announces (default simple2)\n");
+	printf("  --count <n>            number of fake users (default 10)\n");
+	printf("  --ramp <ms>            delay between two user connects (default 200)\n");
+	printf("  --truck <file>         truck file the fake users register (default semi.truck)\n");
+	printf("  --nodes <n>            non-wheel nodes of that truck (default 100)\n");
+	printf("  --wheels <n>           wheels of that truck (default 4)\n");
+	printf("  --rate <hz>            truck packets per second (default 10)\n");
+	printf("  --character-rate <hz>  character packets per second (default 10)\n");
+	printf("  --no-truck             do not register truck streams\n");
+	printf("  --no-character         do not register character streams\n");
+	printf("  --replay <file>        replay truck streams from a recording\n");
+	printf("  --out <file>           output file for record mode\n");
+	printf("  --duration <s>         run time in seconds, 0 = forever (default 0, record: 60)\n");
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2)
+	{
+		usage(argv[0]);
+		return 1;
+	}
+	std::string mode = argv[1];
+
+	load_client_config_t cfg;
+	cfg.host           = "127.0.0.1";
+	cfg.port           = 12000;
+	cfg.truck          = "semi.truck";
+	cfg.nodes          = 100;
+	cfg.wheels         = 4;
+	cfg.truck_rate     = 10.0f;
+	cfg.character_rate = 10.0f;
+	cfg.with_truck     = true;
+	cfg.with_character = true;
+	cfg.replay         = 0;
+
+	std::string terrain = "simple2";
+	std::string replayfile, outfile;
+	int count = 10, ramp = 200, duration = 0;
+
+	for (int i = 2; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool hasValue = (i + 1 < argc);
+		if      (arg == "--host"           && hasValue) cfg.host           = argv[++i];
+		else if (arg == "--port"           && hasValue) cfg.port           = atoi(argv[++i]);
+		else if (arg == "--terrain"        && hasValue) terrain            = argv[++i];
+		else if (arg == "--count"          && hasValue) count              = atoi(argv[++i]);
+		else if (arg == "--ramp"           && hasValue) ramp               = atoi(argv[++i]);
+		else if (arg == "--truck"          && hasValue) cfg.truck          = argv[++i];
+		else if (arg == "--nodes"          && hasValue) cfg.nodes          = std::max(1, atoi(argv[++i]));
+		else if (arg == "--wheels"         && hasValue) cfg.wheels         = std::max(0, atoi(argv[++i]));
+		else if (arg == "--rate"           && hasValue) cfg.truck_rate     = (float)atof(argv[++i]);
+		else if (arg == "--character-rate" && hasValue) cfg.character_rate = (float)atof(argv[++i]);
+		else if (arg == "--replay"         && hasValue) replayfile         = argv[++i];
+		else if (arg == "--out"            && hasValue) outfile            = argv[++i];
+		else if (arg == "--duration"       && hasValue) duration           = atoi(argv[++i]);
+		else if (arg == "--no-truck")                   cfg.with_truck     = false;
+		else if (arg == "--no-character")               cfg.with_character = false;
+		else
+		{
+			printf("unknown argument: %s\n", arg.c_str());
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (mode == "record")
+	{
+		if (outfile.empty())
+		{
+			printf("record mode needs --out\n");
+			return 1;
+		}
+		return recordStreams(cfg.host, cfg.port, outfile, duration > 0 ? duration : 60);
+	}
+
+	LoadServer *server = 0;
+	pthread_t serverthread;
+	if (mode == "server" || mode == "local")
+	{
+		server = new LoadServer(cfg.port, terrain);
+		if (!server->start())
+			return 1;
+
+		if (mode == "server")
+		{
+			server->run();
+			delete server;
+			return 0;
+		}
+		pthread_create(&serverthread, NULL, s_loadserverthread, (void *)server);
+		cfg.host = "127.0.0.1";
+	} else if (mode != "clients")
+	{
+		usage(argv[0]);
+		return 1;
+	}
+
+	std::vector<recorded_packet_t> recording;
+	if (!replayfile.empty())
+	{
+		if (!loadRecording(replayfile, recording))
+			return 1;
+		cfg.replay = &recording;
+	}
+
+	std::vector<LoadClient *> clients;
+	for (int i = 0; i < count; i++)
+	{
+		LoadClient *c = new LoadClient(i, &cfg);
+		if (!c->connect())
+		{
+			delete c;
+			continue;
+		}
+		clients.push_back(c);
+		printf("client %d connected\n", i);
+		nlgSleep(ramp);
+	}
+	printf("%d of %d users connected\n", (int)clients.size(), count);
+
+	unsigned long start = nlgGetTime();
+	unsigned long lastReport = start;
+	unsigned long lastSent = 0, lastRecv = 0;
+	while (duration <= 0 || nlgGetTime() - start < (unsigned long)duration * 1000)
+	{
+		nlgSleep(1000);
+		unsigned long now = nlgGetTime();
+		if (now - lastReport < 5000) continue;
+
+		unsigned long sent = 0, recv = 0;
+		for (size_t i = 0; i < clients.size(); i++)
+		{
+			sent += clients[i]->getBytesSent();
+			recv += clients[i]->getBytesReceived();
+		}
+		float secs = (now - lastReport) / 1000.0f;
+		printf("%d users: %.1f kB/s up, %.1f kB/s down\n", (int)clients.size(), (sent - lastSent) / 1024.0f / secs, (recv - lastRecv) / 1024.0f / secs);
+		lastSent   = sent;
+		lastRecv   = recv;
+		lastReport = now;
+	}
+
+	for (size_t i = 0; i < clients.size(); i++)
+		delete clients[i];
+
+	if (server)
+	{
+		server->stop();
+		pthread_join(serverthread, NULL);
+		delete server;
+	}
+	return 0;
+}